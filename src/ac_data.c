@@ -20,41 +20,105 @@
 #include <stdint.h>
 #include <stdio.h>
 #include "config.h"         // WITH_SQLITE
-#include "dumpvdl2.h"       // NEW(), XFREE(), statsd_increment()
+#include "dumpvdl2.h"       // NEW(), XFREE()
+#include "metrics.h"        // metrics_inc(), metrics_set()
 #include "ac_data.h"        // ac_data_entry
 
 #ifdef WITH_SQLITE
 #include <stdbool.h>
-#include <string.h>         // strdup
-#include <time.h>           // time_t, time()
+#include <stdlib.h>         // qsort, strtoul
+#include <string.h>         // strdup, memcpy
+#include <time.h>           // time_t, time(), clock_gettime
+#include <stdatomic.h>      // atomic_*
+#include <errno.h>          // errno
+#include <sys/stat.h>       // stat
+#include <pthread.h>        // pthread_mutex_*, pthread_cond_*
+#include <glib.h>           // GAsyncQueue, g_async_queue_*
 #include <libacars/dict.h>  // la_dict
 #include <libacars/hash.h>  // la_hash_*
 #include <sqlite3.h>
 #include "gs_data.h"        // uint_hash, uint_compare
 
-static la_hash *ac_data_cache = NULL;
-static time_t last_gc_time = 0L;
-static size_t ac_cache_entry_count = 0;
-
-typedef struct {
-	time_t ctime;
+typedef struct ac_data_cache_entry {
+	struct ac_data_cache_entry *prev, *next;    // LRU list links
+	time_t atime;               // time of the last lookup (or of the DB query)
 	ac_data_entry *ac_data;
+	size_t size;                // approximate memory footprint
+	uint32_t addr;
+	bool pending;               // DB query in progress, ac_data not known yet
 } ac_data_cache_entry;
 
 #define AC_CACHE_TTL 1800L
-#define AC_CACHE_GC_INTERVAL 305L
+// Number of least recently used entries checked for expiry on each lookup
+#define AC_CACHE_EXPIRE_BATCH 4
+// Don't queue more prefetch requests when the worker is that much behind
+#define AC_PREFETCH_MAX_PENDING 32
 
-#define AC_CACHE_ENTRY_COUNT_ADD(x) do { \
-	if((x) < 0 && ac_cache_entry_count < (unsigned long)(-(x))) { \
-		ac_cache_entry_count = 0; \
-	} else { \
-		ac_cache_entry_count += (x); \
-	} \
-	statsd_set("ac_data.cache.entries", ac_cache_entry_count); \
-} while(0)
+// Resolved cache entries are kept on a list ordered from the least recently
+// used one (head) to the most recently used one (tail). A hit refreshes the
+// access time of the entry, so the list is ordered by it and entries which
+// have not been used for AC_CACHE_TTL are found at the head. Each lookup
+// expires a few of them, so that unused entries are purged gradually
+// instead of in a periodic pass over the whole cache. The head is also
+// evicted when the cache exceeds its size limits. Pending entries are not
+// on the list and they don't count towards the entry limit.
+static la_hash *ac_data_cache = NULL;
+static ac_data_cache_entry *lru_head = NULL;
+static ac_data_cache_entry *lru_tail = NULL;
+static size_t ac_cache_entry_count = 0;
+static size_t ac_cache_pending_count = 0;
+static size_t ac_cache_memory = 0;
+static size_t ac_cache_max_entries = AC_CACHE_MAX_ENTRIES_DEFAULT;
+static size_t ac_cache_max_memory = AC_CACHE_MAX_MEMORY_DEFAULT;
+
+// Database queries are performed by a worker thread, which is the only user
+// of the prepared statement after initialization. Cache misses are queued to
+// it as requests and entries waiting for the result are marked as pending.
+// Addresses are queued as addr + 1, because NULL can't be pushed to the queue.
+#define AC_DATA_REQ_SHUTDOWN 0xFFFFFFFFu
 
 static sqlite3 *db = NULL;
 static sqlite3_stmt *stmt = NULL;
+static GAsyncQueue *ac_data_requests = NULL;
+static pthread_t ac_data_worker;
+
+// Protects the cache and the snapshot pointer. Lookups may be performed by
+// several decoder threads at once, while the worker thread resolves entries
+// and cache maintenance removes them. Hence each returned entry carries a
+// reference, which keeps it alive after it leaves the cache, until the frame
+// holding it is destroyed.
+static pthread_mutex_t ac_data_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Signaled by the worker thread whenever a pending entry gets resolved
+static pthread_cond_t ac_data_resolved = PTHREAD_COND_INITIALIZER;
+// How long a lookup waits for a pending entry (milliseconds, 0 = don't wait)
+static int ac_lookup_wait_ms = 0;
+
+// Snapshot mode (--bs-db-preload).
+// The Aircraft table is loaded into memory as a whole. ICAO addresses are
+// stored in a sorted array, which is binary searched on lookup. Entries are
+// stored in a parallel array and their strings are interned in a single
+// string pool, so that repeated values (type codes, operators, etc) are
+// stored only once. The worker thread checks the database file periodically
+// and reloads the snapshot if the file has changed.
+#define AC_SNAPSHOT_CHECK_INTERVAL 60L
+#define AC_SNAPSHOT_FIELD_CNT 6
+
+typedef struct ac_data_snapshot {
+	uint32_t *addrs;            // sorted ICAO addresses
+	ac_data_entry *entries;     // entries[i] describes addrs[i]
+	char *strings;              // string pool referenced by entries
+	size_t count;
+	size_t strings_len;
+	time_t mtime;               // modification time and size of the database
+	off_t size;                 // file when the snapshot has been taken
+	atomic_int refcnt;          // held by the module while current and by each returned entry
+} ac_data_snapshot;
+
+static char *ac_db_file = NULL;
+static bool use_snapshot = false;
+// Current snapshot. A replaced snapshot is freed when the last entry
+// returned from it is released. Protected by ac_data_mutex.
+static ac_data_snapshot *snapshot = NULL;
 
 static void ac_data_entry_destroy(void *data) {
 	if(data == NULL) {
@@ -70,23 +134,136 @@ static void ac_data_entry_destroy(void *data) {
 	XFREE(e);
 }
 
+static void ac_data_snapshot_release(ac_data_snapshot *snap);
+
+// Drops a reference to an entry returned by ac_data_entry_lookup()
+void ac_data_entry_release(ac_data_entry *e) {
+	if(e == NULL) {
+		return;
+	}
+	if(e->snapshot != NULL) {
+		ac_data_snapshot_release(e->snapshot);
+	} else if(atomic_fetch_sub(&e->refcnt, 1) == 1) {
+		ac_data_entry_destroy(e);
+	}
+}
+
 static void ac_data_cache_entry_destroy(void *data) {
 	if(data == NULL) {
 		return;
 	}
 	ac_data_cache_entry *ce = data;
-	ac_data_entry_destroy(ce->ac_data);
+	// Frames might still hold the entry
+	ac_data_entry_release(ce->ac_data);
 	XFREE(ce);
 }
 
-static void ac_data_cache_entry_create(uint32_t addr, ac_data_entry *ac_entry) {
+static size_t ac_data_entry_size(ac_data_entry const *e) {
+	if(e == NULL) {
+		return 0;
+	}
+	size_t size = sizeof(ac_data_entry);
+	char const *fields[] = {
+		e->registration, e->icaotypecode, e->operatorflagcode,
+		e->manufacturer, e->type, e->registeredowners
+	};
+	for(size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+		if(fields[i] != NULL) {
+			size += strlen(fields[i]) + 1;
+		}
+	}
+	return size;
+}
+
+static void ac_data_cache_stats_update() {
+	metrics_set(MG_AC_DATA_CACHE_ENTRIES, ac_cache_entry_count);
+	metrics_set(MG_AC_DATA_CACHE_MEMORY, ac_cache_memory);
+}
+
+static void lru_unlink(ac_data_cache_entry *ce) {
+	if(ce->prev != NULL) {
+		ce->prev->next = ce->next;
+	} else {
+		lru_head = ce->next;
+	}
+	if(ce->next != NULL) {
+		ce->next->prev = ce->prev;
+	} else {
+		lru_tail = ce->prev;
+	}
+	ce->prev = ce->next = NULL;
+}
+
+static void lru_append(ac_data_cache_entry *ce) {
+	ce->prev = lru_tail;
+	ce->next = NULL;
+	if(lru_tail != NULL) {
+		lru_tail->next = ce;
+	} else {
+		lru_head = ce;
+	}
+	lru_tail = ce;
+}
+
+static void ac_data_cache_remove_locked(ac_data_cache_entry *ce) {
+	if(ce->pending == false) {
+		lru_unlink(ce);
+	} else {
+		ac_cache_pending_count--;
+	}
+	ac_cache_entry_count--;
+	ac_cache_memory -= ce->size;
+	uint32_t addr = ce->addr;
+	la_hash_remove(ac_data_cache, &addr);
+}
+
+static bool is_cache_entry_expired(ac_data_cache_entry const *ce, time_t now) {
+	// Pending entries must stay in place until the worker thread resolves them
+	return (ce->pending == false && ce->atime + AC_CACHE_TTL <= now);
+}
+
+// Removes at most AC_CACHE_EXPIRE_BATCH expired entries from the LRU list head
+static void ac_data_cache_expire_locked(time_t now) {
+	int expired_cnt = 0;
+	while(lru_head != NULL && expired_cnt < AC_CACHE_EXPIRE_BATCH && is_cache_entry_expired(lru_head, now)) {
+		debug_print(D_CACHE, "%06X: expired cache entry (atime %ld)\n", lru_head->addr, lru_head->atime);
+		ac_data_cache_remove_locked(lru_head);
+		expired_cnt++;
+	}
+	if(expired_cnt > 0) {
+		ac_data_cache_stats_update();
+	}
+}
+
+// Evicts least recently used entries until the cache fits in its limits
+static void ac_data_cache_shrink_locked() {
+	while(lru_head != NULL && ((ac_cache_max_entries > 0 &&
+					ac_cache_entry_count - ac_cache_pending_count > ac_cache_max_entries) ||
+				(ac_cache_max_memory > 0 && ac_cache_memory > ac_cache_max_memory))) {
+		debug_print(D_CACHE, "%06X: evicting cache entry\n", lru_head->addr);
+		ac_data_cache_remove_locked(lru_head);
+		metrics_inc(M_AC_DATA_CACHE_EVICTIONS);
+	}
+}
+
+// Creates a pending cache entry and queues a DB query for it
+static ac_data_cache_entry *ac_data_request_locked(uint32_t addr, time_t now) {
 	NEW(ac_data_cache_entry, ce);
-	ce->ctime = time(NULL);
-	ce->ac_data = ac_entry;
+	ce->atime = now;
+	ce->ac_data = NULL;
+	ce->addr = addr;
+	ce->size = sizeof(ac_data_cache_entry) + sizeof(uint32_t);
+	ce->pending = true;
 	NEW(uint32_t, key);
 	*key = addr;
 	la_hash_insert(ac_data_cache, key, ce);
-	AC_CACHE_ENTRY_COUNT_ADD(1);
+	ac_cache_entry_count++;
+	ac_cache_pending_count++;
+	ac_cache_memory += ce->size;
+	ac_data_cache_stats_update();
+	metrics_inc(M_AC_DATA_CACHE_MISSES);
+	g_async_queue_push(ac_data_requests, GUINT_TO_POINTER(addr + 1));
+	return ce;
 }
 
 #define BS_DB_COLUMNS "Registration,ICAOTypeCode,OperatorFlagCode,Manufacturer,Type,RegisteredOwners"
@@ -104,13 +281,13 @@ static int ac_data_entry_from_db(uint32_t addr, ac_data_entry **result) {
 	int rc = sqlite3_reset(stmt);
 	if(rc != SQLITE_OK) {
 		debug_print(D_CACHE, "sqlite3_reset() returned error %d\n", rc);
-		statsd_increment("ac_data.db.errors");
+		metrics_inc(M_AC_DATA_DB_ERRORS);
 		return rc;
 	}
 	rc = sqlite3_bind_text(stmt, 1, hex_addr, -1, SQLITE_STATIC);
 	if(rc != SQLITE_OK) {
 		debug_print(D_CACHE, "sqlite3_bind_text('%s') returned error %d\n", hex_addr, rc);
-		statsd_increment("ac_data.db.errors");
+		metrics_inc(M_AC_DATA_DB_ERRORS);
 		return rc;
 	}
 	rc = sqlite3_step(stmt);
@@ -120,13 +297,14 @@ static int ac_data_entry_from_db(uint32_t addr, ac_data_entry **result) {
 			return -3;
 		}
 		rc = SQLITE_OK;
-		statsd_increment("ac_data.db.hits");
+		metrics_inc(M_AC_DATA_DB_HITS);
 		if(result == NULL) {
 			// The caller only wants the result code, not the data
 			return rc;
 		}
-		// Create positive cache entry
 		NEW(ac_data_entry, e);
+		// Reference held by the cache
+		atomic_init(&e->refcnt, 1);
 		char const *field = NULL;
 		if((field = (char *)sqlite3_column_text(stmt, 0)) != NULL) e->registration = strdup(field);
 		if((field = (char *)sqlite3_column_text(stmt, 1)) != NULL) e->icaotypecode = strdup(field);
@@ -134,84 +312,361 @@ static int ac_data_entry_from_db(uint32_t addr, ac_data_entry **result) {
 		if((field = (char *)sqlite3_column_text(stmt, 3)) != NULL) e->manufacturer = strdup(field);
 		if((field = (char *)sqlite3_column_text(stmt, 4)) != NULL) e->type = strdup(field);
 		if((field = (char *)sqlite3_column_text(stmt, 5)) != NULL) e->registeredowners = strdup(field);
-		ac_data_cache_entry_create(addr, e);
 		*result = e;
 	} else if(rc == SQLITE_DONE) {
-		// Create negative cache entry
-		ac_data_cache_entry_create(addr, NULL);
 		// Empty result is not an error
 		rc = SQLITE_OK;
-		statsd_increment("ac_data.db.misses");
+		metrics_inc(M_AC_DATA_DB_MISSES);
 		if(result != NULL) {
 			*result = NULL;
 		}
 	} else {
 		debug_print(D_CACHE, "%s: unexpected query return code %d\n", hex_addr, rc);
-		statsd_increment("ac_data.db.errors");
+		metrics_inc(M_AC_DATA_DB_ERRORS);
 	}
 	return rc;
 }
 
-bool is_cache_entry_expired(void const *key, void const *value, void *ctx) {
-	UNUSED(key);
-	ac_data_cache_entry const *cache_entry = value;
-	time_t now = *(time_t *)ctx;
-	return (cache_entry->ctime + AC_CACHE_TTL <= now);
+static void *ac_data_worker_thread(void *arg) {
+	UNUSED(arg);
+	uint32_t req = 0;
+	while((req = GPOINTER_TO_UINT(g_async_queue_pop(ac_data_requests))) != AC_DATA_REQ_SHUTDOWN) {
+		uint32_t addr = req - 1;
+		ac_data_entry *e = NULL;
+		int rc = ac_data_entry_from_db(addr, &e);
+
+		pthread_mutex_lock(&ac_data_mutex);
+		ac_data_cache_entry *ce = la_hash_lookup(ac_data_cache, &addr);
+		ASSERT(ce != NULL && ce->pending == true);
+		if(rc == SQLITE_OK) {
+			// Positive or negative cache entry, depending on whether the address has been found
+			debug_print(D_CACHE, "%06X: %sfound in BS DB\n", addr, e ? "" : "not ");
+			ce->ac_data = e;
+			ce->atime = time(NULL);
+			ce->pending = false;
+			ac_cache_pending_count--;
+			size_t size = ac_data_entry_size(e);
+			ce->size += size;
+			ac_cache_memory += size;
+			lru_append(ce);
+			ac_data_cache_shrink_locked();
+		} else {
+			// Don't cache errors - next lookup will retry the query
+			debug_print(D_CACHE, "%06X: not found\n", addr);
+			ac_data_cache_remove_locked(ce);
+		}
+		ac_data_cache_stats_update();
+		pthread_cond_broadcast(&ac_data_resolved);
+		pthread_mutex_unlock(&ac_data_mutex);
+	}
+	return NULL;
+}
+
+// Waits until the pending entry for addr is resolved or until
+// ac_lookup_wait_ms elapses, whichever comes first. Returns the entry or NULL
+// if it's gone (the query has failed or the entry has been evicted).
+static ac_data_cache_entry *ac_data_wait_resolved_locked(uint32_t addr) {
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += ac_lookup_wait_ms / 1000;
+	deadline.tv_nsec += (long)(ac_lookup_wait_ms % 1000) * 1000000L;
+	if(deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+	ac_data_cache_entry *ce = NULL;
+	int rc = 0;
+	do {
+		rc = pthread_cond_timedwait(&ac_data_resolved, &ac_data_mutex, &deadline);
+		ce = la_hash_lookup(ac_data_cache, &addr);
+	} while(ce != NULL && ce->pending == true && rc != ETIMEDOUT);
+	return ce;
 }
 
-ac_data_entry *ac_data_entry_lookup(uint32_t addr) {
-	if(ac_data_cache == NULL) {
+typedef struct {
+	uint32_t addr;
+	uint32_t fields[AC_SNAPSHOT_FIELD_CNT];     // string pool offset + 1 or 0 for NULL
+} ac_data_snapshot_row;
+
+typedef struct {
+	char *buf;
+	size_t len;
+	size_t size;
+	la_hash *index;             // string -> offset
+} ac_data_string_pool;
+
+static uint32_t ac_data_string_pool_add(ac_data_string_pool *pool, char const *str) {
+	if(str == NULL) {
+		return 0;
+	}
+	uint32_t *offset = la_hash_lookup(pool->index, str);
+	if(offset != NULL) {
+		return *offset + 1;
+	}
+	size_t len = strlen(str) + 1;
+	if(pool->len + len > pool->size) {
+		while(pool->len + len > pool->size) {
+			pool->size = pool->size > 0 ? 2 * pool->size : 65536;
+		}
+		pool->buf = XREALLOC(pool->buf, pool->size);
+	}
+	memcpy(pool->buf + pool->len, str, len);
+	NEW(uint32_t, new_offset);
+	*new_offset = (uint32_t)pool->len;
+	la_hash_insert(pool->index, strdup(str), new_offset);
+	pool->len += len;
+	return *new_offset + 1;
+}
+
+static int ac_data_snapshot_row_compare(void const *a, void const *b) {
+	uint32_t addr1 = ((ac_data_snapshot_row const *)a)->addr;
+	uint32_t addr2 = ((ac_data_snapshot_row const *)b)->addr;
+	return addr1 < addr2 ? -1 : (addr1 > addr2 ? 1 : 0);
+}
+
+static void ac_data_snapshot_destroy(ac_data_snapshot *snap) {
+	if(snap == NULL) {
+		return;
+	}
+	XFREE(snap->addrs);
+	XFREE(snap->entries);
+	XFREE(snap->strings);
+	XFREE(snap);
+}
+
+static void ac_data_snapshot_release(ac_data_snapshot *snap) {
+	if(snap != NULL && atomic_fetch_sub(&snap->refcnt, 1) == 1) {
+		ac_data_snapshot_destroy(snap);
+	}
+}
+
+static ac_data_snapshot *ac_data_snapshot_load(char const *file) {
+	struct stat st;
+	if(stat(file, &st) < 0) {
+		fprintf(stderr, "%s: could not stat file: %s\n", file, strerror(errno));
 		return NULL;
 	}
+	sqlite3 *sdb = NULL;
+	sqlite3_stmt *sstmt = NULL;
+	ac_data_snapshot *snap = NULL;
+	ac_data_snapshot_row *rows = NULL;
+	ac_data_string_pool pool = {
+		.index = la_hash_new(la_hash_key_str, la_hash_compare_keys_str, la_simple_free, la_simple_free)
+	};
+	size_t row_cnt = 0, rows_size = 0;
 
-	// Periodic cache expiration
-	time_t now = time(NULL);
-	if(last_gc_time + AC_CACHE_GC_INTERVAL <= now) {
-		int expired_cnt = la_hash_foreach_remove(ac_data_cache, is_cache_entry_expired, &now);
-		debug_print(D_CACHE, "last_gc: %ld, now: %ld, expired %d cache entries\n", last_gc_time, now, expired_cnt);
-		AC_CACHE_ENTRY_COUNT_ADD(-expired_cnt);
-		last_gc_time = now;
+	int rc = sqlite3_open_v2(file, &sdb, SQLITE_OPEN_READONLY, NULL);
+	if(rc != SQLITE_OK) {
+		fprintf(stderr, "Can't open database %s: %s\n", file, sqlite3_errmsg(sdb));
+		goto end;
+	}
+	rc = sqlite3_prepare_v2(sdb, "SELECT ModeS," BS_DB_COLUMNS " FROM Aircraft", -1, &sstmt, NULL);
+	if(rc != SQLITE_OK) {
+		fprintf(stderr, "%s: could not query Aircraft table: %s\n", file, sqlite3_errmsg(sdb));
+		goto end;
+	}
+	while((rc = sqlite3_step(sstmt)) == SQLITE_ROW) {
+		char const *modes = (char const *)sqlite3_column_text(sstmt, 0);
+		if(modes == NULL) {
+			continue;
+		}
+		char *endptr = NULL;
+		unsigned long addr = strtoul(modes, &endptr, 16);
+		if(endptr == modes || *endptr != '\0' || addr > 0xFFFFFFUL) {
+			debug_print(D_CACHE, "skipping invalid ModeS value '%s'\n", modes);
+			continue;
+		}
+		if(row_cnt == rows_size) {
+			rows_size = rows_size > 0 ? 2 * rows_size : 4096;
+			rows = XREALLOC(rows, rows_size * sizeof(ac_data_snapshot_row));
+		}
+		ac_data_snapshot_row *row = rows + row_cnt++;
+		row->addr = (uint32_t)addr;
+		for(int i = 0; i < AC_SNAPSHOT_FIELD_CNT; i++) {
+			row->fields[i] = ac_data_string_pool_add(&pool, (char const *)sqlite3_column_text(sstmt, i + 1));
+		}
 	}
+	if(rc != SQLITE_DONE) {
+		fprintf(stderr, "%s: error while reading Aircraft table: %s\n", file, sqlite3_errmsg(sdb));
+		goto end;
+	}
+	qsort(rows, row_cnt, sizeof(ac_data_snapshot_row), ac_data_snapshot_row_compare);
 
-	ac_data_cache_entry *ce = la_hash_lookup(ac_data_cache, &addr);
-	if(ce != NULL) {
-		time_t now = time(NULL);
-		if(is_cache_entry_expired(&addr, ce, &now)) {
-			debug_print(D_CACHE, "%06X: expired cache entry (ctime %ld)\n", addr, ce->ctime);
-			la_hash_remove(ac_data_cache, &addr);
-			AC_CACHE_ENTRY_COUNT_ADD(-1);
+	snap = XCALLOC(1, sizeof(ac_data_snapshot));
+	snap->addrs = XCALLOC(row_cnt > 0 ? row_cnt : 1, sizeof(uint32_t));
+	snap->entries = XCALLOC(row_cnt > 0 ? row_cnt : 1, sizeof(ac_data_entry));
+	snap->strings = pool.buf;
+	snap->strings_len = pool.len;
+	snap->mtime = st.st_mtime;
+	snap->size = st.st_size;
+	atomic_init(&snap->refcnt, 1);
+	pool.buf = NULL;
+	for(size_t i = 0; i < row_cnt; i++) {
+		// ModeS should be unique, but it's not enforced by the schema
+		if(snap->count > 0 && snap->addrs[snap->count - 1] == rows[i].addr) {
+			continue;
+		}
+		char *fields[AC_SNAPSHOT_FIELD_CNT];
+		for(int j = 0; j < AC_SNAPSHOT_FIELD_CNT; j++) {
+			fields[j] = rows[i].fields[j] > 0 ? snap->strings + rows[i].fields[j] - 1 : NULL;
+		}
+		snap->addrs[snap->count] = rows[i].addr;
+		snap->entries[snap->count] = (ac_data_entry){
+			.registration = fields[0],
+			.icaotypecode = fields[1],
+			.operatorflagcode = fields[2],
+			.manufacturer = fields[3],
+			.type = fields[4],
+			.registeredowners = fields[5],
+			.snapshot = snap
+		};
+		snap->count++;
+	}
+	fprintf(stderr, "%s: loaded %zu aircraft (%zu bytes of strings)\n", file, snap->count, snap->strings_len);
+	metrics_set(MG_AC_DATA_SNAPSHOT_ENTRIES, snap->count);
+end:
+	XFREE(rows);
+	XFREE(pool.buf);
+	la_hash_destroy(pool.index);
+	sqlite3_finalize(sstmt);
+	sqlite3_close(sdb);
+	return snap;
+}
+
+static ac_data_entry *ac_data_snapshot_lookup(ac_data_snapshot const *snap, uint32_t addr) {
+	size_t lo = 0, hi = snap->count;
+	while(lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if(snap->addrs[mid] < addr) {
+			lo = mid + 1;
 		} else {
-			statsd_increment("ac_data.cache.hits");
-			debug_print(D_CACHE, "%06X: %s cache hit\n", addr, ce->ac_data ? "positive" : "negative");
-			return ce->ac_data;
+			hi = mid;
 		}
 	}
-	// Cache entry missing or expired. Fetch it from DB.
-	statsd_increment("ac_data.cache.misses");
-	ac_data_entry *e = NULL;
-	if(ac_data_entry_from_db(addr, &e) == SQLITE_OK) {
-		debug_print(D_CACHE, "%06X: %sfound in BS DB\n", addr, e ? "" : "not ");
-		return e;
+	if(lo < snap->count && snap->addrs[lo] == addr) {
+		return &snap->entries[lo];
 	}
-	debug_print(D_CACHE, "%06X: not found\n", addr);
 	return NULL;
 }
 
-#ifdef WITH_STATSD
-static char *ac_data_counters[] = {
-	"ac_data.cache.hits",
-	"ac_data.cache.misses",
-	"ac_data.db.hits",
-	"ac_data.db.misses",
-	"ac_data.db.errors",
-	NULL
-};
-#endif
-
-int ac_data_init(char const *bs_db_file) {
+static void *ac_data_snapshot_reloader_thread(void *arg) {
+	UNUSED(arg);
+	while(GPOINTER_TO_UINT(g_async_queue_timeout_pop(ac_data_requests,
+					AC_SNAPSHOT_CHECK_INTERVAL * G_USEC_PER_SEC)) != AC_DATA_REQ_SHUTDOWN) {
+		struct stat st;
+		if(stat(ac_db_file, &st) < 0 || (st.st_mtime == snapshot->mtime && st.st_size == snapshot->size)) {
+			continue;
+		}
+		fprintf(stderr, "%s: file has changed, reloading\n", ac_db_file);
+		ac_data_snapshot *snap = ac_data_snapshot_load(ac_db_file);
+		if(snap == NULL) {
+			fprintf(stderr, "%s: reload failed, keeping the current data\n", ac_db_file);
+			metrics_inc(M_AC_DATA_SNAPSHOT_RELOAD_ERRORS);
+			continue;
+		}
+		pthread_mutex_lock(&ac_data_mutex);
+		ac_data_snapshot *old = snapshot;
+		snapshot = snap;
+		pthread_mutex_unlock(&ac_data_mutex);
+		// Entries returned from the old snapshot keep it alive
+		ac_data_snapshot_release(old);
+		metrics_inc(M_AC_DATA_SNAPSHOT_RELOADS);
+	}
+	return NULL;
+}
+
+ac_data_entry *ac_data_entry_lookup(uint32_t addr) {
+	if(use_snapshot) {
+		pthread_mutex_lock(&ac_data_mutex);
+		ac_data_snapshot *snap = snapshot;
+		atomic_fetch_add(&snap->refcnt, 1);
+		pthread_mutex_unlock(&ac_data_mutex);
+		ac_data_entry *e = ac_data_snapshot_lookup(snap, addr);
+		if(e == NULL) {
+			ac_data_snapshot_release(snap);
+		}
+		return e;
+	}
+	if(ac_data_cache == NULL) {
+		return NULL;
+	}
+	time_t now = time(NULL);
+	pthread_mutex_lock(&ac_data_mutex);
+	ac_data_cache_expire_locked(now);
+
+	ac_data_cache_entry *ce = la_hash_lookup(ac_data_cache, &addr);
+	if(ce != NULL && is_cache_entry_expired(ce, now)) {
+		debug_print(D_CACHE, "%06X: expired cache entry (atime %ld)\n", addr, ce->atime);
+		ac_data_cache_remove_locked(ce);
+		ac_data_cache_stats_update();
+		ce = NULL;
+	}
+	if(ce == NULL) {
+		// Cache entry missing or expired. Fetch it from DB.
+		ce = ac_data_request_locked(addr, now);
+	} else if(ce->pending == false) {
+		metrics_inc(M_AC_DATA_CACHE_HITS);
+		debug_print(D_CACHE, "%06X: %s cache hit\n", addr, ce->ac_data ? "positive" : "negative");
+		ce->atime = now;
+		lru_unlink(ce);
+		lru_append(ce);
+	}
+	if(ce->pending == true && ac_lookup_wait_ms > 0) {
+		// Either just requested or prefetched, but not resolved yet. When
+		// reading from a file, the output should not depend on how fast the
+		// database is, so give the query some time to complete.
+		ce = ac_data_wait_resolved_locked(addr);
+	}
+	ac_data_entry *e = NULL;
+	if(ce != NULL && ce->pending == true) {
+		// Don't wait for the database any longer - this frame goes without
+		// aircraft data and the worker thread fills the cache for subsequent ones.
+		metrics_inc(M_AC_DATA_LOOKUP_PENDING);
+	} else if(ce != NULL) {
+		e = ce->ac_data;
+	}
+	if(e != NULL) {
+		atomic_fetch_add(&e->refcnt, 1);
+	}
+	pthread_mutex_unlock(&ac_data_mutex);
+	return e;
+}
+
+// Starts a background DB query for the given address, unless it's
+// already cached. Never blocks on the database.
+void ac_data_entry_prefetch(uint32_t addr) {
+	// Nothing to prefetch in snapshot mode
+	if(ac_data_cache == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&ac_data_mutex);
+	if(ac_cache_pending_count < AC_PREFETCH_MAX_PENDING && la_hash_lookup(ac_data_cache, &addr) == NULL) {
+		debug_print(D_CACHE, "%06X: prefetching\n", addr);
+		ac_data_request_locked(addr, time(NULL));
+	}
+	pthread_mutex_unlock(&ac_data_mutex);
+}
+
+static int ac_data_snapshot_init(char const *bs_db_file) {
+	snapshot = ac_data_snapshot_load(bs_db_file);
+	if(snapshot == NULL) {
+		return -1;
+	}
+	ac_db_file = strdup(bs_db_file);
+	use_snapshot = true;
+	ac_data_requests = g_async_queue_new();
+	start_thread(&ac_data_worker, ac_data_snapshot_reloader_thread, NULL);
+	return 0;
+}
+
+int ac_data_init(char const *bs_db_file, bool preload, size_t cache_max_entries, size_t cache_max_memory,
+		int lookup_wait_ms) {
 	if(bs_db_file == NULL) {
 		return -1;
 	}
+	if(preload) {
+		return ac_data_snapshot_init(bs_db_file);
+	}
 	db = NULL;
 
 	int rc = sqlite3_open_v2(bs_db_file, &db, SQLITE_OPEN_READONLY, NULL);
@@ -225,32 +680,52 @@ int ac_data_init(char const *bs_db_file) {
 		goto fail;
 	}
 	ac_data_cache = la_hash_new(uint_hash, uint_compare, la_simple_free, ac_data_cache_entry_destroy);
-	last_gc_time = time(NULL);
-#ifdef WITH_STATSD
-	statsd_initialize_counter_set(ac_data_counters);
-#endif
+	ac_cache_max_entries = cache_max_entries;
+	ac_cache_max_memory = cache_max_memory;
+	ac_lookup_wait_ms = lookup_wait_ms;
 	if(ac_data_entry_from_db(0, NULL) != SQLITE_OK) {
 		fprintf(stderr, "%s: test query failed, database is unusable.\n", bs_db_file);
 		goto fail;
 	}
+	ac_data_requests = g_async_queue_new();
+	start_thread(&ac_data_worker, ac_data_worker_thread, NULL);
 	fprintf(stderr, "%s: database opened\n", bs_db_file);
 	return 0;
 fail:
 	la_hash_destroy(ac_data_cache);
+	ac_data_cache = NULL;
 	sqlite3_close(db);
 	return -1;
 }
 
 void ac_data_destroy() {
+	if(ac_data_requests != NULL) {
+		g_async_queue_push(ac_data_requests, GUINT_TO_POINTER(AC_DATA_REQ_SHUTDOWN));
+		pthread_join(ac_data_worker, NULL);
+		g_async_queue_unref(ac_data_requests);
+		ac_data_requests = NULL;
+	}
 	la_hash_destroy(ac_data_cache);
+	ac_data_cache = NULL;
+	lru_head = lru_tail = NULL;
+	ac_cache_entry_count = ac_cache_pending_count = ac_cache_memory = 0;
 	sqlite3_finalize(stmt);
 	sqlite3_close(db);
+	ac_data_snapshot_release(snapshot);
+	snapshot = NULL;
+	use_snapshot = false;
+	XFREE(ac_db_file);
 }
 
 #else // !WITH_SQLITE
 
-int ac_data_init(char const *bs_db_file) {
+int ac_data_init(char const *bs_db_file, bool preload, size_t cache_max_entries, size_t cache_max_memory,
+		int lookup_wait_ms) {
 	UNUSED(bs_db_file);
+	UNUSED(preload);
+	UNUSED(cache_max_entries);
+	UNUSED(cache_max_memory);
+	UNUSED(lookup_wait_ms);
 	return -1;
 }
 
@@ -259,6 +734,14 @@ ac_data_entry *ac_data_entry_lookup(uint32_t addr) {
 	return NULL;
 }
 
+void ac_data_entry_prefetch(uint32_t addr) {
+	UNUSED(addr);
+}
+
+void ac_data_entry_release(ac_data_entry *e) {
+	UNUSED(e);
+}
+
 void ac_data_destroy() { }
 
 #endif // WITH_SQLITE
@@ -17,8 +17,18 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifndef _AC_DATA_H
+#define _AC_DATA_H
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>      // atomic_int
 
+struct ac_data_snapshot;
+
+// Entries returned by ac_data_entry_lookup() are reference counted and stay
+// valid until released with ac_data_entry_release(), regardless of what
+// happens to the cache or the snapshot they came from in the meantime.
 typedef struct {
 	char *registration;
 	char *icaotypecode;
@@ -26,9 +36,25 @@ typedef struct {
 	char *manufacturer;
 	char *type;
 	char *registeredowners;
+	// private
+	atomic_int refcnt;                      // cache mode only
+	struct ac_data_snapshot *snapshot;      // owning snapshot (preload mode)
 } ac_data_entry;
 
+#define AC_CACHE_MAX_ENTRIES_DEFAULT 50000
+// A smaller cache would evict entries of active aircraft before they are
+// used again, wasting DB queries
+#define AC_CACHE_MIN_ENTRIES 100
+#define AC_CACHE_MAX_MEMORY_DEFAULT (16 * 1024 * 1024)
+// How long a lookup waits for a pending DB query when reading from a file.
+// Live inputs never wait.
+#define AC_LOOKUP_WAIT_OFFLINE_MS 1000
+
 // ac_file.c
-int ac_data_init(char const *bs_db_file);
+int ac_data_init(char const *bs_db_file, bool preload, size_t cache_max_entries, size_t cache_max_memory,
+		int lookup_wait_ms);
 void ac_data_destroy();
 ac_data_entry *ac_data_entry_lookup(uint32_t addr);
+void ac_data_entry_release(ac_data_entry *e);
+void ac_data_entry_prefetch(uint32_t addr);
+#endif // !_AC_DATA_H
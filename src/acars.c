@@ -32,7 +32,9 @@
 #include <libacars/vstring.h>       // la_vstring, la_vstring_append_sprintf
 #include <libacars/reassembly.h>    // la_reasm_ctx
 #include "dumpvdl2.h"
+#include "bench.h"                  // bench_layer_*
 #include "acars.h"
+#include "metrics.h"                // metrics_inc_per_msgdir
 
 static void update_msg_type(uint32_t *msg_type, la_proto_node *root) {
 	la_proto_node *node = la_proto_tree_find_acars(root);
@@ -66,18 +68,7 @@ static void update_msg_type(uint32_t *msg_type, la_proto_node *root) {
 	}
 }
 
-#ifdef WITH_STATSD
-static void update_statsd_acars_metrics(la_msg_dir msg_dir, la_proto_node *root) {
-	static la_dict const reasm_status_counter_names[] = {
-		{ .id = LA_REASM_UNKNOWN, .val = "acars.reasm.unknown" },
-		{ .id = LA_REASM_COMPLETE, .val = "acars.reasm.complete" },
-		// { .id = LA_REASM_IN_PROGRESS, .val = "acars.reasm.in_progress" },    // report final states only
-		{ .id = LA_REASM_SKIPPED, .val = "acars.reasm.skipped" },
-		{ .id = LA_REASM_DUPLICATE, .val = "acars.reasm.duplicate" },
-		{ .id = LA_REASM_FRAG_OUT_OF_SEQUENCE, .val = "acars.reasm.out_of_seq" },
-		{ .id = LA_REASM_ARGS_INVALID, .val = "acars.reasm.invalid_args" },
-		{ .id = 0, .val = NULL }
-	};
+static void update_acars_metrics(la_msg_dir msg_dir, la_proto_node *root) {
 	la_proto_node *node = la_proto_tree_find_acars(root);
 	if(node == NULL) {
 		return;
@@ -86,19 +77,22 @@ static void update_statsd_acars_metrics(la_msg_dir msg_dir, la_proto_node *root)
 	if(amsg->err == true) {
 		return;
 	}
-	char const *metric = la_dict_search(reasm_status_counter_names, amsg->reasm_status);
-	if(metric == NULL) {
-		return;
+	metrics_msgdir_counter id;
+	switch(amsg->reasm_status) {
+		case LA_REASM_UNKNOWN:                  id = MD_ACARS_REASM_UNKNOWN; break;
+		case LA_REASM_COMPLETE:                 id = MD_ACARS_REASM_COMPLETE; break;
+		case LA_REASM_SKIPPED:                  id = MD_ACARS_REASM_SKIPPED; break;
+		case LA_REASM_DUPLICATE:                id = MD_ACARS_REASM_DUPLICATE; break;
+		case LA_REASM_FRAG_OUT_OF_SEQUENCE:     id = MD_ACARS_REASM_OUT_OF_SEQ; break;
+		case LA_REASM_ARGS_INVALID:             id = MD_ACARS_REASM_INVALID_ARGS; break;
+		default:                                return;     // report final states only
 	}
-	// Dropping const on metric is allowed here, because dumpvdl2 metric names
-	// do not contain any characters that statsd-c-client library would need to
-	// sanitize (replace with underscores)
-	statsd_increment_per_msgdir(msg_dir, (char *)metric);
+	metrics_inc_per_msgdir(msg_dir, id);
 }
-#endif
 
 la_proto_node *parse_acars(uint8_t *buf, uint32_t len, uint32_t *msg_type,
 		la_reasm_ctx *reasm_ctx, struct timeval rx_time) {
+	uint64_t t = bench_layer_start(BENCH_LAYER_ACARS, BENCH_OP_PARSE);
 	la_msg_dir msg_dir = LA_MSG_DIR_UNKNOWN;
 	if(*msg_type & MSGFLT_SRC_AIR) {
 		msg_dir = LA_MSG_DIR_AIR2GND;
@@ -107,9 +101,8 @@ la_proto_node *parse_acars(uint8_t *buf, uint32_t len, uint32_t *msg_type,
 	}
 	la_proto_node *node = la_acars_parse_and_reassemble(buf, len, msg_dir, reasm_ctx, rx_time);
 	update_msg_type(msg_type, node);
-#ifdef WITH_STATSD
-	update_statsd_acars_metrics(msg_dir, node);
-#endif
+	update_acars_metrics(msg_dir, node);
+	bench_layer_end(t);
 	return node;
 }
 
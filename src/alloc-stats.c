@@ -0,0 +1,383 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Per-call-site allocation accounting (built with -DALLOC_STATS=ON).
+ * xcalloc() and xrealloc() register each block they return together with
+ * the source location of the XCALLOC / XREALLOC / NEW invocation. Much of
+ * the memory allocated here is released by libacars (when it destroys
+ * protocol trees, lists and hash tables) with a plain free(), so free() is
+ * interposed as well and the real one is looked up with dlsym(RTLD_NEXT).
+ * This works with dynamically linked executables on ELF platforms (eg. glibc).
+ * Every allocation and every free() in the process takes a global lock, so
+ * this is a diagnostic tool, not something to enable by default.
+ */
+
+#define _GNU_SOURCE                     // RTLD_NEXT
+#include <stdio.h>                      // FILE, fprintf
+#include <stdlib.h>                     // calloc, qsort
+#include <string.h>                     // strcmp, strrchr
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>                  // _Atomic
+#include <inttypes.h>                   // PRIu64
+#include <signal.h>                     // sig_atomic_t
+#include <unistd.h>                     // sleep, _exit
+#include <pthread.h>                    // pthread_mutex_*
+#include <dlfcn.h>                      // dlsym, RTLD_NEXT
+#include "alloc-stats.h"
+#include "dumpvdl2.h"                   // ASSERT, UNUSED, do_exit, start_thread
+
+// Max number of distinct call sites (must be a power of 2). Sites above
+// this limit are accounted to a single catch-all entry.
+#define SITES_MAX 4096
+#define PTR_TABLE_INITIAL_SIZE 65536    // must be a power of 2
+#define REPORT_SITES_MAX 50
+
+typedef struct {
+	void *ptr;                          // NULL = empty slot
+	size_t size;
+	uint32_t site;
+} ptr_entry;
+
+typedef void (*free_fn)(void *);
+
+// The last entry is the catch-all site
+static alloc_stats_site sites[SITES_MAX + 1] = {
+	[SITES_MAX] = { .file = "(other)", .func = "", .line = 0 }
+};
+static size_t sites_cnt = 0;
+static alloc_stats_site total;
+
+// Open addressing hash table of live blocks with linear probing
+static ptr_entry *ptrs = NULL;
+static size_t ptrs_size = 0;
+static size_t ptrs_cnt = 0;
+
+static pthread_mutex_t alloc_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile sig_atomic_t report_requested = 0;
+static _Atomic free_fn real_free = NULL;
+static _Thread_local bool resolving_free = false;
+
+static free_fn real_free_get(void) {
+	free_fn f = atomic_load_explicit(&real_free, memory_order_relaxed);
+	if(f == NULL) {
+		if(resolving_free) {
+			// dlsym() released some memory before we got the real free()
+			return NULL;
+		}
+		resolving_free = true;
+		f = (free_fn)dlsym(RTLD_NEXT, "free");
+		resolving_free = false;
+		if(f == NULL) {
+			fprintf(stderr, "alloc-stats: could not find free(): %s\n", dlerror());
+			_exit(1);
+		}
+		atomic_store_explicit(&real_free, f, memory_order_relaxed);
+	}
+	return f;
+}
+
+// Resolves the real free() at startup, before any lock is held, so that
+// dlsym() (which may allocate and free memory itself) never runs under
+// alloc_stats_mutex. Memory released before this runs (eg. by constructors
+// of other libraries) gets the real free() resolved on first use.
+__attribute__((constructor))
+static void real_free_init(void) {
+	UNUSED(real_free_get());
+}
+
+static void call_real_free(void *ptr) {
+	free_fn f = real_free_get();
+	// NULL only while dlsym() is running - leak the block, it happens only once
+	if(f != NULL) {
+		f(ptr);
+	}
+}
+
+static uint32_t site_hash(char const *file, int line) {
+	uint32_t h = 5381;
+	for(char const *p = file; *p != '\0'; p++) {
+		h = h * 33 + (uint8_t)*p;
+	}
+	return (h * 31 + (uint32_t)line) & (SITES_MAX - 1);
+}
+
+// Returns the index of the given call site, creating a new entry if necessary.
+// Must be called with alloc_stats_mutex held.
+static uint32_t site_get(char const *file, int line, char const *func) {
+	char const *base = strrchr(file, '/');
+	base = base != NULL ? base + 1 : file;
+	uint32_t idx = site_hash(base, line);
+	for(size_t i = 0; i < SITES_MAX; i++, idx = (idx + 1) & (SITES_MAX - 1)) {
+		alloc_stats_site *s = &sites[idx];
+		if(s->file == NULL) {
+			// Keep the table sparse enough for short probe sequences
+			if(sites_cnt >= SITES_MAX / 4 * 3) {
+				break;
+			}
+			s->file = base;
+			s->line = line;
+			s->func = func;
+			sites_cnt++;
+			return idx;
+		}
+		if(s->line == line && strcmp(s->file, base) == 0) {
+			return idx;
+		}
+	}
+	return SITES_MAX;
+}
+
+static void site_account_add(alloc_stats_site *s, size_t size) {
+	s->count++;
+	s->bytes += size;
+	s->live_count++;
+	s->live_bytes += size;
+	if(s->live_bytes > s->peak_bytes) {
+		s->peak_bytes = s->live_bytes;
+	}
+}
+
+static void site_account_remove(alloc_stats_site *s, size_t size) {
+	s->live_count--;
+	s->live_bytes -= size;
+}
+
+static size_t ptr_hash(void const *ptr, size_t table_size) {
+	uint64_t h = (uint64_t)((uintptr_t)ptr >> 4) * UINT64_C(0x9e3779b97f4a7c15);
+	return (size_t)(h >> 32) & (table_size - 1);
+}
+
+// Returns the slot holding ptr or the empty slot where it should be inserted
+static size_t ptr_slot(void const *ptr) {
+	size_t i = ptr_hash(ptr, ptrs_size);
+	while(ptrs[i].ptr != NULL && ptrs[i].ptr != ptr) {
+		i = (i + 1) & (ptrs_size - 1);
+	}
+	return i;
+}
+
+static void ptr_table_grow(void) {
+	size_t new_size = ptrs_size > 0 ? 2 * ptrs_size : PTR_TABLE_INITIAL_SIZE;
+	ptr_entry *new_ptrs = calloc(new_size, sizeof(ptr_entry));
+	if(new_ptrs == NULL) {
+		fprintf(stderr, "alloc-stats: could not grow pointer table to %zu entries\n", new_size);
+		_exit(1);
+	}
+	for(size_t i = 0; i < ptrs_size; i++) {
+		if(ptrs[i].ptr != NULL) {
+			size_t j = ptr_hash(ptrs[i].ptr, new_size);
+			while(new_ptrs[j].ptr != NULL) {
+				j = (j + 1) & (new_size - 1);
+			}
+			new_ptrs[j] = ptrs[i];
+		}
+	}
+	// Not free(), which would try to take the lock we are holding
+	if(ptrs != NULL) {
+		call_real_free(ptrs);
+	}
+	ptrs = new_ptrs;
+	ptrs_size = new_size;
+}
+
+// Removes the entry at slot i, shifting back the following entries of the
+// probe sequence, so that no tombstones are necessary
+static void ptr_delete(size_t i) {
+	size_t mask = ptrs_size - 1;
+	for(size_t j = (i + 1) & mask; ptrs[j].ptr != NULL; j = (j + 1) & mask) {
+		size_t k = ptr_hash(ptrs[j].ptr, ptrs_size);
+		// Leave the entry in place if its home slot lies cyclically in (i, j]
+		if(i <= j ? (i < k && k <= j) : (i < k || k <= j)) {
+			continue;
+		}
+		ptrs[i] = ptrs[j];
+		i = j;
+	}
+	ptrs[i].ptr = NULL;
+	ptrs_cnt--;
+}
+
+void alloc_stats_add(void *ptr, size_t size, char const *file, int line, char const *func) {
+	if(ptr == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&alloc_stats_mutex);
+	if(ptrs_size == 0 || (ptrs_cnt + 1) * 10 > ptrs_size * 7) {
+		ptr_table_grow();
+	}
+	uint32_t site = site_get(file, line, func);
+	size_t i = ptr_slot(ptr);
+	if(ptrs[i].ptr == ptr) {
+		// Stale entry - the block has been released in a way we could not
+		// see (eg. realloc() called on it by a library) and then reused
+		site_account_remove(&sites[ptrs[i].site], ptrs[i].size);
+		site_account_remove(&total, ptrs[i].size);
+	} else {
+		ptrs_cnt++;
+	}
+	ptrs[i] = (ptr_entry){ .ptr = ptr, .size = size, .site = site };
+	site_account_add(&sites[site], size);
+	site_account_add(&total, size);
+	pthread_mutex_unlock(&alloc_stats_mutex);
+}
+
+void alloc_stats_remove(void *ptr) {
+	if(ptr == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&alloc_stats_mutex);
+	if(ptrs_size > 0) {
+		size_t i = ptr_slot(ptr);
+		if(ptrs[i].ptr == ptr) {
+			site_account_remove(&sites[ptrs[i].site], ptrs[i].size);
+			site_account_remove(&total, ptrs[i].size);
+			ptr_delete(i);
+		}
+	}
+	pthread_mutex_unlock(&alloc_stats_mutex);
+}
+
+// Blocks allocated with xcalloc() / xrealloc() are removed from the table
+// before they are actually released. Otherwise another thread could get
+// the same address from the allocator and register it in the meantime.
+void free(void *ptr) {
+	alloc_stats_remove(ptr);
+	call_real_free(ptr);
+}
+
+// Stores a copy of all call sites which have allocated anything in *sites
+// (to be freed by the caller) and returns their number. Process-wide totals
+// are stored in *tot, if it's non-NULL.
+size_t alloc_stats_snapshot(alloc_stats_site **result, alloc_stats_site *tot) {
+	ASSERT(result != NULL);
+	// Allocate outside of the lock; sites registered in the meantime
+	// will be included in the next snapshot.
+	pthread_mutex_lock(&alloc_stats_mutex);
+	size_t max = sites_cnt + 1;
+	pthread_mutex_unlock(&alloc_stats_mutex);
+	alloc_stats_site *copy = calloc(max, sizeof(alloc_stats_site));
+	if(copy == NULL) {
+		*result = NULL;
+		return 0;
+	}
+	size_t cnt = 0;
+	pthread_mutex_lock(&alloc_stats_mutex);
+	for(size_t i = 0; i <= SITES_MAX && cnt < max; i++) {
+		if(sites[i].file != NULL && sites[i].count > 0) {
+			copy[cnt++] = sites[i];
+		}
+	}
+	if(tot != NULL) {
+		*tot = total;
+	}
+	pthread_mutex_unlock(&alloc_stats_mutex);
+	*result = copy;
+	return cnt;
+}
+
+static int site_compare_file(void const *a, void const *b) {
+	return strcmp(((alloc_stats_site const *)a)->file, ((alloc_stats_site const *)b)->file);
+}
+
+static int site_compare_live_bytes(void const *a, void const *b) {
+	uint64_t la = ((alloc_stats_site const *)a)->live_bytes;
+	uint64_t lb = ((alloc_stats_site const *)b)->live_bytes;
+	return la < lb ? 1 : la > lb ? -1 : 0;
+}
+
+// Prints live memory per source file and the call sites holding the most
+// memory. Must not be called with alloc_stats_mutex held, because stdio
+// might call free().
+void alloc_stats_report(FILE *f) {
+	ASSERT(f != NULL);
+	alloc_stats_site *s = NULL, tot;
+	size_t cnt = alloc_stats_snapshot(&s, &tot);
+	if(s == NULL) {
+		return;
+	}
+	fprintf(f, "\nAllocation statistics:\n");
+	fprintf(f, "  Live: %" PRIu64 " bytes in %" PRIu64 " blocks, peak: %" PRIu64 " bytes, "
+			"total: %" PRIu64 " allocations, %" PRIu64 " bytes\n",
+			tot.live_bytes, tot.live_count, tot.peak_bytes, tot.count, tot.bytes);
+
+	// Aggregate sites by file (peaks can't be summed up, so they are omitted)
+	alloc_stats_site *files = calloc(cnt > 0 ? cnt : 1, sizeof(alloc_stats_site));
+	size_t file_cnt = 0;
+	if(files != NULL) {
+		qsort(s, cnt, sizeof(alloc_stats_site), site_compare_file);
+		for(size_t i = 0; i < cnt; i++) {
+			if(file_cnt == 0 || strcmp(files[file_cnt-1].file, s[i].file) != 0) {
+				files[file_cnt++].file = s[i].file;
+			}
+			alloc_stats_site *fs = &files[file_cnt-1];
+			fs->count += s[i].count;
+			fs->bytes += s[i].bytes;
+			fs->live_count += s[i].live_count;
+			fs->live_bytes += s[i].live_bytes;
+		}
+		qsort(files, file_cnt, sizeof(alloc_stats_site), site_compare_live_bytes);
+		fprintf(f, "\n  %14s %12s %14s %16s  %s\n", "Live bytes", "Live blocks", "Allocations",
+				"Bytes allocated", "File");
+		for(size_t i = 0; i < file_cnt; i++) {
+			fprintf(f, "  %14" PRIu64 " %12" PRIu64 " %14" PRIu64 " %16" PRIu64 "  %s\n",
+					files[i].live_bytes, files[i].live_count, files[i].count, files[i].bytes,
+					files[i].file);
+		}
+		free(files);
+	}
+
+	qsort(s, cnt, sizeof(alloc_stats_site), site_compare_live_bytes);
+	fprintf(f, "\n  %14s %12s %14s %14s %16s  %s\n", "Live bytes", "Live blocks", "Peak bytes",
+			"Allocations", "Bytes allocated", "Call site");
+	for(size_t i = 0; i < cnt && i < REPORT_SITES_MAX; i++) {
+		fprintf(f, "  %14" PRIu64 " %12" PRIu64 " %14" PRIu64 " %14" PRIu64 " %16" PRIu64 "  %s:%d %s()\n",
+				s[i].live_bytes, s[i].live_count, s[i].peak_bytes, s[i].count, s[i].bytes,
+				s[i].file, s[i].line, s[i].func);
+	}
+	if(cnt > REPORT_SITES_MAX) {
+		fprintf(f, "  (%zu more call sites not shown)\n", cnt - REPORT_SITES_MAX);
+	}
+	fflush(f);
+	free(s);
+}
+
+// Called from a signal handler, hence it only sets a flag. The report
+// is printed by report_thread.
+void alloc_stats_report_request(void) {
+	report_requested = 1;
+}
+
+static void *report_thread(void *arg) {
+	UNUSED(arg);
+	while(do_exit == 0) {
+		if(report_requested) {
+			report_requested = 0;
+			alloc_stats_report(stderr);
+		}
+		sleep(1);
+	}
+	return NULL;
+}
+
+void alloc_stats_init(void) {
+	pthread_t th;
+	start_thread(&th, report_thread, NULL);
+	pthread_detach(th);
+}
@@ -0,0 +1,46 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _ALLOC_STATS_H
+#define _ALLOC_STATS_H 1
+
+#include <stddef.h>                     // size_t
+#include <stdint.h>
+#include <stdio.h>                      // FILE
+
+// Allocation statistics of a single call site of XCALLOC / XREALLOC / NEW
+typedef struct {
+	char const *file;                   // source file name without directory
+	char const *func;
+	int line;
+	uint64_t count;                     // number of allocations and reallocations
+	uint64_t bytes;                     // total number of bytes allocated
+	uint64_t live_count;                // number of blocks not freed yet
+	uint64_t live_bytes;                // size of blocks not freed yet
+	uint64_t peak_bytes;                // highest value of live_bytes so far
+} alloc_stats_site;
+
+// alloc-stats.c
+void alloc_stats_init(void);
+void alloc_stats_add(void *ptr, size_t size, char const *file, int line, char const *func);
+void alloc_stats_remove(void *ptr);
+size_t alloc_stats_snapshot(alloc_stats_site **sites, alloc_stats_site *total);
+void alloc_stats_report(FILE *f);
+void alloc_stats_report_request(void);
+
+#endif // !_ALLOC_STATS_H
@@ -29,12 +29,14 @@
 #include "reassembly.h"             // reasm_contexts
 #include "config.h"                 // IS_BIG_ENDIAN
 #include "dumpvdl2.h"
+#include "bench.h"                  // bench_layer_*
 #include "avlc.h"
 #include "ac_data.h"
 #include "gs_data.h"
 #include "xid.h"
 #include "acars.h"
 #include "x25.h"
+#include "metrics.h"                // metrics_inc_per_channel
 
 #define MIN_AVLC_LEN    11
 #define GOOD_FCS        0xF0B8u
@@ -45,75 +47,6 @@
 #define BSHIFT 24
 #endif
 
-// X.25 control field
-typedef union {
-	uint8_t val;
-	struct {
-#ifdef IS_BIG_ENDIAN
-		uint8_t recv_seq:3;
-		uint8_t poll:1;
-		uint8_t send_seq:3;
-		uint8_t type:1;
-#else
-		uint8_t type:1;
-		uint8_t send_seq:3;
-		uint8_t poll:1;
-		uint8_t recv_seq:3;
-#endif
-	} I;
-	struct {
-#ifdef IS_BIG_ENDIAN
-		uint8_t recv_seq:3;
-		uint8_t pf:1;
-		uint8_t sfunc:2;
-		uint8_t type:2;
-#else
-		uint8_t type:2;
-		uint8_t sfunc:2;
-		uint8_t pf:1;
-		uint8_t recv_seq:3;
-#endif
-	} S;
-	struct {
-#ifdef IS_BIG_ENDIAN
-		uint8_t mfunc:6;
-		uint8_t type:2;
-#else
-		uint8_t type:2;
-		uint8_t mfunc:6;
-#endif
-	} U;
-} lcf_t;
-
-#define IS_I(lcf) (((lcf).val & 0x1) == 0x0)
-#define IS_S(lcf) (((lcf).val & 0x3) == 0x1)
-#define IS_U(lcf) (((lcf).val & 0x3) == 0x3)
-#define U_MFUNC(lcf) ((lcf).U.mfunc & 0x3b)
-#define U_PF(lcf) (((lcf).U.mfunc >> 2) & 0x1)
-
-#define UI      0x00
-#define DM      0x03
-#define DISC    0x10
-#define UA      0x18
-#define FRMR    0x21
-#define XID     0x2b
-#define TEST    0x38
-
-#define ADDRTYPE_AIRCRAFT   1
-#define ADDRTYPE_GS_ADM     4
-#define ADDRTYPE_GS_DEL     5
-#define ADDRTYPE_ALL        7
-
-#define IS_AIRCRAFT(addr) ((addr).a_addr.type == ADDRTYPE_AIRCRAFT)
-#define IS_GS(addr) ((addr).a_addr.type == ADDRTYPE_GS_ADM || (addr).a_addr.type == ADDRTYPE_GS_DEL)
-
-typedef struct {
-	avlc_addr_t src;
-	avlc_addr_t dst;
-	lcf_t lcf;
-	avlc_frame_qentry_t *q;
-} avlc_frame_t;
-
 static char const *status_ag_descr[] = {
 	"Airborne",
 	"On ground"
@@ -156,33 +89,78 @@ static char const *U_cmd[] = {
 // Forward declaration
 la_type_descriptor const proto_DEF_avlc_frame;
 
+char const *avlc_frame_cmd_name(avlc_frame_t const *f) {
+	ASSERT(f != NULL);
+	if(IS_S(f->lcf)) {
+		return S_cmd[f->lcf.S.sfunc];
+	} else if(IS_U(f->lcf) && U_MFUNC(f->lcf) < sizeof(U_cmd) / sizeof(U_cmd[0])) {
+		return U_cmd[U_MFUNC(f->lcf)];
+	}
+	return NULL;
+}
+
 uint32_t parse_dlc_addr(uint8_t *buf) {
 	debug_print(D_PROTO_DETAIL, "%02x %02x %02x %02x\n", buf[0], buf[1], buf[2], buf[3]);
 	return reverse((buf[0] >> 1) | (buf[1] << 6) | (buf[2] << 13) | ((buf[3] & 0xfe) << 20), 28) & ONES(28);
 }
 
+// Returns true if the frame is long enough and its FCS is correct.
+// The result is remembered in the queue entry flags, so that the FCS is
+// computed only once, no matter how many times the frame is checked.
+bool avlc_frame_check_fcs(avlc_frame_qentry_t *q) {
+	ASSERT(q != NULL);
+	ASSERT(q->frame != NULL);
+	if((q->flags & AVLC_FRAME_FCS_CHECKED) == 0) {
+		q->flags |= AVLC_FRAME_FCS_CHECKED;
+		if(q->frame->len >= MIN_AVLC_LEN && crc16_ccitt(q->frame->buf, q->frame->len, 0xFFFFu) == GOOD_FCS) {
+			q->flags |= AVLC_FRAME_FCS_GOOD;
+		}
+	}
+	return (q->flags & AVLC_FRAME_FCS_GOOD) != 0;
+}
+
+// Requests background lookups of aircraft addresses of a frame, so that
+// avlc_parse() is likely to find them in the cache. The caller must have
+// checked the frame with avlc_frame_check_fcs() - there is no point in wasting
+// DB queries on garbage addresses from damaged frames.
+void avlc_frame_prefetch_addrinfo(octet_string_t const *frame) {
+	ASSERT(frame != NULL);
+	if(Config.ac_addrinfo_db_available == false) {
+		return;
+	}
+	avlc_addr_t dst = { .val = parse_dlc_addr(frame->buf) };
+	avlc_addr_t src = { .val = parse_dlc_addr(frame->buf + 4) };
+	if(IS_AIRCRAFT(src)) {
+		ac_data_entry_prefetch(src.a_addr.addr);
+	}
+	if(IS_AIRCRAFT(dst)) {
+		ac_data_entry_prefetch(dst.a_addr.addr);
+	}
+}
+
 la_proto_node *avlc_parse(avlc_frame_qentry_t *q, uint32_t *msg_type, reasm_contexts *reasm_ctx) {
+	uint64_t t = bench_layer_start(BENCH_LAYER_AVLC, BENCH_OP_PARSE);
 	ASSERT(q != NULL);
 	uint8_t *buf = q->frame->buf;
 	uint32_t len = q->frame->len;
 	if(len < MIN_AVLC_LEN) {
 		debug_print(D_PROTO, "Frame %d: too short (len=%u required=%d)\n", q->metadata->idx, len, MIN_AVLC_LEN);
-		statsd_increment_per_channel(q->metadata->freq, "avlc.errors.too_short");
+		metrics_inc_per_channel(q->metadata->freq, MC_AVLC_ERRORS_TOO_SHORT);
+		bench_layer_end(t);
 		return NULL;
 	}
 	debug_print(D_PROTO, "Frame %d: len=%u\n", q->metadata->idx, len);
 	debug_print_buf_hex(D_PROTO_DETAIL, buf, len, "Frame data:\n");
 
-	// FCS check
-	uint16_t fcs = crc16_ccitt(buf, len, 0xFFFFu);
-	debug_print(D_PROTO_DETAIL, "Check FCS: %04x\n", fcs);
-	if(fcs == GOOD_FCS) {
+	// FCS check (usually done already by the decoder)
+	if(avlc_frame_check_fcs(q)) {
 		debug_print(D_PROTO, "FCS check OK\n");
-		statsd_increment_per_channel(q->metadata->freq, "avlc.frames.good");
+		metrics_inc_per_channel(q->metadata->freq, MC_AVLC_FRAMES_GOOD);
 		len -= 2;
 	} else {
 		debug_print(D_PROTO, "FCS check failed\n");
-		statsd_increment_per_channel(q->metadata->freq, "avlc.errors.bad_fcs");
+		metrics_inc_per_channel(q->metadata->freq, MC_AVLC_ERRORS_BAD_FCS);
+		bench_layer_end(t);
 		return NULL;
 	}
 
@@ -198,42 +176,48 @@ la_proto_node *avlc_parse(avlc_frame_qentry_t *q, uint32_t *msg_type, reasm_cont
 	ptr += 4; len -= 4;
 	frame->src.val = parse_dlc_addr(ptr);
 	ptr += 4; len -= 4;
+	// Resolve aircraft info here, so that formatters don't have to query
+	// the database (possibly more than once per address).
+	if(Config.ac_addrinfo_db_available == true) {
+		if(IS_AIRCRAFT(frame->src)) {
+			frame->src_ac = ac_data_entry_lookup(frame->src.a_addr.addr);
+		}
+		if(IS_AIRCRAFT(frame->dst)) {
+			frame->dst_ac = ac_data_entry_lookup(frame->dst.a_addr.addr);
+		}
+	}
 
 	switch(frame->src.a_addr.type) {
 		case ADDRTYPE_AIRCRAFT:
 			*msg_type |= MSGFLT_SRC_AIR;
-#ifdef WITH_STATSD
 			switch(frame->dst.a_addr.type) {
 				case ADDRTYPE_GS_ADM:
 				case ADDRTYPE_GS_DEL:
-					statsd_increment_per_channel(q->metadata->freq, "avlc.msg.air2gnd");
+					metrics_inc_per_channel(q->metadata->freq, MC_AVLC_MSG_AIR2GND);
 					break;
 				case ADDRTYPE_AIRCRAFT:
-					statsd_increment_per_channel(q->metadata->freq, "avlc.msg.air2air");
+					metrics_inc_per_channel(q->metadata->freq, MC_AVLC_MSG_AIR2AIR);
 					break;
 				case ADDRTYPE_ALL:
-					statsd_increment_per_channel(q->metadata->freq, "avlc.msg.air2all");
+					metrics_inc_per_channel(q->metadata->freq, MC_AVLC_MSG_AIR2ALL);
 					break;
 			}
-#endif
 			break;
 		case ADDRTYPE_GS_ADM:
 		case ADDRTYPE_GS_DEL:
 			*msg_type |= MSGFLT_SRC_GND;
-#ifdef WITH_STATSD
 			switch(frame->dst.a_addr.type) {
 				case ADDRTYPE_AIRCRAFT:
-					statsd_increment_per_channel(q->metadata->freq, "avlc.msg.gnd2air");
+					metrics_inc_per_channel(q->metadata->freq, MC_AVLC_MSG_GND2AIR);
 					break;
 				case ADDRTYPE_GS_ADM:
 				case ADDRTYPE_GS_DEL:
-					statsd_increment_per_channel(q->metadata->freq, "avlc.msg.gnd2gnd");
+					metrics_inc_per_channel(q->metadata->freq, MC_AVLC_MSG_GND2GND);
 					break;
 				case ADDRTYPE_ALL:
-					statsd_increment_per_channel(q->metadata->freq, "avlc.msg.gnd2all");
+					metrics_inc_per_channel(q->metadata->freq, MC_AVLC_MSG_GND2ALL);
 					break;
 			}
-#endif
 			break;
 	}
 
@@ -261,13 +245,14 @@ la_proto_node *avlc_parse(avlc_frame_qentry_t *q, uint32_t *msg_type, reasm_cont
 					frame->src.a_addr.addr, frame->dst.a_addr.addr);
 		}
 	}
+	bench_layer_end(t);
 	return node;
 }
 
-static void addrinfo_format_as_text(la_vstring *vstr, int indent, avlc_addr_t addr) {
+static void addrinfo_format_as_text(la_vstring *vstr, int indent, avlc_addr_t addr,
+		ac_data_entry const *ac) {
 	if(IS_AIRCRAFT(addr)) {
 		if(Config.ac_addrinfo_db_available == true) {
-			ac_data_entry *ac = ac_data_entry_lookup(addr.a_addr.addr);
 			if(Config.addrinfo_verbosity == ADDRINFO_TERSE) {
 				la_vstring_append_sprintf(vstr, " [%s]",
 						ac && ac->registration ? ac->registration : "-"
@@ -289,7 +274,8 @@ static void addrinfo_format_as_text(la_vstring *vstr, int indent, avlc_addr_t ad
 		}
 	} else if(IS_GS(addr)) {
 		if(Config.gs_addrinfo_db_available == true) {
-			gs_data_entry *gs = gs_data_entry_lookup(addr.a_addr.addr);
+			gs_data_entry gs_entry;
+			gs_data_entry *gs = gs_data_entry_lookup(addr.a_addr.addr, &gs_entry);
 			if(Config.addrinfo_verbosity == ADDRINFO_TERSE) {
 				la_vstring_append_sprintf(vstr, " [%s]",
 						gs && gs->airport_code ? gs->airport_code : "-"
@@ -304,6 +290,7 @@ static void addrinfo_format_as_text(la_vstring *vstr, int indent, avlc_addr_t ad
 						gs && gs->details ? gs->details : "-"
 						);
 			}
+			gs_data_entry_release(gs);
 		}
 	}
 }
@@ -327,7 +314,7 @@ static void avlc_format_text(la_vstring *vstr, void const *data, int indent) {
 	// Print extra info about source and/or destination?
 	// TERSE verbosity level is printed inline.
 	if(Config.addrinfo_verbosity == ADDRINFO_TERSE) {
-		addrinfo_format_as_text(vstr, indent, f->src);
+		addrinfo_format_as_text(vstr, indent, f->src, f->src_ac);
 	}
 
 	la_vstring_append_sprintf(vstr, " -> %06X (%s)",
@@ -335,7 +322,7 @@ static void avlc_format_text(la_vstring *vstr, void const *data, int indent) {
 			addrtype_descr[f->dst.a_addr.type]
 			);
 	if(Config.addrinfo_verbosity == ADDRINFO_TERSE) {
-		addrinfo_format_as_text(vstr, indent, f->dst);
+		addrinfo_format_as_text(vstr, indent, f->dst, f->dst_ac);
 	}
 	la_vstring_append_sprintf(vstr, ": %s\n",
 			status_cr_descr[f->src.a_addr.status]   // C/R
@@ -344,8 +331,8 @@ static void avlc_format_text(la_vstring *vstr, void const *data, int indent) {
 	// Print extra info about source and/or destination?
 	// Verbosity levels above TERSE are printed as separate lines.
 	if(Config.addrinfo_verbosity > ADDRINFO_TERSE) {
-		addrinfo_format_as_text(vstr, indent, f->src);
-		addrinfo_format_as_text(vstr, indent, f->dst);
+		addrinfo_format_as_text(vstr, indent, f->src, f->src_ac);
+		addrinfo_format_as_text(vstr, indent, f->dst, f->dst_ac);
 	}
 
 	if(IS_S(f->lcf)) {
@@ -360,10 +347,9 @@ static void avlc_format_text(la_vstring *vstr, void const *data, int indent) {
 	}
 }
 
-static void addrinfo_format_as_json(la_vstring *vstr, avlc_addr_t addr) {
+static void addrinfo_format_as_json(la_vstring *vstr, avlc_addr_t addr, ac_data_entry const *ac) {
 	if(IS_AIRCRAFT(addr)) {
 		if(Config.ac_addrinfo_db_available == true) {
-			ac_data_entry *ac = ac_data_entry_lookup(addr.a_addr.addr);
 			if(ac == NULL) {
 				return;
 			}
@@ -380,7 +366,8 @@ static void addrinfo_format_as_json(la_vstring *vstr, avlc_addr_t addr) {
 		}
 	} else if(IS_GS(addr)) {
 		if(Config.gs_addrinfo_db_available == true) {
-			gs_data_entry *gs = gs_data_entry_lookup(addr.a_addr.addr);
+			gs_data_entry gs_entry;
+			gs_data_entry *gs = gs_data_entry_lookup(addr.a_addr.addr, &gs_entry);
 			if(gs == NULL) {
 				return;
 			}
@@ -391,12 +378,13 @@ static void addrinfo_format_as_json(la_vstring *vstr, avlc_addr_t addr) {
 			if(Config.addrinfo_verbosity >= ADDRINFO_VERBOSE) {
 				SAFE_JSON_APPEND_STRING(vstr, "details", gs->details);
 			}
+			gs_data_entry_release(gs);
 		}
 	}
 }
 
 static void avlc_addr_format_as_json(la_vstring *vstr, char const *name, avlc_addr_t addr,
-		int ag_status) {
+		ac_data_entry const *ac, int ag_status) {
 	ASSERT(vstr != NULL);
 	ASSERT(name != NULL);
 
@@ -408,7 +396,7 @@ static void avlc_addr_format_as_json(la_vstring *vstr, char const *name, avlc_ad
 	if(ag_status >= 0 && ag_status <= 1) {
 		la_json_append_string(vstr, "status", status_ag_descr[ag_status]);
 	}
-	addrinfo_format_as_json(vstr, addr);
+	addrinfo_format_as_json(vstr, addr, ac);
 	la_json_object_end(vstr);
 }
 
@@ -418,8 +406,8 @@ static void avlc_format_json(la_vstring *vstr, void const *data) {
 
 	avlc_frame_t const *f = data;
 	// Air/Ground bit applies to the src addr, but it resides in the dst address field
-	avlc_addr_format_as_json(vstr, "src", f->src, f->dst.a_addr.status);
-	avlc_addr_format_as_json(vstr, "dst", f->dst, -1);
+	avlc_addr_format_as_json(vstr, "src", f->src, f->src_ac, f->dst.a_addr.status);
+	avlc_addr_format_as_json(vstr, "dst", f->dst, f->dst_ac, -1);
 
 	la_json_append_string(vstr, "cr", status_cr_descr[f->src.a_addr.status]);
 	if(IS_S(f->lcf)) {
@@ -439,9 +427,19 @@ static void avlc_format_json(la_vstring *vstr, void const *data) {
 	}
 }
 
+static void avlc_frame_destroy(void *data) {
+	if(data == NULL) {
+		return;
+	}
+	avlc_frame_t *f = data;
+	ac_data_entry_release(f->src_ac);
+	ac_data_entry_release(f->dst_ac);
+	XFREE(data);
+}
+
 la_type_descriptor const proto_DEF_avlc_frame = {
 	.format_text = avlc_format_text,
 	.format_json = avlc_format_json,
 	.json_key = "avlc",
-	.destroy = NULL
+	.destroy = avlc_frame_destroy
 };
@@ -25,6 +25,7 @@
 #include "config.h"                 // IS_BIG_ENDIAN
 #include "output-common.h"          // vdl2_msg_metadata
 #include "dumpvdl2.h"               // octet_string_t
+#include "ac_data.h"                // ac_data_entry
 
 typedef union {
 	uint32_t val;
@@ -47,6 +48,98 @@ typedef struct {
 	int flags;
 } avlc_frame_qentry_t;
 
+// avlc_frame_qentry_t flags (lower bits are used for OUT_FLAG_* values)
+// Set by the batch decoder: the frame is to be decoded without producing any
+// output. It is only decoded to feed reassembly (eg. warmup frames preceding
+// a segment of a raw frame file, which get decoded again by the previous
+// segment's worker), so it does not update metrics either.
+#define AVLC_FRAME_NO_OUTPUT (1 << 8)
+// Set by avlc_frame_check_fcs()
+#define AVLC_FRAME_FCS_CHECKED (1 << 9)
+#define AVLC_FRAME_FCS_GOOD (1 << 10)
+// Set by the batch decoder: the frame follows the end of a segment and is only
+// checked for being a duplicate of a frame held for deduplication. It is
+// dropped without decoding, unless it replaces the held frame, in which case
+// it takes over its flags.
+#define AVLC_FRAME_LOOKAHEAD (1 << 11)
+
+// X.25 control field
+typedef union {
+	uint8_t val;
+	struct {
+#ifdef IS_BIG_ENDIAN
+		uint8_t recv_seq:3;
+		uint8_t poll:1;
+		uint8_t send_seq:3;
+		uint8_t type:1;
+#else
+		uint8_t type:1;
+		uint8_t send_seq:3;
+		uint8_t poll:1;
+		uint8_t recv_seq:3;
+#endif
+	} I;
+	struct {
+#ifdef IS_BIG_ENDIAN
+		uint8_t recv_seq:3;
+		uint8_t pf:1;
+		uint8_t sfunc:2;
+		uint8_t type:2;
+#else
+		uint8_t type:2;
+		uint8_t sfunc:2;
+		uint8_t pf:1;
+		uint8_t recv_seq:3;
+#endif
+	} S;
+	struct {
+#ifdef IS_BIG_ENDIAN
+		uint8_t mfunc:6;
+		uint8_t type:2;
+#else
+		uint8_t type:2;
+		uint8_t mfunc:6;
+#endif
+	} U;
+} lcf_t;
+
+#define IS_I(lcf) (((lcf).val & 0x1) == 0x0)
+#define IS_S(lcf) (((lcf).val & 0x3) == 0x1)
+#define IS_U(lcf) (((lcf).val & 0x3) == 0x3)
+#define U_MFUNC(lcf) ((lcf).U.mfunc & 0x3b)
+#define U_PF(lcf) (((lcf).U.mfunc >> 2) & 0x1)
+
+#define UI      0x00
+#define DM      0x03
+#define DISC    0x10
+#define UA      0x18
+#define FRMR    0x21
+#define XID     0x2b
+#define TEST    0x38
+
+#define ADDRTYPE_AIRCRAFT   1
+#define ADDRTYPE_GS_ADM     4
+#define ADDRTYPE_GS_DEL     5
+#define ADDRTYPE_ALL        7
+
+#define IS_AIRCRAFT(addr) ((addr).a_addr.type == ADDRTYPE_AIRCRAFT)
+#define IS_GS(addr) ((addr).a_addr.type == ADDRTYPE_GS_ADM || (addr).a_addr.type == ADDRTYPE_GS_DEL)
+
+typedef struct {
+	avlc_addr_t src;
+	avlc_addr_t dst;
+	lcf_t lcf;
+	avlc_frame_qentry_t *q;
+	ac_data_entry *src_ac;          // aircraft DB entries for src and dst addresses,
+	ac_data_entry *dst_ac;          // resolved once during parsing (NULL = unknown),
+	                                // referenced until the frame is destroyed
+} avlc_frame_t;
+
+// avlc.c
+extern la_type_descriptor const proto_DEF_avlc_frame;
 uint32_t parse_dlc_addr(uint8_t *buf);
+char const *avlc_frame_cmd_name(avlc_frame_t const *f);
 la_proto_node *avlc_parse(avlc_frame_qentry_t *q, uint32_t *msg_type, reasm_contexts *reasm_ctx);
+bool avlc_frame_check_fcs(avlc_frame_qentry_t *q);
+void avlc_frame_prefetch_addrinfo(octet_string_t const *frame);
 #endif // !_AVLC_H
@@ -0,0 +1,102 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* dumpvdl2-bench - measures parsing and formatting cost of each protocol
+ * layer on raw AVLC frames read from a file (see bench-protocols.c).
+ * It's built from the same objects as dumpvdl2, so it exercises exactly
+ * the same decoding code.
+ */
+
+#include <stdio.h>                  // fprintf
+#include <stdlib.h>                 // atoi
+#include <string.h>                 // memset
+#include <unistd.h>                 // _exit
+#include <getopt.h>                 // getopt_long
+#include <libacars/libacars.h>      // LA_VERSION, la_config_set_int
+#include <libacars/acars.h>         // LA_ACARS_BEARER_VHF
+#include "dumpvdl2.h"               // Config, describe_option, DUMPVDL2_VERSION, __OPT_*
+#include "reassembly.h"             // reasm_init, REASM_MAX_MEMORY_DEFAULT
+#include "bench.h"                  // bench_init, bench_protocols_run, BENCH_REPEAT_MAX
+#ifdef WITH_ALLOC_STATS
+#include "alloc-stats.h"            // alloc_stats_init
+#endif
+
+static void usage() {
+	fprintf(stderr, "Usage:\n\n"
+			"%*sdumpvdl2-bench [--repeat <n>] <input_file>\n\n"
+			"Loads all frames from a raw AVLC frame file (written with raw:binary output),\n"
+			"then decodes them and formats the results as text and JSON in a single thread.\n"
+			"Prints CPU time, number of calls and number of allocations of each protocol layer.\n",
+			IND(1), "");
+	fprintf(stderr, "\nOptions:\n");
+	describe_option("--repeat <n>", "Make <n> passes over the frames (default: 1)", 1);
+	describe_option("--version", "Display version number and exit", 1);
+	describe_option("--help", "Display this text and exit", 1);
+	_exit(0);
+}
+
+int main(int argc, char **argv) {
+	int opt;
+	int repeat = 1;
+	struct option long_opts[] = {
+		{ "repeat",             required_argument,  NULL,   __OPT_REPEAT },
+		{ "version",            no_argument,        NULL,   __OPT_VERSION },
+		{ "help",               no_argument,        NULL,   __OPT_HELP },
+		{ 0,                    0,                  0,      0 }
+	};
+
+	// Initialize default config
+	memset(&Config, 0, sizeof(Config));
+	Config.addrinfo_verbosity = ADDRINFO_NORMAL;
+	Config.msg_filter = MSGFLT_ALL;
+
+	fprintf(stderr, "dumpvdl2-bench %s (libacars %s)\n", DUMPVDL2_VERSION, LA_VERSION);
+	while((opt = getopt_long(argc, argv, "", long_opts, NULL)) != -1) {
+		switch(opt) {
+			case __OPT_REPEAT:
+				repeat = atoi(optarg);
+				if(repeat < 1 || repeat > BENCH_REPEAT_MAX) {
+					fprintf(stderr, "Invalid --repeat value: must be between 1 and %d\n", BENCH_REPEAT_MAX);
+					_exit(1);
+				}
+				break;
+			case __OPT_VERSION:
+				_exit(0);
+			case __OPT_HELP:
+				usage();
+				break;
+			default:
+				fprintf(stderr, "Use --help for help\n");
+				_exit(1);
+		}
+	}
+	if(optind != argc - 1) {
+		fprintf(stderr, "Exactly one input file must be given\n");
+		fprintf(stderr, "Use --help for help\n");
+		_exit(1);
+	}
+
+	reasm_init(REASM_MAX_MEMORY_DEFAULT);
+	la_config_set_int("acars_bearer", LA_ACARS_BEARER_VHF);
+#ifdef WITH_ALLOC_STATS
+	alloc_stats_init();
+#endif
+	bench_init();
+	return bench_protocols_run(argv[optind], (uint32_t)repeat);
+}
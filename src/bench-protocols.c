@@ -0,0 +1,234 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Protocol benchmark (dumpvdl2-bench).
+ * Loads all frames from a raw frame file into memory, then decodes them and
+ * formats the results as text and JSON, node by node, so that the CPU time and
+ * the number of allocations can be reported separately for each protocol layer.
+ * Everything runs in a single thread. Outputs are not involved.
+ */
+
+#include <stdio.h>                      // FILE, fopen, fread, fprintf
+#include <stdint.h>
+#include <inttypes.h>                   // PRIu64
+#include <time.h>                       // clock_gettime
+#include <sys/types.h>                  // ssize_t
+#include <libacars/libacars.h>          // la_proto_node, la_proto_tree_destroy
+#include <libacars/acars.h>             // la_DEF_acars_message
+#include <libacars/vstring.h>           // la_vstring
+#include <libacars/json.h>              // la_json_object_start, la_json_object_end
+#include <libacars/reassembly.h>        // la_reasm_ctx_new, la_reasm_ctx_destroy
+#include "bench.h"
+#include "dumpvdl2.h"                   // octet_string_t, do_exit, XCALLOC
+#include "output-file.h"                // OUT_BINARY_FRAME_LEN_OCTETS
+#include "input-raw_frames_file.h"      // raw_frame_unpack
+#include "output-common.h"              // vdl2_msg_metadata_destroy
+#include "reassembly.h"                 // reasm_contexts, reasm_ctx_new, reasm_ctx_destroy
+#include "avlc.h"                       // avlc_parse, avlc_frame_qentry_t
+#include "xid.h"                        // proto_DEF_XID_msg
+#include "x25.h"                        // proto_DEF_X25_pkt
+#include "clnp.h"                       // proto_DEF_clnp_*
+#include "esis.h"                       // proto_DEF_esis_pdu
+#include "idrp.h"                       // proto_DEF_idrp_pdu
+#include "cotp.h"                       // proto_DEF_cotp_concatenated_pdu
+#include "icao.h"                       // proto_DEF_x225_spdu, proto_DEF_cpdlc, etc
+
+#define READ_SIZE 65536
+
+// Nodes of types not listed here (payloads decoded by libacars, undecoded
+// data) are accounted to the layer of the preceding node.
+static struct {
+	la_type_descriptor const *td;
+	bench_layer layer;
+} const td_layers[] = {
+	{ &proto_DEF_avlc_frame,                    BENCH_LAYER_AVLC },
+	{ &proto_DEF_XID_msg,                       BENCH_LAYER_XID },
+	{ &la_DEF_acars_message,                    BENCH_LAYER_ACARS },
+	{ &proto_DEF_X25_pkt,                       BENCH_LAYER_X25 },
+	{ &proto_DEF_clnp_pdu,                      BENCH_LAYER_CLNP },
+	{ &proto_DEF_clnp_compressed_data_pdu,      BENCH_LAYER_CLNP },
+	{ &proto_DEF_esis_pdu,                      BENCH_LAYER_ESIS },
+	{ &proto_DEF_idrp_pdu,                      BENCH_LAYER_IDRP },
+	{ &proto_DEF_cotp_concatenated_pdu,         BENCH_LAYER_COTP },
+	{ &proto_DEF_x225_spdu,                     BENCH_LAYER_ICAO },
+	{ &proto_DEF_x227_acse_apdu,                BENCH_LAYER_ICAO },
+	{ &proto_DEF_cpdlc,                         BENCH_LAYER_ICAO },
+	{ &proto_DEF_cm,                            BENCH_LAYER_ICAO },
+	{ &proto_DEF_adsc_v2,                       BENCH_LAYER_ICAO },
+};
+
+static bench_layer node_layer(la_proto_node const *node, bench_layer prev) {
+	for(size_t i = 0; i < sizeof(td_layers) / sizeof(td_layers[0]); i++) {
+		if(node->td == td_layers[i].td) {
+			return td_layers[i].layer;
+		}
+	}
+	return prev;
+}
+
+static void format_text(la_proto_node const *root) {
+	la_vstring *vstr = la_vstring_new();
+	bench_layer layer = BENCH_LAYER_AVLC;
+	int indent = 0;
+	for(la_proto_node const *node = root; node != NULL; node = node->next) {
+		if(node->td == NULL) {
+			continue;
+		}
+		layer = node_layer(node, layer);
+		if(node->td->format_text != NULL) {
+			uint64_t t = bench_layer_start(layer, BENCH_OP_FORMAT_TEXT);
+			node->td->format_text(vstr, node->data, indent);
+			bench_layer_end(t);
+		}
+		indent++;
+	}
+	la_vstring_destroy(vstr, true);
+}
+
+static void format_json(la_proto_node const *root) {
+	la_vstring *vstr = la_vstring_new();
+	bench_layer layer = BENCH_LAYER_AVLC;
+	int depth = 0;
+	la_json_start(vstr);
+	for(la_proto_node const *node = root; node != NULL; node = node->next) {
+		if(node->td == NULL) {
+			continue;
+		}
+		layer = node_layer(node, layer);
+		if(node->td->json_key != NULL) {
+			la_json_object_start(vstr, node->td->json_key);
+			depth++;
+		}
+		if(node->td->format_json != NULL) {
+			uint64_t t = bench_layer_start(layer, BENCH_OP_FORMAT_JSON);
+			node->td->format_json(vstr, node->data);
+			bench_layer_end(t);
+		}
+	}
+	while(depth-- > 0) {
+		la_json_object_end(vstr);
+	}
+	la_json_end(vstr);
+	la_vstring_destroy(vstr, true);
+}
+
+// Reads the whole file and unpacks all frames. Returns the number of frames
+// stored in *result or -1 on error.
+static ssize_t load_frames(char const *file, avlc_frame_qentry_t **result) {
+	FILE *fh = fopen(file, "r");
+	if(fh == NULL) {
+		perror("Could not open input file");
+		return -1;
+	}
+	uint8_t *buf = NULL;
+	size_t len = 0, size = 0, n = 0;
+	do {
+		if(len + READ_SIZE > size) {
+			size = size > 0 ? 2 * size : 16 * READ_SIZE;
+			buf = XREALLOC(buf, size);
+		}
+		n = fread(buf + len, sizeof(uint8_t), READ_SIZE, fh);
+		len += n;
+	} while(n > 0);
+	fclose(fh);
+
+	avlc_frame_qentry_t *frames = NULL;
+	ssize_t cnt = 0, frames_size = 0;
+	size_t offset = 0;
+	while(offset < len) {
+		size_t frame_len = len - offset < OUT_BINARY_FRAME_LEN_OCTETS ? 0 :
+			((size_t)buf[offset] << 8) | (size_t)buf[offset + 1];
+		if(frame_len < OUT_BINARY_FRAME_LEN_OCTETS + 1 || len - offset < frame_len) {
+			fprintf(stderr, "Input file is truncated or corrupted at offset %zu\n", offset);
+			break;
+		}
+		vdl2_msg_metadata *metadata = NULL;
+		octet_string_t *frame = NULL;
+		if(raw_frame_unpack(buf + offset + OUT_BINARY_FRAME_LEN_OCTETS,
+					frame_len - OUT_BINARY_FRAME_LEN_OCTETS, &metadata, &frame, true) == 0 &&
+				metadata != NULL) {
+			if(cnt == frames_size) {
+				frames_size = frames_size > 0 ? 2 * frames_size : 1024;
+				frames = XREALLOC(frames, frames_size * sizeof(avlc_frame_qentry_t));
+			}
+			frames[cnt++] = (avlc_frame_qentry_t){ .metadata = metadata, .frame = frame };
+		}
+		offset += frame_len;
+	}
+	XFREE(buf);
+	*result = frames;
+	return cnt;
+}
+
+int bench_protocols_run(char const *file, uint32_t repeat) {
+	ASSERT(file != NULL);
+	avlc_frame_qentry_t *frames = NULL;
+	ssize_t cnt = load_frames(file, &frames);
+	if(cnt < 0) {
+		return 2;
+	}
+	if(cnt == 0) {
+		fprintf(stderr, "%s: no frames found\n", file);
+		return 1;
+	}
+	fprintf(stderr, "Loaded %zd frames from %s, making %u pass(es)\n", cnt, file, repeat);
+
+	struct timespec t_start, t_end;
+	uint64_t decoded = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+	for(uint32_t pass = 0; pass < repeat && do_exit == 0; pass++) {
+		// Start each pass with empty reassembly tables, so that all passes
+		// do the same work
+		reasm_contexts rcontexts = {
+			.offsetbased = reasm_ctx_new(),
+			.seqbased = la_reasm_ctx_new()
+		};
+		for(ssize_t i = 0; i < cnt; i++) {
+			uint32_t msg_type = 0;
+			// Don't reuse the FCS check result from the previous pass
+			frames[i].flags = 0;
+			la_proto_node *root = avlc_parse(&frames[i], &msg_type, &rcontexts);
+			if(root != NULL) {
+				format_text(root);
+				format_json(root);
+				decoded++;
+			}
+			la_proto_tree_destroy(root);
+		}
+		reasm_ctx_destroy(rcontexts.offsetbased);
+		la_reasm_ctx_destroy(rcontexts.seqbased);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t_end);
+
+	double elapsed = (double)(t_end.tv_sec - t_start.tv_sec) + (double)(t_end.tv_nsec - t_start.tv_nsec) / 1e9;
+	if(elapsed <= 0.0) {
+		elapsed = 1e-9;
+	}
+	fprintf(stderr, "\nProtocol benchmark results:\n");
+	fprintf(stderr, "  %-18s %.3f s\n", "Elapsed time:", elapsed);
+	fprintf(stderr, "  %-18s %" PRIu64 " (%.1f frames/s)\n", "Frames decoded:", decoded, (double)decoded / elapsed);
+	bench_layer_report();
+
+	for(ssize_t i = 0; i < cnt; i++) {
+		octet_string_destroy(frames[i].frame);
+		vdl2_msg_metadata_destroy(frames[i].metadata);
+	}
+	XFREE(frames);
+	return 0;
+}
@@ -0,0 +1,288 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Benchmark mode (--bench).
+ * Each processing stage is timed with the CPU clock of the thread running it,
+ * so the results are not skewed by threads waiting on each other or by other
+ * processes competing for the CPU. Stages running in separate threads overlap
+ * in time, so the sum of their CPU times might well exceed the wall clock time.
+ * When benchmark mode is off, the hooks below return immediately.
+ */
+
+#include <stdio.h>                      // fprintf
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>                   // PRIu64
+#include <stdatomic.h>                  // atomic_*
+#include <time.h>                       // clock_gettime
+#include "bench.h"
+#include "dumpvdl2.h"                   // Config, ASSERT
+#include "metrics.h"                    // metrics_channel_*
+
+static struct {
+	char const *name;
+	int parent;                         // stage containing this one, -1 if none
+} const stage_descr[BENCH_STAGE_CNT] = {
+	[BENCH_DEMOD]           = { .name = "demodulation",     .parent = -1 },
+	[BENCH_BURST_DECODE]    = { .name = "burst decoding",   .parent = BENCH_DEMOD },
+	[BENCH_AVLC_DECODE]     = { .name = "AVLC decoding",    .parent = -1 },
+	[BENCH_FORMAT]          = { .name = "formatting",       .parent = -1 },
+	[BENCH_OUTPUT]          = { .name = "output",           .parent = -1 },
+};
+
+static struct {
+	atomic_uint_fast64_t nsec;
+	atomic_uint_fast64_t calls;
+} stages[BENCH_STAGE_CNT];
+
+static char const *layer_names[BENCH_LAYER_CNT] = {
+	[BENCH_LAYER_AVLC]      = "AVLC",
+	[BENCH_LAYER_XID]       = "XID",
+	[BENCH_LAYER_ACARS]     = "ACARS",
+	[BENCH_LAYER_X25]       = "X.25",
+	[BENCH_LAYER_CLNP]      = "CLNP",
+	[BENCH_LAYER_ESIS]      = "ES-IS",
+	[BENCH_LAYER_IDRP]      = "IDRP",
+	[BENCH_LAYER_COTP]      = "COTP",
+	[BENCH_LAYER_ICAO]      = "ICAO",
+};
+
+static char const *op_names[BENCH_OP_CNT] = {
+	[BENCH_OP_PARSE]        = "parse",
+	[BENCH_OP_FORMAT_TEXT]  = "text",
+	[BENCH_OP_FORMAT_JSON]  = "JSON",
+};
+
+static struct {
+	atomic_uint_fast64_t nsec;
+	atomic_uint_fast64_t calls;
+	atomic_uint_fast64_t allocs;
+} layers[BENCH_LAYER_CNT][BENCH_OP_CNT];
+
+// Layers are nested (eg. X.25 parser calls CLNP parser), so each thread keeps
+// a stack of layers it is currently in. Nested layer time is subtracted from
+// the time of the enclosing layer. Allocations are attributed to the innermost one.
+#define LAYER_DEPTH_MAX 16
+static _Thread_local struct {
+	bench_layer layer;
+	bench_op op;
+	uint64_t nested_nsec;
+} layer_stack[LAYER_DEPTH_MAX];
+static _Thread_local int layer_depth;
+
+static atomic_uint_fast64_t samples;
+static atomic_uint_fast64_t alloc_cnt;
+static atomic_uint_fast64_t alloc_bytes;
+static struct timespec t_start, t_input_done;
+
+static uint64_t timespec_nsec(struct timespec const *ts) {
+	return (uint64_t)ts->tv_sec * 1000000000ULL + (uint64_t)ts->tv_nsec;
+}
+
+static double timespec_diff(struct timespec const *start, struct timespec const *end) {
+	return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Must be called before any processing threads are started
+void bench_init(void) {
+	Config.bench = true;
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+}
+
+// Returns the CPU time of the calling thread, to be passed to bench_stage_end()
+uint64_t bench_stage_start(void) {
+	if(!Config.bench) {
+		return 0;
+	}
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return timespec_nsec(&ts);
+}
+
+void bench_stage_end(bench_stage stage, uint64_t start) {
+	if(!Config.bench) {
+		return;
+	}
+	ASSERT(stage < BENCH_STAGE_CNT);
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	atomic_fetch_add_explicit(&stages[stage].nsec, timespec_nsec(&ts) - start, memory_order_relaxed);
+	atomic_fetch_add_explicit(&stages[stage].calls, 1, memory_order_relaxed);
+}
+
+// cnt is the number of complex samples handed over to demodulators
+void bench_samples_add(uint32_t cnt) {
+	if(Config.bench) {
+		atomic_fetch_add_explicit(&samples, cnt, memory_order_relaxed);
+	}
+}
+
+// Called by xcalloc and xrealloc. Allocations done by libraries are not counted.
+void bench_alloc_add(size_t size) {
+	if(Config.bench) {
+		atomic_fetch_add_explicit(&alloc_cnt, 1, memory_order_relaxed);
+		atomic_fetch_add_explicit(&alloc_bytes, size, memory_order_relaxed);
+		if(layer_depth > 0 && layer_depth <= LAYER_DEPTH_MAX) {
+			int i = layer_depth - 1;
+			atomic_fetch_add_explicit(&layers[layer_stack[i].layer][layer_stack[i].op].allocs,
+					1, memory_order_relaxed);
+		}
+	}
+}
+
+// Called when all input samples have been demodulated. Throughput figures
+// are calculated up to this point. Decoding and output of the last few frames
+// is not waited for, as it's negligible compared to demodulation.
+void bench_input_done(void) {
+	if(Config.bench) {
+		clock_gettime(CLOCK_MONOTONIC, &t_input_done);
+	}
+}
+
+// Returns the CPU time of the calling thread, to be passed to bench_layer_end().
+// Calls must be paired, the innermost layer must be ended first.
+uint64_t bench_layer_start(bench_layer layer, bench_op op) {
+	if(!Config.bench) {
+		return 0;
+	}
+	ASSERT(layer < BENCH_LAYER_CNT);
+	ASSERT(op < BENCH_OP_CNT);
+	if(layer_depth < LAYER_DEPTH_MAX) {
+		layer_stack[layer_depth].layer = layer;
+		layer_stack[layer_depth].op = op;
+		layer_stack[layer_depth].nested_nsec = 0;
+	}
+	layer_depth++;
+	return bench_stage_start();
+}
+
+void bench_layer_end(uint64_t start) {
+	if(!Config.bench) {
+		return;
+	}
+	ASSERT(layer_depth > 0);
+	layer_depth--;
+	if(layer_depth >= LAYER_DEPTH_MAX) {
+		return;
+	}
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	uint64_t elapsed = timespec_nsec(&ts) - start;
+	uint64_t nested = layer_stack[layer_depth].nested_nsec;
+	bench_layer layer = layer_stack[layer_depth].layer;
+	bench_op op = layer_stack[layer_depth].op;
+	atomic_fetch_add_explicit(&layers[layer][op].nsec, elapsed > nested ? elapsed - nested : 0,
+			memory_order_relaxed);
+	atomic_fetch_add_explicit(&layers[layer][op].calls, 1, memory_order_relaxed);
+	if(layer_depth > 0) {
+		layer_stack[layer_depth - 1].nested_nsec += elapsed;
+	}
+}
+
+// Prints the CPU time spent in each protocol layer, if any was measured
+void bench_layer_report(void) {
+	if(!Config.bench) {
+		return;
+	}
+	bool header_printed = false;
+	for(int i = 0; i < BENCH_LAYER_CNT; i++) {
+		for(int j = 0; j < BENCH_OP_CNT; j++) {
+			uint64_t calls = atomic_load(&layers[i][j].calls);
+			if(calls == 0) {
+				continue;
+			}
+			if(!header_printed) {
+				fprintf(stderr, "  CPU time per protocol layer (excluding nested layers):\n");
+				fprintf(stderr, "    %-8s %-6s %12s %10s %10s %12s\n",
+						"layer", "op", "time", "calls", "us/call", "allocs/call");
+				header_printed = true;
+			}
+			uint64_t nsec = atomic_load(&layers[i][j].nsec);
+			fprintf(stderr, "    %-8s %-6s %10.3f s %10" PRIu64 " %10.2f %12.2f\n",
+					layer_names[i], op_names[j], (double)nsec / 1e9, calls,
+					(double)nsec / 1e3 / (double)calls,
+					(double)atomic_load(&layers[i][j].allocs) / (double)calls);
+		}
+	}
+}
+
+static uint64_t channel_counter_sum(metrics_channel_counter id) {
+	uint64_t sum = 0;
+	for(int i = 0; i < metrics_channel_cnt(); i++) {
+		sum += metrics_channel_counter_get(i, id);
+	}
+	return sum;
+}
+
+// Prints the results. Must be called after all processing threads have finished.
+// sample_rate is used to calculate the realtime factor (0 = skip it).
+void bench_report(uint32_t sample_rate) {
+	if(!Config.bench) {
+		return;
+	}
+	double elapsed = timespec_diff(&t_start, &t_input_done);
+	if(elapsed <= 0.0) {
+		elapsed = 1e-9;
+	}
+	uint64_t sample_cnt = atomic_load(&samples);
+	uint64_t bursts = channel_counter_sum(MC_DEMOD_SYNC_GOOD);
+	uint64_t frames = channel_counter_sum(MC_AVLC_FRAMES_PROCESSED);
+
+	fprintf(stderr, "\nBenchmark results:\n");
+	fprintf(stderr, "  %-18s %.3f s\n", "Elapsed time:", elapsed);
+	fprintf(stderr, "  %-18s %" PRIu64 " (%.0f samples/s", "Samples:", sample_cnt, (double)sample_cnt / elapsed);
+	if(sample_rate > 0) {
+		fprintf(stderr, ", %.2fx realtime", (double)sample_cnt / (double)sample_rate / elapsed);
+	}
+	fprintf(stderr, ")\n");
+	fprintf(stderr, "  %-18s %" PRIu64 " (%.1f bursts/s)\n", "Bursts:", bursts, (double)bursts / elapsed);
+	fprintf(stderr, "  %-18s %" PRIu64 " (%.1f frames/s)\n", "Frames:", frames, (double)frames / elapsed);
+
+	uint64_t nsec[BENCH_STAGE_CNT];
+	uint64_t total = 0;
+	for(int i = 0; i < BENCH_STAGE_CNT; i++) {
+		nsec[i] = atomic_load(&stages[i].nsec);
+	}
+	// Report CPU time of each stage exclusive of its sub-stages
+	for(int i = 0; i < BENCH_STAGE_CNT; i++) {
+		int parent = stage_descr[i].parent;
+		if(parent >= 0) {
+			nsec[parent] = nsec[parent] > nsec[i] ? nsec[parent] - nsec[i] : 0;
+		}
+	}
+	for(int i = 0; i < BENCH_STAGE_CNT; i++) {
+		total += nsec[i];
+	}
+	fprintf(stderr, "  CPU time per stage:\n");
+	for(int i = 0; i < BENCH_STAGE_CNT; i++) {
+		uint64_t calls = atomic_load(&stages[i].calls);
+		fprintf(stderr, "    %-16s %10.3f s %6.1f%% %12" PRIu64 " calls %10.2f us/call\n",
+				stage_descr[i].name, (double)nsec[i] / 1e9,
+				total > 0 ? 100.0 * (double)nsec[i] / (double)total : 0.0,
+				calls, calls > 0 ? (double)nsec[i] / 1e3 / (double)calls : 0.0);
+	}
+	fprintf(stderr, "    %-16s %10.3f s\n", "total", (double)total / 1e9);
+	uint64_t allocs = atomic_load(&alloc_cnt);
+	fprintf(stderr, "  %-18s %" PRIu64 " (%" PRIu64 " bytes", "Allocations:", allocs, (uint64_t)atomic_load(&alloc_bytes));
+	if(frames > 0) {
+		fprintf(stderr, ", %.1f per frame", (double)allocs / (double)frames);
+	}
+	fprintf(stderr, ")\n");
+	bench_layer_report();
+}
@@ -0,0 +1,77 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Processing stages whose CPU time is measured in benchmark mode.
+// When adding a new stage, update the descriptor table in bench.c as well.
+typedef enum {
+	BENCH_DEMOD,                        // filtering, resampling, sync and symbol demodulation
+	BENCH_BURST_DECODE,                 // descrambling, FEC and deinterleaving (part of BENCH_DEMOD)
+	BENCH_AVLC_DECODE,                  // AVLC frame decoding
+	BENCH_FORMAT,                       // message formatting (all formatters)
+	BENCH_OUTPUT,                       // message writes (all outputs)
+	BENCH_STAGE_CNT
+} bench_stage;
+
+// Protocol layers whose parsing and formatting cost is measured in benchmark
+// mode. Time spent in nested layers is not included in the time of the layer
+// containing them. When adding a new layer, update the name table in bench.c.
+typedef enum {
+	BENCH_LAYER_AVLC,
+	BENCH_LAYER_XID,
+	BENCH_LAYER_ACARS,                  // ACARS and its payloads (decoded by libacars)
+	BENCH_LAYER_X25,
+	BENCH_LAYER_CLNP,
+	BENCH_LAYER_ESIS,
+	BENCH_LAYER_IDRP,
+	BENCH_LAYER_COTP,
+	BENCH_LAYER_ICAO,                   // X.225, X.227 and ICAO ASN.1 applications
+	BENCH_LAYER_CNT
+} bench_layer;
+
+typedef enum {
+	BENCH_OP_PARSE,
+	BENCH_OP_FORMAT_TEXT,
+	BENCH_OP_FORMAT_JSON,
+	BENCH_OP_CNT
+} bench_op;
+
+// Max number of input file replays
+#define BENCH_REPEAT_MAX 100000
+
+// bench.c
+void bench_init(void);
+uint64_t bench_stage_start(void);
+void bench_stage_end(bench_stage stage, uint64_t start);
+void bench_samples_add(uint32_t cnt);
+void bench_alloc_add(size_t size);
+void bench_input_done(void);
+uint64_t bench_layer_start(bench_layer layer, bench_op op);
+void bench_layer_end(uint64_t start);
+void bench_layer_report(void);
+void bench_report(uint32_t sample_rate);
+
+// bench-protocols.c
+int bench_protocols_run(char const *file, uint32_t repeat);
+
+#endif // !_BENCH_H
@@ -67,6 +67,39 @@ int bitstream_append_lsbfirst(bitstream_t *bs, uint8_t const *bytes,
 	return 0;
 }
 
+int bitstream_append_word_msbfirst(bitstream_t *bs, uint32_t word, uint32_t numbits) {
+	if(bs->end + numbits > bs->len)
+		return -1;
+	for(int i = numbits - 1; i >= 0; i--)
+		bs->buf[bs->end++] = (word >> i) & 0x01;
+	return 0;
+}
+
+// Appends an HDLC frame - an opening flag, frame octets (LSB first) with a zero
+// bit inserted after each five consecutive ones, and a closing flag.
+// This is the reverse of bitstream_copy_next_frame().
+int bitstream_append_frame(bitstream_t *bs, uint8_t const *bytes, uint32_t numbytes) {
+	static uint8_t const flag = 0x7e;
+	if(bitstream_append_lsbfirst(bs, &flag, 1, 8) < 0)
+		return -1;
+	int ones = 0;
+	for(uint32_t i = 0; i < numbytes; i++) {
+		for(uint32_t j = 0; j < 8; j++) {
+			uint8_t bit = (bytes[i] >> j) & 0x01;
+			if(bs->end + 2 > bs->len)
+				return -1;
+			bs->buf[bs->end++] = bit;
+			if(bit == 0x0) {
+				ones = 0;
+			} else if(++ones == 5) {
+				bs->buf[bs->end++] = 0x0;
+				ones = 0;
+			}
+		}
+	}
+	return bitstream_append_lsbfirst(bs, &flag, 1, 8);
+}
+
 int bitstream_read_lsbfirst(bitstream_t *bs, uint8_t *bytes,
 		uint32_t numbytes, uint32_t numbits) {
 	if(bs->start + numbits * numbytes > bs->end)
@@ -91,6 +124,7 @@ int bitstream_read_word_msbfirst(bitstream_t *bs, uint32_t *ret,
 	return 0;
 }
 
+// Scrambling is an XOR with the LFSR sequence, so this function scrambles as well
 void bitstream_descramble(bitstream_t *bs, uint16_t *lfsr) {
 	uint8_t bit;
 
@@ -24,6 +24,7 @@
 #include <libacars/dict.h>          // la_dict
 #include <libacars/json.h>
 #include "dumpvdl2.h"
+#include "bench.h"                  // bench_layer_*
 #include "tlv.h"
 #include "clnp.h"
 #include "reassembly.h"
@@ -82,8 +83,6 @@ static reasm_table_funcs clnp_reasm_funcs = {
 	.destroy_key = clnp_reasm_key_destroy
 };
 
-#define CLNP_REASM_TABLE_CLEANUP_INTERVAL 20
-
 static la_proto_node *parse_clnp_pdu_payload(uint8_t *buf, uint32_t len, uint32_t *msg_type,
 		reasm_contexts *rtables, struct timeval rx_time, uint32_t src_addr, uint32_t dst_addr) {
 	if(len == 0) {
@@ -237,6 +236,7 @@ static la_dict const clnp_options[] = {
 
 la_proto_node *clnp_pdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type,
 		reasm_contexts *rtables, struct timeval rx_time, uint32_t src_addr, uint32_t dst_addr) {
+	uint64_t t = bench_layer_start(BENCH_LAYER_CLNP, BENCH_OP_PARSE);
 	NEW(clnp_pdu_t, pdu);
 	la_proto_node *node = la_proto_node_new();
 	node->td = &proto_DEF_clnp_pdu;
@@ -326,7 +326,7 @@ la_proto_node *clnp_pdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type,
 			reasm_table *clnp_rtable = reasm_table_lookup(rtables->offsetbased, &proto_DEF_clnp_pdu);
 			if(clnp_rtable == NULL) {
 				clnp_rtable = reasm_table_new(rtables->offsetbased, &proto_DEF_clnp_pdu,
-						clnp_reasm_funcs, CLNP_REASM_TABLE_CLEANUP_INTERVAL);
+						clnp_reasm_funcs);
 			}
 			struct clnp_reasm_key reasm_key = {
 				.src_addr = src_addr, .dst_addr = dst_addr, .pdu_id = pdu->pdu_id
@@ -339,6 +339,7 @@ la_proto_node *clnp_pdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type,
 					.rx_time = rx_time,
 					.reasm_timeout = pdu->lifetime,
 					.offset = pdu->offset,
+					.pdu_len_hint = pdu->total_pdu_len,
 					.is_final_fragment = !hdr->ms,
 					});
 			debug_print(D_MISC, "PDU %d: reasm_status: %s\n", pdu->pdu_id, reasm_status_name_get(pdu->reasm_status));
@@ -361,9 +362,11 @@ la_proto_node *clnp_pdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type,
 			unknown_proto_pdu_new(buf + hdr->len, len - hdr->len);
 	}
 	pdu->err = false;
+	bench_layer_end(t);
 	return node;
 fail:
 	node->next = unknown_proto_pdu_new(buf, len);
+	bench_layer_end(t);
 	return node;
 }
 
@@ -575,6 +578,7 @@ la_type_descriptor const proto_DEF_clnp_compressed_data_pdu;
 
 la_proto_node *clnp_compressed_data_pdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type,
 		reasm_contexts *rtables, struct timeval rx_time, uint32_t src_addr, uint32_t dst_addr) {
+	uint64_t t = bench_layer_start(BENCH_LAYER_CLNP, BENCH_OP_PARSE);
 	NEW(clnp_compressed_data_pdu_t, pdu);
 	la_proto_node *node = la_proto_node_new();
 	node->td = &proto_DEF_clnp_compressed_data_pdu;
@@ -656,7 +660,7 @@ la_proto_node *clnp_compressed_data_pdu_parse(uint8_t *buf, uint32_t len, uint32
 		reasm_table *clnp_rtable = reasm_table_lookup(rtables->offsetbased, &proto_DEF_clnp_compressed_data_pdu);
 		if(clnp_rtable == NULL) {
 			clnp_rtable = reasm_table_new(rtables->offsetbased, &proto_DEF_clnp_pdu,
-					clnp_reasm_funcs, CLNP_REASM_TABLE_CLEANUP_INTERVAL);
+					clnp_reasm_funcs);
 		}
 		struct clnp_reasm_key reasm_key = {
 			.src_addr = src_addr, .dst_addr = dst_addr, .pdu_id = pdu->pdu_id
@@ -669,6 +673,7 @@ la_proto_node *clnp_compressed_data_pdu_parse(uint8_t *buf, uint32_t len, uint32
 				.rx_time = rx_time,
 				.reasm_timeout = pdu->lifetime,
 				.offset = pdu->offset,
+				.pdu_len_hint = pdu->total_pdu_len,
 				.is_final_fragment = !pdu->more_segments,
 				});
 		debug_print(D_MISC, "PDU %d: reasm_status: %s\n", pdu->pdu_id, reasm_status_name_get(pdu->reasm_status));
@@ -689,9 +694,11 @@ la_proto_node *clnp_compressed_data_pdu_parse(uint8_t *buf, uint32_t len, uint32
 		unknown_proto_pdu_new(ptr, remaining);
 
 	pdu->err = false;
+	bench_layer_end(t);
 	return node;
 fail:
 	node->next = unknown_proto_pdu_new(buf, len);
+	bench_layer_end(t);
 	return node;
 }
 
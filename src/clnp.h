@@ -129,6 +129,8 @@ typedef struct {
 } clnp_compressed_data_pdu_t;
 
 // clnp.c
+extern la_type_descriptor const proto_DEF_clnp_pdu;
+extern la_type_descriptor const proto_DEF_clnp_compressed_data_pdu;
 la_proto_node *clnp_pdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type,
 		reasm_contexts *rtables, struct timeval rx_time, uint32_t src_addr, uint32_t dst_addr);
 la_proto_node *clnp_compressed_data_pdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type,
@@ -29,6 +29,7 @@
 #include <libacars/json.h>
 #include <libacars/reassembly.h>
 #include "dumpvdl2.h"
+#include "bench.h"                  // bench_layer_*
 #include "tlv.h"
 #include "cotp.h"
 #include "icao.h"
@@ -651,6 +652,7 @@ fail:
 
 la_proto_node *cotp_concatenated_pdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type,
 		la_reasm_ctx *rtables, struct timeval rx_time, uint32_t src_addr, uint32_t dst_addr) {
+	uint64_t t = bench_layer_start(BENCH_LAYER_COTP, BENCH_OP_PARSE);
 	la_list *pdu_list = NULL;
 	la_proto_node *node = la_proto_node_new();
 	node->td = &proto_DEF_cotp_concatenated_pdu;
@@ -676,6 +678,7 @@ la_proto_node *cotp_concatenated_pdu_parse(uint8_t *buf, uint32_t len, uint32_t
 		buf += r.consumed; len -= r.consumed;
 	}
 	node->data = pdu_list;
+	bench_layer_end(t);
 	return node;
 }
 
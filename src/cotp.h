@@ -55,5 +55,6 @@ typedef struct {
 } cotp_pdu_t;
 
 // cotp.c
+extern la_type_descriptor const proto_DEF_cotp_concatenated_pdu;
 la_proto_node *cotp_concatenated_pdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type,
 		la_reasm_ctx *rtables, struct timeval rx_time, uint32_t src_addr, uint32_t dst_addr);
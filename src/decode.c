@@ -27,15 +27,16 @@
 #include <math.h>                   // log10f
 #include <libacars/libacars.h>      // la_proto_node, la_proto_tree_destroy()
 #include <libacars/reassembly.h>    // la_reasm_ctx, la_reasm_ctx_new()
+#include <sys/time.h>               // gettimeofday
 #include "config.h"
-#ifdef WITH_STATSD
-#include <sys/time.h>
-#endif
 #include "decode.h"                 // avlc_decoder_queue
 #include "output-common.h"
 #include "dumpvdl2.h"
 #include "avlc.h"                   // avlc_frame_qentry_t
 #include "reassembly.h"             // reasm_ctx, reasm_ctx_new()
+#include "dedup.h"                  // dedup_*
+#include "metrics.h"                // metrics_*
+#include "bench.h"                  // bench_stage_*
 
 // Reasonable limits for transmission lengths in bits
 // This is to avoid blocking the decoder in DEC_DATA for a long time
@@ -51,6 +52,7 @@
 
 bool decoder_thread_active;
 static GAsyncQueue *avlc_decoder_queue;
+static int avlc_decoder_queue_id = -1;
 
 static uint32_t const H[HDRFECLEN] = {
 	0b0000000011111111111110000,
@@ -121,6 +123,14 @@ static uint32_t decode_header(uint32_t *r) {
 	return syndrome;
 }
 
+// Computes header FEC bits for the given header word (with FEC bits set to 0)
+static uint32_t encode_header(uint32_t h) {
+	for(int i = 0; i < HDRFECLEN; i++) {
+		h |= parity(h & H[i]) << (HDRFECLEN - 1 - i);
+	}
+	return h;
+}
+
 static int get_fec_octetcount(uint32_t len) {
 	if(len < 3)
 		return 0;
@@ -162,11 +172,44 @@ static int deinterleave(uint8_t *in, uint32_t len, uint32_t rows, uint32_t cols,
 	return 0;
 }
 
+// Reverse of deinterleave() - reads len octets from the given columns of in,
+// column by column, and stores them in out
+static void interleave(uint32_t rows, uint32_t cols, uint8_t in[][cols], uint32_t len, uint32_t fillwidth,
+		uint32_t offset, uint8_t *out) {
+	uint32_t last_row_len = len % fillwidth;
+	if(last_row_len == 0) last_row_len = fillwidth;
+	uint32_t row = 0, col = offset;
+	last_row_len += offset;
+	for(uint32_t i = 0; i < len; i++) {
+		if(row == rows - 1 && col >= last_row_len) {
+			row = 0;
+			col++;
+		}
+		out[i] = in[row++][col];
+		if(row == rows) {
+			row = 0;
+			col++;
+		}
+	}
+}
+
 void avlc_decoder_queue_push(vdl2_msg_metadata *metadata, octet_string_t *frame, int flags) {
+	if(metadata != NULL) {
+		vdl2_msg_trace_mark(metadata, TRACE_ENQUEUED);
+		metrics_observe_interval_per_channel(metadata->freq, MH_LATENCY_DEMOD,
+				&metadata->trace[TRACE_SYNC], &metadata->trace[TRACE_ENQUEUED]);
+	}
 	NEW(avlc_frame_qentry_t, qentry);
 	qentry->metadata = metadata;
 	qentry->frame = frame;
 	qentry->flags = flags;
+	// Start aircraft DB queries now, so that they run while the frame waits
+	// in the queue. The FCS check result is cached in the frame flags, so the
+	// decoder does not repeat it.
+	if(frame != NULL && avlc_frame_check_fcs(qentry)) {
+		avlc_frame_prefetch_addrinfo(frame);
+	}
+	metrics_queue_push(avlc_decoder_queue_id);
 	g_async_queue_push(avlc_decoder_queue, qentry);
 }
 
@@ -186,6 +229,7 @@ static void decode_frame(vdl2_channel_t const *v,
 	metadata->synd_weight = synd_weight[v->syndrome];
 	metadata->num_fec_corrections = v->num_fec_corrections;
 	metadata->idx = frame_num;
+	metadata->trace[TRACE_SYNC] = v->burst_sync_time;
 	int flags = 0;
 
 	uint8_t *copy = XCALLOC(len, sizeof(uint8_t));
@@ -201,7 +245,7 @@ void decode_vdl2_burst(vdl2_channel_t *v) {
 			uint32_t header;
 			if(bitstream_read_word_msbfirst(v->bs, &header, HEADER_LEN) < 0) {
 				debug_print(D_BURST, "Could not read header from bitstream\n");
-				statsd_increment_per_channel(v->freq, "decoder.errors.no_header");
+				metrics_inc_per_channel(v->freq, MC_DECODER_ERRORS_NO_HEADER);
 				v->decoder_state = DEC_IDLE;
 				return;
 			}
@@ -209,12 +253,12 @@ void decode_vdl2_burst(vdl2_channel_t *v) {
 			header &= ONES(TRLEN+HDRFECLEN);
 			v->syndrome = decode_header(&header);
 			if(v->syndrome == 0) {
-				statsd_increment_per_channel(v->freq, "decoder.crc.good");
+				metrics_inc_per_channel(v->freq, MC_DECODER_CRC_GOOD);
 			}
 			// sanity check - reserved symbol bits shall still be set to 0
 			if((header & ONES(TRLEN+HDRFECLEN)) != header) {
 				debug_print(D_BURST, "Rejecting decoded header with non-zero reserved bits\n");
-				statsd_increment_per_channel(v->freq, "decoder.crc.bad");
+				metrics_inc_per_channel(v->freq, MC_DECODER_CRC_BAD);
 				v->decoder_state = DEC_IDLE;
 				return;
 			}
@@ -226,7 +270,7 @@ void decode_vdl2_burst(vdl2_channel_t *v) {
 			// possibly overlooking valid frames.
 			if((v->syndrome != 0 && v->datalen > MAX_FRAME_LENGTH_CORRECTED) || v->datalen > MAX_FRAME_LENGTH) {
 				debug_print(D_BURST, "v->datalen=%u v->syndrome=%u - frame rejected\n", v->datalen, v->syndrome);
-				statsd_increment_per_channel(v->freq, "decoder.errors.too_long");
+				metrics_inc_per_channel(v->freq, MC_DECODER_ERRORS_TOO_LONG);
 				v->decoder_state = DEC_IDLE;
 				return;
 			}
@@ -246,7 +290,7 @@ void decode_vdl2_burst(vdl2_channel_t *v) {
 
 			if(v->fec_octets == 0) {
 				debug_print(D_BURST, "fec_octets is 0 which means the frame is unreasonably short\n");
-				statsd_increment_per_channel(v->freq, "decoder.errors.no_fec");
+				metrics_inc_per_channel(v->freq, MC_DECODER_ERRORS_NO_FEC);
 				v->decoder_state = DEC_IDLE;
 				return;
 			}
@@ -254,20 +298,18 @@ void decode_vdl2_burst(vdl2_channel_t *v) {
 			v->decoder_state = DEC_DATA;
 			return;
 		case DEC_DATA:
-#ifdef WITH_STATSD
 			gettimeofday(&v->tstart, NULL);
-#endif
 			bitstream_descramble(v->bs, &v->lfsr);
 			uint8_t *data = XCALLOC(v->datalen_octets, sizeof(uint8_t));
 			uint8_t *fec = XCALLOC(v->fec_octets, sizeof(uint8_t));
 			if(bitstream_read_lsbfirst(v->bs, data, v->datalen_octets, 8) < 0) {
 				debug_print(D_BURST, "Frame data truncated\n");
-				statsd_increment_per_channel(v->freq, "decoder.errors.data_truncated");
+				metrics_inc_per_channel(v->freq, MC_DECODER_ERRORS_DATA_TRUNCATED);
 				goto cleanup;
 			}
 			if(bitstream_read_lsbfirst(v->bs, fec, v->fec_octets, 8) < 0) {
 				debug_print(D_BURST, "FEC data truncated\n");
-				statsd_increment_per_channel(v->freq, "decoder.errors.fec_truncated");
+				metrics_inc_per_channel(v->freq, MC_DECODER_ERRORS_FEC_TRUNCATED);
 				goto cleanup;
 			}
 			debug_print_buf_hex(D_BURST_DETAIL, data, v->datalen_octets, "Data:\n");
@@ -278,7 +320,7 @@ void decode_vdl2_burst(vdl2_channel_t *v) {
 				int ret;
 				if((ret = deinterleave(data, v->datalen_octets, v->num_blocks, RS_N, rs_tab, RS_K, 0)) < 0) {
 					debug_print(D_BURST, "Deinterleaver failed with error %d\n", ret);
-					statsd_increment_per_channel(v->freq, "decoder.errors.deinterleave_data");
+					metrics_inc_per_channel(v->freq, MC_DECODER_ERRORS_DEINTERLEAVE_DATA);
 					goto cleanup;
 				}
 
@@ -289,7 +331,7 @@ void decode_vdl2_burst(vdl2_channel_t *v) {
 
 				if((ret = deinterleave(fec, v->fec_octets, fec_rows, RS_N, rs_tab, RS_N - RS_K, RS_K)) < 0) {
 					debug_print(D_BURST, "Deinterleaver failed with error %d\n", ret);
-					statsd_increment_per_channel(v->freq, "decoder.errors.deinterleave_fec");
+					metrics_inc_per_channel(v->freq, MC_DECODER_ERRORS_DEINTERLEAVE_FEC);
 					goto cleanup;
 				}
 #ifdef DEBUG
@@ -300,7 +342,7 @@ void decode_vdl2_burst(vdl2_channel_t *v) {
 #endif
 				bitstream_reset(v->bs);
 				for(uint32_t r = 0; r < v->num_blocks; r++) {
-					statsd_increment_per_channel(v->freq, "decoder.blocks.processed");
+					metrics_inc_per_channel(v->freq, MC_DECODER_BLOCKS_PROCESSED);
 					int num_fec_octets = RS_N - RS_K;   // full block
 					if(r == v->num_blocks - 1) {        // final, partial block
 						num_fec_octets = get_fec_octetcount(v->last_block_len_octets);
@@ -309,10 +351,10 @@ void decode_vdl2_burst(vdl2_channel_t *v) {
 					debug_print(D_BURST, "Block %d FEC: %d\n", r, ret);
 					if(ret < 0) {
 						debug_print(D_BURST, "FEC check failed\n");
-						statsd_increment_per_channel(v->freq, "decoder.errors.fec_bad");
+						metrics_inc_per_channel(v->freq, MC_DECODER_ERRORS_FEC_BAD);
 						goto cleanup;
 					} else {
-						statsd_increment_per_channel(v->freq, "decoder.blocks.fec_ok");
+						metrics_inc_per_channel(v->freq, MC_DECODER_BLOCKS_FEC_OK);
 						if(ret > 0) {
 							debug_print_buf_hex(D_BURST_DETAIL, rs_tab[r], RS_N, "Corrected block %d:\n", r);
 							// count corrected octets, excluding intended erasures
@@ -325,7 +367,7 @@ void decode_vdl2_burst(vdl2_channel_t *v) {
 						ret = bitstream_append_lsbfirst(v->bs, (uint8_t *)&rs_tab[r], v->last_block_len_octets, 8);
 					if(ret < 0) {
 						debug_print(D_BURST, "bitstream_append_lsbfirst failed\n");
-						statsd_increment_per_channel(v->freq, "decoder.errors.bitstream");
+						metrics_inc_per_channel(v->freq, MC_DECODER_ERRORS_BITSTREAM);
 						goto cleanup;
 					}
 				}
@@ -342,7 +384,7 @@ void decode_vdl2_burst(vdl2_channel_t *v) {
 			while((ret = bitstream_copy_next_frame(v->bs, v->frame_bs)) >= 0) {
 				if((v->frame_bs->end - v->frame_bs->start) % 8 != 0) {
 					debug_print(D_BURST, "Frame %d: Bit stream error: does not end on a byte boundary\n", frame_cnt);
-					statsd_increment_per_channel(v->freq, "decoder.errors.truncated_octets");
+					metrics_inc_per_channel(v->freq, MC_DECODER_ERRORS_TRUNCATED_OCTETS);
 					goto cleanup;
 				}
 				debug_print(D_BURST, "Frame %d: Stream OK after unstuffing, length is %u octets\n",
@@ -351,10 +393,10 @@ void decode_vdl2_burst(vdl2_channel_t *v) {
 				memset(data, 0, frame_len_octets * sizeof(uint8_t));
 				if(bitstream_read_lsbfirst(v->frame_bs, data, frame_len_octets, 8) < 0) {
 					debug_print(D_BURST, "Frame %d: bitstream_read_lsbfirst failed\n", frame_cnt);
-					statsd_increment_per_channel(v->freq, "decoder.errors.bitstream");
+					metrics_inc_per_channel(v->freq, MC_DECODER_ERRORS_BITSTREAM);
 					goto cleanup;
 				}
-				statsd_increment_per_channel(v->freq, "decoder.msg.good");
+				metrics_inc_per_channel(v->freq, MC_DECODER_MSG_GOOD);
 				decode_frame(v, frame_cnt, data, frame_len_octets);
 				frame_cnt++;
 				if(ret == 0) { // this was the last frame in this burst
@@ -362,12 +404,15 @@ void decode_vdl2_burst(vdl2_channel_t *v) {
 				}
 			}
 			if(ret < 0) {
-				statsd_increment_per_channel(v->freq, "decoder.errors.unstuff");
+				metrics_inc_per_channel(v->freq, MC_DECODER_ERRORS_UNSTUFF);
 				goto cleanup;
 			}
-			statsd_timing_delta_per_channel(v->freq, "decoder.msg.processing_time", v->tstart);
+			metrics_timing_per_channel(v->freq, MH_DECODER_MSG_PROCESSING_TIME, v->tstart);
+			if(v->frame_pwr > 0.0F) {
+				metrics_observe_per_channel(v->freq, MH_DECODER_MSG_POWER, 10.0F * log10f(v->frame_pwr));
+			}
 			if(v->frame_pwr > 1.0F) {	// check for log(v->frame_power) > 0dBFs
-				statsd_increment_per_channel(v->freq, "decoder.msg.good_loud");
+				metrics_inc_per_channel(v->freq, MC_DECODER_MSG_GOOD_LOUD);
 			}
 cleanup:
 			XFREE(data);
@@ -380,6 +425,77 @@ cleanup:
 	}
 }
 
+// Encodes an AVLC frame (including FCS) into a VDL2 burst - the reverse of
+// decode_vdl2_burst(). The frame gets bit-stuffed and enclosed in flags,
+// Reed-Solomon encoded, interleaved, preceded by the header and scrambled.
+// The resulting bits (from the reserved symbol onwards, ie. without ramp-up
+// and preamble) are stored in bs, which must be empty.
+// Returns 0 on success or -1 if the frame is too long.
+int encode_vdl2_burst(uint8_t const *frame, uint32_t len, bitstream_t *bs) {
+	ASSERT(frame != NULL);
+	ASSERT(bs != NULL);
+	int ret = -1;
+	// worst case: stuffing adds one bit per five, plus two flags
+	bitstream_t *payload = bitstream_init(len * 8 + len * 8 / 5 + 16);
+	if(bitstream_append_frame(payload, frame, len) < 0) {
+		goto end;
+	}
+	uint32_t datalen = payload->end;
+	if(datalen > MAX_FRAME_LENGTH_CORRECTED) {
+		debug_print(D_BURST, "Frame too long: %u bits\n", datalen);
+		goto end;
+	}
+	uint32_t datalen_octets = datalen / 8;
+	if(datalen % 8 != 0)
+		datalen_octets++;
+	// Pad the payload with zero bits up to a whole octet
+	payload->end = datalen_octets * 8;
+	uint32_t num_blocks = datalen_octets / RS_K;
+	uint32_t fec_octets = num_blocks * (RS_N - RS_K);
+	uint32_t last_block_len_octets = datalen_octets % RS_K;
+	if(last_block_len_octets != 0)
+		num_blocks++;
+	else
+		last_block_len_octets = RS_K;
+	fec_octets += get_fec_octetcount(datalen_octets % RS_K);
+
+	{
+		uint8_t data[datalen_octets], fec[fec_octets];
+		uint8_t rs_tab[num_blocks][RS_N];
+		memset(rs_tab, 0, sizeof(uint8_t[num_blocks][RS_N]));
+		for(uint32_t r = 0; r < num_blocks; r++) {
+			uint32_t block_len = (r == num_blocks - 1 ? last_block_len_octets : RS_K);
+			bitstream_read_lsbfirst(payload, rs_tab[r], block_len, 8);
+			// Partial blocks are encoded as if padded with zeros up to RS_K octets.
+			// All parity octets are computed, but only the first
+			// get_fec_octetcount(block_len) of them are transmitted.
+			rs_encode(rs_tab[r], rs_tab[r] + RS_K);
+		}
+		uint32_t fec_rows = num_blocks;
+		if(get_fec_octetcount(last_block_len_octets) == 0)
+			fec_rows--;
+		interleave(num_blocks, RS_N, rs_tab, datalen_octets, RS_K, 0, data);
+		if(fec_octets > 0) {
+			interleave(fec_rows, RS_N, rs_tab, fec_octets, RS_N - RS_K, RS_K, fec);
+		}
+
+		bitstream_reset(bs);
+		// reserved symbol (3 zero bits), transmission length (LSB first), header FEC
+		uint32_t header = encode_header(reverse(datalen, TRLEN) << HDRFECLEN);
+		if(bitstream_append_word_msbfirst(bs, header, HEADER_LEN) < 0 ||
+				bitstream_append_lsbfirst(bs, data, datalen_octets, 8) < 0 ||
+				bitstream_append_lsbfirst(bs, fec, fec_octets, 8) < 0) {
+			goto end;
+		}
+	}
+	uint16_t lfsr = LFSR_IV;
+	bitstream_descramble(bs, &lfsr);
+	ret = 0;
+end:
+	bitstream_destroy(payload);
+	return ret;
+}
+
 static void output_queue_push(void *data, void *ctx) {
 	ASSERT(data != NULL);
 	ASSERT(ctx != NULL);
@@ -391,9 +507,11 @@ static void output_queue_push(void *data, void *ctx) {
 	bool active = output->ctx->active;
 	if(qentry->flags & OUT_FLAG_ORDERED_SHUTDOWN || (active && !overflow)) {
 		output_qentry_t *copy = output_qentry_copy(qentry);
+		metrics_queue_push(output->ctx->queue_id);
 		g_async_queue_push(output->ctx->q, copy);
 		debug_print(D_OUTPUT, "dispatched %s output %p\n", output->td->name, output);
 	} else {
+		metrics_queue_drop(output->ctx->queue_id);
 		if(overflow) {
 			fprintf(stderr, "%s output queue overflow, throttling\n", output->td->name);
 		} else if(!active) {
@@ -416,14 +534,16 @@ static void shutdown_outputs(la_list *fmtr_list) {
 	}
 }
 
-void *avlc_decoder_thread(void *arg) {
-	ASSERT(arg != NULL);
-	la_list *fmtr_list = arg;
-	avlc_frame_qentry_t *q = NULL;
-	la_proto_node *root = NULL;
-	uint32_t msg_type = 0;
+// Called for every message produced by a formatter. Takes ownership of qentry->msg.
+typedef void (*avlc_output_sink)(la_list *outputs, output_qentry_t *qentry, void *ctx);
 
-	decoder_thread_active = true;
+static void dispatch_to_outputs(la_list *outputs, output_qentry_t *qentry, void *ctx) {
+	UNUSED(ctx);
+	la_list_foreach(outputs, output_queue_push, qentry);
+	// output_queue_push makes a copy of the message, so it's safe to free it now
+	octet_string_destroy(qentry->msg);
+	qentry->msg = NULL;
+}
 
 // Currently there are two reassembly engine implementations:
 // - based on fragment offsets (in dumpvdl2, used only for CLNP)
@@ -437,94 +557,342 @@ void *avlc_decoder_thread(void *arg) {
 // context pointers through the whole decoding stack of functions. This
 // is probably the least messy way to implement this for now, but it
 // needs an improvement.
-	la_reasm_ctx *seqbased_reasm_ctx = la_reasm_ctx_new();
-	reasm_ctx *offsetbased_reasm_ctx = reasm_ctx_new();
-	reasm_contexts rcontexts = {
-		.offsetbased = offsetbased_reasm_ctx,
-		.seqbased = seqbased_reasm_ctx
-	};
+static void reasm_contexts_init(reasm_contexts *rcontexts) {
+	rcontexts->offsetbased = reasm_ctx_new();
+	rcontexts->seqbased = la_reasm_ctx_new();
+}
+
+static void reasm_contexts_destroy(reasm_contexts *rcontexts) {
+	reasm_ctx_destroy(rcontexts->offsetbased);
+	la_reasm_ctx_destroy(rcontexts->seqbased);
+	rcontexts->offsetbased = NULL;
+	rcontexts->seqbased = NULL;
+}
 
+static void avlc_frame_trace_formatted(vdl2_msg_metadata *metadata) {
+	vdl2_msg_trace_mark(metadata, TRACE_FORMATTED);
+	metrics_observe_interval_per_channel(metadata->freq, MH_LATENCY_FORMAT,
+			&metadata->trace[TRACE_FORMAT_START], &metadata->trace[TRACE_FORMATTED]);
+}
+
+// Decodes the frame (if any formatter needs it), runs it through all formatters
+// and hands the results over to the sink. If sink is NULL, the frame is only
+// decoded to update reassembly state and no output is produced.
+static void avlc_frame_process(avlc_frame_qentry_t *q, la_list *fmtr_list,
+		reasm_contexts *rcontexts, avlc_output_sink sink, void *sink_ctx) {
+	la_proto_node *root = NULL;
+	uint32_t msg_type = 0;
 	enum {
 		DEC_NOT_DONE,
 		DEC_SUCCESS,
 		DEC_FAILURE
-	} decoding_status;
+	} decoding_status = DEC_NOT_DONE;
+
+	if(sink != NULL) {
+		metrics_inc_per_channel(q->metadata->freq, MC_AVLC_FRAMES_PROCESSED);
+	}
+	fmtr_instance_t *fmtr = NULL;
+	for(la_list *p = fmtr_list; p != NULL; p = la_list_next(p)) {
+		fmtr = p->data;
+		if(fmtr->intype == FMTR_INTYPE_DECODED_FRAME) {
+			// Decode the frame unless we've done it before
+			if(decoding_status == DEC_NOT_DONE) {
+				msg_type = 0;
+				uint64_t t = bench_stage_start();
+				root = avlc_parse(q, &msg_type, rcontexts);
+				bench_stage_end(BENCH_AVLC_DECODE, t);
+				vdl2_msg_trace_mark(q->metadata, TRACE_DECODED);
+				metrics_observe_interval_per_channel(q->metadata->freq, MH_LATENCY_DECODE,
+						&q->metadata->trace[TRACE_DECODE_START], &q->metadata->trace[TRACE_DECODED]);
+				if(root != NULL) {
+					decoding_status = DEC_SUCCESS;
+				} else {
+					decoding_status = DEC_FAILURE;
+					la_proto_tree_destroy(root);
+					root = NULL;
+				}
+			}
+			if(decoding_status == DEC_SUCCESS && sink != NULL) {
+				if((msg_type & Config.msg_filter) == msg_type) {
+					debug_print(D_OUTPUT, "msg_type: %x msg_filter: %x (accepted)\n", msg_type, Config.msg_filter);
+					vdl2_msg_trace_mark(q->metadata, TRACE_FORMAT_START);
+					uint64_t t = bench_stage_start();
+					octet_string_t *serialized_msg = fmtr->td->format_decoded_msg(q->metadata, root);
+					bench_stage_end(BENCH_FORMAT, t);
+					avlc_frame_trace_formatted(q->metadata);
+					// First check if the formatter actually returned something.
+					// A formatter might be suitable only for a particular message type. If this is the case.
+					// it will return NULL for all messages it cannot handle.
+					// An example is pp_acars which only deals with ACARS messages.
+					if(serialized_msg != NULL) {
+						output_qentry_t qentry = {
+							.msg = serialized_msg,
+							.metadata = q->metadata,
+							.format = fmtr->td->output_format
+						};
+						sink(fmtr->outputs, &qentry, sink_ctx);
+					}
+				} else {
+					debug_print(D_OUTPUT, "msg_type: %x msg_filter: %x (filtered out)\n", msg_type, Config.msg_filter);
+				}
+			}
+		} else if(fmtr->intype == FMTR_INTYPE_RAW_FRAME && sink != NULL) {
+			vdl2_msg_trace_mark(q->metadata, TRACE_FORMAT_START);
+			uint64_t t = bench_stage_start();
+			octet_string_t *serialized_msg = fmtr->td->format_raw_msg(q->metadata, q->frame);
+			bench_stage_end(BENCH_FORMAT, t);
+			avlc_frame_trace_formatted(q->metadata);
+			if(serialized_msg != NULL) {
+				output_qentry_t qentry = {
+					.msg = serialized_msg,
+					.metadata = q->metadata,
+					.format = fmtr->td->output_format
+				};
+				sink(fmtr->outputs, &qentry, sink_ctx);
+			}
+		}
+	}
+	la_proto_tree_destroy(root);
+}
+
+static void avlc_frame_qentry_destroy(avlc_frame_qentry_t *q) {
+	if(q == NULL) {
+		return;
+	}
+	octet_string_destroy(q->frame);
+	XFREE(q->metadata);
+	XFREE(q);
+}
+
+// dedup callback for both decoder flavours - drops a duplicate frame
+static void avlc_frame_discard(void *item, void *ctx) {
+	UNUSED(ctx);
+	avlc_frame_qentry_t *q = item;
+	debug_print(D_PROTO, "Dropping duplicate frame %d received on %u Hz\n",
+			q->metadata->idx, q->metadata->freq);
+	avlc_frame_qentry_destroy(q);
+}
+
+typedef struct {
+	la_list *fmtr_list;
+	reasm_contexts rcontexts;
+} avlc_decoder_ctx;
+
+static void avlc_decoder_process(void *item, void *ctx) {
+	avlc_frame_qentry_t *q = item;
+	avlc_decoder_ctx *d = ctx;
+	// Time spent in the deduplication window counts as queueing time
+	vdl2_msg_trace_mark(q->metadata, TRACE_DECODE_START);
+	metrics_observe_interval_per_channel(q->metadata->freq, MH_LATENCY_DECODER_QUEUE,
+			&q->metadata->trace[TRACE_ENQUEUED], &q->metadata->trace[TRACE_DECODE_START]);
+	avlc_frame_process(q, d->fmtr_list, &d->rcontexts, dispatch_to_outputs, NULL);
+	avlc_frame_qentry_destroy(q);
+}
+
+void *avlc_decoder_thread(void *arg) {
+	ASSERT(arg != NULL);
+	avlc_frame_qentry_t *q = NULL;
+
+	decoder_thread_active = true;
+
+	avlc_decoder_ctx d = { .fmtr_list = arg };
+	reasm_contexts_init(&d.rcontexts);
+	dedup_ctx *dedup = dedup_ctx_new(
+			(dedup_funcs){ .release = avlc_decoder_process, .discard = avlc_frame_discard }, &d);
+
 	while(1) {
-		q = g_async_queue_pop(avlc_decoder_queue);
+		if(dedup_pending(dedup)) {
+			q = g_async_queue_timeout_pop(avlc_decoder_queue, (guint64)dedup_window_get() * 1000);
+			if(q == NULL) {
+				// No frames for the whole window - held ones can't have any more duplicates
+				dedup_flush(dedup);
+				continue;
+			}
+		} else {
+			q = g_async_queue_pop(avlc_decoder_queue);
+		}
+		metrics_queue_pop(avlc_decoder_queue_id);
 
 		if(q->flags & OUT_FLAG_ORDERED_SHUTDOWN) {
 			fprintf(stderr, "Shutting down decoder thread\n");
-			shutdown_outputs(fmtr_list);
+			dedup_flush(dedup);
+			dedup_ctx_destroy(dedup);
+			shutdown_outputs(d.fmtr_list);
 			decoder_thread_active = false;
+			XFREE(q);
 			return NULL;
 		}
 
 		ASSERT(q->metadata != NULL);
-		statsd_increment_per_channel(q->metadata->freq, "avlc.frames.processed");
-
-		fmtr_instance_t *fmtr = NULL;
-		decoding_status = DEC_NOT_DONE;
-		for(la_list *p = fmtr_list; p != NULL; p = la_list_next(p)) {
-			fmtr = p->data;
-			if(fmtr->intype == FMTR_INTYPE_DECODED_FRAME) {
-				// Decode the frame unless we've done it before
-				if(decoding_status == DEC_NOT_DONE) {
-					msg_type = 0;
-					root = avlc_parse(q, &msg_type, &rcontexts);
-					if(root != NULL) {
-						decoding_status = DEC_SUCCESS;
-					} else {
-						decoding_status = DEC_FAILURE;
-						la_proto_tree_destroy(root);
-						root = NULL;
-					}
-				}
-				if(decoding_status == DEC_SUCCESS) {
-					if((msg_type & Config.msg_filter) == msg_type) {
-						debug_print(D_OUTPUT, "msg_type: %x msg_filter: %x (accepted)\n", msg_type, Config.msg_filter);
-						octet_string_t *serialized_msg = fmtr->td->format_decoded_msg(q->metadata, root);
-						// First check if the formatter actually returned something.
-						// A formatter might be suitable only for a particular message type. If this is the case.
-						// it will return NULL for all messages it cannot handle.
-						// An example is pp_acars which only deals with ACARS messages.
-						if(serialized_msg != NULL) {
-							output_qentry_t qentry = {
-								.msg = serialized_msg,
-								.metadata = q->metadata,
-								.format = fmtr->td->output_format
-							};
-							la_list_foreach(fmtr->outputs, output_queue_push, &qentry);
-							// output_queue_push makes a copy of serialized_msg, so it's safe to free it now
-							octet_string_destroy(serialized_msg);
-						}
-					} else {
-						debug_print(D_OUTPUT, "msg_type: %x msg_filter: %x (filtered out)\n", msg_type, Config.msg_filter);
-					}
-				}
-			} else if(fmtr->intype == FMTR_INTYPE_RAW_FRAME) {
-				octet_string_t *serialized_msg = fmtr->td->format_raw_msg(q->metadata, q->frame);
-				if(serialized_msg != NULL) {
-					output_qentry_t qentry = {
-						.msg = serialized_msg,
-						.metadata = q->metadata,
-						.format = fmtr->td->output_format
-					};
-					la_list_foreach(fmtr->outputs, output_queue_push, &qentry);
-					// output_queue_push makes a copy of serialized_msg, so it's safe to free it now
-					octet_string_destroy(serialized_msg);
-				}
-			}
+		bool valid = avlc_frame_check_fcs(q);
+		if(dedup != NULL) {
+			// Damaged frames are held too, so that the order of frames is
+			// preserved, but they are not matched against other frames
+			dedup_submit(dedup, q, valid ? q->frame->buf : NULL, q->frame->len,
+					q->metadata->burst_timestamp, q->metadata->frame_pwr_dbfs);
+		} else {
+			avlc_decoder_process(q, &d);
 		}
-		la_proto_tree_destroy(root);
-		root = NULL;
+	}
+}
+
+// Batch decoder.
+// Decodes frames synchronously in the calling thread, using its own reassembly
+// state, and keeps the formatted messages until avlc_decoder_batch_flush() is
+// called. This allows several threads to decode separate parts of a recording
+// simultaneously while still delivering the results to outputs in order.
+// When deduplication is enabled, frames following the end of the batch are
+// submitted as lookahead frames, so that the deduplication window is not cut
+// at batch boundaries. A stronger copy received after the boundary replaces
+// the held frame in the batch which would have output it when decoding the
+// recording serially; the batch which follows gets the same copy as a frame
+// replacing a warmup frame, so it does not output it again.
+
+typedef struct {
+	la_list *outputs;
+	output_qentry_t qentry;
+} avlc_decoder_batch_entry;
+
+struct avlc_decoder_batch {
+	la_list *fmtr_list;
+	reasm_contexts rcontexts;
+	dedup_ctx *dedup;
+	avlc_decoder_batch_entry *entries;
+	size_t len, size;
+};
+
+#define BATCH_INITIAL_SIZE 1024
+
+static void batch_append(la_list *outputs, output_qentry_t *qentry, void *ctx) {
+	ASSERT(ctx != NULL);
+	avlc_decoder_batch_t *b = ctx;
+	if(b->len == b->size) {
+		b->size = b->size > 0 ? 2 * b->size : BATCH_INITIAL_SIZE;
+		b->entries = XREALLOC(b->entries, b->size * sizeof(avlc_decoder_batch_entry));
+	}
+	avlc_decoder_batch_entry *e = &b->entries[b->len++];
+	e->outputs = outputs;
+	e->qentry = *qentry;
+	// The frame metadata goes away when the frame is processed
+	e->qentry.metadata = vdl2_msg_metadata_copy(qentry->metadata);
+}
+
+static void batch_decode(avlc_decoder_batch_t *b, avlc_frame_qentry_t *q) {
+	if(q->flags & AVLC_FRAME_LOOKAHEAD) {
 		octet_string_destroy(q->frame);
 		XFREE(q->metadata);
-		XFREE(q);
+		return;
+	}
+	vdl2_msg_trace_mark(q->metadata, TRACE_DECODE_START);
+	bool quiet = (q->flags & AVLC_FRAME_NO_OUTPUT) != 0;
+	bool prev = metrics_suppress(quiet);
+	avlc_frame_process(q, b->fmtr_list, &b->rcontexts, quiet ? NULL : batch_append, b);
+	metrics_suppress(prev);
+	octet_string_destroy(q->frame);
+	XFREE(q->metadata);
+}
+
+// dedup callback - decodes a held frame
+static void batch_release(void *item, void *ctx) {
+	avlc_frame_qentry_t *q = item;
+	batch_decode(ctx, q);
+	XFREE(q);
+}
+
+// dedup callback - the stronger copy takes the place of the held frame,
+// so it inherits its role in the batch
+static void batch_replace(void *stronger, void *weaker, void *ctx) {
+	UNUSED(ctx);
+	avlc_frame_qentry_t *s = stronger;
+	avlc_frame_qentry_t const *w = weaker;
+	int const role_flags = AVLC_FRAME_NO_OUTPUT | AVLC_FRAME_LOOKAHEAD;
+	s->flags = (s->flags & ~role_flags) | (w->flags & role_flags);
+}
+
+avlc_decoder_batch_t *avlc_decoder_batch_new(la_list *fmtr_list) {
+	NEW(avlc_decoder_batch_t, b);
+	b->fmtr_list = fmtr_list;
+	reasm_contexts_init(&b->rcontexts);
+	b->dedup = dedup_ctx_new(
+			(dedup_funcs){
+				.release = batch_release,
+				.discard = avlc_frame_discard,
+				.replace = batch_replace
+			}, b);
+	return b;
+}
+
+void avlc_decoder_batch_process(avlc_decoder_batch_t *b, vdl2_msg_metadata *metadata,
+		octet_string_t *frame, avlc_batch_frame_role role) {
+	ASSERT(b != NULL);
+	ASSERT(metadata != NULL);
+	avlc_frame_qentry_t q = {
+		.metadata = metadata,
+		.frame = frame,
+		.flags = role == BATCH_FRAME_OUTPUT ? 0 :
+			role == BATCH_FRAME_WARMUP ? AVLC_FRAME_NO_OUTPUT : AVLC_FRAME_LOOKAHEAD
+	};
+	bool valid = avlc_frame_check_fcs(&q);
+	if(role == BATCH_FRAME_LOOKAHEAD && (!valid || b->dedup == NULL)) {
+		// Can't be a duplicate of anything held by this batch
+		batch_decode(b, &q);
+		return;
+	}
+	if(valid) {
+		// Started before the frame is held for deduplication or decoded.
+		// There is little lead time here, but lookups in file decoding mode
+		// wait for pending queries, so the output does not depend on it.
+		avlc_frame_prefetch_addrinfo(frame);
+	}
+	if(b->dedup != NULL) {
+		NEW(avlc_frame_qentry_t, held);
+		*held = q;
+		// Dedup counters are updated on submission
+		bool prev = metrics_suppress(role != BATCH_FRAME_OUTPUT);
+		dedup_submit(b->dedup, held, valid ? frame->buf : NULL, frame->len,
+				metadata->burst_timestamp, metadata->frame_pwr_dbfs);
+		metrics_suppress(prev);
+		return;
+	}
+	batch_decode(b, &q);
+}
+
+size_t avlc_decoder_batch_length(avlc_decoder_batch_t const *b) {
+	ASSERT(b != NULL);
+	return b->len;
+}
+
+void avlc_decoder_batch_flush(avlc_decoder_batch_t *b) {
+	ASSERT(b != NULL);
+	// Decode frames still held for deduplication, so that they get
+	// delivered with this batch
+	dedup_flush(b->dedup);
+	for(size_t i = 0; i < b->len; i++) {
+		avlc_decoder_batch_entry *e = &b->entries[i];
+		la_list_foreach(e->outputs, output_queue_push, &e->qentry);
+		octet_string_destroy(e->qentry.msg);
+		vdl2_msg_metadata_destroy(e->qentry.metadata);
+	}
+	b->len = 0;
+}
+
+void avlc_decoder_batch_destroy(avlc_decoder_batch_t *b) {
+	if(b == NULL) {
+		return;
+	}
+	for(size_t i = 0; i < b->len; i++) {
+		octet_string_destroy(b->entries[i].qentry.msg);
+		vdl2_msg_metadata_destroy(b->entries[i].qentry.metadata);
 	}
+	XFREE(b->entries);
+	dedup_ctx_destroy(b->dedup);
+	reasm_contexts_destroy(&b->rcontexts);
+	XFREE(b);
 }
 
 void avlc_decoder_init() {
 	avlc_decoder_queue = g_async_queue_new();
+	avlc_decoder_queue_id = metrics_queue_register("decoder");
 }
 
 void avlc_decoder_shutdown() {
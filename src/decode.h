@@ -19,15 +19,32 @@
 
 #ifndef _DECODE_H
 #define _DECODE_H 1
+#include <stdbool.h>
 #include <glib.h>               // GAsyncQueue
+#include <libacars/list.h>      // la_list
 #include "output-common.h"      // vdl2_msg_metadata
 #include "dumpvdl2.h"           // octet_string_t
 
 extern bool decoder_thread_active;
 void decode_vdl2_burst(vdl2_channel_t *v);
+int encode_vdl2_burst(uint8_t const *frame, uint32_t len, bitstream_t *bs);
 void avlc_decoder_init();
 void *avlc_decoder_thread(void *arg);
 void avlc_decoder_shutdown();
 void avlc_decoder_queue_push(vdl2_msg_metadata *metadata, octet_string_t *frame, int flags);
 
+typedef struct avlc_decoder_batch avlc_decoder_batch_t;
+// Roles of frames submitted to a batch decoder
+typedef enum {
+	BATCH_FRAME_OUTPUT,             // decoded and output
+	BATCH_FRAME_WARMUP,             // decoded only to feed reassembly
+	BATCH_FRAME_LOOKAHEAD           // follows the batch, only checked for duplicates
+} avlc_batch_frame_role;
+avlc_decoder_batch_t *avlc_decoder_batch_new(la_list *fmtr_list);
+void avlc_decoder_batch_process(avlc_decoder_batch_t *b, vdl2_msg_metadata *metadata,
+		octet_string_t *frame, avlc_batch_frame_role role);
+size_t avlc_decoder_batch_length(avlc_decoder_batch_t const *b);
+void avlc_decoder_batch_flush(avlc_decoder_batch_t *b);
+void avlc_decoder_batch_destroy(avlc_decoder_batch_t *b);
+
 #endif // !_DECODE_H
@@ -0,0 +1,228 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Duplicate frame suppression.
+ * The same frame might be received more than once - on overlapping channels,
+ * by several receivers or by several stations whose recordings have been
+ * merged into a single file. Each frame is held for a short time window,
+ * during which further copies of it are discarded. If a copy with a higher
+ * signal level arrives, it replaces the held one, so that the best copy is
+ * passed on when the window closes. The window runs on frame timestamps
+ * rather than on the wall clock, so that historical data is processed in
+ * the same way as live data.
+ *
+ * Held frames are stored in a ring in the order of arrival and released
+ * from its tail, so their original order is preserved. Items which can't be
+ * deduplicated (eg. damaged frames) are held as well, for the same reason,
+ * but they are not put on hash chains. Frames are looked up
+ * by a hash of their contents and then compared byte by byte. Hash buckets
+ * are chained through ring slot numbers, so no memory is allocated after
+ * the context has been created.
+ */
+
+#include <string.h>                     // memcmp
+#include <sys/time.h>                   // struct timeval
+#include "dumpvdl2.h"                   // NEW, XCALLOC, XFREE, ASSERT
+#include "dedup.h"
+#include "metrics.h"                    // metrics_inc
+
+// Max number of frames held at a time. When the ring is full,
+// the oldest frame is released before its window closes.
+#define DEDUP_RING_SIZE 1024
+#define DEDUP_BUCKET_CNT (2 * DEDUP_RING_SIZE)
+#define DEDUP_NONE (-1)
+
+typedef struct {
+	uint64_t hash;                      /* hash of the frame contents */
+	uint8_t const *buf;                 /* frame contents (owned by the held item,
+	                                       NULL if the item is not on a hash chain) */
+	size_t len;                         /* frame length */
+	int64_t ts;                         /* timestamp of the first copy (microseconds) */
+	float pwr;                          /* signal level of the held copy */
+	void *item;                         /* the held copy */
+	int32_t next;                       /* next slot in the same hash bucket */
+} dedup_entry;
+
+struct dedup_ctx_s {
+	dedup_entry *ring;
+	int32_t *buckets;                   /* first slot of each hash chain */
+	uint32_t head;                      /* slot of the oldest entry */
+	uint32_t cnt;                       /* number of entries held */
+	int64_t now;                        /* newest timestamp seen so far (microseconds) */
+	dedup_funcs funcs;
+	void *cb_ctx;                       /* passed to callbacks */
+};
+
+static uint32_t dedup_window_ms = 0;
+
+void dedup_init(uint32_t window_ms) {
+	dedup_window_ms = window_ms;
+}
+
+uint32_t dedup_window_get(void) {
+	return dedup_window_ms;
+}
+
+// Returns NULL if deduplication is disabled
+dedup_ctx *dedup_ctx_new(dedup_funcs funcs, void *cb_ctx) {
+	ASSERT(funcs.release != NULL);
+	ASSERT(funcs.discard != NULL);
+	if(dedup_window_ms == 0) {
+		return NULL;
+	}
+	NEW(dedup_ctx, ctx);
+	ctx->ring = XCALLOC(DEDUP_RING_SIZE, sizeof(dedup_entry));
+	ctx->buckets = XCALLOC(DEDUP_BUCKET_CNT, sizeof(int32_t));
+	for(int i = 0; i < DEDUP_BUCKET_CNT; i++) {
+		ctx->buckets[i] = DEDUP_NONE;
+	}
+	ctx->funcs = funcs;
+	ctx->cb_ctx = cb_ctx;
+	return ctx;
+}
+
+// FNV-1a
+static uint64_t dedup_hash(uint8_t const *buf, size_t len) {
+	uint64_t h = 14695981039346656037ULL;
+	for(size_t i = 0; i < len; i++) {
+		h ^= buf[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+static dedup_entry *dedup_oldest_unlink(dedup_ctx *ctx) {
+	dedup_entry *e = &ctx->ring[ctx->head];
+	if(e->buf != NULL) {
+		// New entries are prepended to chains, so the oldest one is usually the last
+		int32_t *p = &ctx->buckets[e->hash % DEDUP_BUCKET_CNT];
+		while(*p != (int32_t)ctx->head) {
+			ASSERT(*p != DEDUP_NONE);
+			p = &ctx->ring[*p].next;
+		}
+		*p = e->next;
+	}
+	ctx->head = (ctx->head + 1) % DEDUP_RING_SIZE;
+	ctx->cnt--;
+	return e;
+}
+
+static void dedup_release_oldest(dedup_ctx *ctx) {
+	dedup_entry *e = dedup_oldest_unlink(ctx);
+	void *item = e->item;
+	e->item = NULL;
+	e->buf = NULL;
+	ctx->funcs.release(item, ctx->cb_ctx);
+}
+
+static void dedup_expire(dedup_ctx *ctx) {
+	int64_t window = (int64_t)dedup_window_ms * 1000;
+	while(ctx->cnt > 0 && ctx->ring[ctx->head].ts + window <= ctx->now) {
+		dedup_release_oldest(ctx);
+	}
+}
+
+// Takes ownership of the item. buf and len describe the frame contents
+// and must remain valid for as long as the item exists. The item is either
+// passed to the release callback (now or later) or to the discard callback
+// (if it's a duplicate of a held item which is at least as strong).
+// If buf is NULL, the item is held and released in order with other items,
+// but it's never treated as a duplicate.
+void dedup_submit(dedup_ctx *ctx, void *item, uint8_t const *buf, size_t len,
+		struct timeval ts, float pwr) {
+	ASSERT(ctx != NULL);
+	ASSERT(item != NULL);
+
+	int64_t t = (int64_t)ts.tv_sec * 1000000 + ts.tv_usec;
+	if(t > ctx->now) {
+		ctx->now = t;
+	}
+	dedup_expire(ctx);
+
+	uint64_t hash = buf != NULL ? dedup_hash(buf, len) : 0;
+	int32_t *bucket = &ctx->buckets[hash % DEDUP_BUCKET_CNT];
+	for(int32_t i = buf != NULL ? *bucket : DEDUP_NONE; i != DEDUP_NONE; i = ctx->ring[i].next) {
+		dedup_entry *e = &ctx->ring[i];
+		if(e->hash != hash || e->len != len || memcmp(e->buf, buf, len) != 0) {
+			continue;
+		}
+		metrics_inc(M_DEDUP_DROPPED);
+		if(pwr > e->pwr) {
+			void *weaker = e->item;
+			e->item = item;
+			e->buf = buf;
+			e->pwr = pwr;
+			metrics_inc(M_DEDUP_REPLACED);
+			if(ctx->funcs.replace != NULL) {
+				ctx->funcs.replace(item, weaker, ctx->cb_ctx);
+			}
+			ctx->funcs.discard(weaker, ctx->cb_ctx);
+		} else {
+			ctx->funcs.discard(item, ctx->cb_ctx);
+		}
+		return;
+	}
+
+	if(ctx->cnt == DEDUP_RING_SIZE) {
+		metrics_inc(M_DEDUP_EVICTED);
+		dedup_release_oldest(ctx);
+	}
+	uint32_t slot = (ctx->head + ctx->cnt) % DEDUP_RING_SIZE;
+	dedup_entry *e = &ctx->ring[slot];
+	e->hash = hash;
+	e->buf = buf;
+	e->len = len;
+	e->ts = t;
+	e->pwr = pwr;
+	e->item = item;
+	e->next = DEDUP_NONE;
+	if(buf != NULL) {
+		e->next = *bucket;
+		*bucket = (int32_t)slot;
+	}
+	ctx->cnt++;
+}
+
+bool dedup_pending(dedup_ctx const *ctx) {
+	return ctx != NULL && ctx->cnt > 0;
+}
+
+// Releases all held items regardless of their age
+void dedup_flush(dedup_ctx *ctx) {
+	if(ctx == NULL) {
+		return;
+	}
+	while(ctx->cnt > 0) {
+		dedup_release_oldest(ctx);
+	}
+}
+
+// Items still held are discarded
+void dedup_ctx_destroy(dedup_ctx *ctx) {
+	if(ctx == NULL) {
+		return;
+	}
+	while(ctx->cnt > 0) {
+		dedup_entry *e = dedup_oldest_unlink(ctx);
+		ctx->funcs.discard(e->item, ctx->cb_ctx);
+	}
+	XFREE(ctx->ring);
+	XFREE(ctx->buckets);
+	XFREE(ctx);
+}
@@ -0,0 +1,50 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _DEDUP_H
+#define _DEDUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>                   // struct timeval
+
+typedef struct dedup_ctx_s dedup_ctx;
+
+typedef void (dedup_item_func)(void *item, void *ctx);
+typedef void (dedup_replace_func)(void *stronger, void *weaker, void *ctx);
+typedef struct {
+	dedup_item_func *release;           // passes the held item on for processing
+	dedup_item_func *discard;           // destroys a duplicate item
+	dedup_replace_func *replace;        // optional, called before a held item is replaced by a stronger copy
+} dedup_funcs;
+
+// Max length of the deduplication window
+#define DEDUP_WINDOW_MAX 10000
+
+// dedup.c
+void dedup_init(uint32_t window_ms);
+uint32_t dedup_window_get(void);
+dedup_ctx *dedup_ctx_new(dedup_funcs funcs, void *cb_ctx);
+void dedup_submit(dedup_ctx *ctx, void *item, uint8_t const *buf, size_t len,
+		struct timeval ts, float pwr);
+bool dedup_pending(dedup_ctx const *ctx);
+void dedup_flush(dedup_ctx *ctx);
+void dedup_ctx_destroy(dedup_ctx *ctx);
+
+#endif // !_DEDUP_H
@@ -20,10 +20,13 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdint.h>
-#include <stdlib.h>             // calloc
+#include <stdlib.h>             // calloc, posix_memalign
 #include <math.h>               // sincosf, hypotf, atan2
-#include <string.h>             // memset
+#include <string.h>             // memset, memcpy
+#include <strings.h>            // strcasecmp
+#include <unistd.h>             // _exit
 #include <sys/time.h>           // gettimeofday
+#include <time.h>               // clock_gettime
 #include "config.h"
 #ifdef HAVE_PTHREAD_BARRIERS
 #include <pthread.h>            // pthread_barrier_wait
@@ -33,6 +36,8 @@
 #include "chebyshev.h"          // chebyshev_lpf_init
 #include "decode.h"             // decode_vdl2_burst
 #include "dumpvdl2.h"
+#include "metrics.h"            // metrics_inc_per_channel
+#include "bench.h"              // bench_stage_*, bench_samples_add
 
 #define BSLEN 32768UL
 #define PHERR_MAX 1000.f        // initial value for frame sync error (read: high)
@@ -46,13 +51,19 @@
 #define INP_LPF_RIPPLE_PERCENT 0.5f
 // do not change this; filtering routine is currently hardcoded to 2 poles to minimize CPU usage
 #define INP_LPF_NPOLES 2
+// alignment of sample blocks, suitable for vector loads
+#define SAMPLE_BLOCK_ALIGN 64
+// Polyphase resampler design constants (see input_resampler_init).
+// Maximum number of filter bank branches, ie. fractional delays the filter
+// is sampled at. With 64 branches the timing error is at most 1/128 of an
+// input sample.
+#define RESAMPLER_MAX_PHASES 64
+// Filter length in input samples per one output sample period. Longer
+// filters have narrower transition bands.
+#define RESAMPLER_TAPS_PER_OUTPUT 4
+#define RESAMPLER_MAX_TAPS 512
 
-float *sbuf;
-static float *levels;
 static float sin_lut[257], cos_lut[257];
-static uint32_t sbuf_len;
-// filter coefficients
-static float *A = NULL, *B = NULL;
 
 // phi range must be (0..1), rescaled to 0x0-0xFFFFFF
 static void sincosf_lut(uint32_t phi, float *sine, float *cosine) {
@@ -71,7 +82,7 @@ static void sincosf_lut(uint32_t phi, float *sine, float *cosine) {
 	*cosine = v1 + (v2 - v1) * fract;
 }
 
-static float chebyshev_lpf_2pole(float const *in, float const *out) {
+static float chebyshev_lpf_2pole(float const *A, float const *B, float const *in, float const *out) {
 	float r = A[0] * in[0];
 	r += A[1] * in[1] + A[2] * in[2];
 	r += B[1] * out[1] + B[2] * out[2];
@@ -241,8 +252,9 @@ static void demod(vdl2_channel_t *v, float re, float im) {
 				v->mag_nf = NF_LP * v->mag_nf + (1.0f - NF_LP) * fminf(v->mag_lp, v->mag_nf) + 0.0001f;
 			}
 			if(got_sync(v)) {
-				statsd_increment_per_channel(v->freq, "demod.sync.good");
+				metrics_inc_per_channel(v->freq, MC_DEMOD_SYNC_GOOD);
 				gettimeofday(&v->burst_timestamp, NULL);
+				clock_gettime(CLOCK_MONOTONIC, &v->burst_sync_time);
 				v->demod_state = DM_SYNC;
 				debug_print(D_DEMOD, "DM_SYNC, v->sclk=%d\n", v->sclk);
 			}
@@ -278,27 +290,56 @@ static void demod(vdl2_channel_t *v, float re, float im) {
 			if(v->bs->end - v->bs->start >= v->requested_bits) {
 				debug_print(D_DEMOD, "bitstream len=%u requested_bits=%u, launching frame decoder\n",
 						v->bs->end - v->bs->start, v->requested_bits);
+				uint64_t t = bench_stage_start();
 				decode_vdl2_burst(v);
+				bench_stage_end(BENCH_BURST_DECODE, t);
 			}
 			return;
 	}
 }
 
 void *process_samples(void *arg) {
-	int cnt = 0;
+	uint32_t phase = 0;
 	float cwf, swf;
 	float re[INP_LPF_NPOLES+1], im[INP_LPF_NPOLES+1];
 	float lp_re[INP_LPF_NPOLES+1], lp_im[INP_LPF_NPOLES+1];
 	vdl2_channel_t *v = arg;
+	vdl2_state_t *ctx = v->source;
+	// Resampler filter history. Each sample is stored twice, flen positions
+	// apart, so that the last flen samples always form a contiguous window
+	// starting at hist_re + hpos (oldest sample first).
+	uint32_t const flen = ctx->resampler_len;
+	float *hist_re = NULL, *hist_im = NULL;
+	uint32_t hpos = 0;
+	if(ctx->resampler_coeffs != NULL) {
+		hist_re = XCALLOC(2 * flen, sizeof(float));
+		hist_im = XCALLOC(2 * flen, sizeof(float));
+	}
 	v->samplenum = -1;
 	memset(lp_re, 0, sizeof(lp_re));
 	memset(lp_im, 0, sizeof(lp_im));
 	memset(re, 0, sizeof(re));
 	memset(im, 0, sizeof(im));
 	while(1) {
-		pthread_barrier_wait(&demods_ready);
-		pthread_barrier_wait(&samples_ready);
-		for(uint32_t i = 0; i < sbuf_len;) {
+		pthread_barrier_wait(&ctx->demods_ready);
+		pthread_barrier_wait(&ctx->samples_ready);
+		if(ctx->discontinuity) {
+			debug_print(D_DEMOD, "%u: sample discontinuity, resetting demodulator\n", v->freq);
+			demod_reset(v);
+			memset(lp_re, 0, sizeof(lp_re));
+			memset(lp_im, 0, sizeof(lp_im));
+			memset(re, 0, sizeof(re));
+			memset(im, 0, sizeof(im));
+			if(hist_re != NULL) {
+				memset(hist_re, 0, 2 * flen * sizeof(float));
+				memset(hist_im, 0, 2 * flen * sizeof(float));
+			}
+			hpos = 0;
+			phase = 0;
+		}
+		uint64_t t = bench_stage_start();
+		float const *sbuf = ctx->sbuf;
+		for(uint32_t i = 0; i < ctx->sbuf_len;) {
 			for(int k = INP_LPF_NPOLES; k > 0; k--) {
 				re[k] = re[k-1];
 				im[k] = im[k-1];
@@ -315,17 +356,42 @@ void *process_samples(void *arg) {
 				v->downmix_phi &= 0xffffff;
 			}
 			// lowpass IIR
-			lp_re[0] = chebyshev_lpf_2pole(re, lp_re);
-			lp_im[0] = chebyshev_lpf_2pole(im, lp_im);
-			// decimation
-			if(++cnt == v->oversample) {
-				cnt = 0;
+			lp_re[0] = chebyshev_lpf_2pole(ctx->lpf_a, ctx->lpf_b, re, lp_re);
+			lp_im[0] = chebyshev_lpf_2pole(ctx->lpf_a, ctx->lpf_b, im, lp_im);
+			if(hist_re != NULL) {
+				hist_re[hpos] = hist_re[hpos + flen] = lp_re[0];
+				hist_im[hpos] = hist_im[hpos + flen] = lp_im[0];
+				hpos = hpos + 1 < flen ? hpos + 1 : 0;
+			}
+			// Rational resampling down to SYMBOL_RATE * SPS. The phase advances by
+			// resample_num per input sample and an output sample is due every
+			// resample_den. If the ratio is an integer, this is plain decimation.
+			phase += v->resample_num;
+			if(phase >= v->resample_den) {
+				phase -= v->resample_den;
 #ifdef DEBUG
 				v->samplenum++;
 #endif
-				demod(v, lp_re[0], lp_im[0]);
+				if(hist_re == NULL) {
+					demod(v, lp_re[0], lp_im[0]);
+				} else {
+					// The output instant lags the current sample by phase / resample_num
+					// of the input sample period (plus the constant filter delay).
+					// Pick the filter bank branch for this fractional delay.
+					uint32_t p = ctx->resampler_phases == v->resample_num ? phase :
+						(uint32_t)(((uint64_t)phase * ctx->resampler_phases + v->resample_num / 2) / v->resample_num);
+					float const *c = ctx->resampler_coeffs + (size_t)p * flen;
+					float const *wr = hist_re + hpos, *wi = hist_im + hpos;
+					float out_re = 0.0f, out_im = 0.0f;
+					for(uint32_t k = 0; k < flen; k++) {
+						out_re += c[k] * wr[k];
+						out_im += c[k] * wi[k];
+					}
+					demod(v, out_re, out_im);
+				}
 			}
 		}
+		bench_stage_end(BENCH_DEMOD, t);
 #ifdef DEBUG
 		if(++v->bufnum == 10) {
 			v->bufnum = 0;
@@ -335,37 +401,228 @@ void *process_samples(void *arg) {
 	}
 }
 
-void process_buf_uchar(unsigned char *buf, uint32_t len, void *ctx) {
-	UNUSED(ctx);
-	if(len == 0) return;
-	pthread_barrier_wait(&demods_ready);
-	sbuf_len = len;
-	for(uint32_t i = 0; i < sbuf_len; i++)
-		sbuf[i] = levels[buf[i]];
-	pthread_barrier_wait(&samples_ready);
+// Sample converters below are plain loops over restrict-qualified buffers
+// with no table lookups, so that the compiler vectorizes them.
+
+// Converts len octets of U8 samples into floats. Returns the number of floats stored in out.
+uint32_t convert_buf_uchar(unsigned char const *restrict buf, uint32_t len, float *restrict out) {
+	for(uint32_t i = 0; i < len; i++)
+		out[i] = (float)buf[i] * (1.0f / 127.5f) - 1.0f;
+	return len;
+}
+
+// Converts len octets of S8 samples into floats. Returns the number of floats stored in out.
+uint32_t convert_buf_schar(unsigned char const *restrict buf, uint32_t len, float *restrict out) {
+	int8_t const *restrict sbuf = (int8_t const *)buf;
+	for(uint32_t i = 0; i < len; i++)
+		out[i] = (float)sbuf[i] * (1.0f / 128.0f);
+	return len;
+}
+
+// Converts len octets of S16_LE samples into floats. Returns the number of floats stored in out.
+uint32_t convert_buf_short(unsigned char const *restrict buf, uint32_t len, float *restrict out) {
+	int16_t const *restrict bbuf = (int16_t const *)buf;
+	uint32_t cnt = len / 2;
+	for(uint32_t i = 0; i < cnt; i++)
+		out[i] = (float)bbuf[i] * (1.0f / 32768.0f);
+	return cnt;
+}
+
+// Copies len octets of F32_LE samples (expected to be in the -1..1 range).
+// Returns the number of floats stored in out.
+uint32_t convert_buf_float(unsigned char const *restrict buf, uint32_t len, float *restrict out) {
+	uint32_t cnt = len / sizeof(float);
+	memcpy(out, buf, cnt * sizeof(float));
+	return cnt;
+}
+
+static struct {
+	char const *name;
+	char const *alias;                  // name used by SoapySDR and other SDR tools
+	uint32_t sample_size;               // octets per complex sample
+	convert_buf_func *convert;
+} const sample_format_descr[SFMT_UNDEF] = {
+	[SFMT_U8]       = { .name = "U8",     .alias = "CU8",  .sample_size = 2, .convert = convert_buf_uchar },
+	[SFMT_S8]       = { .name = "S8",     .alias = "CS8",  .sample_size = 2, .convert = convert_buf_schar },
+	[SFMT_S16_LE]   = { .name = "S16_LE", .alias = "CS16", .sample_size = 4, .convert = convert_buf_short },
+	[SFMT_F32_LE]   = { .name = "F32_LE", .alias = "CF32", .sample_size = 8, .convert = convert_buf_float }
+};
+
+// Returns SFMT_UNDEF if the name is not known
+enum sample_formats sample_format_from_string(char const *name) {
+	ASSERT(name != NULL);
+	for(int i = 0; i < SFMT_UNDEF; i++) {
+		if(!strcasecmp(name, sample_format_descr[i].name) || !strcasecmp(name, sample_format_descr[i].alias)) {
+			return (enum sample_formats)i;
+		}
+	}
+	return SFMT_UNDEF;
+}
+
+char const *sample_format_name(enum sample_formats sfmt) {
+	return sfmt < SFMT_UNDEF ? sample_format_descr[sfmt].name : "unknown";
+}
+
+uint32_t sample_format_size(enum sample_formats sfmt) {
+	return sfmt < SFMT_UNDEF ? sample_format_descr[sfmt].sample_size : 0;
+}
+
+// Returns NULL if the format is not supported
+convert_buf_func *sample_format_converter(enum sample_formats sfmt) {
+	return sfmt < SFMT_UNDEF ? sample_format_descr[sfmt].convert : NULL;
+}
+
+// Hands over a buffer of converted samples to demodulator threads of the
+// given input. Returns the buffer they have been working on previously.
+// It's no longer in use, so the caller may fill it with next batch of samples
+// while the demodulators are busy.
+float *demod_swap_sample_buffer(vdl2_state_t *ctx, float *buf, uint32_t len) {
+	pthread_barrier_wait(&ctx->demods_ready);
+	float *prev = ctx->sbuf;
+	ctx->sbuf = buf;
+	ctx->sbuf_len = len;
+	ctx->discontinuity = ctx->discontinuity_pending;
+	ctx->discontinuity_pending = false;
+	pthread_barrier_wait(&ctx->samples_ready);
+	bench_samples_add(len / 2);
+	return prev;
+}
+
+// Called by inputs which might lose samples (eg. network inputs) when this
+// happens. Demodulators will drop any burst in progress and restart from
+// scratch when they get the next buffer, instead of demodulating across the gap.
+void demod_mark_discontinuity(vdl2_state_t *ctx) {
+	ctx->discontinuity_pending = true;
+}
+
+static float *sample_block_alloc(uint32_t len) {
+	void *ptr = NULL;
+	if(posix_memalign(&ptr, SAMPLE_BLOCK_ALIGN, len * sizeof(float)) != 0) {
+		fprintf(stderr, "posix_memalign failed, cannot allocate sample buffer\n");
+		_exit(1);
+	}
+	memset(ptr, 0, len * sizeof(float));
+	return ptr;
+}
+
+// Sets up a pair of sample blocks of len floats each. One of them becomes
+// the demodulators' input buffer (ctx->sbuf), the other one is filled by the
+// driver via sample_block_feed_*() functions. Must be called before any
+// samples are fed, instead of allocating ctx->sbuf directly.
+void sample_block_init(sample_block_t *blk, vdl2_state_t *ctx, uint32_t len) {
+	ASSERT(blk != NULL);
+	ASSERT(ctx != NULL);
+	// Blocks must hold whole I/Q pairs
+	len &= ~1U;
+	ASSERT(len > 0);
+	ctx->sbuf = sample_block_alloc(len);
+	blk->ctx = ctx;
+	blk->buf = sample_block_alloc(len);
+	blk->len = len;
+	blk->pos = 0;
+}
+
+static void sample_block_commit(sample_block_t *blk, uint32_t cnt) {
+	blk->pos += cnt;
+	if(blk->pos == blk->len) {
+		blk->buf = demod_swap_sample_buffer(blk->ctx, blk->buf, blk->len);
+		blk->pos = 0;
+	}
 }
 
-void process_buf_uchar_init() {
-	levels = XCALLOC(256, sizeof(float));
-	for (int i = 0; i < 256; i++) {
-		levels[i] = (i-127.5f)/127.5f;
+// Converts cnt interleaved CS16 values (cnt/2 I/Q pairs) straight into
+// sample blocks, handing each block over to demodulators as soon as it fills up.
+void sample_block_feed_cs16(sample_block_t *blk, int16_t const *samples, uint32_t cnt) {
+	while(cnt > 0) {
+		uint32_t n = blk->len - blk->pos;
+		if(n > cnt) {
+			n = cnt;
+		}
+		float *restrict out = blk->buf + blk->pos;
+		for(uint32_t i = 0; i < n; i++) {
+			out[i] = (float)samples[i] * (1.0f / 32768.0f);
+		}
+		samples += n;
+		cnt -= n;
+		sample_block_commit(blk, n);
+	}
+}
+
+// Converts cnt interleaved CS8 values (cnt/2 I/Q pairs) into sample blocks
+void sample_block_feed_cs8(sample_block_t *blk, int8_t const *samples, uint32_t cnt) {
+	while(cnt > 0) {
+		uint32_t n = blk->len - blk->pos;
+		if(n > cnt) {
+			n = cnt;
+		}
+		float *restrict out = blk->buf + blk->pos;
+		for(uint32_t i = 0; i < n; i++) {
+			out[i] = (float)samples[i] * (1.0f / 128.0f);
+		}
+		samples += n;
+		cnt -= n;
+		sample_block_commit(blk, n);
+	}
+}
+
+// Copies cnt interleaved CF32 values (cnt/2 I/Q pairs) into sample blocks
+void sample_block_feed_cf32(sample_block_t *blk, float const *samples, uint32_t cnt) {
+	while(cnt > 0) {
+		uint32_t n = blk->len - blk->pos;
+		if(n > cnt) {
+			n = cnt;
+		}
+		memcpy(blk->buf + blk->pos, samples, n * sizeof(float));
+		samples += n;
+		cnt -= n;
+		sample_block_commit(blk, n);
+	}
+}
+
+// Same as sample_block_feed_cs16, but I and Q parts are stored in separate arrays,
+// cnt elements each.
+void sample_block_feed_cs16_split(sample_block_t *blk, int16_t const *xi, int16_t const *xq, uint32_t cnt) {
+	while(cnt > 0) {
+		uint32_t n = (blk->len - blk->pos) / 2;
+		if(n > cnt) {
+			n = cnt;
+		}
+		float *restrict out = blk->buf + blk->pos;
+		for(uint32_t i = 0; i < n; i++) {
+			out[2 * i] = (float)xi[i] * (1.0f / 32768.0f);
+			out[2 * i + 1] = (float)xq[i] * (1.0f / 32768.0f);
+		}
+		xi += n;
+		xq += n;
+		cnt -= n;
+		sample_block_commit(blk, 2 * n);
 	}
 }
 
+// Callback for SDR libraries delivering U8 samples. ctx is the vdl2_state_t
+// of the input.
+void process_buf_uchar(unsigned char *buf, uint32_t len, void *ctx) {
+	vdl2_state_t *state = ctx;
+	if(len == 0) return;
+	pthread_barrier_wait(&state->demods_ready);
+	state->sbuf_len = convert_buf_uchar(buf, len, state->sbuf);
+	pthread_barrier_wait(&state->samples_ready);
+}
+
+// Callback for SDR libraries delivering S16_LE samples. ctx is the vdl2_state_t
+// of the input.
 void process_buf_short(unsigned char *buf, uint32_t len, void *ctx) {
-	UNUSED(ctx);
+	vdl2_state_t *state = ctx;
 	if(len == 0) return;
-	int16_t *bbuf = (int16_t *)buf;
-	pthread_barrier_wait(&demods_ready);
-	sbuf_len = len / 2;
-	for(uint32_t i = 0; i < sbuf_len; i++)
-		sbuf[i] = (float)bbuf[i] / 32768.0f;
-	pthread_barrier_wait(&samples_ready);
+	pthread_barrier_wait(&state->demods_ready);
+	state->sbuf_len = convert_buf_short(buf, len, state->sbuf);
+	pthread_barrier_wait(&state->samples_ready);
 }
 
-void input_lpf_init(uint32_t sample_rate) {
+void input_lpf_init(vdl2_state_t *ctx, uint32_t sample_rate) {
 	assert(sample_rate != 0);
-	chebyshev_lpf_init((float)INP_LPF_CUTOFF_FREQ / (float)sample_rate, INP_LPF_RIPPLE_PERCENT, INP_LPF_NPOLES, &A, &B);
+	chebyshev_lpf_init((float)INP_LPF_CUTOFF_FREQ / (float)sample_rate, INP_LPF_RIPPLE_PERCENT, INP_LPF_NPOLES,
+			&ctx->lpf_a, &ctx->lpf_b);
 }
 
 void sincosf_lut_init() {
@@ -375,8 +632,75 @@ void sincosf_lut_init() {
 	cos_lut[256] = cos_lut[0];
 }
 
-vdl2_channel_t *vdl2_channel_init(uint32_t centerfreq, uint32_t freq, uint32_t source_rate, uint32_t oversample) {
+static uint32_t gcd(uint32_t a, uint32_t b) {
+	while(b != 0) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+// Builds the polyphase filter bank used to resample channels of this input
+// to SYMBOL_RATE * SPS when the input rate is not an integer multiple of it.
+// The prototype filter is a Hamming-windowed sinc with the cutoff at the
+// Nyquist frequency of the output rate. Its length scales with the
+// decimation ratio, so that the transition band ends below the output rate
+// minus the channel bandwidth - ie. the energy which would alias onto the
+// channel is attenuated on top of the input IIR filter. The filter is
+// sampled at resampler_phases + 1 fractional delays from 0 to 1 input
+// sample, one branch per delay, and each branch is normalized to unity gain.
+void input_resampler_init(vdl2_state_t *ctx, uint32_t sample_rate) {
+	assert(sample_rate != 0);
+	uint32_t const demod_rate = SYMBOL_RATE * SPS;
+	uint32_t div = gcd(demod_rate, sample_rate);
+	uint32_t num = demod_rate / div;
+	uint32_t den = sample_rate / div;
+	ctx->resampler_coeffs = NULL;
+	ctx->resampler_len = ctx->resampler_phases = 0;
+	if(num == 1) {
+		// Integer ratio - plain decimation
+		return;
+	}
+	uint32_t len = (uint32_t)(((uint64_t)RESAMPLER_TAPS_PER_OUTPUT * den + num - 1) / num);
+	if(len > RESAMPLER_MAX_TAPS) {
+		len = RESAMPLER_MAX_TAPS;
+	}
+	uint32_t phases = num < RESAMPLER_MAX_PHASES ? num : RESAMPLER_MAX_PHASES;
+	double const fc = 0.5 * (double)num / (double)den;    // cycles per input sample
+	double const center = (double)(len - 1) / 2.0;
+	double const half_width = (double)(len + 1) / 2.0;
+	float *coeffs = XCALLOC((size_t)(phases + 1) * len, sizeof(float));
+	for(uint32_t p = 0; p <= phases; p++) {
+		float *c = coeffs + (size_t)p * len;
+		double const delay = (double)p / (double)phases;
+		double sum = 0.0;
+		for(uint32_t k = 0; k < len; k++) {
+			// c[k] multiplies the k-th oldest sample in the filter history
+			double t = (double)(len - 1 - k) - center - delay;
+			double h = fabs(t) < 1e-9 ? 2.0 * fc : sin(2.0 * M_PI * fc * t) / (M_PI * t);
+			h *= 0.54 + 0.46 * cos(M_PI * t / half_width);
+			c[k] = (float)h;
+			sum += h;
+		}
+		for(uint32_t k = 0; k < len; k++) {
+			c[k] = (float)((double)c[k] / sum);
+		}
+	}
+	debug_print(D_DEMOD, "resampler: %u/%u, %u branches of %u taps\n", num, den, phases + 1, len);
+	ctx->resampler_coeffs = coeffs;
+	ctx->resampler_len = len;
+	ctx->resampler_phases = phases;
+}
+
+vdl2_channel_t *vdl2_channel_init(vdl2_state_t *ctx, uint32_t centerfreq, uint32_t freq, uint32_t source_rate) {
+	uint32_t const demod_rate = SYMBOL_RATE * SPS;
+	if(source_rate < demod_rate) {
+		fprintf(stderr, "Sampling rate %u is too low (must be at least %u)\n", source_rate, demod_rate);
+		return NULL;
+	}
 	NEW(vdl2_channel_t, v);
+	v->source = ctx;
 	v->bs = bitstream_init(BSLEN);
 	v->frame_bs = bitstream_init(BSLEN);
 	v->mag_nf = 2.0f;
@@ -384,7 +708,10 @@ vdl2_channel_t *vdl2_channel_init(uint32_t centerfreq, uint32_t freq, uint32_t s
 	v->downmix_dphi = (uint32_t)(int)(((float)centerfreq - (float)freq) / (float)source_rate * 256.0f * 65536.0f);
 	debug_print(D_DEMOD, "downmix_dphi: 0x%x\n", v->downmix_dphi);
 	v->offset_tuning = (centerfreq != freq);
-	v->oversample = oversample;
+	uint32_t div = gcd(demod_rate, source_rate);
+	v->resample_num = demod_rate / div;
+	v->resample_den = source_rate / div;
+	debug_print(D_DEMOD, "resampling ratio: %u/%u\n", v->resample_num, v->resample_den);
 	v->freq = freq;
 	demod_reset(v);
 	return v;
@@ -25,6 +25,7 @@
 #include <getopt.h>
 #include <signal.h>
 #include <errno.h>
+#include <time.h>               // strptime, mktime, timegm
 #include <libacars/libacars.h>  // LA_VERSION, la_config_set_bool()
 #include <libacars/acars.h>     // LA_ACARS_BEARER_VHF
 #include <libacars/list.h>      // la_list
@@ -59,20 +60,17 @@
 #include "ac_data.h"
 #endif
 #include "gs_data.h"
+#include "reassembly.h"              // reasm_init, REASM_MAX_MEMORY_DEFAULT
+#include "dedup.h"                   // dedup_init, DEDUP_WINDOW_MAX
+#include "metrics.h"                 // metrics_channel_register, metrics_server_start
+#include "sigmf.h"                   // sigmf_is_recording, sigmf_meta_read
+#include "bench.h"                   // bench_*, BENCH_REPEAT_MAX
+#ifdef WITH_ALLOC_STATS
+#include "alloc-stats.h"             // alloc_stats_init, alloc_stats_report_request
+#endif
 
-int do_exit = 0;
-dumpvdl2_config_t Config;
-
-pthread_barrier_t demods_ready, samples_ready;
-
-void sighandler(int sig) {
-	fprintf(stderr, "Got signal %d, ", sig);
-	if(do_exit == 0) {
-		fprintf(stderr, "exiting gracefully (send signal once again to force quit)\n");
-	} else {
-		fprintf(stderr, "forcing quit\n");
-	}
-	do_exit++;
+// Stops all running inputs
+void inputs_cancel() {
 #ifdef WITH_RTLSDR
 	rtl_cancel();
 #endif
@@ -90,15 +88,51 @@ void sighandler(int sig) {
 #endif
 }
 
+void sighandler(int sig) {
+	fprintf(stderr, "Got signal %d, ", sig);
+	if(do_exit == 0) {
+		fprintf(stderr, "exiting gracefully (send signal once again to force quit)\n");
+	} else {
+		fprintf(stderr, "forcing quit\n");
+	}
+	do_exit++;
+	inputs_cancel();
+}
+
+// SIGHUP reloads ground station data, if it's in use
+static void sighup_handler(int sig) {
+	if(Config.gs_addrinfo_db_available == true) {
+		gs_data_reload_request();
+	} else {
+		sighandler(sig);
+	}
+}
+
+#ifdef WITH_ALLOC_STATS
+// SIGUSR1 prints allocation statistics
+static void sigusr1_handler(int sig) {
+	UNUSED(sig);
+	alloc_stats_report_request();
+}
+#endif
+
 static void setup_signals() {
-	struct sigaction sigact, pipeact;
+	struct sigaction sigact, pipeact, hupact;
 
 	memset(&sigact, 0, sizeof(sigact));
 	memset(&pipeact, 0, sizeof(pipeact));
+	memset(&hupact, 0, sizeof(hupact));
 	pipeact.sa_handler = SIG_IGN;
 	sigact.sa_handler = &sighandler;
+	hupact.sa_handler = &sighup_handler;
 	sigaction(SIGPIPE, &pipeact, NULL);
-	sigaction(SIGHUP, &sigact, NULL);
+	sigaction(SIGHUP, &hupact, NULL);
+#ifdef WITH_ALLOC_STATS
+	struct sigaction usr1act;
+	memset(&usr1act, 0, sizeof(usr1act));
+	usr1act.sa_handler = &sigusr1_handler;
+	sigaction(SIGUSR1, &usr1act, NULL);
+#endif
 	sigaction(SIGINT, &sigact, NULL);
 	sigaction(SIGQUIT, &sigact, NULL);
 	sigaction(SIGTERM, &sigact, NULL);
@@ -114,17 +148,8 @@ static void pthread_barrier_new(pthread_barrier_t *barrier, unsigned count) {
 }
 
 static void setup_barriers(vdl2_state_t *ctx) {
-	pthread_barrier_new(&demods_ready, ctx->num_channels+1);
-	pthread_barrier_new(&samples_ready, ctx->num_channels+1);
-}
-
-void start_thread(pthread_t *pth, void *(*start_routine)(void *), void *thread_ctx) {
-	int ret;
-	if((ret = pthread_create(pth, NULL, start_routine, thread_ctx) != 0)) {
-		errno = ret;
-		perror("pthread_create failed");
-		_exit(2);
-	}
+	pthread_barrier_new(&ctx->demods_ready, ctx->num_channels+1);
+	pthread_barrier_new(&ctx->samples_ready, ctx->num_channels+1);
 }
 
 static void start_demod_threads(vdl2_state_t *ctx) {
@@ -319,55 +344,10 @@ la_list *setup_output(la_list *fmtr_list, char *output_spec) {
 	return fmtr_list;
 }
 
-void process_iq_file(vdl2_state_t *ctx, char *path, enum sample_formats sfmt) {
-	UNUSED(ctx);
-	FILE *f;
-	uint32_t len;
-	unsigned char buf[FILE_BUFSIZE];
-	void (*process_buf)() = NULL;
-
-	if(!strcmp(path, "-")) {
-		f = stdin;
-	} else {
-		f = fopen(path, "r");
-	}
-	if(f == NULL) {
-		perror("Could not open input file");
-		_exit(2);
-	}
-	switch(sfmt) {
-		case SFMT_U8:
-			process_buf_uchar_init();
-			sbuf = XCALLOC(FILE_BUFSIZE / sizeof(uint8_t), sizeof(float));
-			process_buf = &process_buf_uchar;
-			break;
-		case SFMT_S16_LE:
-			sbuf = XCALLOC(FILE_BUFSIZE / sizeof(int16_t), sizeof(float));
-			process_buf = &process_buf_short;
-			break;
-		default:
-			fprintf(stderr, "Unsupported sample format\n");
-			_exit(5);
-	}
-	do {
-		len = fread(buf, 1, FILE_BUFSIZE, f);
-		(*process_buf)(buf, len, NULL);
-	} while(len == FILE_BUFSIZE && do_exit == 0);
-	fclose(f);
-}
-
 void print_version() {
 	fprintf(stderr, "dumpvdl2 %s (libacars %s)\n", DUMPVDL2_VERSION, LA_VERSION);
 }
 
-void describe_option(char const *name, char const *description, int indent) {
-	int descr_shiftwidth = USAGE_OPT_NAME_COLWIDTH - (int)strlen(name) - indent * USAGE_INDENT_STEP;
-	if(descr_shiftwidth < 1) {
-		descr_shiftwidth = 1;
-	}
-	fprintf(stderr, "%*s%s%*s%s\n", IND(indent), "", name, descr_shiftwidth, "", description);
-}
-
 
 void usage() {
 	fprintf(stderr, "Usage:\n");
@@ -399,10 +379,23 @@ void usage() {
 	fprintf(stderr, "\nRead I/Q samples from a file (use \"-\" to read from standard input):\n\n"
 			"%*sdumpvdl2 [output_options] --iq-file <input_file> [file_options] [<freq_1> [<freq_2> [...]]]\n",
 			IND(1), "");
+	fprintf(stderr, "\nReceive I/Q samples over the network:\n\n"
+			"%*sdumpvdl2 [output_options] --iq-net <url> [iq_net_options] [<freq_1> [<freq_2> [...]]]\n",
+			IND(1), "");
+	fprintf(stderr, "\nGenerate a synthetic VDL2 signal (for testing and benchmarking):\n\n"
+			"%*sdumpvdl2 [output_options] --iq-synth <param1=val1,...> [iq_synth_options] [<freq_1> [<freq_2> [...]]]\n",
+			IND(1), "");
 #ifdef WITH_PROTOBUF_C
 	fprintf(stderr, "\nRead raw AVLC frames from a file (use \"-\" to read from standard input):\n\n"
-			"%*sdumpvdl2 [output_options] --raw-frames-file <input_file>\n",
+			"%*sdumpvdl2 [output_options] --raw-frames-file <input_file> [raw_frames_file_options]\n",
 			IND(1), "");
+#endif
+#if defined WITH_RTLSDR || defined WITH_MIRISDR || defined WITH_SDRPLAY || defined WITH_SDRPLAY3 || defined WITH_SOAPYSDR
+	fprintf(stderr, "\nMultiple receivers (up to %d) in a single process:\n\n"
+			"%*sdumpvdl2 [output_options] --rtlsdr <device_id_1> [rtlsdr_options] <freqs_1> --rtlsdr <device_id_2> [rtlsdr_options] <freqs_2> ...\n\n"
+			"%*sReceiver options and frequencies apply to the most recently given receiver.\n"
+			"%*sReceivers of different types may be mixed, but at most one SDRplay device is allowed.\n",
+			INPUTS_MAX, IND(1), "", IND(1), "", IND(1), "");
 #endif
 	fprintf(stderr, "\nGeneral options:\n");
 	describe_option("--help", "Displays this text", 1);
@@ -412,7 +405,10 @@ void usage() {
 #endif
 	fprintf(stderr, "common options:\n");
 	describe_option("<freq_1> [<freq_2> [...]]", "VDL2 channel frequencies", 1);
-	fprintf(stderr, "If channel frequencies are omitted, VDL2 Common Signalling Channel (%u Hz) will be used as default.\n\n", CSC_FREQ);
+	fprintf(stderr, "If channel frequencies are omitted, VDL2 Common Signalling Channel (%u Hz) will be used as default.\n", CSC_FREQ);
+	describe_option("--sample-rate <sample_rate>", "Set input sampling rate, k or M suffix allowed (default: input-specific)", 1);
+	fprintf(stderr, "%*s(any rate of at least %u sps; rates which are not a multiple of it are resampled)\n\n",
+			USAGE_OPT_NAME_COLWIDTH, "", SYMBOL_RATE * SPS);
 
 #ifdef WITH_RTLSDR
 	fprintf(stderr, "rtlsdr_options:\n");
@@ -469,14 +465,58 @@ void usage() {
 #endif
 	fprintf(stderr, "\nfile_options:\n");
 	describe_option("--iq-file <input_file>", "Read I/Q samples from a file (use \"-\" to read from standard input)", 1);
+	describe_option("", "(for SigMF recordings give the .sigmf-data or .sigmf-meta file - center frequency,", 1);
+	describe_option("", "sampling rate and sample format are then read from metadata, unless overridden)", 1);
 	describe_option("--centerfreq <center_frequency>", "Center frequency of the input data, (default: 0)", 1);
 	describe_option("--oversample <oversample_rate>", "Oversampling rate for recorded data", 1);
-	fprintf(stderr, "%*s(sampling rate will be set to %u * oversample_rate)\n", USAGE_OPT_NAME_COLWIDTH, "", SYMBOL_RATE * SPS);
+	fprintf(stderr, "%*s(sampling rate will be set to %u * oversample_rate, unless --sample-rate is given)\n", USAGE_OPT_NAME_COLWIDTH, "", SYMBOL_RATE * SPS);
 	fprintf(stderr, "%*sDefault: %u\n", USAGE_OPT_NAME_COLWIDTH, "", FILE_OVERSAMPLE);
+	describe_option("--repeat <n>", "Read the input file <n> times (default: 1, standard input can't be repeated)", 1);
 
 	describe_option("--sample-format <sample_format>", "Input sample format. Supported formats:", 1);
 	describe_option("U8", "8-bit unsigned (eg. recorded with rtl_sdr) (default)", 2);
-	describe_option("S16LE", "16-bit signed, little-endian (eg. recorded with miri_sdr)", 2);
+	describe_option("S8", "8-bit signed (eg. recorded with hackrf_transfer)", 2);
+	describe_option("S16_LE", "16-bit signed, little-endian (eg. recorded with miri_sdr)", 2);
+	describe_option("F32_LE", "32-bit float, little-endian (eg. recorded with GNU Radio)", 2);
+	fprintf(stderr, "%*s(SoapySDR names - CU8, CS8, CS16, CF32 - are accepted as well)\n", USAGE_OPT_NAME_COLWIDTH, "");
+
+	fprintf(stderr, "\niq_net_options:\n");
+	describe_option("--iq-net <url>", "Receive I/Q samples from the network. Supported URLs:", 1);
+	describe_option("rtl_tcp://<host>:<port>", "Connect to rtl_tcp server (U8 samples only)", 2);
+	describe_option("tcp://<host>:<port>", "Connect to a server sending a raw I/Q stream", 2);
+	describe_option("udp://[<address>:]<port>", "Receive a raw I/Q stream sent as UDP datagrams to the given port", 2);
+	describe_option("--centerfreq <center_frequency>", "Set center frequency (default: auto)", 1);
+	describe_option("", "(tcp and udp: must match the frequency the remote receiver is tuned to)", 1);
+	describe_option("--gain <gain>", "rtl_tcp: set gain (decibels)", 1);
+	describe_option("--correction <correction>", "rtl_tcp: set freq correction (ppm)", 1);
+	describe_option("--sample-format <sample_format>", "tcp and udp: input sample format (see file_options)", 1);
+	describe_option("--iq-net-idle-timeout <seconds>", "rtl_tcp and tcp: reconnect if no data arrives for this long", 1);
+	fprintf(stderr, "%*s(default: %d, 0 = never)\n", USAGE_OPT_NAME_COLWIDTH, "", IQ_NET_IDLE_TIMEOUT_DEFAULT);
+	fprintf(stderr, "%*sDefault sampling rate: %u sps\n", USAGE_OPT_NAME_COLWIDTH, "", SYMBOL_RATE * SPS * IQ_NET_OVERSAMPLE);
+
+	fprintf(stderr, "\niq_synth_options:\n");
+	describe_option("--iq-synth <param1=val1,...>", "Generate VDL2 bursts in white noise on all channels. Parameters:", 1);
+	describe_option("duration=<seconds>", "Signal length (default: 10)", 2);
+	describe_option("burst-rate=<bursts/sec>", "Average number of bursts per second on each channel (default: 10)", 2);
+	describe_option("snr=<dB>", "Signal to noise ratio (Es/N0) (default: 20)", 2);
+	describe_option("freq-offset=<Hz>", "Max carrier frequency offset, random for each burst (default: 0)", 2);
+	describe_option("msg-len=<n>", "ACARS message text length, max 220 (default: 100)", 2);
+	describe_option("seed=<n>", "Random seed (default: 1)", 2);
+	describe_option("--centerfreq <center_frequency>", "Set center frequency (default: auto)", 1);
+	fprintf(stderr, "%*sDefault sampling rate: %u sps\n", USAGE_OPT_NAME_COLWIDTH, "", SYMBOL_RATE * SPS * IQ_SYNTH_OVERSAMPLE);
+#ifdef WITH_PROTOBUF_C
+
+	fprintf(stderr, "\nraw_frames_file_options:\n");
+	describe_option("--decoder-threads <n>", "Number of threads decoding the file (default: 1, 0 = one per CPU core)", 1);
+	describe_option("", "(multithreaded decoding is not available when reading from standard input)", 1);
+	describe_option("--from <time>", "Process only frames received at or after <time>", 1);
+	describe_option("--to <time>", "Process only frames received before <time>", 1);
+	fprintf(stderr, "%*s<time> is either a Unix timestamp or a date in the form of YYYY-MM-DD[ HH:MM[:SS]]\n", USAGE_OPT_NAME_COLWIDTH, "");
+	fprintf(stderr, "%*s(local time, unless --utc is given)\n", USAGE_OPT_NAME_COLWIDTH, "");
+	describe_option("--freq <frequency>", "Process only frames received on the given channel frequency", 1);
+	describe_option("--addr <hex_address>", "Process only frames sent from or to the given AVLC address", 1);
+	describe_option("", "(a sidecar index file is used, when available, to locate matching frames)", 1);
+#endif
 
 	fprintf(stderr, "\nOutput options:\n");
 	describe_option("--output <output_specifier>", "Output specification (default: " DEFAULT_OUTPUT ")", 1);
@@ -484,9 +524,22 @@ void usage() {
 	describe_option("--output-queue-hwm <integer>", "High water mark value for output queues (0 = no limit)", 1);
 	fprintf(stderr, "%*s(default: %d messages, not applicable when using --iq-file or --raw-frames-file)\n", USAGE_OPT_NAME_COLWIDTH, "", OUTPUT_QUEUE_HWM_DEFAULT);
 	describe_option("--decode-fragments", "Decode higher level protocols in fragmented packets", 1);
-	describe_option("--gs-file <file>", "Read ground station info from <file> (MultiPSK format)", 1);
+	describe_option("--reasm-max-memory <megabytes>", "Max total memory used by CLNP reassembly (0 = no limit)", 1);
+	fprintf(stderr, "%*s(default: %d)\n", USAGE_OPT_NAME_COLWIDTH, "", REASM_MAX_MEMORY_DEFAULT / 1024 / 1024);
+	describe_option("--dedup-window <milliseconds>", "Suppress copies of the same frame received within this time window,", 1);
+	describe_option("", "keeping the one with the highest signal level (0 = disabled)", 1);
+	fprintf(stderr, "%*s(default: 0, max: %d)\n", USAGE_OPT_NAME_COLWIDTH, "", DEDUP_WINDOW_MAX);
+	describe_option("--gs-file <file>", "Read ground station info from <file> (MultiPSK format or binary)", 1);
+	describe_option("", "(send SIGHUP to the program to reload the file)", 1);
+	describe_option("--gs-file-compile <file>", "Convert --gs-file to binary format, save it to <file> and exit", 1);
 #ifdef WITH_SQLITE
 	describe_option("--bs-db <file>", "Read aircraft info from Basestation database <file> (SQLite)", 1);
+	describe_option("--bs-db-preload", "Load the whole Basestation database into memory on startup", 1);
+	describe_option("", "(the database is reloaded automatically when the file changes)", 1);
+	describe_option("--bs-db-cache-size <integer>", "Max number of cached aircraft entries (0 = no limit)", 1);
+	fprintf(stderr, "%*s(default: %d, not applicable when using --bs-db-preload)\n", USAGE_OPT_NAME_COLWIDTH, "", AC_CACHE_MAX_ENTRIES_DEFAULT);
+	describe_option("--bs-db-cache-memory <megabytes>", "Max memory used by cached aircraft entries (0 = no limit)", 1);
+	fprintf(stderr, "%*s(default: %d, not applicable when using --bs-db-preload)\n", USAGE_OPT_NAME_COLWIDTH, "", AC_CACHE_MAX_MEMORY_DEFAULT / 1024 / 1024);
 #endif
 	describe_option("--addrinfo terse|normal|verbose", "Aircraft/ground station info verbosity level (default: normal)", 1);
 	describe_option("--station-id <name>", "Receiver site identifier", 1);
@@ -495,7 +548,14 @@ void usage() {
 	describe_option("", "(See \"--msg-filter help\" for details)", 1);
 #ifdef WITH_STATSD
 	describe_option("--statsd <host>:<port>", "Send statistics to Etsy StatsD server <host>:<port>", 1);
+	describe_option("--statsd-interval <seconds>", "How often to send statistics to the StatsD server", 1);
+	fprintf(stderr, "%*s(default: %d)\n", USAGE_OPT_NAME_COLWIDTH, "", STATSD_INTERVAL_DEFAULT);
 #endif
+	describe_option("--metrics-listen [<address>:]<port>", "Serve statistics in Prometheus format over HTTP", 1);
+	fprintf(stderr, "%*s(URL: http://<address>:<port>/metrics, default address: all)\n", USAGE_OPT_NAME_COLWIDTH, "");
+	describe_option("--latency-trace", "Include processing latency of each message in JSON output", 1);
+	describe_option("--bench", "Benchmark mode - print throughput, CPU time of each processing stage", 1);
+	describe_option("", "and allocation count at exit (default output: decoded text to /dev/null)", 1);
 
 	fprintf(stderr, "\nText output formatting options:\n");
 	describe_option("--utc", "Use UTC timestamps in output and file names", 1);
@@ -637,6 +697,56 @@ static uint32_t parse_msg_filterspec(msg_filterspec_t const *filters, void (*hel
 	return fmask;
 }
 
+#ifdef WITH_PROTOBUF_C
+static bool parse_timestamp(char const *str, struct timeval *result) {
+	ASSERT(str != NULL);
+	ASSERT(result != NULL);
+
+	char *endptr = NULL;
+	long long val = strtoll(str, &endptr, 10);
+	if(endptr != str && *endptr == '\0') {
+		result->tv_sec = (time_t)val;
+		result->tv_usec = 0;
+		return true;
+	}
+	static char const *formats[] = {
+		"%Y-%m-%d %H:%M:%S",
+		"%Y-%m-%dT%H:%M:%S",
+		"%Y-%m-%d %H:%M",
+		"%Y-%m-%dT%H:%M",
+		"%Y-%m-%d",
+		NULL
+	};
+	struct tm tm;
+	for(char const **fmt = formats; *fmt != NULL; fmt++) {
+		memset(&tm, 0, sizeof(tm));
+		endptr = strptime(str, *fmt, &tm);
+		if(endptr != NULL && *endptr == '\0') {
+			tm.tm_isdst = -1;
+			result->tv_sec = Config.utc ? timegm(&tm) : mktime(&tm);
+			result->tv_usec = 0;
+			return true;
+		}
+	}
+	fprintf(stderr, "Cannot parse '%s' as time: expected a Unix timestamp or YYYY-MM-DD[ HH:MM[:SS]]\n", str);
+	return false;
+}
+
+static bool parse_address(char const *str, uint32_t *result) {
+	ASSERT(str != NULL);
+	ASSERT(result != NULL);
+
+	char *endptr = NULL;
+	unsigned long val = strtoul(str, &endptr, 16);
+	if(endptr == str || *endptr != '\0' || val > RAW_FRAMES_INDEX_ADDR_MASK) {
+		fprintf(stderr, "Cannot parse '%s' as address: expected a hexadecimal number not larger than FFFFFF\n", str);
+		return false;
+	}
+	*result = (uint32_t)val;
+	return true;
+}
+#endif
+
 static bool parse_frequency(char const *str, uint32_t *result) {
 	ASSERT(str != NULL);
 	ASSERT(result != NULL);
@@ -686,47 +796,183 @@ static bool parse_frequency(char const *str, uint32_t *result) {
 	return true;
 }
 
-
-int main(int argc, char **argv) {
-	vdl2_state_t ctx;
-	uint32_t centerfreq = 0, sample_rate = 0, oversample = 0, bandwidth = 0;
-	uint32_t *freqs = NULL;
-	int num_channels = 0;
-	enum input_types input = INPUT_UNDEF;
-	enum sample_formats sample_fmt = SFMT_UNDEF;
-	la_list *fmtr_list = NULL;
-	bool input_is_iq = true;
-	pthread_t decoder_thread;
-#if defined WITH_RTLSDR || defined WITH_MIRISDR || defined WITH_SDRPLAY || defined WITH_SDRPLAY3 || defined WITH_SOAPYSDR
-	char *device = NULL;
-	float gain = SDR_AUTO_GAIN;
-	int correction = 0;
-	int bias = 0;
+// Settings and state of a single input (SDR device or file)
+typedef struct {
+	enum input_types type;
+	char *device;                       // device ID or input file name
+	uint32_t *freqs;                    // channel frequencies
+	int num_channels;
+	uint32_t centerfreq, sample_rate, oversample, bandwidth;
+	enum sample_formats sample_fmt;
+	float gain;
+	int correction;
+	int repeat;                         // number of passes over the input file
+	int iq_net_idle_timeout;            // seconds without data before reconnecting (0 = never)
+#ifdef WITH_RTLSDR
+	int bias;
 #endif
 #ifdef WITH_MIRISDR
-	int mirisdr_hw_flavour = 0;
-	int mirisdr_usb_xfer_mode = 0;
+	int mirisdr_hw_flavour;
+	int mirisdr_usb_xfer_mode;
+#endif
+#if defined WITH_SDRPLAY || defined WITH_SDRPLAY3
+	char *sdrplay_antenna;
+	int sdrplay_biast;
+	int sdrplay_notch_filter;
+	int sdrplay_tuner;
+	int sdrplay_agc;
+#endif
+#ifdef WITH_SDRPLAY
+	int sdrplay_gr;
+#endif
+#ifdef WITH_SDRPLAY3
+	int sdrplay3_dab_notch_filter;
+	int sdrplay3_ifgr;
+	int sdrplay3_lna_state;
+#endif
+#ifdef WITH_SOAPYSDR
+	char *soapysdr_settings;
+	char *soapysdr_antenna;
+	char *soapysdr_gain;
 #endif
+	vdl2_state_t ctx;
+	pthread_t thread;
+	int exit_code;
+} input_t;
+
+static void input_set_defaults(input_t *in) {
+	memset(in, 0, sizeof(input_t));
+	in->type = INPUT_UNDEF;
+	in->sample_fmt = SFMT_UNDEF;
+	in->gain = SDR_AUTO_GAIN;
+	in->iq_net_idle_timeout = IQ_NET_IDLE_TIMEOUT_DEFAULT;
 #if defined WITH_SDRPLAY || defined WITH_SDRPLAY3
-	char *sdrplay_antenna = NULL;
-	int sdrplay_biast = 0;
-	int sdrplay_notch_filter = 0;
-	int sdrplay_tuner = 1;
-	int sdrplay_agc = 0;
+	in->sdrplay_tuner = 1;
+#endif
+#ifdef WITH_SDRPLAY
+	in->sdrplay_gr = SDR_AUTO_GAIN;
+#endif
+#ifdef WITH_SDRPLAY3
+	in->sdrplay3_ifgr = SDR_AUTO_GAIN;
+	in->sdrplay3_lna_state = SDR_AUTO_GAIN;
+#endif
+}
+
+// Called for each input option (--rtlsdr, --iq-file, etc). Input-specific
+// options and channel frequencies apply to the most recently added input.
+// Those given before the first input option apply to the first input.
+static input_t *input_add(input_t *inputs, int *num_inputs, enum input_types type,
+		char *device, uint32_t oversample) {
+	input_t *in = &inputs[0];
+	if(*num_inputs > 0) {
+		if(*num_inputs == INPUTS_MAX) {
+			fprintf(stderr, "Too many inputs (max %d)\n", INPUTS_MAX);
+			_exit(1);
+		}
+		in = &inputs[*num_inputs];
+		input_set_defaults(in);
+	}
+	(*num_inputs)++;
+	in->type = type;
+	in->device = device;
+	if(in->oversample == 0) {
+		in->oversample = oversample;
+	}
+	return in;
+}
+
+// Runs the input until it ends or the program is stopped.
+// Returns the program exit code.
+static int input_run(input_t *in) {
+	switch(in->type) {
+		case INPUT_IQ_FILE:
+			input_iq_file_process(&in->ctx, in->device, in->sample_fmt, in->sample_rate,
+					in->repeat > 0 ? (uint32_t)in->repeat : 1);
+			break;
+		case INPUT_IQ_NET:
+			input_iq_net_process(&in->ctx, in->device, in->sample_fmt, in->centerfreq, in->sample_rate,
+					in->gain, in->correction, in->iq_net_idle_timeout);
+			break;
+		case INPUT_IQ_SYNTH:
+			input_iq_synth_process(&in->ctx, in->device, in->centerfreq, in->sample_rate,
+					in->freqs, in->num_channels);
+			break;
+#ifdef WITH_RTLSDR
+		case INPUT_RTLSDR:
+			rtl_init(&in->ctx, in->device, in->centerfreq, in->sample_rate, in->bandwidth,
+					in->gain, in->correction, in->bias);
+			break;
+#endif
+#ifdef WITH_MIRISDR
+		case INPUT_MIRISDR:
+			mirisdr_init(&in->ctx, in->device, in->mirisdr_hw_flavour, in->centerfreq, in->sample_rate,
+					in->gain, in->correction, in->mirisdr_usb_xfer_mode);
+			break;
 #endif
 #ifdef WITH_SDRPLAY
-	int sdrplay_gr = SDR_AUTO_GAIN;
+		case INPUT_SDRPLAY:
+			sdrplay_init(&in->ctx, in->device, in->sdrplay_antenna, in->centerfreq, in->sample_rate,
+					in->sdrplay_gr, in->correction, in->sdrplay_biast, in->sdrplay_notch_filter,
+					in->sdrplay_agc, in->sdrplay_tuner);
+			break;
 #endif
 #ifdef WITH_SDRPLAY3
-	int sdrplay3_dab_notch_filter = 0;
-	int sdrplay3_ifgr = SDR_AUTO_GAIN;
-	int sdrplay3_lna_state = SDR_AUTO_GAIN;
+		case INPUT_SDRPLAY3:
+			sdrplay3_init(&in->ctx, in->device, in->sdrplay_antenna, in->centerfreq, in->sample_rate,
+					in->sdrplay3_ifgr, in->sdrplay3_lna_state, in->correction, in->sdrplay_biast,
+					in->sdrplay_notch_filter, in->sdrplay3_dab_notch_filter, in->sdrplay_agc, in->sdrplay_tuner);
+			break;
 #endif
 #ifdef WITH_SOAPYSDR
-	char *soapysdr_settings = NULL;
-	char *soapysdr_antenna = NULL;
-	char *soapysdr_gain = NULL;
+		case INPUT_SOAPYSDR:
+			soapysdr_init(&in->ctx, in->device, in->soapysdr_antenna, in->centerfreq, in->sample_rate,
+					in->bandwidth, in->gain, in->correction, in->soapysdr_settings, in->soapysdr_gain);
+			break;
 #endif
+		default:
+			fprintf(stderr, "Unknown input type\n");
+			return 5;
+	}
+	return 0;
+}
+
+static void *input_thread(void *arg) {
+	input_t *in = arg;
+	in->exit_code = input_run(in);
+	// If any of the inputs stops, shut down the others as well
+	if(do_exit == 0) {
+		do_exit = 1;
+	}
+	inputs_cancel();
+	return NULL;
+}
+
+// Runs all SDR inputs, each one in its own thread, if there is more than one.
+static int inputs_run(input_t *inputs, int num_inputs) {
+	if(num_inputs == 1) {
+		return input_run(&inputs[0]);
+	}
+	for(int i = 0; i < num_inputs; i++) {
+		start_thread(&inputs[i].thread, input_thread, &inputs[i]);
+	}
+	int exit_code = 0;
+	for(int i = 0; i < num_inputs; i++) {
+		pthread_join(inputs[i].thread, NULL);
+		if(inputs[i].exit_code != 0) {
+			exit_code = inputs[i].exit_code;
+		}
+	}
+	return exit_code;
+}
+
+int main(int argc, char **argv) {
+	input_t inputs[INPUTS_MAX];
+	int num_inputs = 0;
+	input_set_defaults(&inputs[0]);
+	input_t *in = &inputs[0];
+	la_list *fmtr_list = NULL;
+	bool input_is_iq = true;
+	pthread_t decoder_thread;
 	int opt;
 	struct option long_opts[] = {
 		{ "centerfreq",         required_argument,  NULL,   __OPT_CENTERFREQ },
@@ -737,17 +983,27 @@ int main(int argc, char **argv) {
 		{ "dump-asn1",          no_argument,        NULL,   __OPT_DUMP_ASN1 },
 		{ "extended-header",    no_argument,        NULL,   __OPT_EXTENDED_HEADER },
 		{ "decode-fragments",   no_argument,        NULL,   __OPT_DECODE_FRAGMENTS },
+		{ "reasm-max-memory",   required_argument,  NULL,   __OPT_REASM_MAX_MEMORY },
+		{ "dedup-window",       required_argument,  NULL,   __OPT_DEDUP_WINDOW },
 		{ "prettify-xml",       no_argument,        NULL,   __OPT_PRETTIFY_XML },
 		{ "gs-file",            required_argument,  NULL,   __OPT_GS_FILE },
+		{ "gs-file-compile",    required_argument,  NULL,   __OPT_GS_FILE_COMPILE },
 		{ "prettify-json",      no_argument,        NULL,   __OPT_PRETTIFY_JSON },
 #ifdef WITH_SQLITE
 		{ "bs-db",              required_argument,  NULL,   __OPT_BS_DB },
+		{ "bs-db-preload",      no_argument,        NULL,   __OPT_BS_DB_PRELOAD },
+		{ "bs-db-cache-size",   required_argument,  NULL,   __OPT_BS_DB_CACHE_SIZE },
+		{ "bs-db-cache-memory", required_argument,  NULL,   __OPT_BS_DB_CACHE_MEMORY },
 #endif
 		{ "addrinfo",           required_argument,  NULL,   __OPT_ADDRINFO_VERBOSITY },
 		{ "output",             required_argument,  NULL,   __OPT_OUTPUT },
 		{ "output-queue-hwm",   required_argument,  NULL,   __OPT_OUTPUT_QUEUE_HWM },
 		{ "iq-file",            required_argument,  NULL,   __OPT_IQ_FILE },
+		{ "iq-net",             required_argument,  NULL,   __OPT_IQ_NET },
+		{ "iq-net-idle-timeout", required_argument, NULL,   __OPT_IQ_NET_IDLE_TIMEOUT },
+		{ "iq-synth",           required_argument,  NULL,   __OPT_IQ_SYNTH },
 		{ "oversample",         required_argument,  NULL,   __OPT_OVERSAMPLE },
+		{ "sample-rate",        required_argument,  NULL,   __OPT_SAMPLE_RATE },
 		{ "sample-format",      required_argument,  NULL,   __OPT_SAMPLE_FORMAT },
 		{ "msg-filter",         required_argument,  NULL,   __OPT_MSG_FILTER },
 #ifdef WITH_MIRISDR
@@ -782,18 +1038,24 @@ int main(int argc, char **argv) {
 		{ "rtlsdr",             required_argument,  NULL,   __OPT_RTLSDR },
 		{ "bias",               required_argument,  NULL,   __OPT_BIAS },
 #endif
-#if defined WITH_RTLSDR || defined WITH_MIRISDR || defined WITH_SOAPYSDR
 		{ "gain",               required_argument,  NULL,   __OPT_GAIN },
-#endif
-#if defined WITH_RTLSDR || defined WITH_MIRISDR || defined WITH_SDRPLAY || defined WITH_SDRPLAY3 || defined WITH_SOAPYSDR
 		{ "correction",         required_argument,  NULL,   __OPT_CORRECTION },
-#endif
 #ifdef WITH_PROTOBUF_C
 		{ "raw-frames-file",    required_argument,  NULL,   __OPT_RAW_FRAMES_FILE },
+		{ "decoder-threads",    required_argument,  NULL,   __OPT_DECODER_THREADS },
+		{ "from",               required_argument,  NULL,   __OPT_FROM },
+		{ "to",                 required_argument,  NULL,   __OPT_TO },
+		{ "freq",               required_argument,  NULL,   __OPT_FREQ },
+		{ "addr",               required_argument,  NULL,   __OPT_ADDR },
 #endif
 #ifdef WITH_STATSD
 		{ "statsd",             required_argument,  NULL,   __OPT_STATSD },
+		{ "statsd-interval",    required_argument,  NULL,   __OPT_STATSD_INTERVAL },
 #endif
+		{ "metrics-listen",     required_argument,  NULL,   __OPT_METRICS_LISTEN },
+		{ "latency-trace",      no_argument,        NULL,   __OPT_LATENCY_TRACE },
+		{ "bench",              no_argument,        NULL,   __OPT_BENCH },
+		{ "repeat",             required_argument,  NULL,   __OPT_REPEAT },
 		{ "version",            no_argument,        NULL,   __OPT_VERSION },
 		{ "help",               no_argument,        NULL,   __OPT_HELP },
 #ifdef DEBUG
@@ -805,12 +1067,26 @@ int main(int argc, char **argv) {
 #ifdef WITH_STATSD
 	char *statsd_addr = NULL;
 	bool statsd_enabled = false;
+	int statsd_interval = STATSD_INTERVAL_DEFAULT;
 #endif
+	char *metrics_listen_addr = NULL;
 #ifdef WITH_SQLITE
 	char *bs_db_file = NULL;
+	bool bs_db_preload = false;
+	int bs_db_cache_size = AC_CACHE_MAX_ENTRIES_DEFAULT;
+	int bs_db_cache_memory = AC_CACHE_MAX_MEMORY_DEFAULT / 1024 / 1024;
 #endif
-	char *infile = NULL;
+	int reasm_max_memory = REASM_MAX_MEMORY_DEFAULT / 1024 / 1024;
+	int dedup_window = 0;
+	bool bench = false;
 	char *gs_file = NULL;
+	char *gs_file_compiled = NULL;
+#ifdef WITH_PROTOBUF_C
+	int decoder_threads = 1;
+	char *raw_frames_from = NULL, *raw_frames_to = NULL;
+	raw_frames_filter_t raw_frames_filter;
+	memset(&raw_frames_filter, 0, sizeof(raw_frames_filter));
+#endif
 
 	// Initialize default config
 	memset(&Config, 0, sizeof(Config));
@@ -819,27 +1095,62 @@ int main(int argc, char **argv) {
 	Config.output_queue_hwm = OUTPUT_QUEUE_HWM_DEFAULT;
 
 	print_version();
-	while((opt = getopt_long(argc, argv, "", long_opts, NULL)) != -1) {
+	// Leading '-' makes non-option arguments (channel frequencies) to be
+	// returned in order with options, so that they can be assigned to inputs
+	while((opt = getopt_long(argc, argv, "-", long_opts, NULL)) != -1) {
 		switch(opt) {
+			case 1:
+				in->freqs = XREALLOC(in->freqs, (in->num_channels + 1) * sizeof(uint32_t));
+				if(parse_frequency(optarg, &in->freqs[in->num_channels]) == false) {
+					return 1;
+				}
+				in->num_channels++;
+				break;
 #ifdef WITH_PROTOBUF_C
 			case __OPT_RAW_FRAMES_FILE:
-				infile = strdup(optarg);
-				input = INPUT_RAW_FRAMES_FILE;
+				in = input_add(inputs, &num_inputs, INPUT_RAW_FRAMES_FILE, optarg, 0);
 				input_is_iq = false;
 				break;
+			case __OPT_DECODER_THREADS:
+				decoder_threads = atoi(optarg);
+				if(decoder_threads < 0) {
+					fprintf(stderr, "Invalid --decoder-threads value: must be a non-negative integer\n");
+					_exit(1);
+				}
+				break;
+			case __OPT_FROM:
+				raw_frames_from = optarg;
+				break;
+			case __OPT_TO:
+				raw_frames_to = optarg;
+				break;
+			case __OPT_FREQ:
+				if(parse_frequency(optarg, &raw_frames_filter.freq) == false) {
+					_exit(1);
+				}
+				break;
+			case __OPT_ADDR:
+				if(parse_address(optarg, &raw_frames_filter.addr) == false) {
+					_exit(1);
+				}
+				raw_frames_filter.addr_set = true;
+				break;
 #endif
 			case __OPT_IQ_FILE:
-				infile = strdup(optarg);
-				input = INPUT_IQ_FILE;
-				oversample = FILE_OVERSAMPLE;
-				sample_fmt = SFMT_U8;
+				in = input_add(inputs, &num_inputs, INPUT_IQ_FILE, optarg, FILE_OVERSAMPLE);
+				break;
+			case __OPT_IQ_NET:
+				in = input_add(inputs, &num_inputs, INPUT_IQ_NET, optarg, IQ_NET_OVERSAMPLE);
+				if(in->sample_fmt == SFMT_UNDEF) {
+					in->sample_fmt = SFMT_U8;
+				}
+				break;
+			case __OPT_IQ_SYNTH:
+				in = input_add(inputs, &num_inputs, INPUT_IQ_SYNTH, optarg, IQ_SYNTH_OVERSAMPLE);
 				break;
 			case __OPT_SAMPLE_FORMAT:
-				if(!strcmp(optarg, "U8"))
-					sample_fmt = SFMT_U8;
-				else if(!strcmp(optarg, "S16_LE"))
-					sample_fmt = SFMT_S16_LE;
-				else {
+				in->sample_fmt = sample_format_from_string(optarg);
+				if(in->sample_fmt == SFMT_UNDEF) {
 					fprintf(stderr, "Unknown sample format\n");
 					_exit(1);
 				}
@@ -864,12 +1175,29 @@ int main(int argc, char **argv) {
 				Config.decode_fragments = true;
 				la_config_set_bool("decode_fragments", true);
 				break;
+			case __OPT_REASM_MAX_MEMORY:
+				reasm_max_memory = atoi(optarg);
+				if(reasm_max_memory < 0) {
+					fprintf(stderr, "Invalid --reasm-max-memory value: must be a non-negative integer\n");
+					_exit(1);
+				}
+				break;
+			case __OPT_DEDUP_WINDOW:
+				dedup_window = atoi(optarg);
+				if(dedup_window < 0 || dedup_window > DEDUP_WINDOW_MAX) {
+					fprintf(stderr, "Invalid --dedup-window value: must be between 0 and %d\n", DEDUP_WINDOW_MAX);
+					_exit(1);
+				}
+				break;
 			case __OPT_PRETTIFY_XML:
 				la_config_set_bool("prettify_xml", true);
 				break;
 			case __OPT_GS_FILE:
 				gs_file = optarg;
 				break;
+			case __OPT_GS_FILE_COMPILE:
+				gs_file_compiled = optarg;
+				break;
 			case __OPT_PRETTIFY_JSON:
 				la_config_set_bool("prettify_json", true);
 				break;
@@ -877,6 +1205,23 @@ int main(int argc, char **argv) {
 			case __OPT_BS_DB:
 				bs_db_file = optarg;
 				break;
+			case __OPT_BS_DB_PRELOAD:
+				bs_db_preload = true;
+				break;
+			case __OPT_BS_DB_CACHE_SIZE:
+				bs_db_cache_size = atoi(optarg);
+				if(bs_db_cache_size < 0 || (bs_db_cache_size > 0 && bs_db_cache_size < AC_CACHE_MIN_ENTRIES)) {
+					fprintf(stderr, "Invalid --bs-db-cache-size value: must be 0 or at least %d\n", AC_CACHE_MIN_ENTRIES);
+					_exit(1);
+				}
+				break;
+			case __OPT_BS_DB_CACHE_MEMORY:
+				bs_db_cache_memory = atoi(optarg);
+				if(bs_db_cache_memory < 0) {
+					fprintf(stderr, "Invalid --bs-db-cache-memory value: must be a non-negative integer\n");
+					_exit(1);
+				}
+				break;
 #endif
 			case __OPT_ADDRINFO_VERBOSITY:
 				if(!strcmp(optarg, "terse")) {
@@ -899,102 +1244,88 @@ int main(int argc, char **argv) {
 				Config.station_id = strndup(optarg, STATION_ID_LEN_MAX);
 				break;
 			case __OPT_CENTERFREQ:
-				if(parse_frequency(optarg, &centerfreq) == false) {
+				if(parse_frequency(optarg, &in->centerfreq) == false) {
 					_exit(1);
 				}
 				break;
 #ifdef WITH_MIRISDR
 			case __OPT_MIRISDR:
-				device = optarg;
-				input = INPUT_MIRISDR;
-				oversample = MIRISDR_OVERSAMPLE;
+				in = input_add(inputs, &num_inputs, INPUT_MIRISDR, optarg, MIRISDR_OVERSAMPLE);
 				break;
 			case __OPT_HW_TYPE:
-				mirisdr_hw_flavour = atoi(optarg);
+				in->mirisdr_hw_flavour = atoi(optarg);
 				break;
 			case __OPT_USB_MODE:
-				mirisdr_usb_xfer_mode = atoi(optarg);
+				in->mirisdr_usb_xfer_mode = atoi(optarg);
 				break;
 #endif
 #ifdef WITH_SDRPLAY
 			case __OPT_SDRPLAY:
-				device = optarg;
-				input = INPUT_SDRPLAY;
-				oversample = SDRPLAY_OVERSAMPLE;
+				in = input_add(inputs, &num_inputs, INPUT_SDRPLAY, optarg, SDRPLAY_OVERSAMPLE);
 				break;
 			case __OPT_GR:
-				sdrplay_gr = atoi(optarg);
+				in->sdrplay_gr = atoi(optarg);
 				break;
 #endif
 #ifdef WITH_SDRPLAY3
 			case __OPT_SDRPLAY3:
-				device = optarg;
-				input = INPUT_SDRPLAY3;
-				oversample = SDRPLAY3_OVERSAMPLE;
+				in = input_add(inputs, &num_inputs, INPUT_SDRPLAY3, optarg, SDRPLAY3_OVERSAMPLE);
 				break;
 			case __OPT_SDRPLAY3_IFGR:
-				sdrplay3_ifgr = atoi(optarg);
+				in->sdrplay3_ifgr = atoi(optarg);
 				break;
 			case __OPT_SDRPLAY3_LNA_STATE:
-				sdrplay3_lna_state = atoi(optarg);
+				in->sdrplay3_lna_state = atoi(optarg);
 				break;
 			case __OPT_SDRPLAY3_DAB_NOTCH_FILTER:
-				sdrplay3_dab_notch_filter = atoi(optarg);
+				in->sdrplay3_dab_notch_filter = atoi(optarg);
 				break;
 #endif
 #if defined WITH_SDRPLAY || defined WITH_SDRPLAY3
 			case __OPT_ANTENNA:
-				sdrplay_antenna = strdup(optarg);
+				in->sdrplay_antenna = strdup(optarg);
 				break;
 			case __OPT_BIAST:
-				sdrplay_biast = atoi(optarg);
+				in->sdrplay_biast = atoi(optarg);
 				break;
 			case __OPT_NOTCH_FILTER:
-				sdrplay_notch_filter = atoi(optarg);
+				in->sdrplay_notch_filter = atoi(optarg);
 				break;
 			case __OPT_AGC:
-				sdrplay_agc = atoi(optarg);
+				in->sdrplay_agc = atoi(optarg);
 				break;
 			case __OPT_TUNER:
-				sdrplay_tuner = atoi(optarg);
+				in->sdrplay_tuner = atoi(optarg);
 				break;
 #endif
 #ifdef WITH_SOAPYSDR
 			case __OPT_SOAPYSDR:
-				device = optarg;
-				input = INPUT_SOAPYSDR;
-				oversample = SOAPYSDR_OVERSAMPLE;
+				in = input_add(inputs, &num_inputs, INPUT_SOAPYSDR, optarg, SOAPYSDR_OVERSAMPLE);
 				break;
 			case __OPT_DEVICE_SETTINGS:
-				soapysdr_settings = strdup(optarg);
+				in->soapysdr_settings = strdup(optarg);
 				break;
 			case __OPT_SOAPY_ANTENNA:
-				soapysdr_antenna = strdup(optarg);
+				in->soapysdr_antenna = strdup(optarg);
 				break;
 			case __OPT_SOAPY_GAIN:
-				soapysdr_gain = strdup(optarg);
+				in->soapysdr_gain = strdup(optarg);
 				break;
 #endif
 #ifdef WITH_RTLSDR
 			case __OPT_RTLSDR:
-				device = optarg;
-				input = INPUT_RTLSDR;
-				oversample = RTL_OVERSAMPLE;
+				in = input_add(inputs, &num_inputs, INPUT_RTLSDR, optarg, RTL_OVERSAMPLE);
 				break;
 			case __OPT_BIAS:
-				bias = atoi(optarg);
+				in->bias = atoi(optarg);
 				break;
 #endif
-#if defined WITH_RTLSDR || defined WITH_MIRISDR || defined WITH_SOAPYSDR
 			case __OPT_GAIN:
-				gain = atof(optarg);
+				in->gain = atof(optarg);
 				break;
-#endif
-#if defined WITH_RTLSDR || defined WITH_MIRISDR || defined WITH_SDRPLAY || defined WITH_SDRPLAY3 || defined WITH_SOAPYSDR
 			case __OPT_CORRECTION:
-				correction = atoi(optarg);
+				in->correction = atoi(optarg);
 				break;
-#endif
 			case __OPT_OUTPUT:
 				fmtr_list = setup_output(fmtr_list, optarg);
 				break;
@@ -1006,14 +1337,53 @@ int main(int argc, char **argv) {
 				}
 				break;
 			case __OPT_OVERSAMPLE:
-				oversample = atoi(optarg);
+				in->oversample = atoi(optarg);
+				break;
+			case __OPT_SAMPLE_RATE:
+				if(parse_frequency(optarg, &in->sample_rate) == false) {
+					_exit(1);
+				}
+				if(in->sample_rate < SYMBOL_RATE * SPS) {
+					fprintf(stderr, "Invalid --sample-rate value: must be at least %u\n", SYMBOL_RATE * SPS);
+					_exit(1);
+				}
 				break;
 #ifdef WITH_STATSD
 			case __OPT_STATSD:
 				statsd_addr = strdup(optarg);
 				statsd_enabled = true;
 				break;
+			case __OPT_STATSD_INTERVAL:
+				statsd_interval = atoi(optarg);
+				if(statsd_interval < 1) {
+					fprintf(stderr, "Invalid --statsd-interval value: must be a positive integer\n");
+					_exit(1);
+				}
+				break;
 #endif
+			case __OPT_METRICS_LISTEN:
+				metrics_listen_addr = optarg;
+				break;
+			case __OPT_LATENCY_TRACE:
+				Config.latency_trace = true;
+				break;
+			case __OPT_BENCH:
+				bench = true;
+				break;
+			case __OPT_IQ_NET_IDLE_TIMEOUT:
+				in->iq_net_idle_timeout = atoi(optarg);
+				if(in->iq_net_idle_timeout < 0) {
+					fprintf(stderr, "Invalid --iq-net-idle-timeout value: must be a non-negative integer\n");
+					_exit(1);
+				}
+				break;
+			case __OPT_REPEAT:
+				in->repeat = atoi(optarg);
+				if(in->repeat < 1 || in->repeat > BENCH_REPEAT_MAX) {
+					fprintf(stderr, "Invalid --repeat value: must be between 1 and %d\n", BENCH_REPEAT_MAX);
+					_exit(1);
+				}
+				break;
 			case __OPT_MSG_FILTER:
 				Config.msg_filter = parse_msg_filterspec(msg_filters, msg_filter_usage, optarg);
 				break;
@@ -1031,53 +1401,136 @@ int main(int argc, char **argv) {
 				usage();
 		}
 	}
-	if(input == INPUT_UNDEF) {
+	if(gs_file_compiled != NULL) {
+		if(gs_file == NULL) {
+			fprintf(stderr, "--gs-file-compile requires --gs-file\n");
+			_exit(1);
+		}
+		_exit(gs_data_compile(gs_file, gs_file_compiled) < 0 ? 1 : 0);
+	}
+	if(num_inputs == 0) {
 		fprintf(stderr, "No input specified\n");
 		fprintf(stderr, "Use --help for help\n");
 		_exit(1);
 	}
+	if(num_inputs > 1) {
+#if defined WITH_SDRPLAY || defined WITH_SDRPLAY3
+		int sdrplay_cnt = 0;
+#endif
+		for(int i = 0; i < num_inputs; i++) {
+			if(inputs[i].type == INPUT_IQ_FILE || inputs[i].type == INPUT_IQ_SYNTH || !input_is_iq) {
+				fprintf(stderr, "--iq-file, --iq-synth and --raw-frames-file cannot be combined with other inputs\n");
+				_exit(1);
+			}
+#ifdef WITH_SDRPLAY
+			if(inputs[i].type == INPUT_SDRPLAY) {
+				sdrplay_cnt++;
+			}
+#endif
+#ifdef WITH_SDRPLAY3
+			if(inputs[i].type == INPUT_SDRPLAY3) {
+				sdrplay_cnt++;
+			}
+#endif
+		}
+#if defined WITH_SDRPLAY || defined WITH_SDRPLAY3
+		if(sdrplay_cnt > 1) {
+			fprintf(stderr, "Only one SDRplay device per process is supported\n");
+			_exit(1);
+		}
+#endif
+	}
 
 // no --output given?
 	if(fmtr_list == NULL) {
-		fmtr_list = setup_output(fmtr_list, DEFAULT_OUTPUT);
+		// Benchmark mode measures formatting, but writing to the terminal would distort the results
+		fmtr_list = setup_output(fmtr_list, bench ? BENCH_DEFAULT_OUTPUT : DEFAULT_OUTPUT);
 	}
 	ASSERT(fmtr_list != NULL);
 
+#ifdef WITH_PROTOBUF_C
+	// Parsed after all options, because the result depends on --utc
+	if(raw_frames_from != NULL) {
+		if(parse_timestamp(raw_frames_from, &raw_frames_filter.from) == false) {
+			_exit(1);
+		}
+		raw_frames_filter.from_set = true;
+	}
+	if(raw_frames_to != NULL) {
+		if(parse_timestamp(raw_frames_to, &raw_frames_filter.to) == false) {
+			_exit(1);
+		}
+		raw_frames_filter.to_set = true;
+	}
+	if(raw_frames_filter_is_active(&raw_frames_filter) && inputs[0].type != INPUT_RAW_FRAMES_FILE) {
+		fprintf(stderr, "--from, --to, --freq and --addr options require --raw-frames-file\n");
+		_exit(1);
+	}
+#endif
+
 	if(input_is_iq) {
-		if(optind < argc) {
-			num_channels = argc - optind;
-			freqs = XCALLOC(num_channels, sizeof(uint32_t));
-			for(int i = 0; i < num_channels; i++)
-				if(parse_frequency(argv[optind + i], &freqs[i]) == false) {
-					return 1;
+		for(int n = 0; n < num_inputs; n++) {
+			in = &inputs[n];
+			if(num_inputs > 1) {
+				fprintf(stderr, "Input #%d: %s\n", n + 1, in->device);
+			}
+			if(in->type == INPUT_IQ_FILE) {
+				// Explicit options take precedence over SigMF metadata
+				if(sigmf_is_recording(in->device)) {
+					sigmf_meta_t meta;
+					if(sigmf_meta_read(in->device, &meta) < 0) {
+						_exit(1);
+					}
+					in->device = meta.data_path;
+					if(in->sample_fmt == SFMT_UNDEF) {
+						in->sample_fmt = meta.sample_fmt;
+					}
+					if(in->sample_rate == 0) {
+						in->sample_rate = meta.sample_rate;
+					}
+					if(in->centerfreq == 0) {
+						in->centerfreq = meta.centerfreq;
+					}
 				}
-		} else {
-			fprintf(stderr, "Warning: frequency not set - using VDL2 Common Signalling Channel as a default (%u Hz)\n", CSC_FREQ);
-			num_channels = 1;
-			freqs = XCALLOC(num_channels, sizeof(uint32_t));
-			freqs[0] = CSC_FREQ;
-		}
+				if(in->sample_fmt == SFMT_UNDEF) {
+					in->sample_fmt = SFMT_U8;
+				}
+				fprintf(stderr, "Sample format: %s\n", sample_format_name(in->sample_fmt));
+			}
+			if(in->num_channels == 0) {
+				fprintf(stderr, "Warning: frequency not set - using VDL2 Common Signalling Channel as a default (%u Hz)\n", CSC_FREQ);
+				in->num_channels = 1;
+				in->freqs = XCALLOC(in->num_channels, sizeof(uint32_t));
+				in->freqs[0] = CSC_FREQ;
+			}
 
-		sample_rate = SYMBOL_RATE * SPS * oversample;
-		fprintf(stderr, "Sampling rate set to %u sps\n", sample_rate);
-		if(centerfreq == 0) {
-			centerfreq = calc_centerfreq(freqs, num_channels, sample_rate);
-			if(centerfreq == 0) {
-				fprintf(stderr, "Failed to calculate center frequency\n");
-				_exit(2);
+			if(in->sample_rate == 0) {
+				in->sample_rate = SYMBOL_RATE * SPS * in->oversample;
+			}
+			fprintf(stderr, "Sampling rate set to %u sps\n", in->sample_rate);
+			if(in->sample_rate % (SYMBOL_RATE * SPS) != 0) {
+				fprintf(stderr, "Sampling rate is not a multiple of %u sps, resampling will be performed\n",
+						SYMBOL_RATE * SPS);
+			}
+			if(in->centerfreq == 0) {
+				in->centerfreq = calc_centerfreq(in->freqs, in->num_channels, in->sample_rate);
+				if(in->centerfreq == 0) {
+					fprintf(stderr, "Failed to calculate center frequency\n");
+					_exit(2);
+				}
 			}
-		}
 
-		if(bandwidth == 0)
-			bandwidth = calc_bandwidth(freqs, num_channels);
+			if(in->bandwidth == 0)
+				in->bandwidth = calc_bandwidth(in->freqs, in->num_channels);
 
-		memset(&ctx, 0, sizeof(vdl2_state_t));
-		ctx.num_channels = num_channels;
-		ctx.channels = XCALLOC(num_channels, sizeof(vdl2_channel_t *));
-		for(int i = 0; i < num_channels; i++) {
-			if((ctx.channels[i] = vdl2_channel_init(centerfreq, freqs[i], sample_rate, oversample)) == NULL) {
-				fprintf(stderr, "Failed to initialize VDL channel\n");
-				_exit(2);
+			vdl2_state_t *ctx = &in->ctx;
+			ctx->num_channels = in->num_channels;
+			ctx->channels = XCALLOC(in->num_channels, sizeof(vdl2_channel_t *));
+			for(int i = 0; i < in->num_channels; i++) {
+				if((ctx->channels[i] = vdl2_channel_init(ctx, in->centerfreq, in->freqs[i], in->sample_rate)) == NULL) {
+					fprintf(stderr, "Failed to initialize VDL channel\n");
+					_exit(2);
+				}
 			}
 		}
 
@@ -1095,19 +1548,19 @@ int main(int argc, char **argv) {
 			Config.gs_addrinfo_db_available = true;
 		}
 	}
+	if(input_is_iq) {
+		for(int n = 0; n < num_inputs; n++) {
+			for(int i = 0; i < inputs[n].num_channels; i++) {
+				metrics_channel_register(inputs[n].freqs[i]);
+			}
+		}
+	}
 #ifdef WITH_STATSD
 	if(statsd_enabled) {
-		if(statsd_initialize(statsd_addr) < 0) {
+		if(statsd_initialize(statsd_addr, statsd_interval) < 0) {
 			fprintf(stderr, "Failed to initialize statsd client - disabling\n");
 			XFREE(statsd_addr);
 			statsd_enabled = false;
-		} else {
-			if(input_is_iq) {
-				for(int i = 0; i < num_channels; i++) {
-					statsd_initialize_counters_per_channel(freqs[i]);
-				}
-			}
-			statsd_initialize_counters_per_msgdir();
 		}
 	} else {
 		XFREE(statsd_addr);
@@ -1116,7 +1569,15 @@ int main(int argc, char **argv) {
 #endif
 #ifdef WITH_SQLITE
 	if(bs_db_file != NULL) {
-		if(ac_data_init(bs_db_file) < 0) {
+		// Files are decoded as fast as possible, so that the first frame from
+		// an aircraft would otherwise always miss the DB query
+		bool offline = inputs[0].type == INPUT_IQ_FILE || inputs[0].type == INPUT_IQ_SYNTH;
+#ifdef WITH_PROTOBUF_C
+		offline = offline || inputs[0].type == INPUT_RAW_FRAMES_FILE;
+#endif
+		if(ac_data_init(bs_db_file, bs_db_preload, (size_t)bs_db_cache_size,
+					(size_t)bs_db_cache_memory * 1024 * 1024,
+					offline ? AC_LOOKUP_WAIT_OFFLINE_MS : 0) < 0) {
 			fprintf(stderr, "Failed to open aircraft database. "
 					"Extended data for aircraft will not be logged.\n");
 		} else {
@@ -1125,71 +1586,59 @@ int main(int argc, char **argv) {
 	}
 #endif
 
+	reasm_init((size_t)reasm_max_memory * 1024 * 1024);
+	dedup_init((uint32_t)dedup_window);
+
 	// Configure libacars
 	la_config_set_int("acars_bearer", LA_ACARS_BEARER_VHF);
 
 	setup_signals();
+#ifdef WITH_ALLOC_STATS
+	alloc_stats_init();
+#endif
+	if(bench) {
+		bench_init();
+	}
+	if(metrics_listen_addr != NULL && metrics_server_start(metrics_listen_addr) < 0) {
+		fprintf(stderr, "Failed to start metrics server - disabling\n");
+	}
 	start_all_output_threads(fmtr_list);
 	avlc_decoder_init();
 	start_thread(&decoder_thread, avlc_decoder_thread, fmtr_list);
 
 	if(input_is_iq) {
 		sincosf_lut_init();
-		input_lpf_init(sample_rate);
 		demod_sync_init();
-		setup_barriers(&ctx);
-		start_demod_threads(&ctx);
+		for(int n = 0; n < num_inputs; n++) {
+			input_lpf_init(&inputs[n].ctx, inputs[n].sample_rate);
+			input_resampler_init(&inputs[n].ctx, inputs[n].sample_rate);
+			setup_barriers(&inputs[n].ctx);
+			start_demod_threads(&inputs[n].ctx);
+		}
 	}
 
 #ifdef WITH_PROFILING
     ProfilerStart("dumpvdl2.prof");
 #endif
 	int exit_code = 0;
-	switch(input) {
+	switch(inputs[0].type) {
 #ifdef WITH_PROTOBUF_C
 		case INPUT_RAW_FRAMES_FILE:
 			Config.output_queue_hwm = OUTPUT_QUEUE_HWM_NONE;
-			exit_code = input_raw_frames_file_process(infile);
+			exit_code = input_raw_frames_file_process(inputs[0].device, fmtr_list, decoder_threads, &raw_frames_filter);
 			break;
 #endif
 		case INPUT_IQ_FILE:
+		case INPUT_IQ_SYNTH:
 			Config.output_queue_hwm = OUTPUT_QUEUE_HWM_NONE;
-			process_iq_file(&ctx, infile, sample_fmt);
-			pthread_barrier_wait(&demods_ready);
+			exit_code = input_run(&inputs[0]);
+			pthread_barrier_wait(&inputs[0].ctx.demods_ready);
 			break;
-#ifdef WITH_RTLSDR
-		case INPUT_RTLSDR:
-			rtl_init(&ctx, device, centerfreq, bandwidth, gain, correction, bias);
-			break;
-#endif
-#ifdef WITH_MIRISDR
-		case INPUT_MIRISDR:
-			mirisdr_init(&ctx, device, mirisdr_hw_flavour, centerfreq, gain, correction, mirisdr_usb_xfer_mode);
-			break;
-#endif
-#ifdef WITH_SDRPLAY
-		case INPUT_SDRPLAY:
-			sdrplay_init(&ctx, device, sdrplay_antenna, centerfreq, sdrplay_gr, correction,
-					sdrplay_biast, sdrplay_notch_filter, sdrplay_agc, sdrplay_tuner);
-			break;
-#endif
-#ifdef WITH_SDRPLAY3
-		case INPUT_SDRPLAY3:
-			sdrplay3_init(&ctx, device, sdrplay_antenna, centerfreq, sdrplay3_ifgr, sdrplay3_lna_state, correction,
-					sdrplay_biast, sdrplay_notch_filter, sdrplay3_dab_notch_filter, sdrplay_agc, sdrplay_tuner);
-			break;
-#endif
-#ifdef WITH_SOAPYSDR
-		case INPUT_SOAPYSDR:
-			soapysdr_init(&ctx, device, soapysdr_antenna, centerfreq, bandwidth, gain, correction,
-					soapysdr_settings, soapysdr_gain);
-			break;
-#endif
 		default:
-			fprintf(stderr, "Unknown input type\n");
-			exit_code = 5;
+			exit_code = inputs_run(inputs, num_inputs);
 			break;
 	}
+	bench_input_done();
 	avlc_decoder_shutdown();
 
 	fprintf(stderr, "Waiting for output threads to finish\n");
@@ -1212,6 +1661,12 @@ int main(int argc, char **argv) {
 			}
 		}
 	} while(active_threads_cnt != 0 && do_exit < 2);
+#ifdef WITH_STATSD
+	if(statsd_enabled) {
+		statsd_shutdown();
+	}
+#endif
+	bench_report(num_inputs == 1 ? inputs[0].sample_rate : 0);
 	fprintf(stderr, "Exiting\n");
 #ifdef WITH_PROFILING
     ProfilerStop();
@@ -25,11 +25,16 @@
 #include <stdint.h>
 #include <stdlib.h>             // abort()
 #include <sys/time.h>
+#include <time.h>               // struct timespec
 #include <pthread.h>            // pthread_t, pthread_barrier_t
 #include <libacars/libacars.h>  // la_proto_node
 #include <libacars/vstring.h>   // la_vstring
 #include <libacars/dict.h>      // la_dict
+#include <libacars/list.h>      // la_list
 #include "config.h"
+#ifdef WITH_PROTOBUF_C
+#include "raw_frames_index.h"   // raw_frames_filter_t
+#endif
 #ifndef HAVE_PTHREAD_BARRIERS
 #include "pthread_barrier.h"
 #endif
@@ -47,10 +52,15 @@
 #define CSC_FREQ 136975000U
 #define FILE_BUFSIZE 320000U
 #define FILE_OVERSAMPLE 10
+#define IQ_NET_OVERSAMPLE 10
+#define IQ_NET_IDLE_TIMEOUT_DEFAULT 10  // seconds
+#define IQ_SYNTH_OVERSAMPLE 10
 #define SDR_AUTO_GAIN -100.0f
+#define INPUTS_MAX 8                    // max number of inputs in a single process
 
 // long command line options
-#define __OPT_CENTERFREQ              1
+// (1 is reserved - getopt_long returns it for non-option arguments)
+#define __OPT_CENTERFREQ             42
 #define __OPT_STATION_ID              2
 #ifdef WITH_PROTOBUF_C
 #define __OPT_RAW_FRAMES_FILE         3
@@ -71,13 +81,9 @@
 #define __OPT_BIAS                   50
 #endif
 
-#if defined WITH_MIRISDR || defined WITH_RTLSDR || defined WITH_SOAPYSDR
+// Always available - rtl_tcp network input uses them too
 #define __OPT_GAIN                   12
-#endif
-
-#if defined WITH_MIRISDR || defined WITH_RTLSDR || defined WITH_SDRPLAY || defined WITH_SDRPLAY3 || defined WITH_SOAPYSDR
 #define __OPT_CORRECTION             13
-#endif
 
 #ifdef WITH_STATSD
 #define __OPT_STATSD                 14
@@ -97,6 +103,32 @@
 #define __OPT_PRETTIFY_XML           25
 #define __OPT_MILLISECONDS           26
 #define __OPT_PRETTIFY_JSON          27
+#ifdef WITH_PROTOBUF_C
+#define __OPT_DECODER_THREADS        28
+#define __OPT_FROM                   29
+#define __OPT_TO                     30
+#define __OPT_FREQ                   31
+#define __OPT_ADDR                   32
+#endif
+#ifdef WITH_SQLITE
+#define __OPT_BS_DB_PRELOAD          33
+#define __OPT_BS_DB_CACHE_SIZE       34
+#define __OPT_BS_DB_CACHE_MEMORY     35
+#endif
+#define __OPT_GS_FILE_COMPILE        36
+#define __OPT_REASM_MAX_MEMORY       37
+#define __OPT_METRICS_LISTEN         38
+#ifdef WITH_STATSD
+#define __OPT_STATSD_INTERVAL        39
+#endif
+#define __OPT_LATENCY_TRACE          40
+#define __OPT_SAMPLE_RATE            41
+#define __OPT_DEDUP_WINDOW           43
+#define __OPT_IQ_NET                 44
+#define __OPT_BENCH                  45
+#define __OPT_REPEAT                 46
+#define __OPT_IQ_SYNTH               47
+#define __OPT_IQ_NET_IDLE_TIMEOUT    49
 
 #ifdef WITH_SDRPLAY3
 #define __OPT_SDRPLAY3               70
@@ -168,6 +200,8 @@
 
 // default output specification - decoded text output to stdout
 #define DEFAULT_OUTPUT "decoded:text:file:path=-"
+// default output specification in benchmark mode
+#define BENCH_DEFAULT_OUTPUT "decoded:text:file:path=/dev/null"
 
 // output queue high water mark
 #define OUTPUT_QUEUE_HWM_DEFAULT 1000
@@ -210,6 +244,8 @@ typedef struct {
 	char *station_id;
 	bool hourly, daily, utc, milliseconds;
 	bool output_raw_frames, dump_asn1, extended_header, decode_fragments;
+	bool latency_trace;
+	bool bench;
 	bool ac_addrinfo_db_available;
 	bool gs_addrinfo_db_available;
 	addrinfo_verbosity_t addrinfo_verbosity;
@@ -309,12 +345,18 @@ enum input_types {
 	INPUT_SOAPYSDR,
 #endif
 	INPUT_IQ_FILE,
+	INPUT_IQ_NET,
+	INPUT_IQ_SYNTH,
 #ifdef WITH_PROTOBUF_C
 	INPUT_RAW_FRAMES_FILE,
 #endif
 	INPUT_UNDEF
 };
-enum sample_formats { SFMT_U8, SFMT_S16_LE, SFMT_UNDEF };
+enum sample_formats { SFMT_U8, SFMT_S8, SFMT_S16_LE, SFMT_F32_LE, SFMT_UNDEF };
+// Converts len octets of samples into floats, returns the number of floats stored in out
+typedef uint32_t (convert_buf_func)(unsigned char const *buf, uint32_t len, float *out);
+
+struct vdl2_state;
 
 typedef struct {
 	long long unsigned samplenum;
@@ -343,21 +385,46 @@ typedef struct {
 	uint32_t num_blocks;
 	uint32_t syndrome;
 	uint16_t lfsr;
-	uint16_t oversample;
+	uint32_t resample_num, resample_den;    // demod rate / input rate, reduced
 	struct timeval tstart;
 	struct timeval burst_timestamp;
+	struct timespec burst_sync_time;    // CLOCK_MONOTONIC, for latency tracing
 	pthread_t demod_thread;
+	struct vdl2_state *source;          // input this channel is received from
 } vdl2_channel_t;
 
-typedef struct {
+// State of a single input (SDR device or I/Q file) and its channels.
+// Each input has its own sample buffer and barrier pair, so that
+// several inputs may run concurrently, feeding a common decoder.
+typedef struct vdl2_state {
 	int num_channels;
 	vdl2_channel_t **channels;
+	float *sbuf;                        // samples being demodulated
+	uint32_t sbuf_len;
+	bool discontinuity;                 // samples have been lost right before sbuf
+	bool discontinuity_pending;         // same for the next buffer (set by the input)
+	float *lpf_a, *lpf_b;               // input lowpass filter coefficients
+	float *resampler_coeffs;            // polyphase resampler filter bank (NULL for integer ratios)
+	uint32_t resampler_len;             // taps per filter bank branch
+	uint32_t resampler_phases;          // number of filter bank branches - 1
+	pthread_barrier_t demods_ready, samples_ready;
 } vdl2_state_t;
 
+// A block of converted I/Q samples being filled by an SDR driver
+// before it's handed over to demodulators
+typedef struct {
+	vdl2_state_t *ctx;
+	float *buf;
+	uint32_t len;                       // block length (floats)
+	uint32_t pos;                       // number of floats stored so far
+} sample_block_t;
+
 // bitstream.c
 bitstream_t *bitstream_init(uint32_t len);
 int bitstream_append_msbfirst(bitstream_t *bs, uint8_t const *bytes, uint32_t numbytes, uint32_t numbits);
 int bitstream_append_lsbfirst(bitstream_t *bs, uint8_t const *bytes, uint32_t numbytes, uint32_t numbits);
+int bitstream_append_word_msbfirst(bitstream_t *bs, uint32_t word, uint32_t numbits);
+int bitstream_append_frame(bitstream_t *bs, uint8_t const *bytes, uint32_t numbytes);
 int bitstream_read_lsbfirst(bitstream_t *bs, uint8_t *bytes, uint32_t numbytes, uint32_t numbits);
 int bitstream_read_word_msbfirst(bitstream_t *bs, uint32_t *ret, uint32_t numbits);
 int bitstream_copy_next_frame(bitstream_t *src, bitstream_t *dst);
@@ -367,15 +434,28 @@ void bitstream_destroy(bitstream_t *bs);
 uint32_t reverse(uint32_t v, int numbits);
 
 // demod.c
-extern float *sbuf;
-vdl2_channel_t *vdl2_channel_init(uint32_t centerfreq, uint32_t freq, uint32_t source_rate, uint32_t oversample);
+vdl2_channel_t *vdl2_channel_init(vdl2_state_t *ctx, uint32_t centerfreq, uint32_t freq, uint32_t source_rate);
 void sincosf_lut_init();
-void input_lpf_init(uint32_t sample_rate);
+void input_lpf_init(vdl2_state_t *ctx, uint32_t sample_rate);
+void input_resampler_init(vdl2_state_t *ctx, uint32_t sample_rate);
 void demod_sync_init();
-void process_buf_uchar_init();
 void process_buf_uchar(unsigned char *buf, uint32_t len, void *ctx);
-void process_buf_short_init();
 void process_buf_short(unsigned char *buf, uint32_t len, void *ctx);
+convert_buf_func convert_buf_uchar;
+convert_buf_func convert_buf_schar;
+convert_buf_func convert_buf_short;
+convert_buf_func convert_buf_float;
+enum sample_formats sample_format_from_string(char const *name);
+char const *sample_format_name(enum sample_formats sfmt);
+uint32_t sample_format_size(enum sample_formats sfmt);
+convert_buf_func *sample_format_converter(enum sample_formats sfmt);
+float *demod_swap_sample_buffer(vdl2_state_t *ctx, float *buf, uint32_t len);
+void demod_mark_discontinuity(vdl2_state_t *ctx);
+void sample_block_init(sample_block_t *blk, vdl2_state_t *ctx, uint32_t len);
+void sample_block_feed_cs8(sample_block_t *blk, int8_t const *samples, uint32_t cnt);
+void sample_block_feed_cs16(sample_block_t *blk, int16_t const *samples, uint32_t cnt);
+void sample_block_feed_cf32(sample_block_t *blk, float const *samples, uint32_t cnt);
+void sample_block_feed_cs16_split(sample_block_t *blk, int16_t const *xi, int16_t const *xq, uint32_t cnt);
 void *process_samples(void *arg);
 
 // crc.c
@@ -384,36 +464,31 @@ uint16_t crc16_ccitt(uint8_t *data, uint32_t len, uint16_t crc_init);
 // rs.c
 int rs_init();
 int rs_verify(uint8_t *data, int fec_octets);
+void rs_encode(uint8_t *data, uint8_t *parity);
+
+// input-iq_file.c
+void input_iq_file_process(vdl2_state_t *ctx, char const *path, enum sample_formats sfmt, uint32_t sample_rate,
+		uint32_t repeat);
+
+// input-iq_net.c
+void input_iq_net_process(vdl2_state_t *ctx, char const *url, enum sample_formats sfmt,
+		uint32_t centerfreq, uint32_t sample_rate, float gain, int correction, int idle_timeout);
+
+// input-iq_synth.c
+void input_iq_synth_process(vdl2_state_t *ctx, char const *spec, uint32_t centerfreq, uint32_t sample_rate,
+		uint32_t const *freqs, int num_channels);
 
 // input-raw_frame_file.c
 #ifdef WITH_PROTOBUF_C
-int input_raw_frames_file_process(char const *file);
+int input_raw_frames_file_process(char const *file, la_list *fmtr_list, int num_threads,
+		raw_frames_filter_t const *filter);
 #endif
 
 // statsd.c
 #ifdef WITH_STATSD
-int statsd_initialize(char *statsd_addr);
-void statsd_initialize_counters_per_channel(uint32_t freq);
-void statsd_initialize_counters_per_msgdir();
-void statsd_initialize_counter_set(char **counter_set);
-// Can't have char const * pointers here, because statsd-c-client
-// may potentially modify their contents :/
-void statsd_counter_per_channel_increment(uint32_t freq, char *counter);
-void statsd_timing_delta_per_channel_send(uint32_t freq, char *timer, struct timeval ts);
-void statsd_counter_per_msgdir_increment(la_msg_dir msg_dir, char *counter);
-void statsd_counter_increment(char *counter);
-void statsd_gauge_set(char *gauge, size_t value);
-#define statsd_increment_per_channel(freq, counter) statsd_counter_per_channel_increment(freq, counter)
-#define statsd_timing_delta_per_channel(freq, timer, start) statsd_timing_delta_per_channel_send(freq, timer, start)
-#define statsd_increment_per_msgdir(counter, msgdir) statsd_counter_per_msgdir_increment(counter, msgdir)
-#define statsd_increment(counter) statsd_counter_increment(counter)
-#define statsd_set(gauge, value) statsd_gauge_set(gauge, value)
-#else
-#define statsd_increment_per_channel(freq, counter) nop()
-#define statsd_timing_delta_per_channel(freq, timer, start) nop()
-#define statsd_increment_per_msgdir(counter, msgdir) nop()
-#define statsd_increment(counter) nop()
-#define statsd_set(gauge, value) nop()
+#define STATSD_INTERVAL_DEFAULT 1
+int statsd_initialize(char *statsd_addr, int interval);
+void statsd_shutdown();
 #endif
 
 // util.c
@@ -443,12 +518,13 @@ void octet_string_destroy(octet_string_t *ostring);
 char *hexdump(uint8_t *data, size_t len);
 void append_hexdump_with_indent(la_vstring *vstr, uint8_t *data, size_t len, int indent);
 la_proto_node *unknown_proto_pdu_new(void *buf, size_t len);
-
-// dumpvdl2.c
 extern int do_exit;
 extern dumpvdl2_config_t Config;
-extern pthread_barrier_t demods_ready, samples_ready;
 void describe_option(char const *name, char const *description, int indent);
+void start_thread(pthread_t *pth, void *(*start_routine)(void *), void *thread_ctx);
+
+// dumpvdl2.c
+void inputs_cancel();
 
 // version.c
 extern char const * const DUMPVDL2_VERSION;
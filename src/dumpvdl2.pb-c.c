@@ -103,6 +103,276 @@ void   dumpvdl2__raw_avlc_frame__free_unpacked
   assert(message->base.descriptor == &dumpvdl2__raw_avlc_frame__descriptor);
   protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
 }
+void   dumpvdl2__avlc_address__init
+                     (Dumpvdl2__AvlcAddress         *message)
+{
+  static const Dumpvdl2__AvlcAddress init_value = DUMPVDL2__AVLC_ADDRESS__INIT;
+  *message = init_value;
+}
+size_t dumpvdl2__avlc_address__get_packed_size
+                     (const Dumpvdl2__AvlcAddress *message)
+{
+  assert(message->base.descriptor == &dumpvdl2__avlc_address__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t dumpvdl2__avlc_address__pack
+                     (const Dumpvdl2__AvlcAddress *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &dumpvdl2__avlc_address__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t dumpvdl2__avlc_address__pack_to_buffer
+                     (const Dumpvdl2__AvlcAddress *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &dumpvdl2__avlc_address__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+Dumpvdl2__AvlcAddress *
+       dumpvdl2__avlc_address__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (Dumpvdl2__AvlcAddress *)
+     protobuf_c_message_unpack (&dumpvdl2__avlc_address__descriptor,
+                                allocator, len, data);
+}
+void   dumpvdl2__avlc_address__free_unpacked
+                     (Dumpvdl2__AvlcAddress *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &dumpvdl2__avlc_address__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
+void   dumpvdl2__acars_message__init
+                     (Dumpvdl2__AcarsMessage         *message)
+{
+  static const Dumpvdl2__AcarsMessage init_value = DUMPVDL2__ACARS_MESSAGE__INIT;
+  *message = init_value;
+}
+size_t dumpvdl2__acars_message__get_packed_size
+                     (const Dumpvdl2__AcarsMessage *message)
+{
+  assert(message->base.descriptor == &dumpvdl2__acars_message__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t dumpvdl2__acars_message__pack
+                     (const Dumpvdl2__AcarsMessage *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &dumpvdl2__acars_message__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t dumpvdl2__acars_message__pack_to_buffer
+                     (const Dumpvdl2__AcarsMessage *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &dumpvdl2__acars_message__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+Dumpvdl2__AcarsMessage *
+       dumpvdl2__acars_message__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (Dumpvdl2__AcarsMessage *)
+     protobuf_c_message_unpack (&dumpvdl2__acars_message__descriptor,
+                                allocator, len, data);
+}
+void   dumpvdl2__acars_message__free_unpacked
+                     (Dumpvdl2__AcarsMessage *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &dumpvdl2__acars_message__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
+void   dumpvdl2__x25_packet__init
+                     (Dumpvdl2__X25Packet         *message)
+{
+  static const Dumpvdl2__X25Packet init_value = DUMPVDL2__X25_PACKET__INIT;
+  *message = init_value;
+}
+size_t dumpvdl2__x25_packet__get_packed_size
+                     (const Dumpvdl2__X25Packet *message)
+{
+  assert(message->base.descriptor == &dumpvdl2__x25_packet__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t dumpvdl2__x25_packet__pack
+                     (const Dumpvdl2__X25Packet *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &dumpvdl2__x25_packet__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t dumpvdl2__x25_packet__pack_to_buffer
+                     (const Dumpvdl2__X25Packet *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &dumpvdl2__x25_packet__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+Dumpvdl2__X25Packet *
+       dumpvdl2__x25_packet__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (Dumpvdl2__X25Packet *)
+     protobuf_c_message_unpack (&dumpvdl2__x25_packet__descriptor,
+                                allocator, len, data);
+}
+void   dumpvdl2__x25_packet__free_unpacked
+                     (Dumpvdl2__X25Packet *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &dumpvdl2__x25_packet__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
+void   dumpvdl2__clnp_pdu__init
+                     (Dumpvdl2__ClnpPdu         *message)
+{
+  static const Dumpvdl2__ClnpPdu init_value = DUMPVDL2__CLNP_PDU__INIT;
+  *message = init_value;
+}
+size_t dumpvdl2__clnp_pdu__get_packed_size
+                     (const Dumpvdl2__ClnpPdu *message)
+{
+  assert(message->base.descriptor == &dumpvdl2__clnp_pdu__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t dumpvdl2__clnp_pdu__pack
+                     (const Dumpvdl2__ClnpPdu *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &dumpvdl2__clnp_pdu__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t dumpvdl2__clnp_pdu__pack_to_buffer
+                     (const Dumpvdl2__ClnpPdu *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &dumpvdl2__clnp_pdu__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+Dumpvdl2__ClnpPdu *
+       dumpvdl2__clnp_pdu__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (Dumpvdl2__ClnpPdu *)
+     protobuf_c_message_unpack (&dumpvdl2__clnp_pdu__descriptor,
+                                allocator, len, data);
+}
+void   dumpvdl2__clnp_pdu__free_unpacked
+                     (Dumpvdl2__ClnpPdu *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &dumpvdl2__clnp_pdu__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
+void   dumpvdl2__application_pdu__init
+                     (Dumpvdl2__ApplicationPdu         *message)
+{
+  static const Dumpvdl2__ApplicationPdu init_value = DUMPVDL2__APPLICATION_PDU__INIT;
+  *message = init_value;
+}
+size_t dumpvdl2__application_pdu__get_packed_size
+                     (const Dumpvdl2__ApplicationPdu *message)
+{
+  assert(message->base.descriptor == &dumpvdl2__application_pdu__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t dumpvdl2__application_pdu__pack
+                     (const Dumpvdl2__ApplicationPdu *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &dumpvdl2__application_pdu__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t dumpvdl2__application_pdu__pack_to_buffer
+                     (const Dumpvdl2__ApplicationPdu *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &dumpvdl2__application_pdu__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+Dumpvdl2__ApplicationPdu *
+       dumpvdl2__application_pdu__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (Dumpvdl2__ApplicationPdu *)
+     protobuf_c_message_unpack (&dumpvdl2__application_pdu__descriptor,
+                                allocator, len, data);
+}
+void   dumpvdl2__application_pdu__free_unpacked
+                     (Dumpvdl2__ApplicationPdu *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &dumpvdl2__application_pdu__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
+void   dumpvdl2__decoded_avlc_frame__init
+                     (Dumpvdl2__DecodedAvlcFrame         *message)
+{
+  static const Dumpvdl2__DecodedAvlcFrame init_value = DUMPVDL2__DECODED_AVLC_FRAME__INIT;
+  *message = init_value;
+}
+size_t dumpvdl2__decoded_avlc_frame__get_packed_size
+                     (const Dumpvdl2__DecodedAvlcFrame *message)
+{
+  assert(message->base.descriptor == &dumpvdl2__decoded_avlc_frame__descriptor);
+  return protobuf_c_message_get_packed_size ((const ProtobufCMessage*)(message));
+}
+size_t dumpvdl2__decoded_avlc_frame__pack
+                     (const Dumpvdl2__DecodedAvlcFrame *message,
+                      uint8_t       *out)
+{
+  assert(message->base.descriptor == &dumpvdl2__decoded_avlc_frame__descriptor);
+  return protobuf_c_message_pack ((const ProtobufCMessage*)message, out);
+}
+size_t dumpvdl2__decoded_avlc_frame__pack_to_buffer
+                     (const Dumpvdl2__DecodedAvlcFrame *message,
+                      ProtobufCBuffer *buffer)
+{
+  assert(message->base.descriptor == &dumpvdl2__decoded_avlc_frame__descriptor);
+  return protobuf_c_message_pack_to_buffer ((const ProtobufCMessage*)message, buffer);
+}
+Dumpvdl2__DecodedAvlcFrame *
+       dumpvdl2__decoded_avlc_frame__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data)
+{
+  return (Dumpvdl2__DecodedAvlcFrame *)
+     protobuf_c_message_unpack (&dumpvdl2__decoded_avlc_frame__descriptor,
+                                allocator, len, data);
+}
+void   dumpvdl2__decoded_avlc_frame__free_unpacked
+                     (Dumpvdl2__DecodedAvlcFrame *message,
+                      ProtobufCAllocator *allocator)
+{
+  if(!message)
+    return;
+  assert(message->base.descriptor == &dumpvdl2__decoded_avlc_frame__descriptor);
+  protobuf_c_message_free_unpacked ((ProtobufCMessage*)message, allocator);
+}
 static const ProtobufCFieldDescriptor dumpvdl2__vdl2_msg_metadata__timestamp__field_descriptors[2] =
 {
   {
@@ -373,3 +643,921 @@ const ProtobufCMessageDescriptor dumpvdl2__raw_avlc_frame__descriptor =
   (ProtobufCMessageInit) dumpvdl2__raw_avlc_frame__init,
   NULL,NULL,NULL    /* reserved[123] */
 };
+static const ProtobufCFieldDescriptor dumpvdl2__avlc_address__field_descriptors[2] =
+{
+  {
+    "addr",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__AvlcAddress, addr),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "type",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__AvlcAddress, type),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned dumpvdl2__avlc_address__field_indices_by_name[] = {
+  0,   /* field[0] = addr */
+  1,   /* field[1] = type */
+};
+static const ProtobufCIntRange dumpvdl2__avlc_address__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 2 }
+};
+const ProtobufCMessageDescriptor dumpvdl2__avlc_address__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "dumpvdl2.avlc_address",
+  "AvlcAddress",
+  "Dumpvdl2__AvlcAddress",
+  "dumpvdl2",
+  sizeof(Dumpvdl2__AvlcAddress),
+  2,
+  dumpvdl2__avlc_address__field_descriptors,
+  dumpvdl2__avlc_address__field_indices_by_name,
+  1,  dumpvdl2__avlc_address__number_ranges,
+  (ProtobufCMessageInit) dumpvdl2__avlc_address__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor dumpvdl2__acars_message__field_descriptors[13] =
+{
+  {
+    "err",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__AcarsMessage, err),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "crc_ok",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__AcarsMessage, crc_ok),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "mode",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__AcarsMessage, mode),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "reg",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__AcarsMessage, reg),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "ack",
+    5,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__AcarsMessage, ack),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "label",
+    6,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__AcarsMessage, label),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "sublabel",
+    7,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__AcarsMessage, sublabel),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "mfi",
+    8,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__AcarsMessage, mfi),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "block_id",
+    9,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__AcarsMessage, block_id),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "msg_num",
+    10,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__AcarsMessage, msg_num),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "flight_id",
+    11,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__AcarsMessage, flight_id),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "text",
+    12,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__AcarsMessage, text),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "reasm_status",
+    13,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__AcarsMessage, reasm_status),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned dumpvdl2__acars_message__field_indices_by_name[] = {
+  4,   /* field[4] = ack */
+  8,   /* field[8] = block_id */
+  1,   /* field[1] = crc_ok */
+  0,   /* field[0] = err */
+  10,   /* field[10] = flight_id */
+  5,   /* field[5] = label */
+  7,   /* field[7] = mfi */
+  2,   /* field[2] = mode */
+  9,   /* field[9] = msg_num */
+  12,   /* field[12] = reasm_status */
+  3,   /* field[3] = reg */
+  6,   /* field[6] = sublabel */
+  11,   /* field[11] = text */
+};
+static const ProtobufCIntRange dumpvdl2__acars_message__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 13 }
+};
+const ProtobufCMessageDescriptor dumpvdl2__acars_message__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "dumpvdl2.acars_message",
+  "AcarsMessage",
+  "Dumpvdl2__AcarsMessage",
+  "dumpvdl2",
+  sizeof(Dumpvdl2__AcarsMessage),
+  13,
+  dumpvdl2__acars_message__field_descriptors,
+  dumpvdl2__acars_message__field_indices_by_name,
+  1,  dumpvdl2__acars_message__number_ranges,
+  (ProtobufCMessageInit) dumpvdl2__acars_message__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor dumpvdl2__x25_packet__field_descriptors[14] =
+{
+  {
+    "err",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__X25Packet, err),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "pkt_type",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__X25Packet, pkt_type),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "chan_group",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__X25Packet, chan_group),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "chan_num",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__X25Packet, chan_num),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "sseq",
+    5,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__X25Packet, sseq),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "rseq",
+    6,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__X25Packet, rseq),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "more",
+    7,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__X25Packet, more),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "calling_addr",
+    8,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__X25Packet, calling_addr),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "called_addr",
+    9,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__X25Packet, called_addr),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "compression",
+    10,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__X25Packet, compression),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "clear_cause",
+    11,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__X25Packet, clear_cause),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "diag_code_present",
+    12,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__X25Packet, diag_code_present),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "diag_code",
+    13,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__X25Packet, diag_code),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "reasm_status",
+    14,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__X25Packet, reasm_status),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned dumpvdl2__x25_packet__field_indices_by_name[] = {
+  8,   /* field[8] = called_addr */
+  7,   /* field[7] = calling_addr */
+  2,   /* field[2] = chan_group */
+  3,   /* field[3] = chan_num */
+  10,   /* field[10] = clear_cause */
+  9,   /* field[9] = compression */
+  12,   /* field[12] = diag_code */
+  11,   /* field[11] = diag_code_present */
+  0,   /* field[0] = err */
+  6,   /* field[6] = more */
+  1,   /* field[1] = pkt_type */
+  13,   /* field[13] = reasm_status */
+  5,   /* field[5] = rseq */
+  4,   /* field[4] = sseq */
+};
+static const ProtobufCIntRange dumpvdl2__x25_packet__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 14 }
+};
+const ProtobufCMessageDescriptor dumpvdl2__x25_packet__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "dumpvdl2.x25_packet",
+  "X25Packet",
+  "Dumpvdl2__X25Packet",
+  "dumpvdl2",
+  sizeof(Dumpvdl2__X25Packet),
+  14,
+  dumpvdl2__x25_packet__field_descriptors,
+  dumpvdl2__x25_packet__field_indices_by_name,
+  1,  dumpvdl2__x25_packet__number_ranges,
+  (ProtobufCMessageInit) dumpvdl2__x25_packet__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor dumpvdl2__clnp_pdu__field_descriptors[13] =
+{
+  {
+    "err",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ClnpPdu, err),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "compressed",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ClnpPdu, compressed),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "pdu_type",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ClnpPdu, pdu_type),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "src_nsap",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BYTES,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ClnpPdu, src_nsap),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "dst_nsap",
+    5,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BYTES,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ClnpPdu, dst_nsap),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "lifetime_ms",
+    6,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ClnpPdu, lifetime_ms),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "flags",
+    7,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ClnpPdu, flags),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "local_ref",
+    8,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ClnpPdu, local_ref),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "pdu_id",
+    9,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ClnpPdu, pdu_id),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "segment_offset",
+    10,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ClnpPdu, segment_offset),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "pdu_total_len",
+    11,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ClnpPdu, pdu_total_len),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "more_segments",
+    12,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ClnpPdu, more_segments),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "reasm_status",
+    13,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ClnpPdu, reasm_status),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned dumpvdl2__clnp_pdu__field_indices_by_name[] = {
+  1,   /* field[1] = compressed */
+  4,   /* field[4] = dst_nsap */
+  0,   /* field[0] = err */
+  6,   /* field[6] = flags */
+  5,   /* field[5] = lifetime_ms */
+  7,   /* field[7] = local_ref */
+  11,   /* field[11] = more_segments */
+  8,   /* field[8] = pdu_id */
+  10,   /* field[10] = pdu_total_len */
+  2,   /* field[2] = pdu_type */
+  12,   /* field[12] = reasm_status */
+  9,   /* field[9] = segment_offset */
+  3,   /* field[3] = src_nsap */
+};
+static const ProtobufCIntRange dumpvdl2__clnp_pdu__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 13 }
+};
+const ProtobufCMessageDescriptor dumpvdl2__clnp_pdu__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "dumpvdl2.clnp_pdu",
+  "ClnpPdu",
+  "Dumpvdl2__ClnpPdu",
+  "dumpvdl2",
+  sizeof(Dumpvdl2__ClnpPdu),
+  13,
+  dumpvdl2__clnp_pdu__field_descriptors,
+  dumpvdl2__clnp_pdu__field_indices_by_name,
+  1,  dumpvdl2__clnp_pdu__number_ranges,
+  (ProtobufCMessageInit) dumpvdl2__clnp_pdu__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor dumpvdl2__application_pdu__field_descriptors[3] =
+{
+  {
+    "protocol",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ApplicationPdu, protocol),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "asn1_type",
+    2,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ApplicationPdu, asn1_type),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "json",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__ApplicationPdu, json),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned dumpvdl2__application_pdu__field_indices_by_name[] = {
+  1,   /* field[1] = asn1_type */
+  2,   /* field[2] = json */
+  0,   /* field[0] = protocol */
+};
+static const ProtobufCIntRange dumpvdl2__application_pdu__number_ranges[1 + 1] =
+{
+  { 1, 0 },
+  { 0, 3 }
+};
+const ProtobufCMessageDescriptor dumpvdl2__application_pdu__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "dumpvdl2.application_pdu",
+  "ApplicationPdu",
+  "Dumpvdl2__ApplicationPdu",
+  "dumpvdl2",
+  sizeof(Dumpvdl2__ApplicationPdu),
+  3,
+  dumpvdl2__application_pdu__field_descriptors,
+  dumpvdl2__application_pdu__field_indices_by_name,
+  1,  dumpvdl2__application_pdu__number_ranges,
+  (ProtobufCMessageInit) dumpvdl2__application_pdu__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
+static const ProtobufCFieldDescriptor dumpvdl2__decoded_avlc_frame__field_descriptors[14] =
+{
+  {
+    "metadata",
+    1,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__DecodedAvlcFrame, metadata),
+    &dumpvdl2__vdl2_msg_metadata__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "src",
+    3,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__DecodedAvlcFrame, src),
+    &dumpvdl2__avlc_address__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "dst",
+    4,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__DecodedAvlcFrame, dst),
+    &dumpvdl2__avlc_address__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "on_ground",
+    5,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__DecodedAvlcFrame, on_ground),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "response",
+    6,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__DecodedAvlcFrame, response),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "frame_type",
+    7,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__DecodedAvlcFrame, frame_type),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "cmd",
+    8,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__DecodedAvlcFrame, cmd),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "sseq",
+    9,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__DecodedAvlcFrame, sseq),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "rseq",
+    10,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__DecodedAvlcFrame, rseq),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "poll_final",
+    11,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_BOOL,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__DecodedAvlcFrame, poll_final),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "acars",
+    12,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__DecodedAvlcFrame, acars),
+    &dumpvdl2__acars_message__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "x25",
+    13,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__DecodedAvlcFrame, x25),
+    &dumpvdl2__x25_packet__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "clnp",
+    14,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_MESSAGE,
+    0,   /* quantifier_offset */
+    offsetof(Dumpvdl2__DecodedAvlcFrame, clnp),
+    &dumpvdl2__clnp_pdu__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "applications",
+    15,
+    PROTOBUF_C_LABEL_REPEATED,
+    PROTOBUF_C_TYPE_MESSAGE,
+    offsetof(Dumpvdl2__DecodedAvlcFrame, n_applications),   /* quantifier_offset */
+    offsetof(Dumpvdl2__DecodedAvlcFrame, applications),
+    &dumpvdl2__application_pdu__descriptor,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+};
+static const unsigned dumpvdl2__decoded_avlc_frame__field_indices_by_name[] = {
+  10,   /* field[10] = acars */
+  13,   /* field[13] = applications */
+  12,   /* field[12] = clnp */
+  6,   /* field[6] = cmd */
+  2,   /* field[2] = dst */
+  5,   /* field[5] = frame_type */
+  0,   /* field[0] = metadata */
+  3,   /* field[3] = on_ground */
+  9,   /* field[9] = poll_final */
+  4,   /* field[4] = response */
+  8,   /* field[8] = rseq */
+  1,   /* field[1] = src */
+  7,   /* field[7] = sseq */
+  11,   /* field[11] = x25 */
+};
+static const ProtobufCIntRange dumpvdl2__decoded_avlc_frame__number_ranges[2 + 1] =
+{
+  { 1, 0 },
+  { 3, 1 },
+  { 0, 14 }
+};
+const ProtobufCMessageDescriptor dumpvdl2__decoded_avlc_frame__descriptor =
+{
+  PROTOBUF_C__MESSAGE_DESCRIPTOR_MAGIC,
+  "dumpvdl2.decoded_avlc_frame",
+  "DecodedAvlcFrame",
+  "Dumpvdl2__DecodedAvlcFrame",
+  "dumpvdl2",
+  sizeof(Dumpvdl2__DecodedAvlcFrame),
+  14,
+  dumpvdl2__decoded_avlc_frame__field_descriptors,
+  dumpvdl2__decoded_avlc_frame__field_indices_by_name,
+  2,  dumpvdl2__decoded_avlc_frame__number_ranges,
+  (ProtobufCMessageInit) dumpvdl2__decoded_avlc_frame__init,
+  NULL,NULL,NULL    /* reserved[123] */
+};
@@ -18,6 +18,12 @@ PROTOBUF_C__BEGIN_DECLS
 typedef struct _Dumpvdl2__Vdl2MsgMetadata Dumpvdl2__Vdl2MsgMetadata;
 typedef struct _Dumpvdl2__Vdl2MsgMetadata__Timestamp Dumpvdl2__Vdl2MsgMetadata__Timestamp;
 typedef struct _Dumpvdl2__RawAvlcFrame Dumpvdl2__RawAvlcFrame;
+typedef struct _Dumpvdl2__AvlcAddress Dumpvdl2__AvlcAddress;
+typedef struct _Dumpvdl2__AcarsMessage Dumpvdl2__AcarsMessage;
+typedef struct _Dumpvdl2__X25Packet Dumpvdl2__X25Packet;
+typedef struct _Dumpvdl2__ClnpPdu Dumpvdl2__ClnpPdu;
+typedef struct _Dumpvdl2__ApplicationPdu Dumpvdl2__ApplicationPdu;
+typedef struct _Dumpvdl2__DecodedAvlcFrame Dumpvdl2__DecodedAvlcFrame;
 
 
 /* --- enums --- */
@@ -67,6 +73,120 @@ struct  _Dumpvdl2__RawAvlcFrame
     , NULL, {0,NULL} }
 
 
+struct  _Dumpvdl2__AvlcAddress
+{
+  ProtobufCMessage base;
+  uint32_t addr;
+  uint32_t type;
+};
+#define DUMPVDL2__AVLC_ADDRESS__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&dumpvdl2__avlc_address__descriptor) \
+    , 0, 0 }
+
+
+struct  _Dumpvdl2__AcarsMessage
+{
+  ProtobufCMessage base;
+  protobuf_c_boolean err;
+  protobuf_c_boolean crc_ok;
+  char *mode;
+  char *reg;
+  char *ack;
+  char *label;
+  char *sublabel;
+  char *mfi;
+  char *block_id;
+  char *msg_num;
+  char *flight_id;
+  char *text;
+  char *reasm_status;
+};
+#define DUMPVDL2__ACARS_MESSAGE__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&dumpvdl2__acars_message__descriptor) \
+    , 0, 0, (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string }
+
+
+struct  _Dumpvdl2__X25Packet
+{
+  ProtobufCMessage base;
+  protobuf_c_boolean err;
+  uint32_t pkt_type;
+  uint32_t chan_group;
+  uint32_t chan_num;
+  uint32_t sseq;
+  uint32_t rseq;
+  protobuf_c_boolean more;
+  char *calling_addr;
+  char *called_addr;
+  uint32_t compression;
+  uint32_t clear_cause;
+  protobuf_c_boolean diag_code_present;
+  uint32_t diag_code;
+  char *reasm_status;
+};
+#define DUMPVDL2__X25_PACKET__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&dumpvdl2__x25_packet__descriptor) \
+    , 0, 0, 0, 0, 0, 0, 0, (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string, 0, 0, 0, 0, (char *)protobuf_c_empty_string }
+
+
+struct  _Dumpvdl2__ClnpPdu
+{
+  ProtobufCMessage base;
+  protobuf_c_boolean err;
+  protobuf_c_boolean compressed;
+  uint32_t pdu_type;
+  ProtobufCBinaryData src_nsap;
+  ProtobufCBinaryData dst_nsap;
+  uint32_t lifetime_ms;
+  uint32_t flags;
+  uint32_t local_ref;
+  uint32_t pdu_id;
+  uint32_t segment_offset;
+  uint32_t pdu_total_len;
+  protobuf_c_boolean more_segments;
+  char *reasm_status;
+};
+#define DUMPVDL2__CLNP_PDU__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&dumpvdl2__clnp_pdu__descriptor) \
+    , 0, 0, 0, {0,NULL}, {0,NULL}, 0, 0, 0, 0, 0, 0, 0, (char *)protobuf_c_empty_string }
+
+
+struct  _Dumpvdl2__ApplicationPdu
+{
+  ProtobufCMessage base;
+  char *protocol;
+  char *asn1_type;
+  char *json;
+};
+#define DUMPVDL2__APPLICATION_PDU__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&dumpvdl2__application_pdu__descriptor) \
+    , (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string }
+
+
+struct  _Dumpvdl2__DecodedAvlcFrame
+{
+  ProtobufCMessage base;
+  Dumpvdl2__Vdl2MsgMetadata *metadata;
+  Dumpvdl2__AvlcAddress *src;
+  Dumpvdl2__AvlcAddress *dst;
+  protobuf_c_boolean on_ground;
+  protobuf_c_boolean response;
+  char *frame_type;
+  char *cmd;
+  uint32_t sseq;
+  uint32_t rseq;
+  protobuf_c_boolean poll_final;
+  Dumpvdl2__AcarsMessage *acars;
+  Dumpvdl2__X25Packet *x25;
+  Dumpvdl2__ClnpPdu *clnp;
+  size_t n_applications;
+  Dumpvdl2__ApplicationPdu **applications;
+};
+#define DUMPVDL2__DECODED_AVLC_FRAME__INIT \
+ { PROTOBUF_C_MESSAGE_INIT (&dumpvdl2__decoded_avlc_frame__descriptor) \
+    , NULL, NULL, NULL, 0, 0, (char *)protobuf_c_empty_string, (char *)protobuf_c_empty_string, 0, 0, 0, NULL, NULL, NULL, 0,NULL }
+
+
 /* Dumpvdl2__Vdl2MsgMetadata__Timestamp methods */
 void   dumpvdl2__vdl2_msg_metadata__timestamp__init
                      (Dumpvdl2__Vdl2MsgMetadata__Timestamp         *message);
@@ -108,6 +228,120 @@ Dumpvdl2__RawAvlcFrame *
 void   dumpvdl2__raw_avlc_frame__free_unpacked
                      (Dumpvdl2__RawAvlcFrame *message,
                       ProtobufCAllocator *allocator);
+/* Dumpvdl2__AvlcAddress methods */
+void   dumpvdl2__avlc_address__init
+                     (Dumpvdl2__AvlcAddress         *message);
+size_t dumpvdl2__avlc_address__get_packed_size
+                     (const Dumpvdl2__AvlcAddress   *message);
+size_t dumpvdl2__avlc_address__pack
+                     (const Dumpvdl2__AvlcAddress   *message,
+                      uint8_t             *out);
+size_t dumpvdl2__avlc_address__pack_to_buffer
+                     (const Dumpvdl2__AvlcAddress   *message,
+                      ProtobufCBuffer     *buffer);
+Dumpvdl2__AvlcAddress *
+       dumpvdl2__avlc_address__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   dumpvdl2__avlc_address__free_unpacked
+                     (Dumpvdl2__AvlcAddress *message,
+                      ProtobufCAllocator *allocator);
+/* Dumpvdl2__AcarsMessage methods */
+void   dumpvdl2__acars_message__init
+                     (Dumpvdl2__AcarsMessage         *message);
+size_t dumpvdl2__acars_message__get_packed_size
+                     (const Dumpvdl2__AcarsMessage   *message);
+size_t dumpvdl2__acars_message__pack
+                     (const Dumpvdl2__AcarsMessage   *message,
+                      uint8_t             *out);
+size_t dumpvdl2__acars_message__pack_to_buffer
+                     (const Dumpvdl2__AcarsMessage   *message,
+                      ProtobufCBuffer     *buffer);
+Dumpvdl2__AcarsMessage *
+       dumpvdl2__acars_message__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   dumpvdl2__acars_message__free_unpacked
+                     (Dumpvdl2__AcarsMessage *message,
+                      ProtobufCAllocator *allocator);
+/* Dumpvdl2__X25Packet methods */
+void   dumpvdl2__x25_packet__init
+                     (Dumpvdl2__X25Packet         *message);
+size_t dumpvdl2__x25_packet__get_packed_size
+                     (const Dumpvdl2__X25Packet   *message);
+size_t dumpvdl2__x25_packet__pack
+                     (const Dumpvdl2__X25Packet   *message,
+                      uint8_t             *out);
+size_t dumpvdl2__x25_packet__pack_to_buffer
+                     (const Dumpvdl2__X25Packet   *message,
+                      ProtobufCBuffer     *buffer);
+Dumpvdl2__X25Packet *
+       dumpvdl2__x25_packet__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   dumpvdl2__x25_packet__free_unpacked
+                     (Dumpvdl2__X25Packet *message,
+                      ProtobufCAllocator *allocator);
+/* Dumpvdl2__ClnpPdu methods */
+void   dumpvdl2__clnp_pdu__init
+                     (Dumpvdl2__ClnpPdu         *message);
+size_t dumpvdl2__clnp_pdu__get_packed_size
+                     (const Dumpvdl2__ClnpPdu   *message);
+size_t dumpvdl2__clnp_pdu__pack
+                     (const Dumpvdl2__ClnpPdu   *message,
+                      uint8_t             *out);
+size_t dumpvdl2__clnp_pdu__pack_to_buffer
+                     (const Dumpvdl2__ClnpPdu   *message,
+                      ProtobufCBuffer     *buffer);
+Dumpvdl2__ClnpPdu *
+       dumpvdl2__clnp_pdu__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   dumpvdl2__clnp_pdu__free_unpacked
+                     (Dumpvdl2__ClnpPdu *message,
+                      ProtobufCAllocator *allocator);
+/* Dumpvdl2__ApplicationPdu methods */
+void   dumpvdl2__application_pdu__init
+                     (Dumpvdl2__ApplicationPdu         *message);
+size_t dumpvdl2__application_pdu__get_packed_size
+                     (const Dumpvdl2__ApplicationPdu   *message);
+size_t dumpvdl2__application_pdu__pack
+                     (const Dumpvdl2__ApplicationPdu   *message,
+                      uint8_t             *out);
+size_t dumpvdl2__application_pdu__pack_to_buffer
+                     (const Dumpvdl2__ApplicationPdu   *message,
+                      ProtobufCBuffer     *buffer);
+Dumpvdl2__ApplicationPdu *
+       dumpvdl2__application_pdu__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   dumpvdl2__application_pdu__free_unpacked
+                     (Dumpvdl2__ApplicationPdu *message,
+                      ProtobufCAllocator *allocator);
+/* Dumpvdl2__DecodedAvlcFrame methods */
+void   dumpvdl2__decoded_avlc_frame__init
+                     (Dumpvdl2__DecodedAvlcFrame         *message);
+size_t dumpvdl2__decoded_avlc_frame__get_packed_size
+                     (const Dumpvdl2__DecodedAvlcFrame   *message);
+size_t dumpvdl2__decoded_avlc_frame__pack
+                     (const Dumpvdl2__DecodedAvlcFrame   *message,
+                      uint8_t             *out);
+size_t dumpvdl2__decoded_avlc_frame__pack_to_buffer
+                     (const Dumpvdl2__DecodedAvlcFrame   *message,
+                      ProtobufCBuffer     *buffer);
+Dumpvdl2__DecodedAvlcFrame *
+       dumpvdl2__decoded_avlc_frame__unpack
+                     (ProtobufCAllocator  *allocator,
+                      size_t               len,
+                      const uint8_t       *data);
+void   dumpvdl2__decoded_avlc_frame__free_unpacked
+                     (Dumpvdl2__DecodedAvlcFrame *message,
+                      ProtobufCAllocator *allocator);
 /* --- per-message closures --- */
 
 typedef void (*Dumpvdl2__Vdl2MsgMetadata__Timestamp_Closure)
@@ -119,6 +353,24 @@ typedef void (*Dumpvdl2__Vdl2MsgMetadata_Closure)
 typedef void (*Dumpvdl2__RawAvlcFrame_Closure)
                  (const Dumpvdl2__RawAvlcFrame *message,
                   void *closure_data);
+typedef void (*Dumpvdl2__AvlcAddress_Closure)
+                 (const Dumpvdl2__AvlcAddress *message,
+                  void *closure_data);
+typedef void (*Dumpvdl2__AcarsMessage_Closure)
+                 (const Dumpvdl2__AcarsMessage *message,
+                  void *closure_data);
+typedef void (*Dumpvdl2__X25Packet_Closure)
+                 (const Dumpvdl2__X25Packet *message,
+                  void *closure_data);
+typedef void (*Dumpvdl2__ClnpPdu_Closure)
+                 (const Dumpvdl2__ClnpPdu *message,
+                  void *closure_data);
+typedef void (*Dumpvdl2__ApplicationPdu_Closure)
+                 (const Dumpvdl2__ApplicationPdu *message,
+                  void *closure_data);
+typedef void (*Dumpvdl2__DecodedAvlcFrame_Closure)
+                 (const Dumpvdl2__DecodedAvlcFrame *message,
+                  void *closure_data);
 
 /* --- services --- */
 
@@ -128,6 +380,12 @@ typedef void (*Dumpvdl2__RawAvlcFrame_Closure)
 extern const ProtobufCMessageDescriptor dumpvdl2__vdl2_msg_metadata__descriptor;
 extern const ProtobufCMessageDescriptor dumpvdl2__vdl2_msg_metadata__timestamp__descriptor;
 extern const ProtobufCMessageDescriptor dumpvdl2__raw_avlc_frame__descriptor;
+extern const ProtobufCMessageDescriptor dumpvdl2__avlc_address__descriptor;
+extern const ProtobufCMessageDescriptor dumpvdl2__acars_message__descriptor;
+extern const ProtobufCMessageDescriptor dumpvdl2__x25_packet__descriptor;
+extern const ProtobufCMessageDescriptor dumpvdl2__clnp_pdu__descriptor;
+extern const ProtobufCMessageDescriptor dumpvdl2__application_pdu__descriptor;
+extern const ProtobufCMessageDescriptor dumpvdl2__decoded_avlc_frame__descriptor;
 
 PROTOBUF_C__END_DECLS
 
@@ -27,6 +27,7 @@
 #include "atn.h"                    // atn_traffic_types, atsc_traffic_classes
 #include "esis.h"
 #include "dumpvdl2.h"
+#include "bench.h"                  // bench_layer_*
 #include "tlv.h"
 
 // Forward declaration
@@ -149,6 +150,7 @@ static la_dict const esis_options[] = {
 };
 
 la_proto_node *esis_pdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type) {
+	uint64_t t = bench_layer_start(BENCH_LAYER_ESIS, BENCH_OP_PARSE);
 	NEW(esis_pdu_t, pdu);
 	la_proto_node *node = la_proto_node_new();
 	node->td = &proto_DEF_esis_pdu;
@@ -200,9 +202,11 @@ la_proto_node *esis_pdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type) {
 	pdu->hdr = hdr;
 	*msg_type |= MSGFLT_ESIS;
 	pdu->err = false;
+	bench_layer_end(t);
 	return node;
 end:
 	node->next = unknown_proto_pdu_new(buf, len);
+	bench_layer_end(t);
 	return node;
 }
 
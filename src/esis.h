@@ -52,4 +52,5 @@ typedef struct {
 } esis_pdu_t;
 
 // esis.c
+extern la_type_descriptor const proto_DEF_esis_pdu;
 la_proto_node *esis_pdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type);
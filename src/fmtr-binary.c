@@ -17,12 +17,46 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>                     // memcpy
+#include <libacars/libacars.h>          // la_proto_node, la_proto_tree_format_json
+#include <libacars/vstring.h>           // la_vstring
+#include <libacars/acars.h>             // la_proto_tree_find_acars, la_acars_msg
+#include <libacars/cpdlc.h>             // la_proto_tree_find_cpdlc
+#include <libacars/adsc.h>              // la_proto_tree_find_adsc
+#include <libacars/reassembly.h>        // la_reasm_status_name_get
 #include "output-common.h"              // fmtr_descriptor_t
 #include "dumpvdl2.h"                   // octet_string_t
 #include "dumpvdl2.pb-c.h"              // protobuf-c API
+#include "avlc.h"                       // avlc_frame_t, proto_DEF_avlc_frame
+#include "x25.h"                        // x25_pkt_t, proto_DEF_X25_pkt, fmt_x25_addr
+#include "clnp.h"                       // clnp_pdu_t, clnp_compressed_data_pdu_t, proto_DEF_clnp_*
+#include "reassembly.h"                 // reasm_status_name_get
+#include "asn1-util.h"                  // asn1_pdu_t
+#include "icao.h"                       // proto_DEF_cpdlc, proto_DEF_cm, proto_DEF_adsc_v2
+
+// Maximum number of application PDUs stored in a single decoded frame
+#define APP_PDUS_MAX 4
 
 static bool fmtr_binary_supports_data_type(fmtr_input_type_t type) {
-	return(type == FMTR_INTYPE_RAW_FRAME);
+	return(type == FMTR_INTYPE_RAW_FRAME || type == FMTR_INTYPE_DECODED_FRAME);
+}
+
+static void metadata_to_protobuf(vdl2_msg_metadata const *metadata, Dumpvdl2__Vdl2MsgMetadata *m,
+		Dumpvdl2__Vdl2MsgMetadata__Timestamp *ts) {
+	ts->tv_sec = metadata->burst_timestamp.tv_sec;
+	ts->tv_usec = metadata->burst_timestamp.tv_usec;
+
+	m->station_id = metadata->station_id;
+	m->burst_timestamp = ts;
+	m->datalen_octets = metadata->datalen_octets;
+	m->frequency = metadata->freq;
+	m->frame_pwr_dbfs = metadata->frame_pwr_dbfs;
+	m->nf_pwr_dbfs = metadata->nf_pwr_dbfs;
+	m->idx = metadata->idx;
+	m->num_fec_corrections = metadata->num_fec_corrections;
+	m->ppm_error = metadata->ppm_error;
+	m->synd_weight = metadata->synd_weight;
+	m->version = metadata->version;
 }
 
 static octet_string_t *fmtr_binary_format_raw_frame(vdl2_msg_metadata *metadata, octet_string_t *frame) {
@@ -30,21 +64,8 @@ static octet_string_t *fmtr_binary_format_raw_frame(vdl2_msg_metadata *metadata,
 	ASSERT(frame != NULL);
 
 	Dumpvdl2__Vdl2MsgMetadata__Timestamp ts = DUMPVDL2__VDL2_MSG_METADATA__TIMESTAMP__INIT;
-	ts.tv_sec = metadata->burst_timestamp.tv_sec;
-	ts.tv_usec = metadata->burst_timestamp.tv_usec;
-
 	Dumpvdl2__Vdl2MsgMetadata m = DUMPVDL2__VDL2_MSG_METADATA__INIT;
-	m.station_id = metadata->station_id;
-	m.burst_timestamp = &ts;
-	m.datalen_octets = metadata->datalen_octets;
-	m.frequency = metadata->freq;
-	m.frame_pwr_dbfs = metadata->frame_pwr_dbfs;
-	m.nf_pwr_dbfs = metadata->nf_pwr_dbfs;
-	m.idx = metadata->idx;
-	m.num_fec_corrections = metadata->num_fec_corrections;
-	m.ppm_error = metadata->ppm_error;
-	m.synd_weight = metadata->synd_weight;
-	m.version = metadata->version;
+	metadata_to_protobuf(metadata, &m, &ts);
 
 	Dumpvdl2__RawAvlcFrame f = DUMPVDL2__RAW_AVLC_FRAME__INIT;
 	f.metadata = &m;
@@ -59,10 +80,252 @@ static octet_string_t *fmtr_binary_format_raw_frame(vdl2_msg_metadata *metadata,
 	return octet_string_new(buf, packed_len);
 }
 
+// Storage for all protobuf messages of a single decoded frame.
+// Strings point either to the protocol tree or to the buffers below,
+// so the tree must not be destroyed before the frame is packed.
+typedef struct {
+	Dumpvdl2__DecodedAvlcFrame frame;
+	Dumpvdl2__Vdl2MsgMetadata metadata;
+	Dumpvdl2__Vdl2MsgMetadata__Timestamp ts;
+	Dumpvdl2__AvlcAddress src, dst;
+	Dumpvdl2__AcarsMessage acars;
+	Dumpvdl2__X25Packet x25;
+	Dumpvdl2__ClnpPdu clnp;
+	Dumpvdl2__ApplicationPdu apps[APP_PDUS_MAX];
+	Dumpvdl2__ApplicationPdu *app_ptrs[APP_PDUS_MAX];
+	la_vstring *app_json[APP_PDUS_MAX];
+	char *x25_calling, *x25_called;
+	char acars_mode[2], acars_ack[2], acars_block_id[2], acars_msg_num[5];
+	char frame_type[2];
+} decoded_frame_pb;
+
+static void avlc_to_protobuf(decoded_frame_pb *pb, avlc_frame_t const *f) {
+	pb->src.addr = f->src.a_addr.addr;
+	pb->src.type = f->src.a_addr.type;
+	pb->dst.addr = f->dst.a_addr.addr;
+	pb->dst.type = f->dst.a_addr.type;
+	pb->frame.src = &pb->src;
+	pb->frame.dst = &pb->dst;
+	// Air/Ground bit applies to the src addr, but it resides in the dst address field
+	pb->frame.on_ground = f->dst.a_addr.status;
+	pb->frame.response = f->src.a_addr.status;
+	char const *cmd = avlc_frame_cmd_name(f);
+	if(IS_S(f->lcf)) {
+		pb->frame_type[0] = 'S';
+		pb->frame.rseq = f->lcf.S.recv_seq;
+		pb->frame.poll_final = f->lcf.S.pf;
+	} else if(IS_U(f->lcf)) {
+		pb->frame_type[0] = 'U';
+		pb->frame.poll_final = U_PF(f->lcf);
+	} else {
+		pb->frame_type[0] = 'I';
+		pb->frame.sseq = f->lcf.I.send_seq;
+		pb->frame.rseq = f->lcf.I.recv_seq;
+		pb->frame.poll_final = f->lcf.I.poll;
+	}
+	pb->frame.frame_type = pb->frame_type;
+	if(cmd != NULL) {
+		pb->frame.cmd = (char *)cmd;
+	}
+}
+
+static void acars_to_protobuf(decoded_frame_pb *pb, la_acars_msg const *msg) {
+	Dumpvdl2__AcarsMessage *a = &pb->acars;
+	a->err = msg->err;
+	if(msg->err == true) {
+		return;
+	}
+	a->crc_ok = msg->crc_ok;
+	pb->acars_mode[0] = msg->mode;
+	pb->acars_ack[0] = msg->ack;
+	pb->acars_block_id[0] = msg->block_id;
+	memcpy(pb->acars_msg_num, msg->msg_num, 3);
+	pb->acars_msg_num[3] = msg->msg_num_seq;
+	a->mode = pb->acars_mode;
+	a->ack = pb->acars_ack;
+	a->block_id = pb->acars_block_id;
+	a->msg_num = pb->acars_msg_num;
+	a->reg = (char *)msg->reg;
+	a->label = (char *)msg->label;
+	a->sublabel = (char *)msg->sublabel;
+	a->mfi = (char *)msg->mfi;
+	a->flight_id = (char *)msg->flight_id;
+	if(msg->txt != NULL) {
+		a->text = msg->txt;
+	}
+	a->reasm_status = (char *)la_reasm_status_name_get(msg->reasm_status);
+}
+
+static void x25_to_protobuf(decoded_frame_pb *pb, x25_pkt_t const *pkt) {
+	Dumpvdl2__X25Packet *x = &pb->x25;
+	x->err = pkt->err;
+	if(pkt->err == true) {
+		return;
+	}
+	x->pkt_type = pkt->type;
+	x->chan_group = pkt->hdr->chan_group;
+	x->chan_num = pkt->hdr->chan_num;
+	if(pkt->addr_block_present) {
+		if((pb->x25_calling = fmt_x25_addr(pkt->calling.addr, pkt->calling.len)) != NULL) {
+			x->calling_addr = pb->x25_calling;
+		}
+		if((pb->x25_called = fmt_x25_addr(pkt->called.addr, pkt->called.len)) != NULL) {
+			x->called_addr = pb->x25_called;
+		}
+	} else if(pkt->type == X25_DATA) {
+		x->sseq = pkt->hdr->type.data.sseq;
+		x->rseq = pkt->hdr->type.data.rseq;
+		x->more = pkt->hdr->type.data.more;
+	} else if(pkt->type == X25_RR || pkt->type == X25_REJ) {
+		x->rseq = pkt->hdr->type.data.rseq;
+	}
+	switch(pkt->type) {
+		case X25_CALL_REQUEST:
+		case X25_CALL_ACCEPTED:
+			x->compression = pkt->compression;
+			break;
+		case X25_DATA:
+			x->reasm_status = (char *)la_reasm_status_name_get(pkt->reasm_status);
+			break;
+		case X25_CLEAR_REQUEST:
+		case X25_RESET_REQUEST:
+		case X25_RESTART_REQUEST:
+			x->clear_cause = pkt->clr_cause;
+			break;
+	}
+	x->diag_code_present = pkt->diag_code_present;
+	x->diag_code = pkt->diag_code;
+}
+
+static void clnp_to_protobuf(decoded_frame_pb *pb, clnp_pdu_t const *pdu) {
+	Dumpvdl2__ClnpPdu *c = &pb->clnp;
+	c->err = pdu->err;
+	if(pdu->err == true) {
+		return;
+	}
+	c->compressed = false;
+	c->pdu_type = pdu->hdr->type;
+	c->src_nsap.data = pdu->src_nsap.buf;
+	c->src_nsap.len = pdu->src_nsap.len;
+	c->dst_nsap.data = pdu->dst_nsap.buf;
+	c->dst_nsap.len = pdu->dst_nsap.len;
+	c->lifetime_ms = pdu->lifetime.tv_sec * 1000 + pdu->lifetime.tv_usec / 1000;
+	c->flags = (pdu->hdr->sp << 2) | (pdu->hdr->ms << 1) | pdu->hdr->er;
+	if(pdu->hdr->sp != 0) {
+		c->pdu_id = pdu->pdu_id;
+		c->segment_offset = pdu->offset;
+		c->pdu_total_len = pdu->total_pdu_len;
+		c->more_segments = pdu->hdr->ms;
+	}
+	c->reasm_status = (char *)reasm_status_name_get(pdu->reasm_status);
+}
+
+static void clnp_compressed_to_protobuf(decoded_frame_pb *pb, clnp_compressed_data_pdu_t const *pdu) {
+	Dumpvdl2__ClnpPdu *c = &pb->clnp;
+	c->err = pdu->err;
+	if(pdu->err == true) {
+		return;
+	}
+	c->compressed = true;
+	c->local_ref = pdu->lref;
+	c->lifetime_ms = pdu->lifetime.tv_sec * 1000 + pdu->lifetime.tv_usec / 1000;
+	c->flags = pdu->hdr->flags.val;
+	if(pdu->is_segmentation_permitted) {
+		c->pdu_id = pdu->pdu_id;
+	}
+	if(pdu->derived) {
+		c->segment_offset = pdu->offset;
+		c->pdu_total_len = pdu->total_pdu_len;
+		c->more_segments = pdu->more_segments;
+		c->reasm_status = (char *)reasm_status_name_get(pdu->reasm_status);
+	}
+}
+
+static void app_to_protobuf(decoded_frame_pb *pb, la_proto_node *node, char const *asn1_type) {
+	size_t i = pb->frame.n_applications;
+	if(i >= APP_PDUS_MAX) {
+		return;
+	}
+	dumpvdl2__application_pdu__init(&pb->apps[i]);
+	if(node->td->json_key != NULL) {
+		pb->apps[i].protocol = (char *)node->td->json_key;
+	}
+	if(asn1_type != NULL) {
+		pb->apps[i].asn1_type = (char *)asn1_type;
+	}
+	pb->app_json[i] = la_proto_tree_format_json(NULL, node);
+	pb->apps[i].json = pb->app_json[i]->str;
+	pb->app_ptrs[i] = &pb->apps[i];
+	pb->frame.applications = pb->app_ptrs;
+	pb->frame.n_applications++;
+}
+
+static octet_string_t *fmtr_binary_format_decoded_msg(vdl2_msg_metadata *metadata, la_proto_node *root) {
+	ASSERT(metadata != NULL);
+	ASSERT(root != NULL);
+
+	decoded_frame_pb pb = {
+		.frame = DUMPVDL2__DECODED_AVLC_FRAME__INIT,
+		.metadata = DUMPVDL2__VDL2_MSG_METADATA__INIT,
+		.ts = DUMPVDL2__VDL2_MSG_METADATA__TIMESTAMP__INIT,
+		.src = DUMPVDL2__AVLC_ADDRESS__INIT,
+		.dst = DUMPVDL2__AVLC_ADDRESS__INIT,
+		.acars = DUMPVDL2__ACARS_MESSAGE__INIT,
+		.x25 = DUMPVDL2__X25_PACKET__INIT,
+		.clnp = DUMPVDL2__CLNP_PDU__INIT
+	};
+	metadata_to_protobuf(metadata, &pb.metadata, &pb.ts);
+	pb.frame.metadata = &pb.metadata;
+
+	// Walk the tree once, picking the layers we know about
+	for(la_proto_node *node = root; node != NULL; node = node->next) {
+		if(node->td == &proto_DEF_avlc_frame) {
+			avlc_to_protobuf(&pb, node->data);
+		} else if(node->td == &proto_DEF_X25_pkt) {
+			x25_to_protobuf(&pb, node->data);
+			pb.frame.x25 = &pb.x25;
+		} else if(node->td == &proto_DEF_clnp_pdu) {
+			clnp_to_protobuf(&pb, node->data);
+			pb.frame.clnp = &pb.clnp;
+		} else if(node->td == &proto_DEF_clnp_compressed_data_pdu) {
+			clnp_compressed_to_protobuf(&pb, node->data);
+			pb.frame.clnp = &pb.clnp;
+		} else if(node->td == &proto_DEF_cpdlc || node->td == &proto_DEF_cm ||
+				node->td == &proto_DEF_adsc_v2) {
+			asn1_pdu_t const *pdu = node->data;
+			app_to_protobuf(&pb, node, pdu->type != NULL ? pdu->type->name : NULL);
+		}
+	}
+	la_proto_node *node = la_proto_tree_find_acars(root);
+	if(node != NULL) {
+		acars_to_protobuf(&pb, node->data);
+		pb.frame.acars = &pb.acars;
+		// FANS-1/A applications carried in ACARS
+		if((node = la_proto_tree_find_cpdlc(root)) != NULL) {
+			app_to_protobuf(&pb, node, NULL);
+		}
+		if((node = la_proto_tree_find_adsc(root)) != NULL) {
+			app_to_protobuf(&pb, node, NULL);
+		}
+	}
+
+	size_t len = dumpvdl2__decoded_avlc_frame__get_packed_size(&pb.frame);
+	void *buf = XCALLOC(sizeof(uint8_t), len);
+	size_t packed_len = dumpvdl2__decoded_avlc_frame__pack(&pb.frame, buf);
+	debug_print(D_OUTPUT, "get_packed_size: %zu, pack_result_size: %zu\n", len, packed_len);
+
+	for(size_t i = 0; i < pb.frame.n_applications; i++) {
+		la_vstring_destroy(pb.app_json[i], true);
+	}
+	XFREE(pb.x25_calling);
+	XFREE(pb.x25_called);
+	return octet_string_new(buf, packed_len);
+}
+
 fmtr_descriptor_t fmtr_DEF_binary = {
 	.name = "binary",
-	.description = "Binary format, suitable for archiving raw frames",
-	.format_decoded_msg = NULL,
+	.description = "Binary format (protobuf), suitable for archiving raw frames and for machine processing of decoded frames",
+	.format_decoded_msg = fmtr_binary_format_decoded_msg,
 	.format_raw_msg = fmtr_binary_format_raw_frame,
 	.supports_data_type = fmtr_binary_supports_data_type,
 	.output_format = OFMT_BINARY,
@@ -22,12 +22,30 @@
 #include <libacars/vstring.h>           // la_vstring
 #include <libacars/json.h>
 #include "fmtr-json.h"
-#include "output-common.h"              // fmtr_descriptor_t
+#include "output-common.h"              // fmtr_descriptor_t, trace_interval_usec
 #include "dumpvdl2.h"                   // octet_string_t, Config, DUMPVDL2_VERSION
 
 // forward declarations
 la_type_descriptor const la_DEF_vdl2_message;
 
+static void append_trace_interval(la_vstring *vstr, char const *key,
+		struct timespec const *start, struct timespec const *end) {
+	int64_t usec = trace_interval_usec(start, end);
+	if(usec >= 0) {
+		la_json_append_int64(vstr, key, usec);
+	}
+}
+
+// Time spent by the message in each pipeline stage so far (in microseconds)
+static void format_trace_json(la_vstring *vstr, vdl2_msg_metadata const *m) {
+	la_json_object_start(vstr, "trace");
+	append_trace_interval(vstr, "demod_usec", &m->trace[TRACE_SYNC], &m->trace[TRACE_ENQUEUED]);
+	append_trace_interval(vstr, "decoder_queue_usec", &m->trace[TRACE_ENQUEUED], &m->trace[TRACE_DECODE_START]);
+	append_trace_interval(vstr, "decode_usec", &m->trace[TRACE_DECODE_START], &m->trace[TRACE_DECODED]);
+	append_trace_interval(vstr, "age_usec", &m->trace[TRACE_SYNC], &m->trace[TRACE_FORMAT_START]);
+	la_json_object_end(vstr);
+}
+
 void la_vdl2_format_json(la_vstring *vstr, void const *data) {
 	ASSERT(vstr);
 	ASSERT(data);
@@ -54,6 +72,9 @@ void la_vdl2_format_json(la_vstring *vstr, void const *data) {
 	la_json_append_double(vstr, "sig_level", m->frame_pwr_dbfs);
 	la_json_append_double(vstr, "noise_level", m->nf_pwr_dbfs);
 	la_json_append_double(vstr, "freq_skew", m->ppm_error);
+	if(Config.latency_trace) {
+		format_trace_json(vstr, m);
+	}
 }
 
 static bool fmtr_json_supports_data_type(fmtr_input_type_t type) {
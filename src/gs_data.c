@@ -16,14 +16,80 @@
  *  You should have received a copy of the GNU General Public License
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+
 #include <errno.h>          // errno
 #include <stdio.h>          // fprintf, fopen, fscanf, fclose, perror
-#include <string.h>         // strerror
-#include <libacars/hash.h>  // la_hash_*
-#include "dumpvdl2.h"       // debug_print
+#include <stdlib.h>         // qsort
+#include <string.h>         // strerror, memcmp, memcpy
+#include <stdatomic.h>      // atomic_*
+#include <signal.h>         // sig_atomic_t
+#include <pthread.h>        // pthread_mutex_*, pthread_detach
+#include <unistd.h>         // close, write, unlink, sleep
+#include <fcntl.h>          // open
+#include <sys/stat.h>       // fstat
+#include "config.h"         // HAVE_SYS_MMAN_H
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>       // mmap, munmap
+#endif
+#include "dumpvdl2.h"       // debug_print, do_exit, start_thread
 #include "gs_data.h"        // gs_data_entry
 
-static la_hash *gs_data = NULL;
+// Binary ground station database format.
+//
+// All integers are little-endian.
+//
+// Header (GS_DB_HEADER_LEN octets):
+//   0: magic (GS_DB_MAGIC, 8 octets)
+//   8: version (uint32_t)
+//  12: number of entries (uint32_t)
+//  16: string table length (uint32_t)
+//  20: reserved (uint32_t, zero)
+//
+// The header is followed by the entry table - an array of records of
+// GS_DB_RECORD_LEN octets sorted by address:
+//   0: address (uint32_t)
+//   4: airport code (uint32_t string table offset)
+//   8: details (uint32_t string table offset)
+//  12: location (uint32_t string table offset)
+//
+// The string table follows the entry table. It contains NUL-terminated strings.
+//
+// The file is memory-mapped as a whole and searched in place, so multiple
+// processes using the same file share a single copy of it in memory. The
+// contents are validated once, when the file is loaded, so the file must not
+// be modified in place afterwards - updates have to be written to a new file
+// which is then renamed over the old one (like --gs-file-compile does). The
+// old inode stays intact for as long as it's mapped. As a safety net, the
+// reloader thread checks the mapped file periodically and replaces the
+// mapping if the file has been overwritten or truncated in place.
+
+#define GS_DB_MAGIC "VDL2GSDB"
+#define GS_DB_VERSION 1
+#define GS_DB_HEADER_LEN 24
+#define GS_DB_RECORD_LEN 16
+
+typedef struct gs_db {
+	uint8_t *buf;               // whole database image (read-only when mapped)
+	size_t len;
+	bool mapped;                // buf is a file mapping (otherwise it's malloc'ed)
+	int fd;                     // mapped file, kept open to watch it for changes
+	time_t mtime;               // modification time of the mapped file
+	uint32_t count;
+	uint8_t const *records;
+	char const *strings;
+	atomic_int refcnt;          // held by the module while current and by each returned entry
+} gs_db;
+
+// Current database. Each entry returned by gs_data_entry_lookup() holds a
+// reference to the database it comes from, so a replaced database is freed
+// (and unmapped) only after all messages using it have been formatted.
+// Reloads are performed by gs_data_reloader_thread, so decoder threads
+// never wait for the file to be parsed. gs_data_mutex protects the gs_data
+// pointer, so that taking a reference can't race with the swap.
+static gs_db *gs_data = NULL;
+static char *gs_data_file = NULL;
+static pthread_mutex_t gs_data_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile sig_atomic_t gs_data_reload_requested = 0;
 
 uint32_t uint_hash(void const *key) {
 	return *(uint32_t *)key;
@@ -33,70 +99,413 @@ bool uint_compare(void const *key1, void const *key2) {
 	return *(uint32_t *)key1 == *(uint32_t *)key2;
 }
 
-static void gs_data_entry_destroy(void *data) {
-	if(data == NULL) {
+static uint32_t get_le32(uint8_t const *buf) {
+	return (uint32_t)buf[0] | (uint32_t)buf[1] << 8 | (uint32_t)buf[2] << 16 | (uint32_t)buf[3] << 24;
+}
+
+static void put_le32(uint8_t *buf, uint32_t val) {
+	buf[0] = val & 0xff;
+	buf[1] = (val >> 8) & 0xff;
+	buf[2] = (val >> 16) & 0xff;
+	buf[3] = (val >> 24) & 0xff;
+}
+
+static void gs_db_destroy(gs_db *db) {
+	if(db == NULL) {
 		return;
 	}
-	gs_data_entry *k = data;
-	XFREE(k->airport_code);
-	XFREE(k->details);
-	XFREE(k->location);
-	XFREE(k);
+#ifdef HAVE_SYS_MMAN_H
+	if(db->mapped) {
+		munmap(db->buf, db->len);
+		close(db->fd);
+	} else {
+		XFREE(db->buf);
+	}
+#else
+	XFREE(db->buf);
+#endif
+	XFREE(db);
 }
 
-int gs_data_import(char const *file) {
-	if(file == NULL) {
+static void gs_db_release(gs_db *db) {
+	if(db != NULL && atomic_fetch_sub(&db->refcnt, 1) == 1) {
+		gs_db_destroy(db);
+	}
+}
+
+// Checks the database image and sets up pointers to its sections
+static int gs_db_setup(gs_db *db, char const *file) {
+	if(db->len < GS_DB_HEADER_LEN || memcmp(db->buf, GS_DB_MAGIC, 8) != 0) {
+		fprintf(stderr, "%s: not a ground station database\n", file);
 		return -1;
 	}
-	int ret = -1;
-	FILE *f = fopen(file, "r");
-	if(f == NULL) {
-		fprintf(stderr, "Could not open %s: %s\n", file, strerror(errno));
+	uint32_t version = get_le32(db->buf + 8);
+	if(version != GS_DB_VERSION) {
+		fprintf(stderr, "%s: unsupported database version %u\n", file, version);
 		return -1;
 	}
+	uint32_t count = get_le32(db->buf + 12);
+	uint32_t strings_len = get_le32(db->buf + 16);
+	if((uint64_t)GS_DB_HEADER_LEN + (uint64_t)count * GS_DB_RECORD_LEN + strings_len != db->len ||
+			strings_len == 0 || db->buf[db->len - 1] != '\0') {
+		fprintf(stderr, "%s: database file is truncated or damaged\n", file);
+		return -1;
+	}
+	db->count = count;
+	db->records = db->buf + GS_DB_HEADER_LEN;
+	db->strings = (char const *)db->records + (size_t)count * GS_DB_RECORD_LEN;
+	// Validate the whole table once, so that lookups don't have to
+	for(uint32_t i = 0; i < count; i++) {
+		uint8_t const *rec = db->records + (size_t)i * GS_DB_RECORD_LEN;
+		if(i > 0 && get_le32(rec) <= get_le32(rec - GS_DB_RECORD_LEN)) {
+			fprintf(stderr, "%s: entries are not sorted\n", file);
+			return -1;
+		}
+		for(int j = 1; j <= 3; j++) {
+			if(get_le32(rec + 4 * j) >= strings_len) {
+				fprintf(stderr, "%s: entry %u: invalid string offset\n", file, i);
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+// Maps (or reads) a binary database. Takes over fd - it's either kept open
+// along with the mapping or closed.
+static gs_db *gs_db_map(int fd, char const *file) {
+	struct stat st;
+	if(fstat(fd, &st) < 0) {
+		fprintf(stderr, "%s: could not stat file: %s\n", file, strerror(errno));
+		close(fd);
+		return NULL;
+	}
+	if(st.st_size < GS_DB_HEADER_LEN) {
+		fprintf(stderr, "%s: not a ground station database\n", file);
+		close(fd);
+		return NULL;
+	}
+	NEW(gs_db, db);
+	db->len = (size_t)st.st_size;
+#ifdef HAVE_SYS_MMAN_H
+	void *map = mmap(NULL, db->len, PROT_READ, MAP_SHARED, fd, 0);
+	if(map == MAP_FAILED) {
+		fprintf(stderr, "%s: could not map file: %s\n", file, strerror(errno));
+		close(fd);
+		XFREE(db);
+		return NULL;
+	}
+	db->buf = map;
+	db->mapped = true;
+	db->fd = fd;
+	db->mtime = st.st_mtime;
+#else
+	db->buf = XCALLOC(db->len, sizeof(uint8_t));
+	ssize_t len = pread(fd, db->buf, db->len, 0);
+	close(fd);
+	if(len != (ssize_t)db->len) {
+		fprintf(stderr, "%s: could not read file: %s\n", file, strerror(errno));
+		gs_db_destroy(db);
+		return NULL;
+	}
+#endif
+	if(gs_db_setup(db, file) < 0) {
+		gs_db_destroy(db);
+		return NULL;
+	}
+	return db;
+}
+
+// Returns true if the file backing the mapping of db has been modified in
+// place since it was mapped. The mapping can't be trusted anymore then - it
+// might contain unvalidated data or access to it might raise SIGBUS if the
+// file has been truncated.
+static bool gs_db_mapping_stale(gs_db const *db) {
+	if(db == NULL || db->mapped == false) {
+		return false;
+	}
+	struct stat st;
+	if(fstat(db->fd, &st) < 0) {
+		return false;
+	}
+	return (size_t)st.st_size != db->len || st.st_mtime != db->mtime;
+}
+
+typedef struct {
+	uint32_t addr;
+	uint32_t line;
+	uint32_t strings[3];        // airport code, details, location
+} gs_text_entry;
+
+static int gs_text_entry_compare(void const *a, void const *b) {
+	gs_text_entry const *e1 = a, *e2 = b;
+	if(e1->addr != e2->addr) {
+		return e1->addr < e2->addr ? -1 : 1;
+	}
+	return e1->line < e2->line ? -1 : (e1->line > e2->line ? 1 : 0);
+}
+
+static uint32_t strtab_append(char **strtab, size_t *len, size_t *size, char const *str) {
+	size_t slen = strlen(str) + 1;
+	while(*len + slen > *size) {
+		*size = *size > 0 ? 2 * *size : 16384;
+		*strtab = XREALLOC(*strtab, *size);
+	}
+	uint32_t offset = (uint32_t)*len;
+	memcpy(*strtab + *len, str, slen);
+	*len += slen;
+	return offset;
+}
+
+// Parses a text file in MultiPSK format and builds a database image from it
+static gs_db *gs_db_parse_text(FILE *f, char const *file) {
+	gs_text_entry *entries = NULL;
+	size_t entries_size = 0;
+	char *strtab = NULL;
+	size_t strtab_len = 0, strtab_size = 0;
+	gs_db *db = NULL;
+
 	uint32_t addr = 0;
 	char airport_code[33];
 	char details[257];
 	char location[257];
 	int result = 0;
 	int cnt = 0;
-	gs_data = la_hash_new(uint_hash, uint_compare, la_simple_free, gs_data_entry_destroy);
 	while((result = fscanf(f, "%x [%256[^]]] [%256[^]]]\n", &addr, details, location)) != EOF) {
 		cnt++;
 		if(result != 3) {
 			fprintf(stderr, "%s: parse error at line %d: expected 3 fields, got %d\n", file, cnt, result);
-			ret = -1;
-			goto fail;
+			goto end;
 		}
 		if(sscanf(details, "%32s", airport_code) != 1) {
 			fprintf(stderr, "%s: parse error at line %d: could not find airport code\n", file, cnt);
-			ret = -1;
-			goto fail;
+			goto end;
 		}
 		debug_print(D_CACHE, "%d: addr: '%06X' apt_code: '%s' details: '%s' location: '%s'\n",
 				cnt, addr, airport_code, details, location);
-		NEW(uint32_t, key);
-		NEW(gs_data_entry, entry);
-		*key = addr;
-		entry->airport_code = strdup(airport_code);
-		entry->details = strdup(details);
-		entry->location = strdup(location);
-		la_hash_insert(gs_data, key, entry);
-	}
-	fprintf(stderr, "%s: read %d entries\n", file, cnt);
-	ret = cnt;
-	goto cleanup;
-
-fail:
-	la_hash_destroy(gs_data);
-cleanup:
-	fclose(f);
+		if((size_t)cnt > entries_size) {
+			entries_size = entries_size > 0 ? 2 * entries_size : 1024;
+			entries = XREALLOC(entries, entries_size * sizeof(gs_text_entry));
+		}
+		gs_text_entry *e = entries + cnt - 1;
+		e->addr = addr;
+		e->line = (uint32_t)cnt;
+		e->strings[0] = strtab_append(&strtab, &strtab_len, &strtab_size, airport_code);
+		e->strings[1] = strtab_append(&strtab, &strtab_len, &strtab_size, details);
+		e->strings[2] = strtab_append(&strtab, &strtab_len, &strtab_size, location);
+	}
+	if(strtab_len == 0) {
+		strtab_append(&strtab, &strtab_len, &strtab_size, "");
+	}
+	// If an address is listed more than once, the last entry wins
+	if(cnt > 0) {
+		qsort(entries, (size_t)cnt, sizeof(gs_text_entry), gs_text_entry_compare);
+	}
+	size_t unique_cnt = 0;
+	for(int i = 0; i < cnt; i++) {
+		if(unique_cnt > 0 && entries[unique_cnt - 1].addr == entries[i].addr) {
+			entries[unique_cnt - 1] = entries[i];
+		} else {
+			entries[unique_cnt++] = entries[i];
+		}
+	}
+
+	db = XCALLOC(1, sizeof(gs_db));
+	db->len = GS_DB_HEADER_LEN + unique_cnt * GS_DB_RECORD_LEN + strtab_len;
+	db->buf = XCALLOC(db->len, sizeof(uint8_t));
+	memcpy(db->buf, GS_DB_MAGIC, 8);
+	put_le32(db->buf + 8, GS_DB_VERSION);
+	put_le32(db->buf + 12, (uint32_t)unique_cnt);
+	put_le32(db->buf + 16, (uint32_t)strtab_len);
+	uint8_t *rec = db->buf + GS_DB_HEADER_LEN;
+	for(size_t i = 0; i < unique_cnt; i++, rec += GS_DB_RECORD_LEN) {
+		put_le32(rec, entries[i].addr);
+		for(int j = 0; j < 3; j++) {
+			put_le32(rec + 4 * (j + 1), entries[i].strings[j]);
+		}
+	}
+	memcpy(rec, strtab, strtab_len);
+	if(gs_db_setup(db, file) < 0) {
+		gs_db_destroy(db);
+		db = NULL;
+	}
+end:
+	XFREE(entries);
+	XFREE(strtab);
+	return db;
+}
+
+// Loads the database from a binary file or from a text file, depending on its contents
+static gs_db *gs_db_load(char const *file) {
+	int fd = open(file, O_RDONLY);
+	if(fd < 0) {
+		fprintf(stderr, "Could not open %s: %s\n", file, strerror(errno));
+		return NULL;
+	}
+	gs_db *db = NULL;
+	char magic[8];
+	if(read(fd, magic, sizeof(magic)) == sizeof(magic) && memcmp(magic, GS_DB_MAGIC, sizeof(magic)) == 0) {
+		// Takes over the descriptor
+		db = gs_db_map(fd, file);
+	} else {
+		FILE *f = fdopen(fd, "r");
+		if(f == NULL) {
+			fprintf(stderr, "%s: %s\n", file, strerror(errno));
+			close(fd);
+			return NULL;
+		}
+		rewind(f);
+		db = gs_db_parse_text(f, file);
+		fclose(f);
+	}
+	if(db != NULL) {
+		atomic_init(&db->refcnt, 1);
+		fprintf(stderr, "%s: read %u entries\n", file, db->count);
+	}
+	return db;
+}
+
+// Called from a signal handler, hence it only sets a flag. The reload is
+// performed by gs_data_reloader_thread.
+void gs_data_reload_request() {
+	gs_data_reload_requested = 1;
+}
+
+static void gs_data_replace(gs_db *db) {
+	pthread_mutex_lock(&gs_data_mutex);
+	gs_db *old = gs_data;
+	gs_data = db;
+	pthread_mutex_unlock(&gs_data_mutex);
+	// Entries returned from the old database keep it alive
+	gs_db_release(old);
+}
+
+// This is the only thread which replaces gs_data, so it can read the pointer
+// without locking
+static void *gs_data_reloader_thread(void *arg) {
+	UNUSED(arg);
+	while(do_exit == 0) {
+		if(gs_db_mapping_stale(gs_data)) {
+			fprintf(stderr, "%s: file has been modified in place, reloading\n", gs_data_file);
+			gs_db *db = gs_db_load(gs_data_file);
+			if(db == NULL) {
+				fprintf(stderr, "%s: reload failed, ground station data disabled "
+						"until the next reload\n", gs_data_file);
+			}
+			gs_data_replace(db);
+		} else if(gs_data_reload_requested) {
+			gs_data_reload_requested = 0;
+			fprintf(stderr, "%s: reloading ground station data\n", gs_data_file);
+			gs_db *db = gs_db_load(gs_data_file);
+			if(db != NULL) {
+				gs_data_replace(db);
+			} else {
+				fprintf(stderr, "%s: reload failed, keeping the current data\n", gs_data_file);
+			}
+		}
+		sleep(1);
+	}
+	return NULL;
+}
+
+int gs_data_import(char const *file) {
+	if(file == NULL) {
+		return -1;
+	}
+	gs_db *db = gs_db_load(file);
+	if(db == NULL) {
+		return -1;
+	}
+	gs_data = db;
+	gs_data_file = strdup(file);
+	pthread_t th;
+	start_thread(&th, gs_data_reloader_thread, NULL);
+	pthread_detach(th);
+	return (int)db->count;
+}
+
+int gs_data_compile(char const *file, char const *out_file) {
+	ASSERT(file != NULL);
+	ASSERT(out_file != NULL);
+	gs_db *db = gs_db_load(file);
+	if(db == NULL) {
+		return -1;
+	}
+	// Write to a temporary file and rename it, so that instances which have
+	// the previous version mapped or reload it concurrently are not affected
+	size_t tmp_len = strlen(out_file) + 5;
+	char *tmp_file = XCALLOC(tmp_len, sizeof(char));
+	snprintf(tmp_file, tmp_len, "%s.tmp", out_file);
+	int ret = -1;
+	int fd = open(tmp_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0) {
+		fprintf(stderr, "Could not open %s: %s\n", tmp_file, strerror(errno));
+		goto end;
+	}
+	size_t written = 0;
+	while(written < db->len) {
+		ssize_t len = write(fd, db->buf + written, db->len - written);
+		if(len < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "Could not write %s: %s\n", tmp_file, strerror(errno));
+			close(fd);
+			unlink(tmp_file);
+			goto end;
+		}
+		written += (size_t)len;
+	}
+	if(close(fd) < 0 || rename(tmp_file, out_file) < 0) {
+		fprintf(stderr, "Could not write %s: %s\n", out_file, strerror(errno));
+		unlink(tmp_file);
+		goto end;
+	}
+	fprintf(stderr, "%s: %u entries written\n", out_file, db->count);
+	ret = 0;
+end:
+	XFREE(tmp_file);
+	gs_db_destroy(db);
 	return ret;
 }
 
-gs_data_entry *gs_data_entry_lookup(uint32_t addr) {
-	if(gs_data == NULL) {
+gs_data_entry *gs_data_entry_lookup(uint32_t addr, gs_data_entry *result) {
+	ASSERT(result != NULL);
+	pthread_mutex_lock(&gs_data_mutex);
+	gs_db *db = gs_data;
+	if(db != NULL) {
+		atomic_fetch_add(&db->refcnt, 1);
+	}
+	pthread_mutex_unlock(&gs_data_mutex);
+	if(db == NULL) {
+		return NULL;
+	}
+	uint32_t lo = 0, hi = db->count;
+	while(lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		if(get_le32(db->records + (size_t)mid * GS_DB_RECORD_LEN) < addr) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	uint8_t const *rec = db->records + (size_t)lo * GS_DB_RECORD_LEN;
+	if(lo >= db->count || get_le32(rec) != addr) {
+		gs_db_release(db);
 		return NULL;
 	}
-	return la_hash_lookup(gs_data, &addr);
+	result->db = db;
+	result->airport_code = db->strings + get_le32(rec + 4);
+	result->details = db->strings + get_le32(rec + 8);
+	result->location = db->strings + get_le32(rec + 12);
+	return result;
+}
+
+// Drops the reference to the database held by an entry returned by
+// gs_data_entry_lookup()
+void gs_data_entry_release(gs_data_entry *e) {
+	if(e != NULL) {
+		gs_db_release(e->db);
+		e->db = NULL;
+	}
 }
@@ -19,14 +19,22 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+struct gs_db;
+
+// Strings of entries returned by gs_data_entry_lookup() point into the
+// database, which is kept alive until gs_data_entry_release() is called
 typedef struct {
-	char *airport_code;
-	char *details;
-	char *location;
+	struct gs_db *db;           // private
+	char const *airport_code;
+	char const *details;
+	char const *location;
 } gs_data_entry;
 
 // gs-file.c
 uint32_t uint_hash(void const *key);
 bool uint_compare(void const *key1, void const *key2);
 int gs_data_import(char const *file);
-gs_data_entry *gs_data_entry_lookup(uint32_t addr);
+int gs_data_compile(char const *file, char const *out_file);
+void gs_data_reload_request();
+gs_data_entry *gs_data_entry_lookup(uint32_t addr, gs_data_entry *result);
+void gs_data_entry_release(gs_data_entry *e);
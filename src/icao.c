@@ -42,6 +42,7 @@
 #include "asn1/ADSPositiveAcknowledgement.h"
 #include "asn1/ADSRequestContract.h"
 #include "dumpvdl2.h"
+#include "bench.h"                      // bench_layer_*
 #include "asn1-util.h"                  // asn1_decode_as(), asn1_pdu_destroy(), asn1_pdu_t, proto_DEF_asn1_pdu
 #include "asn1-format-icao.h"           // asn1_*_formatter_table, asn1_*_formatter_table_len
 #include "icao.h"
@@ -624,6 +625,7 @@ la_type_descriptor const proto_DEF_x225_spdu = {
 *********************************************************************************/
 
 la_proto_node *icao_apdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type) {
+	uint64_t t = bench_layer_start(BENCH_LAYER_ICAO, BENCH_OP_PARSE);
 	la_proto_node *node = NULL;
 	if(len < 1) {
 		debug_print(D_PROTO, "APDU too short (len: %u)\n", len);
@@ -654,6 +656,7 @@ la_proto_node *icao_apdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type) {
 		}
 	}
 end:
+	bench_layer_end(t);
 	return node ? node : unknown_proto_pdu_new(buf, len);
 }
 
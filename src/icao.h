@@ -33,4 +33,9 @@ typedef struct {
 #define ICAO_APP_TYPE_UNKNOWN	-1
 
 // icao.c
+extern la_type_descriptor const proto_DEF_x225_spdu;
+extern la_type_descriptor const proto_DEF_x227_acse_apdu;
+extern la_type_descriptor const proto_DEF_cpdlc;
+extern la_type_descriptor const proto_DEF_cm;
+extern la_type_descriptor const proto_DEF_adsc_v2;
 la_proto_node *icao_apdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type);
@@ -28,6 +28,7 @@
 #include <libacars/list.h>      // la_list
 #include "idrp.h"
 #include "dumpvdl2.h"
+#include "bench.h"              // bench_layer_*
 #include "tlv.h"
 #include "atn.h"                // atn_sec_label_parse, atn_sec_label_format_text
 #include "x25.h"                // SN_PROTO_CLNP
@@ -859,6 +860,7 @@ static int parse_idrp_error_pdu(idrp_pdu_t *pdu, uint8_t *buf, uint32_t len) {
 }
 
 la_proto_node *idrp_pdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type) {
+	uint64_t t = bench_layer_start(BENCH_LAYER_IDRP, BENCH_OP_PARSE);
 	NEW(idrp_pdu_t, pdu);
 	la_proto_node *node = la_proto_node_new();
 	node->td = &proto_DEF_idrp_pdu;
@@ -919,9 +921,11 @@ la_proto_node *idrp_pdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type) {
 
 	pdu->hdr = hdr;
 	pdu->err = false;
+	bench_layer_end(t);
 	return node;
 end:
 	node->next = unknown_proto_pdu_new(buf, len);
+	bench_layer_end(t);
 	return node;
 }
 
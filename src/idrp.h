@@ -67,4 +67,5 @@ typedef struct {
 } idrp_pdu_t;
 
 // idrp.c
+extern la_type_descriptor const proto_DEF_idrp_pdu;
 la_proto_node *idrp_pdu_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type);
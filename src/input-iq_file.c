@@ -0,0 +1,180 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>                  // fprintf, perror
+#include <string.h>                 // strcmp
+#include <errno.h>                  // errno
+#include <inttypes.h>               // PRIu64
+#include <time.h>                   // clock_gettime
+#include <unistd.h>                 // read, close, lseek
+#include <fcntl.h>                  // open, posix_fadvise
+#include <glib.h>                   // GAsyncQueue, g_async_queue_*
+#include "dumpvdl2.h"               // FILE_BUFSIZE, vdl2_state_t, do_exit, start_thread
+
+// Number of buffers circulating between the reader thread and the sample converter
+#define IQ_FILE_NUM_CHUNKS 4
+// How long (in microseconds) a thread waits for a chunk before checking do_exit
+#define IQ_FILE_POP_TIMEOUT 100000
+
+typedef struct {
+	uint8_t *buf;
+	size_t len;
+} iq_file_chunk_t;
+
+typedef struct {
+	int fd;
+	uint32_t passes_left;               // number of times the file is yet to be read after the current pass
+	GAsyncQueue *free_chunks;
+	GAsyncQueue *full_chunks;
+} iq_file_reader_t;
+
+// Reads the input file into chunks of FILE_BUFSIZE octets, so that the I/O
+// overlaps with sample conversion and demodulation. Short chunk means EOF.
+// When the file is to be read more than once, it's rewound on EOF and the
+// chunk is filled up with data from the beginning of the file.
+// On shutdown the consumer stops returning chunks, so the wait for a free
+// chunk is bounded and do_exit is checked in between.
+static void *iq_file_reader_thread(void *arg) {
+	ASSERT(arg != NULL);
+	iq_file_reader_t *r = arg;
+	iq_file_chunk_t *chunk = NULL;
+	while(do_exit == 0) {
+		chunk = g_async_queue_timeout_pop(r->free_chunks, IQ_FILE_POP_TIMEOUT);
+		if(chunk == NULL) {
+			continue;
+		}
+		chunk->len = 0;
+		while(chunk->len < FILE_BUFSIZE && do_exit == 0) {
+			ssize_t ret = read(r->fd, chunk->buf + chunk->len, FILE_BUFSIZE - chunk->len);
+			if(ret < 0) {
+				if(errno == EINTR) {
+					continue;
+				}
+				perror("Error while reading input file");
+				break;
+			} else if(ret == 0) {
+				if(r->passes_left == 0) {
+					break;
+				}
+				if(lseek(r->fd, 0, SEEK_SET) < 0) {
+					perror("Could not rewind input file");
+					break;
+				}
+				r->passes_left--;
+				continue;
+			}
+			chunk->len += (size_t)ret;
+		}
+		g_async_queue_push(r->full_chunks, chunk);
+		if(chunk->len < FILE_BUFSIZE) {
+			break;
+		}
+	}
+	return NULL;
+}
+
+void input_iq_file_process(vdl2_state_t *ctx, char const *path, enum sample_formats sfmt, uint32_t sample_rate,
+		uint32_t repeat) {
+	ASSERT(ctx != NULL);
+	ASSERT(path != NULL);
+	ASSERT(repeat > 0);
+	int fd = -1;
+	if(!strcmp(path, "-")) {
+		fd = STDIN_FILENO;
+	} else {
+		fd = open(path, O_RDONLY);
+	}
+	if(fd < 0) {
+		perror("Could not open input file");
+		_exit(2);
+	}
+	// Let the kernel read ahead aggressively. This fails harmlessly on pipes.
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	convert_buf_func *convert_buf = sample_format_converter(sfmt);
+	if(convert_buf == NULL) {
+		fprintf(stderr, "Unsupported sample format\n");
+		_exit(5);
+	}
+	uint32_t sample_size = sample_format_size(sfmt);
+	// Two sample buffers - one is being demodulated while the other one is being filled.
+	// A chunk of FILE_BUFSIZE octets never converts to more than FILE_BUFSIZE floats.
+	ctx->sbuf = XCALLOC(FILE_BUFSIZE, sizeof(float));
+	float *next_sbuf = XCALLOC(FILE_BUFSIZE, sizeof(float));
+
+	iq_file_reader_t reader = {
+		.fd = fd,
+		.passes_left = repeat - 1,
+		.free_chunks = g_async_queue_new(),
+		.full_chunks = g_async_queue_new()
+	};
+	iq_file_chunk_t chunks[IQ_FILE_NUM_CHUNKS];
+	for(int i = 0; i < IQ_FILE_NUM_CHUNKS; i++) {
+		chunks[i].buf = XCALLOC(FILE_BUFSIZE, sizeof(uint8_t));
+		g_async_queue_push(reader.free_chunks, &chunks[i]);
+	}
+
+	struct timespec t_start, t_end;
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+	pthread_t reader_thread;
+	start_thread(&reader_thread, iq_file_reader_thread, &reader);
+
+	uint64_t octets = 0;
+	while(do_exit == 0) {
+		// The reader might have quit on do_exit without pushing a short chunk,
+		// so don't wait for it indefinitely
+		iq_file_chunk_t *chunk = g_async_queue_timeout_pop(reader.full_chunks, IQ_FILE_POP_TIMEOUT);
+		if(chunk == NULL) {
+			continue;
+		}
+		size_t len = chunk->len;
+		uint32_t cnt = (*convert_buf)(chunk->buf, (uint32_t)len, next_sbuf);
+		g_async_queue_push(reader.free_chunks, chunk);
+		if(cnt > 0) {
+			next_sbuf = demod_swap_sample_buffer(ctx, next_sbuf, cnt);
+		}
+		octets += len;
+		if(len < FILE_BUFSIZE) {
+			break;
+		}
+	}
+
+	pthread_join(reader_thread, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &t_end);
+	double elapsed = (double)(t_end.tv_sec - t_start.tv_sec) +
+		(double)(t_end.tv_nsec - t_start.tv_nsec) / 1e9;
+	uint64_t samples = octets / sample_size;
+	if(elapsed > 0.0 && sample_rate > 0) {
+		fprintf(stderr, "Processed %" PRIu64 " samples in %.3f seconds (%.0f samples/sec, %.2fx realtime)\n",
+				samples, elapsed, (double)samples / elapsed,
+				(double)samples / (double)sample_rate / elapsed);
+	}
+
+	if(fd != STDIN_FILENO) {
+		close(fd);
+	}
+	// The current sbuf might be still in use by demodulators, so it's not freed here
+	XFREE(next_sbuf);
+	for(int i = 0; i < IQ_FILE_NUM_CHUNKS; i++) {
+		XFREE(chunks[i].buf);
+	}
+	g_async_queue_unref(reader.free_chunks);
+	g_async_queue_unref(reader.full_chunks);
+}
@@ -0,0 +1,501 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Network I/Q input. Supported sources:
+ * - rtl_tcp://host:port - rtl_tcp server. It gets tuned to the center
+ *   frequency, sampling rate, gain and correction configured for this input.
+ * - tcp://host:port - a server sending raw I/Q samples as soon as the
+ *   connection is established.
+ * - udp://[address:]port - raw I/Q samples sent as UDP datagrams to the given
+ *   local port. Each datagram must contain a whole number of samples.
+ *
+ * Data is received by a separate thread into a pool of chunks which serves as
+ * a jitter buffer between the network and the demodulators. The reader never
+ * waits for the demodulators - if they fall behind and the pool runs out, the
+ * oldest chunk waiting for demodulation is dropped and reused. Chunks carry
+ * sequence numbers. Whenever samples are lost (due to a dropped chunk,
+ * a reconnection or datagrams dropped by the kernel), the numbering skips,
+ * and the demodulators are reset before processing the next chunk, instead
+ * of demodulating across the gap.
+ */
+
+#include <stdint.h>
+#include <stdio.h>                  // fprintf, perror
+#include <stdlib.h>                 // free
+#include <string.h>                 // strncmp, strrchr, strdup, strerror
+#include <errno.h>                  // errno
+#include <inttypes.h>               // PRIu64
+#include <unistd.h>                 // read, write, close, usleep
+#include <poll.h>                   // poll
+#include <sys/types.h>              // socket
+#include <sys/socket.h>             // socket, connect, bind, recvmsg, setsockopt
+#include <netdb.h>                  // getaddrinfo
+#include <arpa/inet.h>              // htonl
+#include <glib.h>                   // GAsyncQueue, g_async_queue_*
+#include "dumpvdl2.h"               // vdl2_state_t, do_exit, start_thread
+
+// Size of a single chunk. Must be a multiple of the largest sample size.
+#define IQ_NET_CHUNK_SIZE (256U * 1024U)
+// Number of chunks in the pool. This is 8 MB which is about 2 seconds
+// of 8-bit samples at 2 Msps.
+#define IQ_NET_NUM_CHUNKS 32
+// Max length of a UDP datagram payload
+#define IQ_NET_MAX_DATAGRAM 65536U
+// Interval of do_exit checks while waiting for data (ms)
+#define IQ_NET_POLL_TIMEOUT 500
+// Delay between connection attempts (seconds)
+#define IQ_NET_RECONNECT_DELAY 2
+#define IQ_NET_UDP_RCVBUF (4 * 1024 * 1024)
+
+// rtl_tcp protocol
+#define RTL_TCP_MAGIC "RTL0"
+#define RTL_TCP_HEADER_LEN 12
+#define RTL_TCP_SET_FREQ 0x01
+#define RTL_TCP_SET_SAMPLE_RATE 0x02
+#define RTL_TCP_SET_GAIN_MODE 0x03
+#define RTL_TCP_SET_GAIN 0x04
+#define RTL_TCP_SET_FREQ_CORRECTION 0x05
+#define RTL_TCP_SET_AGC_MODE 0x08
+
+enum iq_net_proto { IQ_NET_RTL_TCP, IQ_NET_TCP, IQ_NET_UDP };
+
+typedef struct {
+	uint8_t *buf;
+	size_t len;
+	uint64_t seq;
+} iq_net_chunk_t;
+
+typedef struct {
+	enum iq_net_proto proto;
+	char *url;                          // for messages
+	char *host;                         // NULL = any (udp only)
+	char *port;
+	uint32_t centerfreq, sample_rate;
+	float gain;
+	int correction;
+	int fd;
+	int idle_timeout;                   // seconds without data before reconnecting (0 = never)
+	GAsyncQueue *free_chunks;
+	GAsyncQueue *full_chunks;
+	uint64_t next_seq;                  // sequence number of the next chunk pushed
+	uint32_t kernel_drops;              // datagrams dropped by the kernel so far
+	bool overrun;                       // currently dropping chunks
+} iq_net_reader_t;
+
+static int iq_net_parse_url(iq_net_reader_t *r, char const *url) {
+	static struct {
+		char const *prefix;
+		enum iq_net_proto proto;
+	} const schemes[] = {
+		{ "rtl_tcp://", IQ_NET_RTL_TCP },
+		{ "tcp://", IQ_NET_TCP },
+		{ "udp://", IQ_NET_UDP },
+	};
+	char const *addr = NULL;
+	for(size_t i = 0; i < sizeof(schemes) / sizeof(schemes[0]); i++) {
+		size_t len = strlen(schemes[i].prefix);
+		if(!strncmp(url, schemes[i].prefix, len)) {
+			r->proto = schemes[i].proto;
+			addr = url + len;
+			break;
+		}
+	}
+	if(addr == NULL) {
+		fprintf(stderr, "%s: unknown protocol (must be one of: rtl_tcp, tcp, udp)\n", url);
+		return -1;
+	}
+	r->host = strdup(addr);
+	char *colon = strrchr(r->host, ':');
+	if(colon == NULL) {
+		if(r->proto != IQ_NET_UDP) {
+			fprintf(stderr, "%s: port number not specified\n", url);
+			return -1;
+		}
+		r->port = r->host;
+		r->host = NULL;
+		return 0;
+	}
+	*colon = '\0';
+	r->port = strdup(colon + 1);
+	// IPv6 literal in square brackets
+	size_t alen = strlen(r->host);
+	if(alen >= 2 && r->host[0] == '[' && r->host[alen - 1] == ']') {
+		r->host[alen - 1] = '\0';
+		memmove(r->host, r->host + 1, alen - 1);
+	}
+	if(r->host[0] == '\0') {
+		if(r->proto != IQ_NET_UDP) {
+			fprintf(stderr, "%s: host name not specified\n", url);
+			return -1;
+		}
+		XFREE(r->host);
+	}
+	return 0;
+}
+
+static int write_all(int fd, uint8_t const *buf, size_t len) {
+	while(len > 0) {
+		ssize_t ret = write(fd, buf, len);
+		if(ret < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		buf += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+// Reads exactly len octets, waiting at most IQ_NET_POLL_TIMEOUT for each part
+static int read_all(int fd, uint8_t *buf, size_t len) {
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	while(len > 0) {
+		if(poll(&pfd, 1, IQ_NET_POLL_TIMEOUT) <= 0) {
+			return -1;
+		}
+		ssize_t ret = read(fd, buf, len);
+		if(ret < 0 && errno == EINTR) {
+			continue;
+		} else if(ret <= 0) {
+			return -1;
+		}
+		buf += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+static int rtl_tcp_command(int fd, uint8_t cmd, uint32_t param) {
+	uint8_t buf[5];
+	buf[0] = cmd;
+	uint32_t param_be = htonl(param);
+	memcpy(buf + 1, &param_be, sizeof(param_be));
+	return write_all(fd, buf, sizeof(buf));
+}
+
+static int rtl_tcp_setup(iq_net_reader_t *r) {
+	uint8_t hdr[RTL_TCP_HEADER_LEN];
+	if(read_all(r->fd, hdr, sizeof(hdr)) < 0 || memcmp(hdr, RTL_TCP_MAGIC, strlen(RTL_TCP_MAGIC)) != 0) {
+		fprintf(stderr, "%s: did not receive rtl_tcp header, is it an rtl_tcp server?\n", r->url);
+		return -1;
+	}
+	uint32_t tuner_type;
+	memcpy(&tuner_type, hdr + 4, sizeof(tuner_type));
+	debug_print(D_MISC, "rtl_tcp tuner type: %u\n", ntohl(tuner_type));
+	// rtl_tcp does not respond to commands, so all we can do is to check
+	// if they have been sent successfully
+	int ret = rtl_tcp_command(r->fd, RTL_TCP_SET_SAMPLE_RATE, r->sample_rate);
+	ret |= rtl_tcp_command(r->fd, RTL_TCP_SET_FREQ, r->centerfreq);
+	ret |= rtl_tcp_command(r->fd, RTL_TCP_SET_FREQ_CORRECTION, (uint32_t)r->correction);
+	ret |= rtl_tcp_command(r->fd, RTL_TCP_SET_AGC_MODE, 0);
+	if(r->gain == SDR_AUTO_GAIN) {
+		ret |= rtl_tcp_command(r->fd, RTL_TCP_SET_GAIN_MODE, 0);
+	} else {
+		ret |= rtl_tcp_command(r->fd, RTL_TCP_SET_GAIN_MODE, 1);
+		ret |= rtl_tcp_command(r->fd, RTL_TCP_SET_GAIN, (uint32_t)(int)(r->gain * 10.0f));
+	}
+	if(ret < 0) {
+		fprintf(stderr, "%s: could not configure rtl_tcp server: %s\n", r->url, strerror(errno));
+		return -1;
+	}
+	fprintf(stderr, "%s: center frequency: %u Hz, sampling rate: %u sps, gain: ", r->url,
+			r->centerfreq, r->sample_rate);
+	if(r->gain == SDR_AUTO_GAIN) {
+		fprintf(stderr, "auto\n");
+	} else {
+		fprintf(stderr, "%.1f dB\n", r->gain);
+	}
+	return 0;
+}
+
+static int iq_net_open(iq_net_reader_t *r) {
+	struct addrinfo hints, *result = NULL, *rptr;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	if(r->proto == IQ_NET_UDP) {
+		hints.ai_socktype = SOCK_DGRAM;
+		hints.ai_flags = AI_PASSIVE;
+	} else {
+		hints.ai_socktype = SOCK_STREAM;
+	}
+	int ret = getaddrinfo(r->host, r->port, &hints, &result);
+	if(ret != 0) {
+		fprintf(stderr, "%s: could not resolve address: %s\n", r->url, gai_strerror(ret));
+		return -1;
+	}
+	int fd = -1;
+	for(rptr = result; rptr != NULL; rptr = rptr->ai_next) {
+		fd = socket(rptr->ai_family, rptr->ai_socktype, rptr->ai_protocol);
+		if(fd == -1) {
+			continue;
+		}
+		if(r->proto == IQ_NET_UDP) {
+			int rcvbuf = IQ_NET_UDP_RCVBUF;
+			setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+#ifdef SO_RXQ_OVFL
+			int one = 1;
+			setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one));
+#endif
+			if(bind(fd, rptr->ai_addr, rptr->ai_addrlen) == 0) {
+				break;
+			}
+		} else if(connect(fd, rptr->ai_addr, rptr->ai_addrlen) == 0) {
+			break;
+		}
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(result);
+	if(fd < 0) {
+		fprintf(stderr, "%s: could not %s: %s\n", r->url,
+				r->proto == IQ_NET_UDP ? "bind socket" : "connect", strerror(errno));
+		return -1;
+	}
+	r->fd = fd;
+	if(r->proto == IQ_NET_RTL_TCP && rtl_tcp_setup(r) < 0) {
+		close(r->fd);
+		r->fd = -1;
+		return -1;
+	}
+	fprintf(stderr, "%s: %s\n", r->url, r->proto == IQ_NET_UDP ? "listening" : "connected");
+	return 0;
+}
+
+static void iq_net_close(iq_net_reader_t *r) {
+	if(r->fd >= 0) {
+		close(r->fd);
+		r->fd = -1;
+	}
+}
+
+// Returns the number of octets received, 0 on timeout, -1 when the connection
+// is gone. Sets *gap if datagrams have been dropped by the kernel before the
+// one just received.
+static ssize_t iq_net_receive(iq_net_reader_t *r, uint8_t *buf, size_t len, bool *gap) {
+	*gap = false;
+	struct pollfd pfd = { .fd = r->fd, .events = POLLIN };
+	int ret = poll(&pfd, 1, IQ_NET_POLL_TIMEOUT);
+	if(ret < 0) {
+		return errno == EINTR ? 0 : -1;
+	} else if(ret == 0) {
+		return 0;
+	}
+	if(r->proto != IQ_NET_UDP) {
+		ssize_t result = read(r->fd, buf, len);
+		if(result < 0 && errno == EINTR) {
+			return 0;
+		} else if(result == 0) {
+			fprintf(stderr, "%s: connection closed by peer\n", r->url);
+			return -1;
+		} else if(result < 0) {
+			fprintf(stderr, "%s: read error: %s\n", r->url, strerror(errno));
+		}
+		return result;
+	}
+
+	struct iovec iov = { .iov_base = buf, .iov_len = len };
+	struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+#ifdef SO_RXQ_OVFL
+	char cbuf[CMSG_SPACE(sizeof(uint32_t))];
+	msg.msg_control = cbuf;
+	msg.msg_controllen = sizeof(cbuf);
+#endif
+	ssize_t result = recvmsg(r->fd, &msg, 0);
+	if(result < 0) {
+		return errno == EINTR ? 0 : -1;
+	}
+#ifdef SO_RXQ_OVFL
+	for(struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c != NULL; c = CMSG_NXTHDR(&msg, c)) {
+		if(c->cmsg_level == SOL_SOCKET && c->cmsg_type == SO_RXQ_OVFL) {
+			uint32_t drops;
+			memcpy(&drops, CMSG_DATA(c), sizeof(drops));
+			if(drops != r->kernel_drops) {
+				fprintf(stderr, "%s: %u datagram(s) dropped by the kernel\n",
+						r->url, drops - r->kernel_drops);
+				r->kernel_drops = drops;
+				*gap = true;
+			}
+		}
+	}
+#endif
+	return result;
+}
+
+// Returns a chunk to be filled. If the pool is exhausted, takes over
+// the oldest chunk waiting for demodulation.
+static iq_net_chunk_t *iq_net_chunk_get(iq_net_reader_t *r) {
+	iq_net_chunk_t *chunk = g_async_queue_try_pop(r->free_chunks);
+	if(chunk == NULL) {
+		chunk = g_async_queue_try_pop(r->full_chunks);
+		if(chunk == NULL) {
+			// The consumer has just taken the last one. It will return it shortly.
+			chunk = g_async_queue_pop(r->free_chunks);
+		} else if(!r->overrun) {
+			fprintf(stderr, "%s: demodulators can't keep up, dropping samples\n", r->url);
+			r->overrun = true;
+		}
+	} else {
+		r->overrun = false;
+	}
+	chunk->len = 0;
+	return chunk;
+}
+
+static void *iq_net_reader_thread(void *arg) {
+	ASSERT(arg != NULL);
+	iq_net_reader_t *r = arg;
+	iq_net_chunk_t *chunk = iq_net_chunk_get(r);
+	// UDP chunks are pushed when there is no room for another datagram,
+	// TCP chunks - when they are full
+	size_t const room_needed = r->proto == IQ_NET_UDP ? IQ_NET_MAX_DATAGRAM : 1;
+	bool connected_before = false;
+	// A TCP peer which stops sending without closing the connection is
+	// detected by counting consecutive poll timeouts
+	int idle_polls = 0;
+	int const max_idle_polls = r->proto == IQ_NET_UDP ? 0 :
+		r->idle_timeout * 1000 / IQ_NET_POLL_TIMEOUT;
+	while(do_exit == 0) {
+		if(r->fd < 0) {
+			if(iq_net_open(r) < 0) {
+				for(int i = 0; i < IQ_NET_RECONNECT_DELAY * 10 && do_exit == 0; i++) {
+					usleep(100000);
+				}
+				continue;
+			}
+			if(connected_before) {
+				// Whatever has been received before the reconnection can't be
+				// continued with the new stream
+				chunk->len = 0;
+				r->next_seq++;
+			}
+			connected_before = true;
+			idle_polls = 0;
+		}
+		bool gap = false;
+		ssize_t ret = iq_net_receive(r, chunk->buf + chunk->len, IQ_NET_CHUNK_SIZE - chunk->len, &gap);
+		if(ret < 0) {
+			iq_net_close(r);
+			continue;
+		} else if(ret == 0) {
+			if(max_idle_polls > 0 && ++idle_polls >= max_idle_polls) {
+				fprintf(stderr, "%s: no data for %d seconds, reconnecting\n", r->url, r->idle_timeout);
+				iq_net_close(r);
+			}
+			continue;
+		}
+		idle_polls = 0;
+		if(gap) {
+			// The datagram has been appended to the samples received before
+			// the drop. Push them out as a separate chunk and move the
+			// datagram to a new one, so that the gap falls between them.
+			if(chunk->len > 0) {
+				iq_net_chunk_t *next = iq_net_chunk_get(r);
+				memcpy(next->buf, chunk->buf + chunk->len, (size_t)ret);
+				chunk->seq = r->next_seq++;
+				g_async_queue_push(r->full_chunks, chunk);
+				chunk = next;
+			}
+			r->next_seq++;              // announce the gap
+		}
+		chunk->len += (size_t)ret;
+		if(IQ_NET_CHUNK_SIZE - chunk->len < room_needed) {
+			chunk->seq = r->next_seq++;
+			g_async_queue_push(r->full_chunks, chunk);
+			chunk = iq_net_chunk_get(r);
+		}
+	}
+	iq_net_close(r);
+	g_async_queue_push(r->free_chunks, chunk);
+	return NULL;
+}
+
+void input_iq_net_process(vdl2_state_t *ctx, char const *url, enum sample_formats sfmt,
+		uint32_t centerfreq, uint32_t sample_rate, float gain, int correction, int idle_timeout) {
+	ASSERT(ctx != NULL);
+	ASSERT(url != NULL);
+	iq_net_reader_t reader = {
+		.url = strdup(url),
+		.centerfreq = centerfreq,
+		.sample_rate = sample_rate,
+		.gain = gain,
+		.correction = correction,
+		.idle_timeout = idle_timeout,
+		.fd = -1
+	};
+	if(iq_net_parse_url(&reader, url) < 0) {
+		_exit(1);
+	}
+	if(reader.proto == IQ_NET_RTL_TCP && sfmt != SFMT_U8) {
+		fprintf(stderr, "%s: rtl_tcp supports only U8 sample format\n", url);
+		_exit(1);
+	}
+
+	convert_buf_func *convert_buf = sample_format_converter(sfmt);
+	if(convert_buf == NULL) {
+		fprintf(stderr, "Unsupported sample format\n");
+		_exit(5);
+	}
+	// Two sample buffers - one is being demodulated while the other one is being filled
+	ctx->sbuf = XCALLOC(IQ_NET_CHUNK_SIZE, sizeof(float));
+	float *next_sbuf = XCALLOC(IQ_NET_CHUNK_SIZE, sizeof(float));
+
+	reader.free_chunks = g_async_queue_new();
+	reader.full_chunks = g_async_queue_new();
+	iq_net_chunk_t chunks[IQ_NET_NUM_CHUNKS];
+	for(int i = 0; i < IQ_NET_NUM_CHUNKS; i++) {
+		chunks[i].buf = XCALLOC(IQ_NET_CHUNK_SIZE, sizeof(uint8_t));
+		g_async_queue_push(reader.free_chunks, &chunks[i]);
+	}
+	pthread_t reader_thread;
+	start_thread(&reader_thread, iq_net_reader_thread, &reader);
+
+	uint64_t expected_seq = 0;
+	while(do_exit == 0) {
+		iq_net_chunk_t *chunk = g_async_queue_timeout_pop(reader.full_chunks,
+				IQ_NET_POLL_TIMEOUT * 1000);
+		if(chunk == NULL) {
+			continue;
+		}
+		if(chunk->seq != expected_seq) {
+			debug_print(D_MISC, "%s: expected chunk %" PRIu64 ", got %" PRIu64 "\n",
+					url, expected_seq, chunk->seq);
+			demod_mark_discontinuity(ctx);
+		}
+		expected_seq = chunk->seq + 1;
+		uint32_t cnt = (*convert_buf)(chunk->buf, (uint32_t)chunk->len, next_sbuf);
+		g_async_queue_push(reader.free_chunks, chunk);
+		if(cnt > 0) {
+			next_sbuf = demod_swap_sample_buffer(ctx, next_sbuf, cnt);
+		}
+	}
+
+	pthread_join(reader_thread, NULL);
+	// The current sbuf might be still in use by demodulators, so it's not freed here
+	XFREE(next_sbuf);
+	for(int i = 0; i < IQ_NET_NUM_CHUNKS; i++) {
+		XFREE(chunks[i].buf);
+	}
+	g_async_queue_unref(reader.free_chunks);
+	g_async_queue_unref(reader.full_chunks);
+	XFREE(reader.url);
+	XFREE(reader.host);
+	XFREE(reader.port);
+}
@@ -0,0 +1,443 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Synthetic VDL2 signal generator (--iq-synth).
+ * Produces I/Q samples carrying VDL2 bursts on all channels configured for the
+ * input, buried in white Gaussian noise, and hands them over to demodulators
+ * like any other input does. Each burst carries a single AVLC frame with an
+ * ACARS downlink message from a random aircraft.
+ * The transmitter mirrors the receiver: the frame is turned into bits by
+ * encode_vdl2_burst(), preceded by ramp-up and synchronization symbols,
+ * D8PSK modulated and shaped with a raised cosine filter.
+ * The signal depends only on the parameters and the random seed, so the
+ * results are reproducible. Message contents and burst timing do not depend
+ * on the noise level, so runs with different SNR values carry the same traffic.
+ */
+
+#include <stdint.h>
+#include <stdio.h>                  // fprintf, snprintf
+#include <stdlib.h>                 // strtod
+#include <string.h>                 // strdup, memcpy
+#include <inttypes.h>               // PRIu64
+#include <math.h>                   // sqrt, log, pow, sin, cos, fabs, fmax
+#include <unistd.h>                 // _exit
+#include "dumpvdl2.h"               // vdl2_state_t, bitstream_*, reverse, do_exit
+#include "decode.h"                 // encode_vdl2_burst
+#include "kvargs.h"                 // kvargs_*
+#include "metrics.h"                // metrics_channel_*
+
+// Number of floats in a sample buffer passed to demodulators
+#define IQ_SYNTH_BUFSIZE 320000U
+// Length of the precomputed noise table (complex samples)
+#define NOISE_TABLE_LEN (1U << 20)
+// Signal amplitude of a single channel
+#define SIGNAL_AMPLITUDE 0.1
+// Raised cosine filter roll-off factor and length (in symbols, on each side)
+#define RC_ALPHA 0.6
+#define RC_SPAN 4
+// Pulse shape table resolution (points per symbol)
+#define RC_RES 32
+#define RAMP_UP_SYMS 5
+#define RAMP_DOWN_SYMS 3
+#define MAX_BURST_BITS 32768U
+#define MAX_BURST_SYMS (RAMP_UP_SYMS + PREAMBLE_SYMS + MAX_BURST_BITS / BPS + 1 + RAMP_DOWN_SYMS)
+// Max length of ACARS message text
+#define MSG_LEN_MAX 220
+// Max AVLC frame length: addresses, LCF, ACARS header and trailer, text, FCS
+#define FRAME_LEN_MAX (9 + 3 + 27 + MSG_LEN_MAX + 2)
+// Size of the pool of simulated aircraft
+#define AIRCRAFT_CNT 64
+
+// Synchronization sequence (ramp-up is followed by this) as 3-bit groups
+static uint8_t const preamble[PREAMBLE_SYMS] = {
+	0b000, 0b010, 0b011, 0b110, 0b000, 0b001, 0b101, 0b110,
+	0b001, 0b100, 0b011, 0b111, 0b101, 0b111, 0b100, 0b010
+};
+
+// Reverse of the Gray code table in demod() - phase increment (in pi/4 units)
+// for each 3-bit group
+static uint8_t const phase_incr[1 << BPS] = { 0, 1, 3, 2, 7, 6, 4, 5 };
+
+typedef struct {
+	uint64_t duration;                  // signal length in samples
+	double burst_rate;                  // average bursts per second per channel
+	double snr;                         // Es/N0, dB
+	double freq_offset;                 // max carrier frequency offset, Hz
+	uint32_t msg_len;                   // ACARS message text length
+	uint64_t seed;
+} iq_synth_params_t;
+
+typedef struct {
+	double freq;                        // channel offset from the center frequency, Hz
+	double next_burst;                  // start time of the next burst, samples
+	// burst being transmitted
+	bool active;
+	double start;                       // burst start time, samples
+	uint64_t end;                       // first sample after the burst
+	uint64_t pos;                       // next sample to generate
+	uint32_t num_syms;
+	float *sym_re, *sym_im;             // symbols, scaled to the signal amplitude
+	double rot_re, rot_im;              // carrier phasor at pos
+	double step_re, step_im;            // carrier phasor increment per sample
+} iq_synth_channel_t;
+
+typedef struct {
+	iq_synth_params_t p;
+	uint32_t sample_rate;
+	double sps;                         // samples per symbol
+	uint64_t traffic_rng, noise_rng;
+	iq_synth_channel_t *channels;
+	int num_channels;
+	float rc[2 * RC_SPAN * RC_RES + 2];
+	float *noise;                       // NOISE_TABLE_LEN interleaved I/Q values, scaled
+	bitstream_t *bs;
+	uint64_t bursts;
+} iq_synth_t;
+
+// xorshift64* generator - returns a number in the range [0, 1)
+static double rand_uniform(uint64_t *state) {
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return (double)((*state * 0x2545F4914F6CDD1DULL) >> 11) / (double)(1ULL << 53);
+}
+
+static double rc_pulse(double t) {
+	if(fabs(t) < 1e-9) {
+		return 1.0;
+	}
+	double sinc = sin(M_PI * t) / (M_PI * t);
+	double d = 2.0 * RC_ALPHA * t;
+	if(fabs(fabs(d) - 1.0) < 1e-9) {
+		return M_PI_4 * sinc;
+	}
+	return sinc * cos(M_PI * RC_ALPHA * t) / (1.0 - d * d);
+}
+
+static bool param_get(kvargs const *kv, char const *key, double min, double max, double *result) {
+	char *val = kvargs_get(kv, key);
+	if(val == NULL) {
+		return true;
+	}
+	char *endptr = NULL;
+	double d = strtod(val, &endptr);
+	if(endptr == val || *endptr != '\0' || d < min || d > max) {
+		fprintf(stderr, "--iq-synth: invalid %s value '%s' (allowed range: %g-%g)\n", key, val, min, max);
+		return false;
+	}
+	*result = d;
+	return true;
+}
+
+static int iq_synth_parse_params(char const *spec, uint32_t sample_rate, iq_synth_params_t *p) {
+	double duration = 10.0, msg_len = 100.0, seed = 1.0;
+	p->burst_rate = 10.0;
+	p->snr = 20.0;
+	p->freq_offset = 0.0;
+	char *copy = strdup(spec);
+	kvargs_parse_result r = kvargs_from_string(copy);
+	int ret = -1;
+	if(r.err != 0) {
+		fprintf(stderr, "--iq-synth: could not parse parameters at position %td: %s\n",
+				r.err_pos, kvargs_get_errstr(r.err));
+		XFREE(copy);
+		return -1;
+	}
+	if(!param_get(r.result, "duration", 0.1, 1e6, &duration) ||
+			!param_get(r.result, "burst-rate", 0.01, 1000.0, &p->burst_rate) ||
+			!param_get(r.result, "snr", -10.0, 100.0, &p->snr) ||
+			!param_get(r.result, "freq-offset", 0.0, 5000.0, &p->freq_offset) ||
+			!param_get(r.result, "msg-len", 0.0, MSG_LEN_MAX, &msg_len) ||
+			!param_get(r.result, "seed", 1.0, 4294967295.0, &seed)) {
+		goto end;
+	}
+	p->duration = (uint64_t)(duration * sample_rate);
+	p->msg_len = (uint32_t)msg_len;
+	p->seed = (uint64_t)seed;
+	ret = 0;
+end:
+	kvargs_destroy(r.result);
+	XFREE(copy);
+	return ret;
+}
+
+static void avlc_addr_put(uint8_t *buf, uint32_t addr, uint32_t type) {
+	// Reverse of parse_dlc_addr() (status bit set to 0)
+	uint32_t r = reverse((addr & ONES(24)) | (type << 24), 28);
+	for(int i = 0; i < 4; i++) {
+		buf[i] = ((r >> (7 * i)) & 0x7f) << 1;
+	}
+}
+
+static uint8_t odd_parity(uint8_t c) {
+	uint8_t p = c;
+	p ^= p >> 4;
+	p ^= p >> 2;
+	p ^= p >> 1;
+	return (p & 1) ? c : c | 0x80;
+}
+
+// Builds an AVLC I-frame carrying an ACARS downlink message.
+// Returns the frame length.
+static uint32_t iq_synth_frame(iq_synth_t *s, uint8_t *buf) {
+	uint32_t ac = (uint32_t)(rand_uniform(&s->traffic_rng) * AIRCRAFT_CNT);
+	uint32_t icao = 0x400000 + ac * 0x1234;
+	uint32_t len = 0;
+	avlc_addr_put(buf, 0x10f000 + ac % 8, 5);          // ground station (delegated address)
+	avlc_addr_put(buf + 4, icao, 1);                    // aircraft
+	buf[7] |= 0x01;                                     // end of address field
+	buf[8] = (uint8_t)(((s->bursts & 7) << 1) | ((s->bursts & 7) << 5));   // I-frame, N(S), N(R)
+	len = 9;
+	buf[len++] = 0xff;
+	buf[len++] = 0xff;
+	buf[len++] = 0x01;                                  // SOH
+	uint32_t acars_start = len;
+	char hdr[32];
+	// mode, registration, NAK, label, block ID, STX, message number, flight ID
+	int hdrlen = snprintf(hdr, sizeof(hdr), "2.N%05u\x15H13\x02M%02uASY%04u",
+			ac * 1000 % 100000, (unsigned)(s->bursts % 100), ac * 10);
+	memcpy(buf + len, hdr, (size_t)hdrlen);
+	len += (uint32_t)hdrlen;
+	for(uint32_t i = 0; i < s->p.msg_len; i++) {
+		buf[len++] = (uint8_t)(' ' + rand_uniform(&s->traffic_rng) * ('~' - ' '));
+	}
+	buf[len++] = 0x03;                                  // ETX
+	for(uint32_t i = acars_start; i < len; i++) {
+		buf[i] = odd_parity(buf[i]);
+	}
+	uint16_t bcs = crc16_ccitt(buf + acars_start, len - acars_start, 0);
+	buf[len++] = bcs & 0xff;
+	buf[len++] = bcs >> 8;
+	buf[len++] = 0x7f;                                  // DEL
+	uint16_t fcs = ~crc16_ccitt(buf, len, 0xFFFFu);
+	buf[len++] = fcs & 0xff;
+	buf[len++] = fcs >> 8;
+	return len;
+}
+
+static double exp_interval(iq_synth_t *s) {
+	return -log(1.0 - rand_uniform(&s->traffic_rng)) / s->p.burst_rate * s->sample_rate;
+}
+
+// Encodes and modulates a new burst for the channel.
+// Returns false if the burst wouldn't fit before the end of the signal.
+static bool iq_synth_burst_start(iq_synth_t *s, iq_synth_channel_t *ch) {
+	uint8_t frame[FRAME_LEN_MAX];
+	uint32_t len = iq_synth_frame(s, frame);
+	double phi = 2.0 * M_PI * rand_uniform(&s->traffic_rng);
+	double offset = s->p.freq_offset * (2.0 * rand_uniform(&s->traffic_rng) - 1.0);
+	// Bursts on a channel never overlap
+	ch->start = fmax(ch->next_burst, (double)ch->end);
+	ch->next_burst = ch->start + exp_interval(s);
+	if(encode_vdl2_burst(frame, len, s->bs) < 0) {
+		return false;
+	}
+	uint32_t n = 0;
+	uint8_t incr[MAX_BURST_SYMS];
+	for(int i = 0; i < RAMP_UP_SYMS; i++) {
+		incr[n++] = 0;
+	}
+	for(int i = 0; i < PREAMBLE_SYMS; i++) {
+		incr[n++] = phase_incr[preamble[i]];
+	}
+	while(s->bs->start < s->bs->end) {
+		uint8_t g = 0;
+		for(int i = 0; i < BPS; i++) {
+			g <<= 1;
+			if(s->bs->start < s->bs->end) {
+				g |= s->bs->buf[s->bs->start++];
+			}
+		}
+		incr[n++] = phase_incr[g];
+	}
+	for(int i = 0; i < RAMP_DOWN_SYMS; i++) {
+		incr[n++] = 0;
+	}
+	for(uint32_t i = 0; i < n; i++) {
+		phi += incr[i] * M_PI_4;
+		ch->sym_re[i] = (float)(SIGNAL_AMPLITUDE * cos(phi));
+		ch->sym_im[i] = (float)(SIGNAL_AMPLITUDE * sin(phi));
+	}
+	ch->num_syms = n;
+	ch->end = (uint64_t)ceil(ch->start + (n - 1 + 2 * RC_SPAN) * s->sps);
+	if(ch->end > s->p.duration) {
+		return false;
+	}
+	ch->pos = (uint64_t)ceil(ch->start);
+	double w = 2.0 * M_PI * (ch->freq + offset) / s->sample_rate;
+	ch->rot_re = cos(w * ch->pos);
+	ch->rot_im = sin(w * ch->pos);
+	ch->step_re = cos(w);
+	ch->step_im = sin(w);
+	ch->active = true;
+	s->bursts++;
+	return true;
+}
+
+// Adds samples of the current burst from ch->pos up to (but excluding) sample
+// number end to buf, which starts at sample number buf_start.
+static void iq_synth_burst_render(iq_synth_t *s, iq_synth_channel_t *ch, float *buf,
+		uint64_t buf_start, uint64_t end) {
+	for(; ch->pos < end; ch->pos++) {
+		// position relative to the center of the first symbol, in symbols
+		double x = ((double)ch->pos - ch->start) / s->sps - RC_SPAN;
+		int k_min = (int)ceil(x - RC_SPAN), k_max = (int)floor(x + RC_SPAN);
+		if(k_min < 0) k_min = 0;
+		if(k_max > (int)ch->num_syms - 1) k_max = (int)ch->num_syms - 1;
+		float re = 0.f, im = 0.f;
+		for(int k = k_min; k <= k_max; k++) {
+			float t = (float)((x - k + RC_SPAN) * RC_RES);
+			int idx = (int)t;
+			float fract = t - (float)idx;
+			float p = s->rc[idx] + (s->rc[idx + 1] - s->rc[idx]) * fract;
+			re += ch->sym_re[k] * p;
+			im += ch->sym_im[k] * p;
+		}
+		float *out = buf + 2 * (ch->pos - buf_start);
+		out[0] += re * (float)ch->rot_re - im * (float)ch->rot_im;
+		out[1] += re * (float)ch->rot_im + im * (float)ch->rot_re;
+		double r = ch->rot_re * ch->step_re - ch->rot_im * ch->step_im;
+		ch->rot_im = ch->rot_re * ch->step_im + ch->rot_im * ch->step_re;
+		ch->rot_re = r;
+	}
+}
+
+// Generates len complex samples starting from sample number t into buf
+static void iq_synth_generate(iq_synth_t *s, float *buf, uint64_t t, uint32_t len) {
+	// Noise is copied from a random place of the table
+	uint32_t pos = (uint32_t)(rand_uniform(&s->noise_rng) * NOISE_TABLE_LEN);
+	for(uint32_t i = 0; i < len;) {
+		uint32_t n = NOISE_TABLE_LEN - pos;
+		if(n > len - i) {
+			n = len - i;
+		}
+		memcpy(buf + 2 * i, s->noise + 2 * pos, 2 * n * sizeof(float));
+		i += n;
+		pos = 0;
+	}
+	uint64_t end = t + len;
+	for(int c = 0; c < s->num_channels; c++) {
+		iq_synth_channel_t *ch = &s->channels[c];
+		while(1) {
+			if(ch->active) {
+				iq_synth_burst_render(s, ch, buf, t, ch->end < end ? ch->end : end);
+				if(ch->pos < ch->end) {
+					break;
+				}
+				ch->active = false;
+			} else if(ch->next_burst < (double)end) {
+				if(!iq_synth_burst_start(s, ch)) {
+					// no more room for bursts on this channel
+					ch->next_burst = (double)UINT64_MAX;
+					break;
+				}
+			} else {
+				break;
+			}
+		}
+	}
+}
+
+static void iq_synth_noise_init(iq_synth_t *s) {
+	// Average power of a raised-cosine shaped PSK signal, then noise power
+	// per sample giving the requested Es/N0 at the symbol rate
+	double sig_pwr = SIGNAL_AMPLITUDE * SIGNAL_AMPLITUDE * (1.0 - RC_ALPHA / 4.0);
+	double noise_pwr = sig_pwr * s->sps / pow(10.0, s->p.snr / 10.0);
+	double sigma = sqrt(noise_pwr / 2.0);
+	s->noise = XCALLOC(2 * NOISE_TABLE_LEN, sizeof(float));
+	for(uint32_t i = 0; i < 2 * NOISE_TABLE_LEN; i += 2) {
+		// Box-Muller transform
+		double r = sigma * sqrt(-2.0 * log(1.0 - rand_uniform(&s->noise_rng)));
+		double theta = 2.0 * M_PI * rand_uniform(&s->noise_rng);
+		s->noise[i] = (float)(r * cos(theta));
+		s->noise[i + 1] = (float)(r * sin(theta));
+	}
+}
+
+static uint64_t frames_decoded(void) {
+	uint64_t sum = 0;
+	for(int i = 0; i < metrics_channel_cnt(); i++) {
+		sum += metrics_channel_counter_get(i, MC_DECODER_MSG_GOOD);
+	}
+	return sum;
+}
+
+void input_iq_synth_process(vdl2_state_t *ctx, char const *spec, uint32_t centerfreq, uint32_t sample_rate,
+		uint32_t const *freqs, int num_channels) {
+	ASSERT(ctx != NULL);
+	ASSERT(spec != NULL);
+	ASSERT(freqs != NULL);
+	ASSERT(sample_rate > 0);
+	iq_synth_t s = {
+		.sample_rate = sample_rate,
+		.sps = (double)sample_rate / SYMBOL_RATE,
+		.num_channels = num_channels
+	};
+	if(iq_synth_parse_params(spec, sample_rate, &s.p) < 0) {
+		_exit(1);
+	}
+	fprintf(stderr, "Synthetic signal: %.1f s, %d channel(s), %.2f bursts/s per channel, "
+			"Es/N0 %.1f dB, max frequency offset %.0f Hz, message length %u, seed %" PRIu64 "\n",
+			(double)s.p.duration / sample_rate, num_channels, s.p.burst_rate, s.p.snr,
+			s.p.freq_offset, s.p.msg_len, s.p.seed);
+	// Separate generators, so that the traffic does not depend on the noise
+	s.traffic_rng = s.p.seed;
+	s.noise_rng = s.p.seed ^ 0x9E3779B97F4A7C15ULL;
+	for(int i = 0; i < 2 * RC_SPAN * RC_RES + 2; i++) {
+		s.rc[i] = (float)rc_pulse((double)i / RC_RES - RC_SPAN);
+	}
+	iq_synth_noise_init(&s);
+	s.bs = bitstream_init(MAX_BURST_BITS);
+	s.channels = XCALLOC(num_channels, sizeof(iq_synth_channel_t));
+	for(int i = 0; i < num_channels; i++) {
+		iq_synth_channel_t *ch = &s.channels[i];
+		ch->freq = (double)freqs[i] - (double)centerfreq;
+		ch->next_burst = exp_interval(&s);
+		ch->sym_re = XCALLOC(MAX_BURST_SYMS, sizeof(float));
+		ch->sym_im = XCALLOC(MAX_BURST_SYMS, sizeof(float));
+	}
+
+	ctx->sbuf = XCALLOC(IQ_SYNTH_BUFSIZE, sizeof(float));
+	float *next_sbuf = XCALLOC(IQ_SYNTH_BUFSIZE, sizeof(float));
+	for(uint64_t t = 0; t < s.p.duration && do_exit == 0;) {
+		uint32_t len = IQ_SYNTH_BUFSIZE / 2;
+		if(s.p.duration - t < len) {
+			len = (uint32_t)(s.p.duration - t);
+		}
+		iq_synth_generate(&s, next_sbuf, t, len);
+		next_sbuf = demod_swap_sample_buffer(ctx, next_sbuf, 2 * len);
+		t += len;
+	}
+	// Pass an empty buffer to make sure the last one has been demodulated
+	// before reading the counters
+	next_sbuf = demod_swap_sample_buffer(ctx, next_sbuf, 0);
+	uint64_t decoded = frames_decoded();
+	fprintf(stderr, "Synthetic signal: %" PRIu64 " bursts transmitted, %" PRIu64 " frames decoded (%.1f%%)\n",
+			s.bursts, decoded, s.bursts > 0 ? 100.0 * (double)decoded / (double)s.bursts : 0.0);
+
+	// The current sbuf might be still in use by demodulators, so it's not freed here
+	XFREE(next_sbuf);
+	for(int i = 0; i < num_channels; i++) {
+		XFREE(s.channels[i].sym_re);
+		XFREE(s.channels[i].sym_im);
+	}
+	XFREE(s.channels);
+	XFREE(s.noise);
+	bitstream_destroy(s.bs);
+}
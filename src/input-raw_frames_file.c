@@ -20,69 +20,129 @@
 #include <stdint.h>
 #include <stdio.h>                  // FILE, fopen, fclose, fread
 #include <string.h>                 // memcpy
+#include <errno.h>                  // errno
+#include <unistd.h>                 // close, sysconf
+#include <fcntl.h>                  // open
+#include <pthread.h>                // pthread_*
+#include <sys/stat.h>               // fstat
 #include <arpa/inet.h>              // ntohs
+#include "config.h"                 // HAVE_SYS_MMAN_H
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>               // mmap, munmap, madvise
+#endif
 #include "dumpvdl2.pb-c.h"
 #include "output-common.h"          // vdl2_msg_metadata
 #include "output-file.h"            // OUT_BINARY_FRAME_LEN_MAX, OUT_FILE_FRAME_LEN_OCTETS
-#include "decode.h"                 // avlc_decoder_queue_push
-#include "dumpvdl2.h"               // ASSERT, do_exit
+#include "decode.h"                 // avlc_decoder_queue_push, avlc_decoder_batch_*
+#include "avlc.h"                   // parse_dlc_addr
+#include "input-raw_frames_file.h"  // raw_frame_unpack
+#include "raw_frames_index.h"       // raw_frames_filter_t, raw_frames_index_*
+#include "dedup.h"                  // dedup_window_get
+#include "dumpvdl2.h"               // ASSERT, do_exit, start_thread
 
 #define BUF_SIZE (3 * OUT_BINARY_FRAME_LEN_MAX)
 #define READ_SIZE (2 * OUT_BINARY_FRAME_LEN_MAX)
 
-static int process_frame(uint8_t *buf, size_t len) {
+// Number of frames decoded by a worker thread in one go
+#define SEGMENT_LEN 16384
+
+// Maximum number of decoded segments waiting to be sent to outputs, per thread
+#define SEGMENTS_IN_FLIGHT_PER_THREAD 2
+
+// Each worker thread starts decoding a segment with empty reassembly tables.
+// To avoid losing messages which have been fragmented across a segment
+// boundary, frames received this many seconds before the start of the segment
+// are decoded first (without producing any output) to warm up reassembly
+// state. This exceeds all reassembly timeouts used in practice.
+#define SEGMENT_WARMUP_SECONDS 180
+
+// Unpacks a binary-serialized frame (without the length field). On success,
+// *metadata and *frame are set, unless the frame has no metadata - then both
+// are NULL and the frame should be skipped. Returns -1 if the frame is invalid.
+int raw_frame_unpack(uint8_t const *buf, size_t len, vdl2_msg_metadata **metadata,
+		octet_string_t **frame, bool verbose) {
 	ASSERT(buf != NULL);
+	*metadata = NULL;
+	*frame = NULL;
 	Dumpvdl2__RawAvlcFrame *f =
 		dumpvdl2__raw_avlc_frame__unpack(NULL, len, buf);
 	if(f == NULL) {
-		fprintf(stderr, "Failed to unpack message\n");
+		if(verbose) {
+			fprintf(stderr, "Failed to unpack message\n");
+		}
 		return -1;
 	}
 	if(f->metadata == NULL) {
-		fprintf(stderr, "No metadata in frame, skipping\n");
-		return 0;
+		if(verbose) {
+			fprintf(stderr, "No metadata in frame, skipping\n");
+		}
+		goto end;
 	}
 	if(f->data.data == NULL || f->data.len < 1) {
-		return 0;
+		goto end;
 	}
 	Dumpvdl2__Vdl2MsgMetadata *m = f->metadata;
 	if(m->burst_timestamp == NULL) {
-		fprintf(stderr, "No timestamp in frame metadata, skipping\n");
-		return 0;
-	}
-	NEW(vdl2_msg_metadata, metadata);
-	metadata->version = m->version;;
-	metadata->freq = m->frequency;
-	metadata->frame_pwr_dbfs = m->frame_pwr_dbfs;
-	metadata->nf_pwr_dbfs = m->nf_pwr_dbfs;
-	metadata->ppm_error = m->ppm_error;
-	metadata->burst_timestamp.tv_sec = m->burst_timestamp->tv_sec;
-	metadata->burst_timestamp.tv_usec = m->burst_timestamp->tv_usec;
-	metadata->datalen_octets = m->datalen_octets;
-	metadata->synd_weight = m->synd_weight;
-	metadata->num_fec_corrections = m->num_fec_corrections;
-	metadata->idx = m->idx;
+		if(verbose) {
+			fprintf(stderr, "No timestamp in frame metadata, skipping\n");
+		}
+		goto end;
+	}
+	NEW(vdl2_msg_metadata, md);
+	md->version = m->version;;
+	md->freq = m->frequency;
+	md->frame_pwr_dbfs = m->frame_pwr_dbfs;
+	md->nf_pwr_dbfs = m->nf_pwr_dbfs;
+	md->ppm_error = m->ppm_error;
+	md->burst_timestamp.tv_sec = m->burst_timestamp->tv_sec;
+	md->burst_timestamp.tv_usec = m->burst_timestamp->tv_usec;
+	md->datalen_octets = m->datalen_octets;
+	md->synd_weight = m->synd_weight;
+	md->num_fec_corrections = m->num_fec_corrections;
+	md->idx = m->idx;
 
 	uint8_t *copy = XCALLOC(f->data.len, sizeof(uint8_t));
 	memcpy(copy, f->data.data, f->data.len);
-	int flags = 0;
-	avlc_decoder_queue_push(metadata, octet_string_new(copy, f->data.len), flags);
+	*metadata = md;
+	*frame = octet_string_new(copy, f->data.len);
+end:
 	dumpvdl2__raw_avlc_frame__free_unpacked(f, NULL);
 	return 0;
 }
 
-int input_raw_frames_file_process(char const *file) {
-	ASSERT(file != NULL);
-	FILE *fh = NULL;
-	if(!strcmp(file, "-")) {
-		fh = stdin;
-	} else {
-		fh = fopen(file, "r");
+static bool frame_matches(raw_frames_filter_t const *filter, vdl2_msg_metadata const *metadata,
+		octet_string_t const *frame) {
+	if(!raw_frames_filter_is_active(filter)) {
+		return true;
 	}
-	if (fh == NULL) {
-		perror("Could not open input file");
-		return 2;
+	raw_frames_index_record_t r = {
+		.timestamp = metadata->burst_timestamp,
+		.freq = metadata->freq
+	};
+	if(frame->len >= 8) {
+		r.dst = parse_dlc_addr(frame->buf);
+		r.src = parse_dlc_addr(frame->buf + 4);
 	}
+	return raw_frames_filter_match(filter, &r);
+}
+
+static int process_frame(uint8_t const *buf, size_t len, raw_frames_filter_t const *filter) {
+	vdl2_msg_metadata *metadata = NULL;
+	octet_string_t *frame = NULL;
+	if(raw_frame_unpack(buf, len, &metadata, &frame, true) < 0) {
+		return -1;
+	}
+	if(metadata != NULL && !frame_matches(filter, metadata, frame)) {
+		octet_string_destroy(frame);
+		XFREE(metadata);
+	} else if(metadata != NULL) {
+		int flags = 0;
+		avlc_decoder_queue_push(metadata, frame, flags);
+	}
+	return 0;
+}
+
+static int process_stream(FILE *fh, raw_frames_filter_t const *filter) {
 	int ret = 0;
 	size_t available = 0, offset = 0, i = 0;
 	size_t frame_len = 0;
@@ -103,7 +163,7 @@ int input_raw_frames_file_process(char const *file) {
 			}                                                   // to force loading next batch of data from the file
 			if(available >= frame_len) {                        // whole frame can be read from the current buffer
 				if(process_frame(buf + i + OUT_BINARY_FRAME_LEN_OCTETS,
-							frame_len - OUT_BINARY_FRAME_LEN_OCTETS) != 0) {
+							frame_len - OUT_BINARY_FRAME_LEN_OCTETS, filter) != 0) {
 					ret = 3;
 					goto cleanup;
 				}
@@ -126,3 +186,510 @@ cleanup:
 	fclose(fh);
 	return ret;
 }
+
+#ifdef HAVE_SYS_MMAN_H
+
+static inline size_t frame_len_at(uint8_t const *p) {
+	return ((size_t)p[0] << 8) | (size_t)p[1];
+}
+
+// Frames are identified by their positions, which are byte offsets into
+// the mapped file or, when only frames selected with the index are decoded,
+// indexes into the array of their offsets.
+typedef struct {
+	size_t start;                       // position of the first frame
+	size_t end;                         // position past the last frame
+	avlc_decoder_batch_t *batch;        // decoding results waiting for output
+	enum {
+		SEGMENT_PENDING,
+		SEGMENT_DONE,
+		SEGMENT_FAILED
+	} state;
+} raw_frames_segment_t;
+
+typedef struct {
+	uint8_t const *map;
+	size_t const *frames;               // offsets of selected frames (NULL = all frames)
+	la_list *fmtr_list;
+	raw_frames_filter_t const *filter;
+	raw_frames_segment_t *segments;
+	size_t num_segments;
+	size_t next_segment;                // next segment to be picked up by a worker
+	size_t next_flush;                  // next segment to be sent to outputs
+	size_t max_in_flight;
+	bool abort;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+} raw_frames_reader_t;
+
+static inline size_t frame_offset(raw_frames_reader_t const *r, size_t pos) {
+	return r->frames != NULL ? r->frames[pos] : pos;
+}
+
+static inline size_t next_frame_pos(raw_frames_reader_t const *r, size_t pos) {
+	return r->frames != NULL ? pos + 1 : pos + frame_len_at(r->map + pos);
+}
+
+// Splits cnt selected frames into segments of SEGMENT_LEN frames
+static raw_frames_segment_t *segments_new(size_t cnt, size_t *num_segments) {
+	size_t seg_cnt = (cnt + SEGMENT_LEN - 1) / SEGMENT_LEN;
+	raw_frames_segment_t *seg = XCALLOC(seg_cnt > 0 ? seg_cnt : 1, sizeof(raw_frames_segment_t));
+	for(size_t i = 0; i < seg_cnt; i++) {
+		seg[i] = (raw_frames_segment_t){
+			.start = i * SEGMENT_LEN,
+			.end = (i + 1) * SEGMENT_LEN < cnt ? (i + 1) * SEGMENT_LEN : cnt,
+			.state = SEGMENT_PENDING
+		};
+	}
+	*num_segments = seg_cnt;
+	return seg;
+}
+
+// Walks the file and checks frame boundaries. Stores the offset past the last
+// complete frame in *valid_len. If segments is not NULL, it is filled with
+// segment boundaries (every SEGMENT_LEN frames).
+static int index_frames(uint8_t const *map, size_t len, size_t *valid_len,
+		raw_frames_segment_t **segments, size_t *num_segments) {
+	int ret = 0;
+	size_t offset = 0, frame_cnt = 0, seg_cnt = 0, seg_size = 0;
+	raw_frames_segment_t *seg = NULL;
+	while(offset < len) {
+		if(len - offset < OUT_BINARY_FRAME_LEN_OCTETS) {
+			fprintf(stderr, "Input file is truncated\n");
+			ret = 3;
+			break;
+		}
+		size_t frame_len = frame_len_at(map + offset);
+		if(frame_len < OUT_BINARY_FRAME_LEN_OCTETS + 1) {
+			fprintf(stderr, "Frame too short: %zu\n", frame_len);
+			ret = 3;
+			break;
+		}
+		if(len - offset < frame_len) {
+			fprintf(stderr, "Input file is truncated\n");
+			ret = 3;
+			break;
+		}
+		if(segments != NULL && frame_cnt % SEGMENT_LEN == 0) {
+			if(seg_cnt == seg_size) {
+				seg_size = seg_size > 0 ? 2 * seg_size : 64;
+				seg = XREALLOC(seg, seg_size * sizeof(raw_frames_segment_t));
+			}
+			if(seg_cnt > 0) {
+				seg[seg_cnt - 1].end = offset;
+			}
+			seg[seg_cnt] = (raw_frames_segment_t){ .start = offset, .state = SEGMENT_PENDING };
+			seg_cnt++;
+		}
+		offset += frame_len;
+		frame_cnt++;
+	}
+	if(seg_cnt > 0) {
+		seg[seg_cnt - 1].end = offset;
+	}
+	debug_print(D_MISC, "%zu frames, %zu segments, %zu valid octets\n", frame_cnt, seg_cnt, offset);
+	*valid_len = offset;
+	if(segments != NULL) {
+		*segments = seg;
+		*num_segments = seg_cnt;
+	}
+	return ret;
+}
+
+static bool frame_timestamp(uint8_t const *p, struct timeval *result) {
+	Dumpvdl2__RawAvlcFrame *f = dumpvdl2__raw_avlc_frame__unpack(NULL,
+			frame_len_at(p) - OUT_BINARY_FRAME_LEN_OCTETS, p + OUT_BINARY_FRAME_LEN_OCTETS);
+	bool found = false;
+	if(f != NULL && f->metadata != NULL && f->metadata->burst_timestamp != NULL) {
+		result->tv_sec = f->metadata->burst_timestamp->tv_sec;
+		result->tv_usec = f->metadata->burst_timestamp->tv_usec;
+		found = true;
+	}
+	dumpvdl2__raw_avlc_frame__free_unpacked(f, NULL);
+	return found;
+}
+
+static inline int64_t frame_timestamp_usec(vdl2_msg_metadata const *metadata) {
+	return (int64_t)metadata->burst_timestamp.tv_sec * 1000000 + metadata->burst_timestamp.tv_usec;
+}
+
+// Returns the position of the first frame of the previous segment which was
+// received no more than SEGMENT_WARMUP_SECONDS before the start of segment k.
+static size_t find_warmup_start(raw_frames_reader_t const *r, size_t k) {
+	if(k == 0) {
+		return r->segments[0].start;
+	}
+	size_t start = r->segments[k].start;
+	struct timeval seg_ts;
+	if(!frame_timestamp(r->map + frame_offset(r, start), &seg_ts)) {
+		return start;
+	}
+	size_t *positions = XCALLOC(SEGMENT_LEN, sizeof(size_t));
+	size_t cnt = 0;
+	for(size_t pos = r->segments[k-1].start; pos < start && cnt < SEGMENT_LEN; pos = next_frame_pos(r, pos)) {
+		positions[cnt++] = pos;
+	}
+	struct timeval ts;
+	size_t n = cnt;
+	while(n > 0) {
+		if(frame_timestamp(r->map + frame_offset(r, positions[n-1]), &ts) &&
+				ts.tv_sec + SEGMENT_WARMUP_SECONDS < seg_ts.tv_sec) {
+			break;
+		}
+		n--;
+	}
+	size_t result = n < cnt ? positions[n] : start;
+	XFREE(positions);
+	return result;
+}
+
+static int decode_segment(raw_frames_reader_t *r, size_t k) {
+	raw_frames_segment_t *seg = &r->segments[k];
+	seg->batch = avlc_decoder_batch_new(r->fmtr_list);
+	vdl2_msg_metadata *metadata = NULL;
+	octet_string_t *frame = NULL;
+	int64_t newest = INT64_MIN;
+
+	size_t pos = find_warmup_start(r, k);
+	debug_print(D_MISC, "segment %zu: warmup from %zu, start %zu, end %zu\n",
+			k, pos, seg->start, seg->end);
+	for(; pos < seg->end && do_exit == 0; pos = next_frame_pos(r, pos)) {
+		size_t offset = frame_offset(r, pos);
+		size_t frame_len = frame_len_at(r->map + offset);
+		bool warmup = pos < seg->start;
+		if(raw_frame_unpack(r->map + offset + OUT_BINARY_FRAME_LEN_OCTETS,
+					frame_len - OUT_BINARY_FRAME_LEN_OCTETS, &metadata, &frame, !warmup) < 0) {
+			if(!warmup) {
+				return SEGMENT_FAILED;
+			}
+		} else if(metadata != NULL) {
+			int64_t t = frame_timestamp_usec(metadata);
+			if(t > newest) {
+				newest = t;
+			}
+			// Frames not matching the filter are skipped, as in serial mode.
+			// Passing them to the batch would let them replace matching
+			// frames during deduplication.
+			if(!frame_matches(r->filter, metadata, frame)) {
+				octet_string_destroy(frame);
+				XFREE(metadata);
+				continue;
+			}
+			avlc_decoder_batch_process(seg->batch, metadata, frame,
+					warmup ? BATCH_FRAME_WARMUP : BATCH_FRAME_OUTPUT);
+		}
+	}
+
+	// Frames of the following segments which arrive within the deduplication
+	// window may be stronger copies of frames held at the end of this one.
+	// Decoding the file serially would output them in place of the held
+	// frames, so submit them here as well. The next segment sees the same
+	// frames as replacements of its warmup frames and does not output them.
+	int64_t window = (int64_t)dedup_window_get() * 1000;
+	size_t file_end = r->segments[r->num_segments - 1].end;
+	if(window == 0 || newest == INT64_MIN) {
+		return SEGMENT_DONE;
+	}
+	for(; pos < file_end && do_exit == 0; pos = next_frame_pos(r, pos)) {
+		size_t offset = frame_offset(r, pos);
+		size_t frame_len = frame_len_at(r->map + offset);
+		if(raw_frame_unpack(r->map + offset + OUT_BINARY_FRAME_LEN_OCTETS,
+					frame_len - OUT_BINARY_FRAME_LEN_OCTETS, &metadata, &frame, false) < 0) {
+			break;
+		} else if(metadata == NULL) {
+			continue;
+		}
+		bool past_window = frame_timestamp_usec(metadata) >= newest + window;
+		if(past_window || !frame_matches(r->filter, metadata, frame)) {
+			octet_string_destroy(frame);
+			XFREE(metadata);
+			if(past_window) {
+				break;
+			}
+			continue;
+		}
+		avlc_decoder_batch_process(seg->batch, metadata, frame, BATCH_FRAME_LOOKAHEAD);
+	}
+	return SEGMENT_DONE;
+}
+
+static void *raw_frames_worker(void *arg) {
+	raw_frames_reader_t *r = arg;
+	pthread_mutex_lock(&r->mutex);
+	while(1) {
+		while(!r->abort && r->next_segment < r->num_segments &&
+				r->next_segment - r->next_flush >= r->max_in_flight) {
+			pthread_cond_wait(&r->cond, &r->mutex);
+		}
+		if(r->abort || r->next_segment >= r->num_segments) {
+			break;
+		}
+		size_t k = r->next_segment++;
+		pthread_mutex_unlock(&r->mutex);
+
+		int state = decode_segment(r, k);
+
+		pthread_mutex_lock(&r->mutex);
+		r->segments[k].state = state;
+		pthread_cond_broadcast(&r->cond);
+	}
+	pthread_mutex_unlock(&r->mutex);
+	return NULL;
+}
+
+// Decodes segments of the file in multiple threads and sends the results
+// to outputs in the original order
+static int process_parallel(raw_frames_reader_t *r, int num_threads) {
+	int ret = 0;
+	pthread_mutex_init(&r->mutex, NULL);
+	pthread_cond_init(&r->cond, NULL);
+	r->max_in_flight = (size_t)num_threads * SEGMENTS_IN_FLIGHT_PER_THREAD;
+	pthread_t *workers = XCALLOC(num_threads, sizeof(pthread_t));
+	for(int i = 0; i < num_threads; i++) {
+		start_thread(&workers[i], raw_frames_worker, r);
+	}
+	for(size_t k = 0; k < r->num_segments; k++) {
+		raw_frames_segment_t *seg = &r->segments[k];
+		pthread_mutex_lock(&r->mutex);
+		while(seg->state == SEGMENT_PENDING) {
+			pthread_cond_wait(&r->cond, &r->mutex);
+		}
+		pthread_mutex_unlock(&r->mutex);
+
+		avlc_decoder_batch_flush(seg->batch);
+		avlc_decoder_batch_destroy(seg->batch);
+		seg->batch = NULL;
+
+		pthread_mutex_lock(&r->mutex);
+		r->next_flush++;
+		if(seg->state == SEGMENT_FAILED) {
+			ret = 3;
+			r->abort = true;
+		} else if(do_exit != 0) {
+			r->abort = true;
+		}
+		pthread_cond_broadcast(&r->cond);
+		pthread_mutex_unlock(&r->mutex);
+		if(r->abort) {
+			break;
+		}
+	}
+	for(int i = 0; i < num_threads; i++) {
+		pthread_join(workers[i], NULL);
+	}
+	// Release results of segments decoded after an abort
+	for(size_t k = 0; k < r->num_segments; k++) {
+		avlc_decoder_batch_destroy(r->segments[k].batch);
+	}
+	XFREE(workers);
+	pthread_cond_destroy(&r->cond);
+	pthread_mutex_destroy(&r->mutex);
+	return ret;
+}
+
+// Processes frames starting at the given offset, until the end of the file
+static int process_mapped(uint8_t const *map, size_t start, size_t len, la_list *fmtr_list,
+		int num_threads, raw_frames_filter_t const *filter) {
+	map += start;
+	len -= start;
+	raw_frames_reader_t r = {
+		.map = map,
+		.fmtr_list = fmtr_list,
+		.filter = filter
+	};
+	size_t valid_len = 0;
+	int ret = index_frames(map, len, &valid_len,
+			num_threads > 1 ? &r.segments : NULL, &r.num_segments);
+
+	if(r.num_segments > 1) {
+		fprintf(stderr, "Decoding %zu segments using %d threads\n", r.num_segments, num_threads);
+		int result = process_parallel(&r, num_threads);
+		if(result != 0) {
+			ret = result;
+		}
+	} else {
+		for(size_t offset = 0; offset < valid_len && do_exit == 0; offset += frame_len_at(map + offset)) {
+			if(process_frame(map + offset + OUT_BINARY_FRAME_LEN_OCTETS,
+						frame_len_at(map + offset) - OUT_BINARY_FRAME_LEN_OCTETS, filter) != 0) {
+				ret = 3;
+				break;
+			}
+		}
+	}
+	XFREE(r.segments);
+	return ret;
+}
+
+// Checks whether the frame at the given offset lies within the data file
+static bool frame_in_bounds(uint8_t const *map, size_t len, size_t offset, size_t *frame_len) {
+	if(offset + OUT_BINARY_FRAME_LEN_OCTETS > len) {
+		return false;
+	}
+	*frame_len = frame_len_at(map + offset);
+	return *frame_len >= OUT_BINARY_FRAME_LEN_OCTETS + 1 && offset + *frame_len <= len;
+}
+
+// Selects frames matching the filter using the sidecar index and processes
+// them. Frames appended to the data file after the last indexed one are
+// scanned. Returns -1 if the index can't be used.
+static int process_indexed(char const *file, uint8_t const *map, size_t len,
+		la_list *fmtr_list, int num_threads, raw_frames_filter_t const *filter) {
+	size_t name_len = strlen(file) + strlen(RAW_FRAMES_INDEX_SUFFIX) + 1;
+	char *idx_file = XCALLOC(name_len, sizeof(char));
+	snprintf(idx_file, name_len, "%s%s", file, RAW_FRAMES_INDEX_SUFFIX);
+	int fd = open(idx_file, O_RDONLY);
+	struct stat st;
+	if(fd < 0 || fstat(fd, &st) < 0) {
+		debug_print(D_MISC, "%s: %s\n", idx_file, strerror(errno));
+		if(fd >= 0) {
+			close(fd);
+		}
+		XFREE(idx_file);
+		return -1;
+	}
+	size_t idx_len = (size_t)st.st_size;
+	uint8_t const *idx = idx_len > 0 ? mmap(NULL, idx_len, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	if(idx == MAP_FAILED || !raw_frames_index_header_is_valid(idx, idx_len)) {
+		fprintf(stderr, "%s: not a valid index file, ignoring\n", idx_file);
+		if(idx != MAP_FAILED) {
+			munmap((void *)idx, idx_len);
+		}
+		XFREE(idx_file);
+		return -1;
+	}
+	size_t num_records = (idx_len - RAW_FRAMES_INDEX_HEADER_LEN) / RAW_FRAMES_INDEX_RECORD_LEN;
+	uint8_t const *records = idx + RAW_FRAMES_INDEX_HEADER_LEN;
+	raw_frames_index_record_t r;
+	if(num_records > 0) {
+		raw_frames_index_record_decode(records, &r);
+		if(r.offset != 0) {
+			fprintf(stderr, "%s: index does not cover the whole data file, ignoring\n", idx_file);
+			munmap((void *)idx, idx_len);
+			XFREE(idx_file);
+			return -1;
+		}
+	}
+
+	int ret = 0;
+	size_t matched = 0, indexed_end = 0, frame_len = 0;
+	// The unindexed tail of the data file starts after the last indexed frame
+	if(num_records > 0) {
+		raw_frames_index_record_decode(records + (num_records - 1) * RAW_FRAMES_INDEX_RECORD_LEN, &r);
+		if(!frame_in_bounds(map, len, r.offset, &frame_len)) {
+			fprintf(stderr, "%s: record %zu points outside of the data file\n", idx_file, num_records - 1);
+			ret = 3;
+			goto end;
+		}
+		indexed_end = r.offset + frame_len;
+	}
+
+	// Only records in the requested time range (widened by the allowed
+	// timestamp skew) are examined
+	size_t first = 0;
+	if(filter->from_set) {
+		struct timeval from = filter->from;
+		from.tv_sec -= RAW_FRAMES_INDEX_TIME_SKEW_MAX;
+		first = raw_frames_index_lower_bound(records, num_records, from);
+	}
+	size_t *offsets = XCALLOC(num_records - first > 0 ? num_records - first : 1, sizeof(size_t));
+	for(size_t i = first; i < num_records && do_exit == 0; i++) {
+		raw_frames_index_record_decode(records + i * RAW_FRAMES_INDEX_RECORD_LEN, &r);
+		if(filter->to_set && r.timestamp.tv_sec >= filter->to.tv_sec + RAW_FRAMES_INDEX_TIME_SKEW_MAX) {
+			break;
+		}
+		if(!raw_frames_filter_match(filter, &r)) {
+			continue;
+		}
+		if(!frame_in_bounds(map, len, r.offset, &frame_len)) {
+			fprintf(stderr, "%s: record %zu points outside of the data file\n", idx_file, i);
+			ret = 3;
+			break;
+		}
+		offsets[matched++] = r.offset;
+	}
+
+	// Only frames selected by the index are read from the data file
+	if(ret == 0 && matched > SEGMENT_LEN && num_threads > 1) {
+		raw_frames_reader_t reader = {
+			.map = map,
+			.frames = offsets,
+			.fmtr_list = fmtr_list,
+			.filter = filter
+		};
+		reader.segments = segments_new(matched, &reader.num_segments);
+		fprintf(stderr, "Decoding %zu segments using %d threads\n", reader.num_segments, num_threads);
+		ret = process_parallel(&reader, num_threads);
+		XFREE(reader.segments);
+	} else if(ret == 0) {
+		for(size_t i = 0; i < matched && do_exit == 0; i++) {
+			if(process_frame(map + offsets[i] + OUT_BINARY_FRAME_LEN_OCTETS,
+						frame_len_at(map + offsets[i]) - OUT_BINARY_FRAME_LEN_OCTETS, filter) != 0) {
+				ret = 3;
+				break;
+			}
+		}
+	}
+	XFREE(offsets);
+	fprintf(stderr, "%s: %zu of %zu indexed frames selected\n", idx_file, matched, num_records);
+end:
+	munmap((void *)idx, idx_len);
+	XFREE(idx_file);
+	if(ret == 0 && do_exit == 0 && indexed_end < len) {
+		debug_print(D_MISC, "scanning unindexed data from offset %zu\n", indexed_end);
+		ret = process_mapped(map, indexed_end, len, fmtr_list, num_threads, filter);
+	}
+	return ret;
+}
+
+#endif // HAVE_SYS_MMAN_H
+
+int input_raw_frames_file_process(char const *file, la_list *fmtr_list, int num_threads,
+		raw_frames_filter_t const *filter) {
+	ASSERT(file != NULL);
+	if(!strcmp(file, "-")) {
+		return process_stream(stdin, filter);
+	}
+	int fd = open(file, O_RDONLY);
+	if(fd < 0) {
+		perror("Could not open input file");
+		return 2;
+	}
+	if(num_threads < 1) {
+		long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		num_threads = ncpu > 0 ? (int)ncpu : 1;
+	}
+#ifdef HAVE_SYS_MMAN_H
+	struct stat st;
+	if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+		if(st.st_size == 0) {
+			close(fd);
+			return 0;
+		}
+		void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(map != MAP_FAILED) {
+			close(fd);
+			int ret = -1;
+			if(raw_frames_filter_is_active(filter)) {
+				ret = process_indexed(file, map, (size_t)st.st_size, fmtr_list, num_threads, filter);
+			}
+			if(ret < 0) {
+				madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+				ret = process_mapped(map, 0, (size_t)st.st_size, fmtr_list, num_threads, filter);
+			}
+			munmap(map, (size_t)st.st_size);
+			return ret;
+		}
+		debug_print(D_MISC, "mmap failed: %s, falling back to buffered reads\n", strerror(errno));
+	}
+#else
+	UNUSED(fmtr_list);
+#endif
+	FILE *fh = fdopen(fd, "r");
+	if(fh == NULL) {
+		perror("Could not open input file");
+		close(fd);
+		return 2;
+	}
+	return process_stream(fh, filter);
+}
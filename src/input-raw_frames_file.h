@@ -0,0 +1,32 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _INPUT_RAW_FRAMES_FILE_H
+#define _INPUT_RAW_FRAMES_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>                 // size_t
+#include <stdint.h>
+#include "output-common.h"          // vdl2_msg_metadata
+#include "dumpvdl2.h"               // octet_string_t
+
+// input-raw_frames_file.c
+int raw_frame_unpack(uint8_t const *buf, size_t len, vdl2_msg_metadata **metadata,
+		octet_string_t **frame, bool verbose);
+
+#endif // !_INPUT_RAW_FRAMES_FILE_H
@@ -0,0 +1,222 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* A minimal HTTP server exposing metrics in Prometheus format.
+ * It runs in its own thread and handles one connection at a time, which is
+ * plenty for a scraper polling every few seconds. Anything other than
+ * GET /metrics or GET /status is answered with an error.
+ */
+
+#include <stdio.h>                      // fprintf, snprintf
+#include <string.h>                     // strchr, strrchr, strcmp, strcspn, strdup, strerror
+#include <unistd.h>                     // close, read, write
+#include <errno.h>                      // errno
+#include <poll.h>                       // poll
+#include <pthread.h>                    // pthread_t
+#include <sys/types.h>                  // socket, bind
+#include <sys/socket.h>                 // socket, bind, listen, accept, setsockopt
+#include <sys/time.h>                   // struct timeval
+#include <netdb.h>                      // getaddrinfo
+#include <libacars/vstring.h>           // la_vstring
+#include "metrics.h"                    // metrics_format_prometheus, metrics_format_status_json
+#include "dumpvdl2.h"                   // do_exit, start_thread, debug_print
+
+#define METRICS_SERVER_BACKLOG 8
+#define METRICS_SERVER_REQ_BUFSIZE 2048
+// Max time to wait for the client to send the request or receive the response
+#define METRICS_SERVER_IO_TIMEOUT 2
+
+static pthread_t metrics_server_thread;
+
+static int write_all(int fd, char const *buf, size_t len) {
+	while(len > 0) {
+		ssize_t ret = write(fd, buf, len);
+		if(ret < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		buf += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+static void metrics_server_respond(int fd, char const *status, char const *content_type,
+		char const *body, size_t body_len, bool send_body) {
+	char hdr[256];
+	int hdr_len = snprintf(hdr, sizeof(hdr),
+			"HTTP/1.0 %s\r\n"
+			"Content-Type: %s\r\n"
+			"Content-Length: %zu\r\n"
+			"Connection: close\r\n"
+			"\r\n",
+			status, content_type, body_len);
+	if(write_all(fd, hdr, hdr_len) < 0 || (send_body && write_all(fd, body, body_len) < 0)) {
+		debug_print(D_STATS, "error while sending response: %s\n", strerror(errno));
+	}
+}
+
+static void metrics_server_handle_connection(int fd) {
+	struct timeval tv = { .tv_sec = METRICS_SERVER_IO_TIMEOUT, .tv_usec = 0 };
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	// Only the request line is of interest. Read until it's complete.
+	char buf[METRICS_SERVER_REQ_BUFSIZE];
+	size_t len = 0;
+	while(len < sizeof(buf) - 1) {
+		ssize_t ret = read(fd, buf + len, sizeof(buf) - 1 - len);
+		if(ret < 0 && errno == EINTR) {
+			continue;
+		} else if(ret <= 0) {
+			break;
+		}
+		len += ret;
+		buf[len] = '\0';
+		if(strchr(buf, '\n') != NULL) {
+			break;
+		}
+	}
+	buf[len] = '\0';
+	char *eol = strchr(buf, '\n');
+	if(eol == NULL) {
+		debug_print(D_STATS, "incomplete request, dropping connection\n");
+		return;
+	}
+	*eol = '\0';
+
+	// Request line: <method> <path> <version>
+	char *path = strchr(buf, ' ');
+	if(path == NULL) {
+		metrics_server_respond(fd, "400 Bad Request", "text/plain", "", 0, false);
+		return;
+	}
+	*path++ = '\0';
+	path[strcspn(path, " ?\r")] = '\0';
+	debug_print(D_STATS, "request: %s %s\n", buf, path);
+
+	bool is_head = !strcmp(buf, "HEAD");
+	if(strcmp(buf, "GET") != 0 && !is_head) {
+		static char const msg[] = "Method not allowed\n";
+		metrics_server_respond(fd, "405 Method Not Allowed", "text/plain", msg, sizeof(msg) - 1, true);
+	} else if(!strcmp(path, "/metrics")) {
+		la_vstring *vstr = metrics_format_prometheus();
+		metrics_server_respond(fd, "200 OK", "text/plain; version=0.0.4; charset=utf-8",
+				vstr->str, vstr->len, !is_head);
+		la_vstring_destroy(vstr, true);
+	} else if(!strcmp(path, "/status")) {
+		la_vstring *vstr = metrics_format_status_json();
+		metrics_server_respond(fd, "200 OK", "application/json", vstr->str, vstr->len, !is_head);
+		la_vstring_destroy(vstr, true);
+	} else {
+		static char const msg[] = "Not found\n";
+		metrics_server_respond(fd, "404 Not Found", "text/plain", msg, sizeof(msg) - 1, !is_head);
+	}
+}
+
+static void *metrics_server(void *ctx) {
+	int listen_fd = (int)(intptr_t)ctx;
+	struct pollfd pfd = { .fd = listen_fd, .events = POLLIN };
+	while(!do_exit) {
+		// Wake up periodically to check do_exit
+		int ret = poll(&pfd, 1, 1000);
+		if(ret < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "metrics server: poll() failed: %s\n", strerror(errno));
+			break;
+		} else if(ret == 0) {
+			continue;
+		}
+		int fd = accept(listen_fd, NULL, NULL);
+		if(fd < 0) {
+			debug_print(D_STATS, "accept() failed: %s\n", strerror(errno));
+			continue;
+		}
+		metrics_server_handle_connection(fd);
+		close(fd);
+	}
+	close(listen_fd);
+	return NULL;
+}
+
+// Starts the metrics server listening on [address:]port.
+// Address might be an IPv6 literal in square brackets.
+// If it's omitted, the server listens on all addresses.
+int metrics_server_start(char const *listen_addr) {
+	ASSERT(listen_addr != NULL);
+	char *addr_str = strdup(listen_addr);
+	char *address = NULL;
+	char *port = addr_str;
+	char *colon = strrchr(addr_str, ':');
+	if(colon != NULL) {
+		*colon = '\0';
+		port = colon + 1;
+		address = addr_str;
+		size_t alen = strlen(address);
+		if(alen >= 2 && address[0] == '[' && address[alen - 1] == ']') {
+			address[alen - 1] = '\0';
+			address++;
+		}
+		if(*address == '\0') {
+			address = NULL;
+		}
+	}
+
+	int listen_fd = -1;
+	struct addrinfo hints, *result = NULL, *rptr;
+	memset(&hints, 0, sizeof(struct addrinfo));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+	int ret = getaddrinfo(address, port, &hints, &result);
+	if(ret != 0) {
+		fprintf(stderr, "metrics server: could not resolve %s: %s\n", listen_addr, gai_strerror(ret));
+		goto fail;
+	}
+	for(rptr = result; rptr != NULL; rptr = rptr->ai_next) {
+		listen_fd = socket(rptr->ai_family, rptr->ai_socktype, rptr->ai_protocol);
+		if(listen_fd == -1) {
+			continue;
+		}
+		int one = 1;
+		setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		if(bind(listen_fd, rptr->ai_addr, rptr->ai_addrlen) == 0 &&
+				listen(listen_fd, METRICS_SERVER_BACKLOG) == 0) {
+			break;
+		}
+		close(listen_fd);
+		listen_fd = -1;
+	}
+	freeaddrinfo(result);
+	if(listen_fd < 0) {
+		fprintf(stderr, "metrics server: could not listen on %s: %s\n", listen_addr, strerror(errno));
+		goto fail;
+	}
+	fprintf(stderr, "metrics server: listening on %s\n", listen_addr);
+	XFREE(addr_str);
+	start_thread(&metrics_server_thread, metrics_server, (void *)(intptr_t)listen_fd);
+	return 0;
+fail:
+	XFREE(addr_str);
+	return -1;
+}
@@ -0,0 +1,616 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* In-process metrics registry.
+ * All metrics live in statically allocated slots, so that updating them
+ * is just an atomic increment - no allocations, no string formatting and no
+ * system calls on the hot path. Per-channel metrics are kept in a separate
+ * slot for each channel. A channel is updated by its own demodulator thread
+ * and by the decoder thread, so there is hardly any contention on these.
+ * Relaxed memory ordering is sufficient, because the values are only read
+ * for reporting purposes.
+ */
+
+#include <stddef.h>                     // offsetof
+#include <stdint.h>
+#include <stdatomic.h>                  // atomic_*
+#include <math.h>                       // llround
+#include <pthread.h>                    // pthread_mutex_*
+#include <sys/time.h>                   // gettimeofday
+#include <libacars/libacars.h>          // la_msg_dir
+#include <libacars/vstring.h>           // la_vstring
+#include "metrics.h"
+#include "dumpvdl2.h"                   // ASSERT, debug_print
+#include "output-common.h"              // trace_interval_usec
+#ifdef WITH_ALLOC_STATS
+#include "alloc-stats.h"                // alloc_stats_snapshot
+#endif
+
+#define METRICS_NAMESPACE "dumpvdl2"
+#define METRICS_HISTOGRAM_MAX_BUCKETS 16
+// Histogram sums are stored as integers in millionths of the unit
+#define METRICS_HISTOGRAM_SUM_SCALE 1e6
+
+static char const *channel_counter_names[MC_COUNTER_CNT] = {
+	[MC_AVLC_ERRORS_BAD_FCS] = "avlc.errors.bad_fcs",
+	[MC_AVLC_ERRORS_TOO_SHORT] = "avlc.errors.too_short",
+	[MC_AVLC_FRAMES_GOOD] = "avlc.frames.good",
+	[MC_AVLC_FRAMES_PROCESSED] = "avlc.frames.processed",
+	[MC_AVLC_MSG_AIR2AIR] = "avlc.msg.air2air",
+	[MC_AVLC_MSG_AIR2ALL] = "avlc.msg.air2all",
+	[MC_AVLC_MSG_AIR2GND] = "avlc.msg.air2gnd",
+	[MC_AVLC_MSG_GND2AIR] = "avlc.msg.gnd2air",
+	[MC_AVLC_MSG_GND2ALL] = "avlc.msg.gnd2all",
+	[MC_AVLC_MSG_GND2GND] = "avlc.msg.gnd2gnd",
+	[MC_DECODER_BLOCKS_FEC_OK] = "decoder.blocks.fec_ok",
+	[MC_DECODER_BLOCKS_PROCESSED] = "decoder.blocks.processed",
+	[MC_DECODER_CRC_GOOD] = "decoder.crc.good",
+	[MC_DECODER_CRC_BAD] = "decoder.crc.bad",
+	[MC_DECODER_ERRORS_BITSTREAM] = "decoder.errors.bitstream",
+	[MC_DECODER_ERRORS_DATA_TRUNCATED] = "decoder.errors.data_truncated",
+	[MC_DECODER_ERRORS_DEINTERLEAVE_DATA] = "decoder.errors.deinterleave_data",
+	[MC_DECODER_ERRORS_DEINTERLEAVE_FEC] = "decoder.errors.deinterleave_fec",
+	[MC_DECODER_ERRORS_FEC_BAD] = "decoder.errors.fec_bad",
+	[MC_DECODER_ERRORS_FEC_TRUNCATED] = "decoder.errors.fec_truncated",
+	[MC_DECODER_ERRORS_NO_FEC] = "decoder.errors.no_fec",
+	[MC_DECODER_ERRORS_NO_HEADER] = "decoder.errors.no_header",
+	[MC_DECODER_ERRORS_TOO_LONG] = "decoder.errors.too_long",
+	[MC_DECODER_ERRORS_TRUNCATED_OCTETS] = "decoder.errors.truncated_octets",
+	[MC_DECODER_ERRORS_UNSTUFF] = "decoder.errors.unstuff",
+	[MC_DECODER_MSG_GOOD] = "decoder.msg.good",
+	[MC_DECODER_MSG_GOOD_LOUD] = "decoder.msg.good_loud",
+	[MC_DECODER_PREAMBLES_GOOD] = "decoder.preambles.good",
+	[MC_DEMOD_SYNC_GOOD] = "demod.sync.good"
+};
+
+static char const *msgdir_counter_names[MD_COUNTER_CNT] = {
+	[MD_ACARS_REASM_UNKNOWN] = "acars.reasm.unknown",
+	[MD_ACARS_REASM_COMPLETE] = "acars.reasm.complete",
+	[MD_ACARS_REASM_SKIPPED] = "acars.reasm.skipped",
+	[MD_ACARS_REASM_DUPLICATE] = "acars.reasm.duplicate",
+	[MD_ACARS_REASM_OUT_OF_SEQ] = "acars.reasm.out_of_seq",
+	[MD_ACARS_REASM_INVALID_ARGS] = "acars.reasm.invalid_args",
+	[MD_X25_REASM_UNKNOWN] = "x25.reasm.unknown",
+	[MD_X25_REASM_COMPLETE] = "x25.reasm.complete",
+	[MD_X25_REASM_SKIPPED] = "x25.reasm.skipped",
+	[MD_X25_REASM_DUPLICATE] = "x25.reasm.duplicate",
+	[MD_X25_REASM_OUT_OF_SEQ] = "x25.reasm.out_of_seq",
+	[MD_X25_REASM_INVALID_ARGS] = "x25.reasm.invalid_args"
+};
+
+static char const *msg_dir_labels[] = {
+	[LA_MSG_DIR_UNKNOWN] = "unknown",
+	[LA_MSG_DIR_AIR2GND] = "air2gnd",
+	[LA_MSG_DIR_GND2AIR] = "gnd2air"
+};
+#define MSG_DIR_CNT (sizeof(msg_dir_labels) / sizeof(msg_dir_labels[0]))
+
+static char const *counter_names[M_COUNTER_CNT] = {
+	[M_AC_DATA_CACHE_HITS] = "ac_data.cache.hits",
+	[M_AC_DATA_CACHE_MISSES] = "ac_data.cache.misses",
+	[M_AC_DATA_CACHE_EVICTIONS] = "ac_data.cache.evictions",
+	[M_AC_DATA_DB_HITS] = "ac_data.db.hits",
+	[M_AC_DATA_DB_MISSES] = "ac_data.db.misses",
+	[M_AC_DATA_DB_ERRORS] = "ac_data.db.errors",
+	[M_AC_DATA_LOOKUP_PENDING] = "ac_data.lookup.pending",
+	[M_AC_DATA_SNAPSHOT_RELOADS] = "ac_data.snapshot.reloads",
+	[M_AC_DATA_SNAPSHOT_RELOAD_ERRORS] = "ac_data.snapshot.reload_errors",
+	[M_REASM_OFFSETBASED_EXPIRED] = "reasm.offsetbased.expired",
+	[M_REASM_OFFSETBASED_EVICTED] = "reasm.offsetbased.evicted",
+	[M_REASM_OFFSETBASED_DROPPED] = "reasm.offsetbased.dropped",
+	[M_DEDUP_DROPPED] = "dedup.dropped",
+	[M_DEDUP_REPLACED] = "dedup.replaced",
+	[M_DEDUP_EVICTED] = "dedup.evicted"
+};
+
+static char const *gauge_names[MG_GAUGE_CNT] = {
+	[MG_AC_DATA_CACHE_ENTRIES] = "ac_data.cache.entries",
+	[MG_AC_DATA_CACHE_MEMORY] = "ac_data.cache.memory",
+	[MG_AC_DATA_SNAPSHOT_ENTRIES] = "ac_data.snapshot.entries",
+	[MG_REASM_OFFSETBASED_MEMORY] = "reasm.offsetbased.memory"
+};
+
+static struct {
+	char const *name;
+	char const *unit;                   // appended to the Prometheus metric name
+	int bucket_cnt;
+	double bounds[METRICS_HISTOGRAM_MAX_BUCKETS];   // upper bucket bounds
+} const histogram_descrs[MH_HISTOGRAM_CNT] = {
+	[MH_DECODER_MSG_PROCESSING_TIME] = {
+		.name = "decoder.msg.processing_time",
+		.unit = "seconds",
+		.bucket_cnt = 10,
+		.bounds = { 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5 }
+	},
+	[MH_DECODER_MSG_POWER] = {
+		.name = "decoder.msg.power",
+		.unit = "dbfs",
+		.bucket_cnt = 11,
+		.bounds = { -50.0, -45.0, -40.0, -35.0, -30.0, -25.0, -20.0, -15.0, -10.0, -5.0, 0.0 }
+	},
+#define LATENCY_HISTOGRAM(n) { \
+		.name = n, \
+		.unit = "seconds", \
+		.bucket_cnt = 13, \
+		.bounds = { 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0 } \
+	}
+	[MH_LATENCY_DEMOD] = LATENCY_HISTOGRAM("latency.demod"),
+	[MH_LATENCY_DECODER_QUEUE] = LATENCY_HISTOGRAM("latency.decoder_queue"),
+	[MH_LATENCY_DECODE] = LATENCY_HISTOGRAM("latency.decode"),
+	[MH_LATENCY_FORMAT] = LATENCY_HISTOGRAM("latency.format"),
+	[MH_LATENCY_OUTPUT_QUEUE] = LATENCY_HISTOGRAM("latency.output_queue"),
+	[MH_LATENCY_OUTPUT_WRITE] = LATENCY_HISTOGRAM("latency.output_write"),
+	[MH_LATENCY_TOTAL] = LATENCY_HISTOGRAM("latency.total")
+#undef LATENCY_HISTOGRAM
+};
+
+typedef struct {
+	atomic_uint_fast64_t buckets[METRICS_HISTOGRAM_MAX_BUCKETS + 1];    // the last one is +Inf
+	atomic_int_fast64_t sum;
+} metrics_histogram;
+
+typedef struct {
+	_Alignas(64) uint32_t freq;
+	atomic_uint_fast64_t counters[MC_COUNTER_CNT];
+	metrics_histogram histograms[MH_HISTOGRAM_CNT];
+} metrics_channel;
+
+static metrics_channel channels[METRICS_MAX_CHANNELS];
+// Slots [0..channel_cnt-1] are in use. New slots are appended under
+// register_mutex, lookups are lock-free.
+static atomic_int channel_cnt = 0;
+static pthread_mutex_t register_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+	_Alignas(64) char name[METRICS_QUEUE_NAME_LEN];
+	atomic_uint_fast64_t length;
+	atomic_uint_fast64_t length_max;
+	atomic_uint_fast64_t enqueued;
+	atomic_uint_fast64_t dropped;
+} metrics_queue;
+
+static metrics_queue queues[METRICS_MAX_QUEUES];
+static atomic_int queue_cnt = 0;
+
+static atomic_uint_fast64_t msgdir_counters[MSG_DIR_CNT][MD_COUNTER_CNT];
+static atomic_uint_fast64_t counters[M_COUNTER_CNT];
+// Set while the calling thread processes frames which must not be counted
+static _Thread_local bool suppressed = false;
+static atomic_int_fast64_t gauges[MG_GAUGE_CNT];
+
+static metrics_channel *metrics_channel_find(uint32_t freq, int cnt) {
+	for(int i = 0; i < cnt; i++) {
+		if(channels[i].freq == freq) {
+			return &channels[i];
+		}
+	}
+	return NULL;
+}
+
+static metrics_channel *metrics_channel_get(uint32_t freq) {
+	metrics_channel *c = metrics_channel_find(freq,
+			atomic_load_explicit(&channel_cnt, memory_order_acquire));
+	if(c != NULL) {
+		return c;
+	}
+	// Not registered yet (eg. when processing raw frames from a file)
+	pthread_mutex_lock(&register_mutex);
+	int cnt = atomic_load_explicit(&channel_cnt, memory_order_relaxed);
+	c = metrics_channel_find(freq, cnt);
+	if(c == NULL && cnt < METRICS_MAX_CHANNELS) {
+		c = &channels[cnt];
+		c->freq = freq;
+		atomic_store_explicit(&channel_cnt, cnt + 1, memory_order_release);
+		debug_print(D_STATS, "registered channel %u in slot %d\n", freq, cnt);
+	}
+	pthread_mutex_unlock(&register_mutex);
+	return c;
+}
+
+void metrics_channel_register(uint32_t freq) {
+	if(metrics_channel_get(freq) == NULL) {
+		fprintf(stderr, "Warning: too many channels, metrics for %u Hz will not be reported\n", freq);
+	}
+}
+
+// Disables (or re-enables) counter and histogram updates made by the
+// calling thread. Gauges are not affected, as they reflect the current
+// state rather than the work done. Returns the previous setting.
+bool metrics_suppress(bool suppress) {
+	bool prev = suppressed;
+	suppressed = suppress;
+	return prev;
+}
+
+void metrics_inc_per_channel(uint32_t freq, metrics_channel_counter id) {
+	ASSERT(id < MC_COUNTER_CNT);
+	if(suppressed) {
+		return;
+	}
+	metrics_channel *c = metrics_channel_get(freq);
+	if(c != NULL) {
+		atomic_fetch_add_explicit(&c->counters[id], 1, memory_order_relaxed);
+	}
+}
+
+void metrics_observe_per_channel(uint32_t freq, metrics_channel_histogram id, double value) {
+	ASSERT(id < MH_HISTOGRAM_CNT);
+	if(suppressed) {
+		return;
+	}
+	metrics_channel *c = metrics_channel_get(freq);
+	if(c == NULL) {
+		return;
+	}
+	int bucket_cnt = histogram_descrs[id].bucket_cnt;
+	int b = 0;
+	while(b < bucket_cnt && value > histogram_descrs[id].bounds[b]) {
+		b++;
+	}
+	metrics_histogram *h = &c->histograms[id];
+	atomic_fetch_add_explicit(&h->buckets[b], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&h->sum, llround(value * METRICS_HISTOGRAM_SUM_SCALE), memory_order_relaxed);
+}
+
+// Records the time elapsed since start
+void metrics_timing_per_channel(uint32_t freq, metrics_channel_histogram id, struct timeval start) {
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	if(now.tv_sec < start.tv_sec || (now.tv_sec == start.tv_sec && now.tv_usec < start.tv_usec)) {
+		debug_print(D_STATS, "timediff is negative: start.tv_sec=%lu start.tv_usec=%lu now.tv_sec=%lu now.tv_usec=%lu\n",
+				start.tv_sec, start.tv_usec, now.tv_sec, now.tv_usec);
+		return;
+	}
+	uint64_t tdiff_us = (now.tv_sec - start.tv_sec) * 1000000UL + now.tv_usec - start.tv_usec;
+	metrics_observe_per_channel(freq, id, tdiff_us / 1e6);
+}
+
+// Records the time elapsed between two pipeline trace timestamps.
+// Does nothing if any of them is unset.
+void metrics_observe_interval_per_channel(uint32_t freq, metrics_channel_histogram id,
+		struct timespec const *start, struct timespec const *end) {
+	int64_t usec = trace_interval_usec(start, end);
+	if(usec >= 0) {
+		metrics_observe_per_channel(freq, id, usec / 1e6);
+	}
+}
+
+void metrics_inc_per_msgdir(la_msg_dir msg_dir, metrics_msgdir_counter id) {
+	ASSERT(id < MD_COUNTER_CNT);
+	ASSERT(msg_dir < MSG_DIR_CNT);
+	if(suppressed) {
+		return;
+	}
+	atomic_fetch_add_explicit(&msgdir_counters[msg_dir][id], 1, memory_order_relaxed);
+}
+
+void metrics_inc(metrics_counter id) {
+	ASSERT(id < M_COUNTER_CNT);
+	if(suppressed) {
+		return;
+	}
+	atomic_fetch_add_explicit(&counters[id], 1, memory_order_relaxed);
+}
+
+void metrics_set(metrics_gauge id, int64_t value) {
+	ASSERT(id < MG_GAUGE_CNT);
+	atomic_store_explicit(&gauges[id], value, memory_order_relaxed);
+}
+
+// Registers a queue to be monitored. Returns queue ID to be passed to
+// metrics_queue_* functions or -1 if there are too many queues already.
+int metrics_queue_register(char const *name) {
+	ASSERT(name != NULL);
+	pthread_mutex_lock(&register_mutex);
+	int id = atomic_load_explicit(&queue_cnt, memory_order_relaxed);
+	if(id < METRICS_MAX_QUEUES) {
+		snprintf(queues[id].name, sizeof(queues[id].name), "%s", name);
+		atomic_store_explicit(&queue_cnt, id + 1, memory_order_release);
+	} else {
+		fprintf(stderr, "Warning: too many queues, statistics for queue %s will not be reported\n", name);
+		id = -1;
+	}
+	pthread_mutex_unlock(&register_mutex);
+	return id;
+}
+
+void metrics_queue_push(int queue_id) {
+	if(queue_id < 0) {
+		return;
+	}
+	metrics_queue *q = &queues[queue_id];
+	atomic_fetch_add_explicit(&q->enqueued, 1, memory_order_relaxed);
+	uint_fast64_t len = atomic_fetch_add_explicit(&q->length, 1, memory_order_relaxed) + 1;
+	uint_fast64_t max = atomic_load_explicit(&q->length_max, memory_order_relaxed);
+	while(len > max && !atomic_compare_exchange_weak_explicit(&q->length_max, &max, len,
+				memory_order_relaxed, memory_order_relaxed))
+		;
+}
+
+void metrics_queue_pop(int queue_id) {
+	if(queue_id < 0) {
+		return;
+	}
+	atomic_fetch_sub_explicit(&queues[queue_id].length, 1, memory_order_relaxed);
+}
+
+void metrics_queue_drop(int queue_id) {
+	if(queue_id < 0) {
+		return;
+	}
+	atomic_fetch_add_explicit(&queues[queue_id].dropped, 1, memory_order_relaxed);
+}
+
+char const *metrics_channel_counter_name(metrics_channel_counter id) {
+	return id < MC_COUNTER_CNT ? channel_counter_names[id] : NULL;
+}
+
+char const *metrics_msgdir_counter_name(metrics_msgdir_counter id) {
+	return id < MD_COUNTER_CNT ? msgdir_counter_names[id] : NULL;
+}
+
+char const *metrics_msgdir_label(la_msg_dir msg_dir) {
+	return msg_dir < MSG_DIR_CNT ? msg_dir_labels[msg_dir] : NULL;
+}
+
+char const *metrics_counter_name(metrics_counter id) {
+	return id < M_COUNTER_CNT ? counter_names[id] : NULL;
+}
+
+char const *metrics_gauge_name(metrics_gauge id) {
+	return id < MG_GAUGE_CNT ? gauge_names[id] : NULL;
+}
+
+char const *metrics_channel_histogram_name(metrics_channel_histogram id) {
+	return id < MH_HISTOGRAM_CNT ? histogram_descrs[id].name : NULL;
+}
+
+char const *metrics_channel_histogram_unit(metrics_channel_histogram id) {
+	return id < MH_HISTOGRAM_CNT ? histogram_descrs[id].unit : NULL;
+}
+
+int metrics_channel_cnt(void) {
+	return atomic_load_explicit(&channel_cnt, memory_order_acquire);
+}
+
+uint32_t metrics_channel_freq(int slot) {
+	ASSERT(slot < METRICS_MAX_CHANNELS);
+	return channels[slot].freq;
+}
+
+uint64_t metrics_channel_counter_get(int slot, metrics_channel_counter id) {
+	ASSERT(slot < METRICS_MAX_CHANNELS);
+	ASSERT(id < MC_COUNTER_CNT);
+	return atomic_load_explicit(&channels[slot].counters[id], memory_order_relaxed);
+}
+
+void metrics_channel_histogram_get(int slot, metrics_channel_histogram id, uint64_t *count, double *sum) {
+	ASSERT(slot < METRICS_MAX_CHANNELS);
+	ASSERT(id < MH_HISTOGRAM_CNT);
+	metrics_histogram *h = &channels[slot].histograms[id];
+	uint64_t total = 0;
+	for(int b = 0; b <= histogram_descrs[id].bucket_cnt; b++) {
+		total += atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+	}
+	*count = total;
+	*sum = atomic_load_explicit(&h->sum, memory_order_relaxed) / METRICS_HISTOGRAM_SUM_SCALE;
+}
+
+uint64_t metrics_msgdir_counter_get(la_msg_dir msg_dir, metrics_msgdir_counter id) {
+	ASSERT(msg_dir < MSG_DIR_CNT);
+	ASSERT(id < MD_COUNTER_CNT);
+	return atomic_load_explicit(&msgdir_counters[msg_dir][id], memory_order_relaxed);
+}
+
+uint64_t metrics_counter_get(metrics_counter id) {
+	ASSERT(id < M_COUNTER_CNT);
+	return atomic_load_explicit(&counters[id], memory_order_relaxed);
+}
+
+int64_t metrics_gauge_get(metrics_gauge id) {
+	ASSERT(id < MG_GAUGE_CNT);
+	return atomic_load_explicit(&gauges[id], memory_order_relaxed);
+}
+
+int metrics_queue_cnt(void) {
+	return atomic_load_explicit(&queue_cnt, memory_order_acquire);
+}
+
+void metrics_queue_get(int queue_id, metrics_queue_stats *result) {
+	ASSERT(queue_id >= 0 && queue_id < METRICS_MAX_QUEUES);
+	ASSERT(result != NULL);
+	metrics_queue *q = &queues[queue_id];
+	result->name = q->name;
+	result->length = atomic_load_explicit(&q->length, memory_order_relaxed);
+	result->length_max = atomic_load_explicit(&q->length_max, memory_order_relaxed);
+	result->enqueued = atomic_load_explicit(&q->enqueued, memory_order_relaxed);
+	result->dropped = atomic_load_explicit(&q->dropped, memory_order_relaxed);
+}
+
+/******************************
+ * Prometheus text exposition
+ ******************************/
+
+// Appends the Prometheus name of the given metric (namespace prefix,
+// dots replaced with underscores, optional suffix) to vstr.
+static void prom_append_name(la_vstring *vstr, char const *name, char const *suffix) {
+	la_vstring_append_sprintf(vstr, "%s_", METRICS_NAMESPACE);
+	for(char const *p = name; *p != '\0'; p++) {
+		la_vstring_append_buffer(vstr, *p == '.' ? "_" : p, 1);
+	}
+	if(suffix != NULL) {
+		la_vstring_append_sprintf(vstr, "_%s", suffix);
+	}
+}
+
+static void prom_append_type(la_vstring *vstr, char const *name, char const *suffix, char const *type) {
+	la_vstring_append_sprintf(vstr, "# TYPE ");
+	prom_append_name(vstr, name, suffix);
+	la_vstring_append_sprintf(vstr, " %s\n", type);
+}
+
+static void prom_append_sample(la_vstring *vstr, char const *name, char const *suffix,
+		char const *labels, uint64_t value) {
+	prom_append_name(vstr, name, suffix);
+	la_vstring_append_sprintf(vstr, "%s %llu\n", labels, (unsigned long long)value);
+}
+
+static void prom_format_histogram(la_vstring *vstr, metrics_channel_histogram id, int cnt) {
+	char const *name = histogram_descrs[id].name;
+	char const *unit = histogram_descrs[id].unit;
+	int bucket_cnt = histogram_descrs[id].bucket_cnt;
+	prom_append_type(vstr, name, unit, "histogram");
+	for(int i = 0; i < cnt; i++) {
+		metrics_histogram *h = &channels[i].histograms[id];
+		uint64_t total = 0;
+		for(int b = 0; b <= bucket_cnt; b++) {
+			total += atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+			prom_append_name(vstr, name, unit);
+			if(b < bucket_cnt) {
+				la_vstring_append_sprintf(vstr, "_bucket{freq=\"%u\",le=\"%g\"} %llu\n",
+						channels[i].freq, histogram_descrs[id].bounds[b], (unsigned long long)total);
+			} else {
+				la_vstring_append_sprintf(vstr, "_bucket{freq=\"%u\",le=\"+Inf\"} %llu\n",
+						channels[i].freq, (unsigned long long)total);
+			}
+		}
+		prom_append_name(vstr, name, unit);
+		la_vstring_append_sprintf(vstr, "_sum{freq=\"%u\"} %.6f\n", channels[i].freq,
+				atomic_load_explicit(&h->sum, memory_order_relaxed) / METRICS_HISTOGRAM_SUM_SCALE);
+		prom_append_name(vstr, name, unit);
+		la_vstring_append_sprintf(vstr, "_count{freq=\"%u\"} %llu\n", channels[i].freq,
+				(unsigned long long)total);
+	}
+}
+
+#ifdef WITH_ALLOC_STATS
+// Per-call-site allocation statistics. Sum them up by the "file" label
+// to get the memory usage of a subsystem.
+static void prom_format_alloc_stats(la_vstring *vstr) {
+	static struct {
+		char const *name;
+		char const *suffix;
+		char const *type;
+		size_t offset;
+	} const alloc_metrics[] = {
+		{ "alloc.allocations", "total", "counter", offsetof(alloc_stats_site, count) },
+		{ "alloc.allocated", "bytes_total", "counter", offsetof(alloc_stats_site, bytes) },
+		{ "alloc.live_blocks", NULL, "gauge", offsetof(alloc_stats_site, live_count) },
+		{ "alloc.live", "bytes", "gauge", offsetof(alloc_stats_site, live_bytes) },
+		{ "alloc.live_peak", "bytes", "gauge", offsetof(alloc_stats_site, peak_bytes) }
+	};
+	alloc_stats_site *sites = NULL;
+	size_t cnt = alloc_stats_snapshot(&sites, NULL);
+	char labels[256];
+	for(size_t m = 0; m < sizeof(alloc_metrics) / sizeof(alloc_metrics[0]); m++) {
+		prom_append_type(vstr, alloc_metrics[m].name, alloc_metrics[m].suffix, alloc_metrics[m].type);
+		for(size_t i = 0; i < cnt; i++) {
+			snprintf(labels, sizeof(labels), "{file=\"%s\",line=\"%d\",func=\"%s\"}",
+					sites[i].file, sites[i].line, sites[i].func);
+			prom_append_sample(vstr, alloc_metrics[m].name, alloc_metrics[m].suffix, labels,
+					*(uint64_t *)((char *)&sites[i] + alloc_metrics[m].offset));
+		}
+	}
+	XFREE(sites);
+}
+#endif
+
+// Returns all metrics in Prometheus text exposition format (version 0.0.4).
+// Values are read without any locking, so they might not be consistent
+// with each other, which is fine for monitoring purposes.
+la_vstring *metrics_format_prometheus(void) {
+	la_vstring *vstr = la_vstring_new();
+	char labels[64];
+	int cnt = atomic_load_explicit(&channel_cnt, memory_order_acquire);
+
+	for(int id = 0; id < MC_COUNTER_CNT; id++) {
+		prom_append_type(vstr, channel_counter_names[id], "total", "counter");
+		for(int i = 0; i < cnt; i++) {
+			snprintf(labels, sizeof(labels), "{freq=\"%u\"}", channels[i].freq);
+			prom_append_sample(vstr, channel_counter_names[id], "total", labels,
+					atomic_load_explicit(&channels[i].counters[id], memory_order_relaxed));
+		}
+	}
+	for(int id = 0; id < MH_HISTOGRAM_CNT; id++) {
+		prom_format_histogram(vstr, id, cnt);
+	}
+	for(int id = 0; id < MD_COUNTER_CNT; id++) {
+		prom_append_type(vstr, msgdir_counter_names[id], "total", "counter");
+		for(la_msg_dir dir = 0; dir < MSG_DIR_CNT; dir++) {
+			snprintf(labels, sizeof(labels), "{direction=\"%s\"}", msg_dir_labels[dir]);
+			prom_append_sample(vstr, msgdir_counter_names[id], "total", labels,
+					atomic_load_explicit(&msgdir_counters[dir][id], memory_order_relaxed));
+		}
+	}
+	for(int id = 0; id < M_COUNTER_CNT; id++) {
+		prom_append_type(vstr, counter_names[id], "total", "counter");
+		prom_append_sample(vstr, counter_names[id], "total", "",
+				atomic_load_explicit(&counters[id], memory_order_relaxed));
+	}
+	for(int id = 0; id < MG_GAUGE_CNT; id++) {
+		prom_append_type(vstr, gauge_names[id], NULL, "gauge");
+		prom_append_name(vstr, gauge_names[id], NULL);
+		la_vstring_append_sprintf(vstr, " %lld\n",
+				(long long)atomic_load_explicit(&gauges[id], memory_order_relaxed));
+	}
+
+	static struct {
+		char const *name;
+		char const *suffix;
+		char const *type;
+		size_t offset;
+	} const queue_metrics[] = {
+		{ "queue.length", NULL, "gauge", offsetof(metrics_queue_stats, length) },
+		{ "queue.length_max", NULL, "gauge", offsetof(metrics_queue_stats, length_max) },
+		{ "queue.enqueued", "total", "counter", offsetof(metrics_queue_stats, enqueued) },
+		{ "queue.dropped", "total", "counter", offsetof(metrics_queue_stats, dropped) }
+	};
+	int qcnt = metrics_queue_cnt();
+	metrics_queue_stats qs;
+	for(size_t m = 0; m < sizeof(queue_metrics) / sizeof(queue_metrics[0]); m++) {
+		prom_append_type(vstr, queue_metrics[m].name, queue_metrics[m].suffix, queue_metrics[m].type);
+		for(int i = 0; i < qcnt; i++) {
+			metrics_queue_get(i, &qs);
+			snprintf(labels, sizeof(labels), "{queue=\"%s\"}", qs.name);
+			prom_append_sample(vstr, queue_metrics[m].name, queue_metrics[m].suffix, labels,
+					*(uint64_t *)((char *)&qs + queue_metrics[m].offset));
+		}
+	}
+#ifdef WITH_ALLOC_STATS
+	prom_format_alloc_stats(vstr);
+#endif
+	return vstr;
+}
+
+// Returns queue statistics as a JSON document.
+la_vstring *metrics_format_status_json(void) {
+	la_vstring *vstr = la_vstring_new();
+	la_vstring_append_sprintf(vstr, "{\"queues\":[");
+	int qcnt = metrics_queue_cnt();
+	metrics_queue_stats qs;
+	for(int i = 0; i < qcnt; i++) {
+		metrics_queue_get(i, &qs);
+		la_vstring_append_sprintf(vstr,
+				"%s{\"name\":\"%s\",\"length\":%llu,\"length_max\":%llu,\"enqueued\":%llu,\"dropped\":%llu}",
+				i > 0 ? "," : "", qs.name, (unsigned long long)qs.length, (unsigned long long)qs.length_max,
+				(unsigned long long)qs.enqueued, (unsigned long long)qs.dropped);
+	}
+	la_vstring_append_sprintf(vstr, "]}\n");
+	return vstr;
+}
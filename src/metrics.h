@@ -0,0 +1,183 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <stdint.h>
+#include <sys/time.h>                   // struct timeval
+#include <time.h>                       // struct timespec
+#include <libacars/libacars.h>          // la_msg_dir
+#include <libacars/vstring.h>           // la_vstring
+
+// All metrics are registered statically and referred to by the IDs below.
+// Names of the metrics are kept in metrics.c. When adding a new metric,
+// update the respective name table as well.
+
+// Counters maintained separately for each VDL2 channel
+typedef enum {
+	MC_AVLC_ERRORS_BAD_FCS,
+	MC_AVLC_ERRORS_TOO_SHORT,
+	MC_AVLC_FRAMES_GOOD,
+	MC_AVLC_FRAMES_PROCESSED,
+	MC_AVLC_MSG_AIR2AIR,
+	MC_AVLC_MSG_AIR2ALL,
+	MC_AVLC_MSG_AIR2GND,
+	MC_AVLC_MSG_GND2AIR,
+	MC_AVLC_MSG_GND2ALL,
+	MC_AVLC_MSG_GND2GND,
+	MC_DECODER_BLOCKS_FEC_OK,
+	MC_DECODER_BLOCKS_PROCESSED,
+	MC_DECODER_CRC_GOOD,
+	MC_DECODER_CRC_BAD,
+	MC_DECODER_ERRORS_BITSTREAM,
+	MC_DECODER_ERRORS_DATA_TRUNCATED,
+	MC_DECODER_ERRORS_DEINTERLEAVE_DATA,
+	MC_DECODER_ERRORS_DEINTERLEAVE_FEC,
+	MC_DECODER_ERRORS_FEC_BAD,
+	MC_DECODER_ERRORS_FEC_TRUNCATED,
+	MC_DECODER_ERRORS_NO_FEC,
+	MC_DECODER_ERRORS_NO_HEADER,
+	MC_DECODER_ERRORS_TOO_LONG,
+	MC_DECODER_ERRORS_TRUNCATED_OCTETS,
+	MC_DECODER_ERRORS_UNSTUFF,
+	MC_DECODER_MSG_GOOD,
+	MC_DECODER_MSG_GOOD_LOUD,
+	MC_DECODER_PREAMBLES_GOOD,
+	MC_DEMOD_SYNC_GOOD,
+	MC_COUNTER_CNT
+} metrics_channel_counter;
+
+// Histograms maintained separately for each VDL2 channel
+typedef enum {
+	MH_DECODER_MSG_PROCESSING_TIME,     // seconds
+	MH_DECODER_MSG_POWER,               // dBFS
+	// Latencies of frame processing pipeline stages (seconds)
+	MH_LATENCY_DEMOD,                   // burst sync -> frame queued for decoding
+	MH_LATENCY_DECODER_QUEUE,           // time spent in the decoder queue
+	MH_LATENCY_DECODE,                  // AVLC frame decoding
+	MH_LATENCY_FORMAT,                  // message formatting (each formatter)
+	MH_LATENCY_OUTPUT_QUEUE,            // time spent in the output queue (each output)
+	MH_LATENCY_OUTPUT_WRITE,            // message write by the output driver
+	MH_LATENCY_TOTAL,                   // burst sync -> message written
+	MH_HISTOGRAM_CNT
+} metrics_channel_histogram;
+
+// Counters maintained separately for each message direction
+typedef enum {
+	MD_ACARS_REASM_UNKNOWN,
+	MD_ACARS_REASM_COMPLETE,
+	MD_ACARS_REASM_SKIPPED,
+	MD_ACARS_REASM_DUPLICATE,
+	MD_ACARS_REASM_OUT_OF_SEQ,
+	MD_ACARS_REASM_INVALID_ARGS,
+	MD_X25_REASM_UNKNOWN,
+	MD_X25_REASM_COMPLETE,
+	MD_X25_REASM_SKIPPED,
+	MD_X25_REASM_DUPLICATE,
+	MD_X25_REASM_OUT_OF_SEQ,
+	MD_X25_REASM_INVALID_ARGS,
+	MD_COUNTER_CNT
+} metrics_msgdir_counter;
+
+// Global counters
+typedef enum {
+	M_AC_DATA_CACHE_HITS,
+	M_AC_DATA_CACHE_MISSES,
+	M_AC_DATA_CACHE_EVICTIONS,
+	M_AC_DATA_DB_HITS,
+	M_AC_DATA_DB_MISSES,
+	M_AC_DATA_DB_ERRORS,
+	M_AC_DATA_LOOKUP_PENDING,
+	M_AC_DATA_SNAPSHOT_RELOADS,
+	M_AC_DATA_SNAPSHOT_RELOAD_ERRORS,
+	M_REASM_OFFSETBASED_EXPIRED,
+	M_REASM_OFFSETBASED_EVICTED,
+	M_REASM_OFFSETBASED_DROPPED,
+	M_DEDUP_DROPPED,
+	M_DEDUP_REPLACED,
+	M_DEDUP_EVICTED,
+	M_COUNTER_CNT
+} metrics_counter;
+
+// Global gauges
+typedef enum {
+	MG_AC_DATA_CACHE_ENTRIES,
+	MG_AC_DATA_CACHE_MEMORY,
+	MG_AC_DATA_SNAPSHOT_ENTRIES,
+	MG_REASM_OFFSETBASED_MEMORY,
+	MG_GAUGE_CNT
+} metrics_gauge;
+
+// Max number of distinct channel frequencies tracked.
+// Metrics for channels above this limit are silently discarded.
+#define METRICS_MAX_CHANNELS 64
+// Max number of queues tracked
+#define METRICS_MAX_QUEUES 32
+#define METRICS_QUEUE_NAME_LEN 32
+
+// Statistics of a message queue
+typedef struct {
+	char const *name;
+	uint64_t length;                    // current number of entries
+	uint64_t length_max;                // high-water mark
+	uint64_t enqueued;                  // total number of entries pushed
+	uint64_t dropped;                   // total number of entries discarded instead of being pushed
+} metrics_queue_stats;
+
+// metrics.c
+void metrics_channel_register(uint32_t freq);
+void metrics_inc_per_channel(uint32_t freq, metrics_channel_counter id);
+void metrics_observe_per_channel(uint32_t freq, metrics_channel_histogram id, double value);
+void metrics_timing_per_channel(uint32_t freq, metrics_channel_histogram id, struct timeval start);
+void metrics_observe_interval_per_channel(uint32_t freq, metrics_channel_histogram id,
+		struct timespec const *start, struct timespec const *end);
+bool metrics_suppress(bool suppress);
+void metrics_inc_per_msgdir(la_msg_dir msg_dir, metrics_msgdir_counter id);
+void metrics_inc(metrics_counter id);
+void metrics_set(metrics_gauge id, int64_t value);
+int metrics_queue_register(char const *name);
+void metrics_queue_push(int queue_id);
+void metrics_queue_pop(int queue_id);
+void metrics_queue_drop(int queue_id);
+char const *metrics_channel_counter_name(metrics_channel_counter id);
+char const *metrics_msgdir_counter_name(metrics_msgdir_counter id);
+char const *metrics_msgdir_label(la_msg_dir msg_dir);
+char const *metrics_counter_name(metrics_counter id);
+char const *metrics_gauge_name(metrics_gauge id);
+char const *metrics_channel_histogram_name(metrics_channel_histogram id);
+char const *metrics_channel_histogram_unit(metrics_channel_histogram id);
+// Readers for exporters. Channels are identified by slot numbers
+// in the range [0, metrics_channel_cnt() - 1].
+int metrics_channel_cnt(void);
+uint32_t metrics_channel_freq(int slot);
+uint64_t metrics_channel_counter_get(int slot, metrics_channel_counter id);
+void metrics_channel_histogram_get(int slot, metrics_channel_histogram id, uint64_t *count, double *sum);
+uint64_t metrics_msgdir_counter_get(la_msg_dir msg_dir, metrics_msgdir_counter id);
+uint64_t metrics_counter_get(metrics_counter id);
+int64_t metrics_gauge_get(metrics_gauge id);
+int metrics_queue_cnt(void);
+void metrics_queue_get(int queue_id, metrics_queue_stats *result);
+la_vstring *metrics_format_status_json(void);
+la_vstring *metrics_format_prometheus(void);
+
+// metrics-server.c
+int metrics_server_start(char const *listen_addr);
+
+#endif // !_METRICS_H
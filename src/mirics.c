@@ -20,11 +20,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <stdatomic.h>             // atomic_int
+#include <pthread.h>               // pthread_mutex_*
 #include <mirisdr.h>
 #include "dumpvdl2.h"
 #include "mirics.h"
 
-static mirisdr_dev_t *mirisdr = NULL;
+// Devices opened by all mirisdr_init() instances, for mirisdr_cancel().
+// Published in the same way as in rtl.c - the pointer is stored first, then
+// the count is incremented with release semantics. The mutex serializes
+// concurrent mirisdr_init() calls.
+static mirisdr_dev_t *mirisdr_devs[INPUTS_MAX];
+static atomic_int mirisdr_dev_cnt;
+static pthread_mutex_t mirisdr_devs_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /* taken from librtlsdr-keenerd, (c) Kyle Keen */
 static int mirisdr_nearest_gain(mirisdr_dev_t *dev, int target_gain) {
@@ -112,9 +120,9 @@ static int mirisdr_verbose_device_search(char *s) {
 	return -1;
 }
 
-void mirisdr_init(vdl2_state_t *ctx, char *dev, int flavour, uint32_t freq, float gain,
+void mirisdr_init(vdl2_state_t *ctx, char *dev, int flavour, uint32_t freq, uint32_t sample_rate, float gain,
 		int freq_offset, int usb_xfer_mode) {
-	UNUSED(ctx);
+	mirisdr_dev_t *mirisdr = NULL;
 	int r;
 
 	mirisdr_hw_flavour_t hw_flavour;
@@ -137,6 +145,11 @@ void mirisdr_init(vdl2_state_t *ctx, char *dev, int flavour, uint32_t freq, floa
 		fprintf(stderr, "Failed to open mirisdr device #%u: error %d\n", device, r);
 		_exit(1);
 	}
+	pthread_mutex_lock(&mirisdr_devs_mutex);
+	int cnt = atomic_load_explicit(&mirisdr_dev_cnt, memory_order_relaxed);
+	mirisdr_devs[cnt] = mirisdr;
+	atomic_store_explicit(&mirisdr_dev_cnt, cnt + 1, memory_order_release);
+	pthread_mutex_unlock(&mirisdr_devs_mutex);
 
 	r = mirisdr_set_hw_flavour(mirisdr, hw_flavour);
 	if(r < 0) {
@@ -157,7 +170,7 @@ void mirisdr_init(vdl2_state_t *ctx, char *dev, int flavour, uint32_t freq, floa
 	}
 	fprintf(stderr, "Using USB transfer mode %s\n", mirisdr_get_transfer(mirisdr));
 
-	r = mirisdr_set_sample_rate(mirisdr, MIRISDR_RATE);
+	r = mirisdr_set_sample_rate(mirisdr, sample_rate);
 	if (r < 0) {
 		fprintf(stderr, "Failed to set sample rate for device #%d: error %d\n", device, r);
 		_exit(1);
@@ -199,15 +212,25 @@ void mirisdr_init(vdl2_state_t *ctx, char *dev, int flavour, uint32_t freq, floa
 		_exit(1);
 	}
 	mirisdr_reset_buffer(mirisdr);
+	// A signal which arrived before the async read has started could not
+	// cancel it. Pairs with the fence in mirisdr_cancel().
+	atomic_thread_fence(memory_order_seq_cst);
+	if(do_exit != 0) {
+		return;
+	}
 	fprintf(stderr, "Device %d started\n", device);
-	sbuf = XCALLOC(MIRISDR_BUFSIZE / sizeof(int16_t), sizeof(float));
-	if(mirisdr_read_async(mirisdr, process_buf_short, NULL, MIRISDR_BUFCNT, MIRISDR_BUFSIZE) < 0) {
+	ctx->sbuf = XCALLOC(MIRISDR_BUFSIZE / sizeof(int16_t), sizeof(float));
+	if(mirisdr_read_async(mirisdr, process_buf_short, ctx, MIRISDR_BUFCNT, MIRISDR_BUFSIZE) < 0) {
 		fprintf(stderr, "Device #%d: async read failed\n", device);
 		_exit(1);
 	}
 }
 
 void mirisdr_cancel() {
-	if(mirisdr != NULL)
-		mirisdr_cancel_async(mirisdr);
+	atomic_thread_fence(memory_order_seq_cst);
+	int cnt = atomic_load_explicit(&mirisdr_dev_cnt, memory_order_acquire);
+	for(int i = 0; i < cnt; i++) {
+		if(mirisdr_devs[i] != NULL)
+			mirisdr_cancel_async(mirisdr_devs[i]);
+	}
 }
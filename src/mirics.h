@@ -21,9 +21,8 @@
 #define MIRISDR_BUFSIZE 320000
 #define MIRISDR_BUFCNT 32
 #define MIRISDR_OVERSAMPLE 13
-#define MIRISDR_RATE (SYMBOL_RATE * SPS * MIRISDR_OVERSAMPLE)
 
 // mirics.c
-void mirisdr_init(vdl2_state_t *ctx, char *dev, int flavour, uint32_t freq, float gain,
+void mirisdr_init(vdl2_state_t *ctx, char *dev, int flavour, uint32_t freq, uint32_t sample_rate, float gain,
 		int freq_offset, int usb_xfer_mode);
 void mirisdr_cancel();
@@ -18,11 +18,14 @@
  */
 
 #include <string.h>             // memset, strcmp, strdup
+#include <time.h>               // clock_gettime
 #include <glib.h>               // g_async_queue_new
 #include <libacars/dict.h>      // la_dict
 #include "config.h"             // WITH_*
 #include "dumpvdl2.h"           // NEW, ASSERT
 #include "output-common.h"
+#include "metrics.h"            // metrics_observe_interval_per_channel, metrics_queue_*
+#include "bench.h"              // bench_stage_*
 
 #include "fmtr-text.h"          // fmtr_DEF_text
 #include "fmtr-pp_acars.h"      // fmtr_DEF_pp_acars
@@ -33,6 +36,9 @@
 
 #include "output-file.h"        // out_DEF_file
 #include "output-udp.h"         // out_DEF_udp
+#ifdef HAVE_SYS_MMAN_H
+#include "output-shm.h"         // out_DEF_shm
+#endif
 #ifdef WITH_ZMQ
 #include "output-zmq.h"         // out_DEF_zmq
 #endif
@@ -71,6 +77,9 @@ static la_dict const fmtr_descriptors[] = {
 static output_descriptor_t * output_descriptors[] = {
 	&out_DEF_file,
 	&out_DEF_udp,
+#ifdef HAVE_SYS_MMAN_H
+	&out_DEF_shm,
+#endif
 #ifdef WITH_ZMQ
 	&out_DEF_zmq,
 #endif
@@ -122,11 +131,15 @@ output_descriptor_t *output_descriptor_get(char const *output_name) {
 
 output_instance_t *output_instance_new(output_descriptor_t *outtd, output_format_t format, void *priv) {
 	ASSERT(outtd != NULL);
+	static int output_cnt = 0;
 	NEW(output_ctx_t, ctx);
 	ctx->q = g_async_queue_new();
 	ctx->format = format;
 	ctx->priv = priv;
 	ctx->active = true;
+	char queue_name[METRICS_QUEUE_NAME_LEN];
+	snprintf(queue_name, sizeof(queue_name), "%s_%d", outtd->name, ++output_cnt);
+	ctx->queue_id = metrics_queue_register(queue_name);
 	NEW(output_instance_t, output);
 	output->td = outtd;
 	output->ctx = ctx;
@@ -158,11 +171,13 @@ void output_qentry_destroy(output_qentry_t *q) {
 	XFREE(q);
 }
 
-void output_queue_drain(GAsyncQueue *q) {
+void output_queue_drain(GAsyncQueue *q, int queue_id) {
 	ASSERT(q != NULL);
 	g_async_queue_lock(q);
 	while(g_async_queue_length_unlocked(q) > 0) {
 		output_qentry_t *qentry = g_async_queue_pop_unlocked(q);
+		metrics_queue_pop(queue_id);
+		metrics_queue_drop(queue_id);
 		output_qentry_destroy(qentry);
 	}
 	g_async_queue_unlock(q);
@@ -186,6 +201,22 @@ void vdl2_msg_metadata_destroy(vdl2_msg_metadata *m) {
 	XFREE(m);
 }
 
+void vdl2_msg_trace_mark(vdl2_msg_metadata *m, vdl2_msg_trace_stage stage) {
+	ASSERT(m != NULL);
+	ASSERT(stage < TRACE_STAGE_CNT);
+	clock_gettime(CLOCK_MONOTONIC, &m->trace[stage]);
+}
+
+// Returns the time elapsed between two trace timestamps in microseconds
+// or -1 if any of them is unset.
+int64_t trace_interval_usec(struct timespec const *start, struct timespec const *end) {
+	if((start->tv_sec == 0 && start->tv_nsec == 0) || (end->tv_sec == 0 && end->tv_nsec == 0)) {
+		return -1;
+	}
+	int64_t usec = (int64_t)(end->tv_sec - start->tv_sec) * 1000000 + (end->tv_nsec - start->tv_nsec) / 1000;
+	return usec >= 0 ? usec : -1;
+}
+
 void output_usage() {
 	fprintf(stderr, "\n<output_specifier> is a parameter of the --output option. It has the following syntax:\n\n");
 	fprintf(stderr, "%*s<what_to_output>:<output_format>:<output_type>:<output_parameters>\n\n", IND(1), "");
@@ -234,10 +265,23 @@ void *output_thread(void *arg) {
 	while(1) {
 		output_qentry_t *q = g_async_queue_pop(ctx->q);
 		ASSERT(q != NULL);
+		metrics_queue_pop(ctx->queue_id);
 		if(q->flags & OUT_FLAG_ORDERED_SHUTDOWN) {
 			break;
 		}
+		struct timespec dequeued, written;
+		clock_gettime(CLOCK_MONOTONIC, &dequeued);
+		uint64_t t = bench_stage_start();
 		int result = oi->td->produce(ctx->priv, q->format, q->metadata, q->msg);
+		bench_stage_end(BENCH_OUTPUT, t);
+		if(q->metadata != NULL) {
+			clock_gettime(CLOCK_MONOTONIC, &written);
+			vdl2_msg_metadata *m = q->metadata;
+			metrics_observe_interval_per_channel(m->freq, MH_LATENCY_OUTPUT_QUEUE,
+					&m->trace[TRACE_FORMATTED], &dequeued);
+			metrics_observe_interval_per_channel(m->freq, MH_LATENCY_OUTPUT_WRITE, &dequeued, &written);
+			metrics_observe_interval_per_channel(m->freq, MH_LATENCY_TOTAL, &m->trace[TRACE_SYNC], &written);
+		}
 		output_qentry_destroy(q);
 		if(result < 0) {
 			break;
@@ -255,6 +299,6 @@ fail:
 	if(oi->td->handle_failure != NULL) {
 		oi->td->handle_failure(ctx->priv);
 	}
-	output_queue_drain(ctx->q);
+	output_queue_drain(ctx->q, ctx->queue_id);
 	return NULL;
 }
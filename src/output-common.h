@@ -21,12 +21,24 @@
 #define _OUTPUT_COMMON_H
 
 #include <pthread.h>                    // pthread_t
+#include <time.h>                       // struct timespec
 #include <glib.h>                       // g_async_queue
 #include <libacars/libacars.h>          // la_proto_node
 #include <libacars/list.h>              // la_list
 #include "dumpvdl2.h"                   // octet_string_t
 #include "kvargs.h"                     // kvargs
 
+// Stages of the processing pipeline of a VDL2 frame, for latency tracing
+typedef enum {
+	TRACE_SYNC,                         // burst sync found by the demodulator
+	TRACE_ENQUEUED,                     // frame pushed to the decoder queue
+	TRACE_DECODE_START,                 // frame taken off the queue for decoding
+	TRACE_DECODED,                      // AVLC frame decoded
+	TRACE_FORMAT_START,                 // formatter invoked
+	TRACE_FORMATTED,                    // formatter finished
+	TRACE_STAGE_CNT
+} vdl2_msg_trace_stage;
+
 // Metadata of a VDL2 frame
 typedef struct {
 	char *station_id;                   // textual identifier of the receiving station
@@ -40,6 +52,8 @@ typedef struct {
 	int num_fec_corrections;            // number of octets corrected by FEC
 	int idx;                            // message number
 	struct timeval burst_timestamp;     // receive timestamp of the VDL2 burst (not message!)
+	struct timespec trace[TRACE_STAGE_CNT];     // CLOCK_MONOTONIC timestamps of pipeline stages
+	                                            // (zero if the stage has not been reached)
 } vdl2_msg_metadata;
 
 // Data type on formatter input
@@ -105,6 +119,7 @@ typedef struct {
 	void *priv;                     // output instance context (private)
 	output_format_t format;         // format of the data fed into the output
 	bool active;                    // output thread is running
+	int queue_id;                   // ID of the input queue in the metrics registry
 } output_ctx_t;
 
 // Output instance
@@ -134,11 +149,13 @@ output_descriptor_t *output_descriptor_get(char const *output_name);
 output_instance_t *output_instance_new(output_descriptor_t *outtd, output_format_t format, void *priv);
 output_qentry_t *output_qentry_copy(output_qentry_t const *q);
 void output_qentry_destroy(output_qentry_t *q);
-void output_queue_drain(GAsyncQueue *q);
+void output_queue_drain(GAsyncQueue *q, int queue_id);
 void *output_thread(void *arg);
 
 vdl2_msg_metadata *vdl2_msg_metadata_copy(vdl2_msg_metadata const *m);
 void vdl2_msg_metadata_destroy(vdl2_msg_metadata *m);
+void vdl2_msg_trace_mark(vdl2_msg_metadata *m, vdl2_msg_trace_stage stage);
+int64_t trace_interval_usec(struct timespec const *start, struct timespec const *end);
 
 void output_usage();
 
@@ -21,11 +21,16 @@
 #include <string.h>                     // strcmp, strdup, strerror
 #include <time.h>                       // gmtime_r, localtime_r, strftime
 #include <errno.h>                      // errno
-#include <arpa/inet.h>                  // htons
+#include <unistd.h>                     // unlink
+#include <arpa/inet.h>                  // htons, ntohs
+#include "config.h"                     // WITH_PROTOBUF_C
 #include "output-common.h"              // output_descriptor_t, output_qentry_t, output_queue_drain
 #include "output-file.h"                // OUT_BINARY_FRAME_LEN_OCTETS, OUT_BINARY_FRAME_LEN_MAX
 #include "kvargs.h"                     // kvargs
 #include "dumpvdl2.h"                   // do_exit, option_descr_t
+#ifdef WITH_PROTOBUF_C
+#include "raw_frames_index.h"           // raw_frames_index_*
+#endif
 
 typedef enum {
 	ROT_NONE,
@@ -37,9 +42,16 @@ typedef struct {
 	FILE *fh;
 	char *filename_prefix;
 	char *extension;
+	char *filename;                     // name of the currently open file
 	size_t prefix_len;
 	struct tm current_tm;
 	out_file_rotation_mode rotate;
+#ifdef WITH_PROTOBUF_C
+	bool index;                         // write sidecar index of binary frames
+	bool index_disabled;                // index can't be maintained for the current file
+	FILE *idx_fh;
+	uint64_t offset;                    // current length of the data file
+#endif
 } out_file_ctx_t;
 
 static bool out_file_supports_format(output_format_t format) {
@@ -68,6 +80,20 @@ static void *out_file_configure(kvargs *kv) {
 	} else {
 		cfg->rotate = ROT_NONE;
 	}
+	char *index = kvargs_get(kv, "index");
+	if(index != NULL) {
+#ifdef WITH_PROTOBUF_C
+		if(!strcmp(index, "1")) {
+			cfg->index = true;
+		} else if(strcmp(index, "0") != 0) {
+			fprintf(stderr, "output_file: invalid index value: %s (must be 0 or 1)\n", index);
+			goto fail;
+		}
+#else
+		fprintf(stderr, "output_file: index option requires binary format support\n");
+		goto fail;
+#endif
+	}
 	return cfg;
 fail:
 	XFREE(cfg);
@@ -109,16 +135,125 @@ static int out_file_open(out_file_ctx_t *self) {
 		XFREE(filename);
 		return -1;
 	}
-	XFREE(filename);
+	XFREE(self->filename);
+	self->filename = filename;
+#ifdef WITH_PROTOBUF_C
+	if(self->index) {
+		fseeko(self->fh, 0, SEEK_END);
+		self->offset = (uint64_t)ftello(self->fh);
+	}
+#endif
+	return 0;
+}
+
+#ifdef WITH_PROTOBUF_C
+// Checks whether the index describes all frames currently stored in the data file,
+// ie. whether the last indexed frame ends exactly at the end of the data file.
+static bool out_file_index_is_consistent(out_file_ctx_t *self, off_t idx_len) {
+	if(idx_len == RAW_FRAMES_INDEX_HEADER_LEN) {
+		return self->offset == 0;
+	}
+	if(idx_len < RAW_FRAMES_INDEX_HEADER_LEN + RAW_FRAMES_INDEX_RECORD_LEN) {
+		return false;
+	}
+	uint8_t buf[RAW_FRAMES_INDEX_RECORD_LEN];
+	off_t last = idx_len - (idx_len - RAW_FRAMES_INDEX_HEADER_LEN) % RAW_FRAMES_INDEX_RECORD_LEN -
+		RAW_FRAMES_INDEX_RECORD_LEN;
+	if(fseeko(self->idx_fh, 0, SEEK_SET) < 0 ||
+			fread(buf, 1, RAW_FRAMES_INDEX_HEADER_LEN, self->idx_fh) != RAW_FRAMES_INDEX_HEADER_LEN ||
+			!raw_frames_index_header_is_valid(buf, RAW_FRAMES_INDEX_HEADER_LEN) ||
+			fseeko(self->idx_fh, last, SEEK_SET) < 0 ||
+			fread(buf, 1, RAW_FRAMES_INDEX_RECORD_LEN, self->idx_fh) != RAW_FRAMES_INDEX_RECORD_LEN) {
+		return false;
+	}
+	raw_frames_index_record_t r;
+	raw_frames_index_record_decode(buf, &r);
+	uint16_t frame_len_be = 0;
+	bool result = fseeko(self->fh, (off_t)r.offset, SEEK_SET) == 0 &&
+		fread(&frame_len_be, OUT_BINARY_FRAME_LEN_OCTETS, 1, self->fh) == 1 &&
+		r.offset + ntohs(frame_len_be) == self->offset;
+	fseeko(self->fh, 0, SEEK_END);
+	return result;
+}
+
+static int out_file_index_open(out_file_ctx_t *self) {
+	ASSERT(self->filename != NULL);
+	size_t len = strlen(self->filename) + strlen(RAW_FRAMES_INDEX_SUFFIX) + 1;
+	char *idx_filename = XCALLOC(len, sizeof(char));
+	snprintf(idx_filename, len, "%s%s", self->filename, RAW_FRAMES_INDEX_SUFFIX);
+	if((self->idx_fh = fopen(idx_filename, "a+")) == NULL) {
+		fprintf(stderr, "Could not open index file %s: %s\n", idx_filename, strerror(errno));
+		XFREE(idx_filename);
+		return -1;
+	}
+	fseeko(self->idx_fh, 0, SEEK_END);
+	off_t idx_len = ftello(self->idx_fh);
+	if(idx_len == 0 && self->offset == 0) {
+		uint8_t hdr[RAW_FRAMES_INDEX_HEADER_LEN];
+		raw_frames_index_header_encode(hdr);
+		fwrite(hdr, sizeof(hdr), 1, self->idx_fh);
+		fflush(self->idx_fh);
+	} else if(!out_file_index_is_consistent(self, idx_len)) {
+		// Appending to such index would make it describe wrong frames
+		fprintf(stderr, "output_file: index file %s does not match data file %s, "
+				"not indexing this file\n", idx_filename, self->filename);
+		fclose(self->idx_fh);
+		self->idx_fh = NULL;
+		self->index_disabled = true;
+		if(idx_len == 0) {
+			// Don't leave an empty index file behind
+			unlink(idx_filename);
+		}
+	}
+	XFREE(idx_filename);
 	return 0;
 }
 
+static void out_file_index_close(out_file_ctx_t *self) {
+	if(self->idx_fh != NULL) {
+		fclose(self->idx_fh);
+		self->idx_fh = NULL;
+	}
+	self->index_disabled = false;
+}
+
+static void out_file_index_append(out_file_ctx_t *self, octet_string_t *msg) {
+	if(self->index_disabled) {
+		return;
+	}
+	if(self->idx_fh == NULL && out_file_index_open(self) < 0) {
+		self->index_disabled = true;
+		return;
+	}
+	if(self->idx_fh == NULL) {
+		return;
+	}
+	raw_frames_index_record_t r = { .offset = self->offset };
+	// The output only gets the serialized message, so the record is built by
+	// unpacking it once more. This is also how raw frames are told apart from
+	// decoded ones, which are not readable with --raw-frames-file and
+	// therefore not indexed.
+	if(raw_frames_index_record_from_frame(msg->buf, msg->len, &r)) {
+		uint8_t buf[RAW_FRAMES_INDEX_RECORD_LEN];
+		raw_frames_index_record_encode(&r, buf);
+		fwrite(buf, sizeof(buf), 1, self->idx_fh);
+		fflush(self->idx_fh);
+	}
+}
+#endif
+
 static int out_file_init(void *selfptr) {
 	ASSERT(selfptr != NULL);
 	out_file_ctx_t *self = selfptr;
 	if(!strcmp(self->filename_prefix, "-")) {
 		self->fh = stdout;
 		self->rotate = ROT_NONE;
+#ifdef WITH_PROTOBUF_C
+		if(self->index) {
+			fprintf(stderr, "output_file: index is not supported when writing to standard output\n");
+			self->index = false;
+		}
+#endif
 	} else {
 		self->prefix_len = strlen(self->filename_prefix);
 		if(self->rotate != ROT_NONE) {
@@ -159,6 +294,9 @@ static int out_file_rotate(out_file_ctx_t *self) {
 			fclose(self->fh);
 			self->fh = NULL;
 		}
+#ifdef WITH_PROTOBUF_C
+		out_file_index_close(self);
+#endif
 		return out_file_open(self);
 	}
 	return 0;
@@ -189,6 +327,12 @@ static void out_file_produce_binary(out_file_ctx_t *self, vdl2_msg_metadata *met
     fwrite(&frame_len_be, OUT_BINARY_FRAME_LEN_OCTETS, 1, self->fh);
     fwrite(msg->buf, sizeof(uint8_t), msg->len, self->fh);
     fflush(self->fh);
+#ifdef WITH_PROTOBUF_C
+    if(self->index) {
+        out_file_index_append(self, msg);
+        self->offset += frame_len;
+    }
+#endif
 }
 
 static int out_file_produce(void *selfptr, output_format_t format, vdl2_msg_metadata *metadata, octet_string_t *msg) {
@@ -213,6 +357,9 @@ static void out_file_handle_shutdown(void *selfptr) {
 		fclose(self->fh);
 		self->fh = NULL;
 	}
+#ifdef WITH_PROTOBUF_C
+	out_file_index_close(self);
+#endif
 }
 
 static void out_file_handle_failure(void *selfptr) {
@@ -224,6 +371,9 @@ static void out_file_handle_failure(void *selfptr) {
 		fclose(self->fh);
 		self->fh = NULL;
 	}
+#ifdef WITH_PROTOBUF_C
+	out_file_index_close(self);
+#endif
 }
 
 static option_descr_t const out_file_options[] = {
@@ -235,6 +385,12 @@ static option_descr_t const out_file_options[] = {
 		.name = "rotate",
 		.description = "How often to start a new file: Accepted values: daily, hourly"
 	},
+#ifdef WITH_PROTOBUF_C
+	{
+		.name = "index",
+		.description = "Set to 1 to write a sidecar index of raw frames (binary format only) to <path>" RAW_FRAMES_INDEX_SUFFIX
+	},
+#endif
 	{
 		.name = NULL,
 		.description = NULL
@@ -20,7 +20,9 @@
 #ifndef _OUTPUT_FILE_H
 #define _OUTPUT_FILE_H
 
-#include "output-common.h"          // output_descriptor_t
+#include <stdbool.h>
+#include <stdint.h>
+#include "output-common.h"          // output_descriptor_t, vdl2_msg_metadata
 
 // Maximum allowed length of a binary-serialized frame (including length field)
 #define OUT_BINARY_FRAME_LEN_MAX       65536
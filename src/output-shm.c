@@ -0,0 +1,236 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>                      // fprintf
+#include <stdlib.h>                     // strtoul
+#include <string.h>                     // memcpy, strdup, strerror
+#include <stdatomic.h>                  // atomic_*
+#include <errno.h>                      // errno
+#include <time.h>                       // time
+#include <unistd.h>                     // close, ftruncate, getpid
+#include <fcntl.h>                      // open
+#include <sys/mman.h>                   // mmap, munmap
+#include "output-common.h"              // output_descriptor_t, output_qentry_t
+#include "output-shm.h"                 // struct shm_ring_header, struct shm_ring_record
+#include "kvargs.h"                     // kvargs, option_descr_t
+#include "dumpvdl2.h"                   // NEW, XFREE, ASSERT
+
+#define SHM_RING_HEADER_LEN     64
+#define SHM_RING_DEFAULT_SIZE   (4U * 1024U * 1024U)
+#define SHM_RING_MIN_SIZE       (64U * 1024U)
+#define SHM_RING_MAX_SIZE       (1024U * 1024U * 1024U)
+#define SHM_ROUND_UP(x)         (((x) + SHM_RING_ALIGN - 1) & ~((uint64_t)SHM_RING_ALIGN - 1))
+
+typedef struct {
+	char *path;
+	size_t data_len;
+	size_t map_len;
+	struct shm_ring_header *hdr;
+	uint8_t *data;
+	uint64_t pos;                       // writer's private copy of write_pos
+	uint64_t seq;                       // writer's private copy of write_seq
+} out_shm_ctx_t;
+
+static bool out_shm_supports_format(output_format_t format) {
+	return(format == OFMT_TEXT || format == OFMT_JSON || format == OFMT_BINARY);
+}
+
+static void *out_shm_configure(kvargs *kv) {
+	ASSERT(kv != NULL);
+	NEW(out_shm_ctx_t, cfg);
+	if(kvargs_get(kv, "path") == NULL) {
+		fprintf(stderr, "output_shm: path not specified\n");
+		goto fail;
+	}
+	cfg->path = strdup(kvargs_get(kv, "path"));
+	cfg->data_len = SHM_RING_DEFAULT_SIZE;
+	char *size = kvargs_get(kv, "size");
+	if(size != NULL) {
+		char *endptr = NULL;
+		unsigned long val = strtoul(size, &endptr, 10);
+		if(endptr == size) {
+			fprintf(stderr, "output_shm: invalid ring size: %s\n", size);
+			goto fail;
+		}
+		if(*endptr == 'k' || *endptr == 'K') {
+			val *= 1024UL;
+			endptr++;
+		} else if(*endptr == 'm' || *endptr == 'M') {
+			val *= 1024UL * 1024UL;
+			endptr++;
+		}
+		if(*endptr != '\0' || val < SHM_RING_MIN_SIZE || val > SHM_RING_MAX_SIZE) {
+			fprintf(stderr, "output_shm: invalid ring size: %s (allowed range: %uk - %uM)\n",
+					size, SHM_RING_MIN_SIZE / 1024U, SHM_RING_MAX_SIZE / 1024U / 1024U);
+			goto fail;
+		}
+		cfg->data_len = SHM_ROUND_UP(val);
+	}
+	debug_print(D_OUTPUT, "path: %s data_len: %zu\n", cfg->path, cfg->data_len);
+	return cfg;
+fail:
+	XFREE(cfg->path);
+	XFREE(cfg);
+	return NULL;
+}
+
+static int out_shm_init(void *selfptr) {
+	ASSERT(selfptr != NULL);
+	out_shm_ctx_t *self = selfptr;
+
+	int fd = open(self->path, O_RDWR | O_CREAT, 0644);
+	if(fd < 0) {
+		fprintf(stderr, "output_shm: could not open %s: %s\n", self->path, strerror(errno));
+		return -1;
+	}
+	self->map_len = SHM_RING_HEADER_LEN + self->data_len;
+	// Truncate to zero first to invalidate the magic for any readers which
+	// might still have the previous instance of the ring mapped
+	if(ftruncate(fd, 0) < 0 || ftruncate(fd, (off_t)self->map_len) < 0) {
+		fprintf(stderr, "output_shm: could not resize %s to %zu bytes: %s\n",
+				self->path, self->map_len, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	void *map = mmap(NULL, self->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED) {
+		fprintf(stderr, "output_shm: could not map %s: %s\n", self->path, strerror(errno));
+		return -1;
+	}
+	self->hdr = map;
+	self->data = (uint8_t *)map + SHM_RING_HEADER_LEN;
+	self->pos = 0;
+	self->seq = 0;
+
+	struct shm_ring_header *hdr = self->hdr;
+	hdr->version = SHM_RING_VERSION;
+	hdr->header_len = SHM_RING_HEADER_LEN;
+	hdr->data_len = self->data_len;
+	hdr->writer_pid = (uint32_t)getpid();
+	hdr->generation = (uint64_t)time(NULL);
+	atomic_init(&hdr->reserve_pos, 0);
+	atomic_init(&hdr->write_pos, 0);
+	atomic_init(&hdr->write_seq, 0);
+	atomic_thread_fence(memory_order_release);
+	memcpy(hdr->magic, SHM_RING_MAGIC, sizeof(hdr->magic));
+	fprintf(stderr, "output_shm: ring %s created, data area size: %zu bytes\n",
+			self->path, self->data_len);
+	return 0;
+}
+
+static int out_shm_produce(void *selfptr, output_format_t format, vdl2_msg_metadata *metadata, octet_string_t *msg) {
+	UNUSED(metadata);
+	ASSERT(selfptr != NULL);
+	ASSERT(msg != NULL);
+	out_shm_ctx_t *self = selfptr;
+	struct shm_ring_header *hdr = self->hdr;
+
+	if(msg->len < 1) {
+		return 0;
+	}
+	// Records carry their own length, so no separator is appended
+	uint64_t rec_len = SHM_ROUND_UP(sizeof(struct shm_ring_record) + msg->len);
+	if(rec_len > self->data_len / 2) {
+		fprintf(stderr, "output_shm: message too large for the ring: %zu bytes\n", msg->len);
+		return 0;
+	}
+	if(self->seq == 0) {
+		hdr->format = format;
+	}
+
+	uint64_t offset = self->pos % self->data_len;
+	uint64_t left = self->data_len - offset;
+	uint64_t skip = left < rec_len ? left : 0;
+	// Announce the region we are about to overwrite before touching it,
+	// so that readers copying records from there can detect the overrun
+	atomic_store_explicit(&hdr->reserve_pos, self->pos + skip + rec_len, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	if(skip > 0) {
+		if(skip >= sizeof(struct shm_ring_record)) {
+			struct shm_ring_record *pad = (struct shm_ring_record *)(self->data + offset);
+			pad->seq = 0;
+			pad->len = (uint32_t)(skip - sizeof(struct shm_ring_record));
+			pad->flags = SHM_RING_REC_PAD;
+		}
+		self->pos += skip;
+		offset = 0;
+	}
+	struct shm_ring_record *rec = (struct shm_ring_record *)(self->data + offset);
+	rec->seq = ++self->seq;
+	rec->len = (uint32_t)msg->len;
+	rec->flags = 0;
+	memcpy(self->data + offset + sizeof(struct shm_ring_record), msg->buf, msg->len);
+	self->pos += rec_len;
+
+	atomic_store_explicit(&hdr->write_seq, self->seq, memory_order_relaxed);
+	atomic_store_explicit(&hdr->write_pos, self->pos, memory_order_release);
+	return 0;
+}
+
+static void out_shm_unmap(out_shm_ctx_t *self) {
+	if(self->hdr != NULL) {
+		munmap(self->hdr, self->map_len);
+		self->hdr = NULL;
+		self->data = NULL;
+	}
+}
+
+static void out_shm_handle_shutdown(void *selfptr) {
+	ASSERT(selfptr != NULL);
+	out_shm_ctx_t *self = selfptr;
+	fprintf(stderr, "output_shm(%s): shutting down\n", self->path);
+	out_shm_unmap(self);
+}
+
+static void out_shm_handle_failure(void *selfptr) {
+	ASSERT(selfptr != NULL);
+	out_shm_ctx_t *self = selfptr;
+	fprintf(stderr, "output_shm: could not set up ring buffer '%s', deactivating output\n",
+			self->path);
+	out_shm_unmap(self);
+}
+
+static option_descr_t const out_shm_options[] = {
+	{
+		.name = "path",
+		.description = "Path to the ring buffer file, eg. /dev/shm/dumpvdl2 (required)"
+	},
+	{
+		.name = "size",
+		.description = "Size of the ring buffer data area in bytes, k or M suffix allowed (default: 4M)"
+	},
+	{
+		.name = NULL,
+		.description = NULL
+	}
+};
+
+output_descriptor_t out_DEF_shm = {
+	.name = "shm",
+	.description = "Output to a lock-free ring buffer in shared memory",
+	.options = out_shm_options,
+	.supports_format = out_shm_supports_format,
+	.configure = out_shm_configure,
+	.init = out_shm_init,
+	.produce = out_shm_produce,
+	.handle_shutdown = out_shm_handle_shutdown,
+	.handle_failure = out_shm_handle_failure
+};
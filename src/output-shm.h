@@ -0,0 +1,76 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _OUTPUT_SHM_H
+#define _OUTPUT_SHM_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "output-common.h"          // output_descriptor_t
+
+// Shared memory ring layout.
+//
+// The file consists of a shm_ring_header followed by a data area of
+// data_len octets. The data area holds a sequence of records, each one
+// starting with a shm_ring_record header followed by len octets of payload,
+// padded to SHM_RING_ALIGN octets. A record never wraps around the end of the
+// data area. If it doesn't fit, the writer fills the rest of the area with
+// a record having SHM_RING_REC_PAD flag set (or leaves it unused, if it is
+// shorter than a record header) and places the record at offset 0.
+//
+// Positions (write_pos, reserve_pos) are monotonic octet counters. The offset
+// of a record in the data area is its position modulo data_len.
+//
+// The writer first advances reserve_pos to the end of the record it is about
+// to write, then writes the record, then advances write_pos and write_seq.
+// A reader keeps its own position and expected sequence number. It reads
+// write_pos to find out whether a new record is available, copies it out and
+// then reads reserve_pos. If reserve_pos - reader_pos > data_len, the writer
+// might have overwritten the copied record in the meantime - the reader has
+// been overrun and must resynchronize by jumping to the current write_pos.
+// A sequence number of the copied record different than expected also
+// indicates an overrun.
+
+#define SHM_RING_MAGIC      "VDL2RING"
+#define SHM_RING_VERSION    1
+#define SHM_RING_ALIGN      8
+#define SHM_RING_REC_PAD    1
+
+struct shm_ring_header {
+	char magic[8];                      // SHM_RING_MAGIC, written last when initializing
+	uint32_t version;                   // SHM_RING_VERSION
+	uint32_t header_len;                // offset of the data area from the start of the file
+	uint64_t data_len;                  // length of the data area (multiple of SHM_RING_ALIGN)
+	uint32_t format;                    // output_format_t of the records
+	uint32_t writer_pid;                // process ID of the writer
+	uint64_t generation;                // changes every time the ring is (re)initialized
+	_Atomic uint64_t reserve_pos;       // end of the record currently being written
+	_Atomic uint64_t write_pos;         // end of the last complete record
+	_Atomic uint64_t write_seq;         // sequence number of the last complete record
+};
+
+struct shm_ring_record {
+	uint64_t seq;                       // record sequence number (first record = 1)
+	uint32_t len;                       // payload length (not including padding)
+	uint32_t flags;                     // SHM_RING_REC_*
+};
+
+extern output_descriptor_t out_DEF_shm;
+
+#endif // !_OUTPUT_SHM_H
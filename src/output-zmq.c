@@ -39,7 +39,8 @@ typedef struct {
 } out_zmq_ctx_t;
 
 static bool out_zmq_supports_format(output_format_t format) {
-	return(format == OFMT_TEXT || format == OFMT_JSON || format == OFMT_PP_ACARS);
+	return(format == OFMT_TEXT || format == OFMT_JSON || format == OFMT_PP_ACARS ||
+			format == OFMT_BINARY);
 }
 
 static void *out_zmq_configure(kvargs *kv) {
@@ -122,11 +123,27 @@ static void out_zmq_produce_text(out_zmq_ctx_t *self, vdl2_msg_metadata *metadat
 	}
 }
 
+// ZeroMQ preserves message boundaries, so serialized messages are sent
+// as is, without the length prefix used by the file output
+static void out_zmq_produce_binary(out_zmq_ctx_t *self, vdl2_msg_metadata *metadata, octet_string_t *msg) {
+	UNUSED(metadata);
+	ASSERT(msg != NULL);
+	ASSERT(self->zmq_sock != 0);
+	if(msg->len < 1) {
+		return;
+	}
+	if(zmq_send(self->zmq_sock, msg->buf, msg->len, 0) < 0) {
+		debug_print(D_OUTPUT, "output_zmq: zmq_send error: %s", zmq_strerror(errno));
+	}
+}
+
 static int out_zmq_produce(void *selfptr, output_format_t format, vdl2_msg_metadata *metadata, octet_string_t *msg) {
 	ASSERT(selfptr != NULL);
 	out_zmq_ctx_t *self = selfptr;
 	if(format == OFMT_TEXT || format == OFMT_JSON || format == OFMT_PP_ACARS) {
 		out_zmq_produce_text(self, metadata, msg);
+	} else if(format == OFMT_BINARY) {
+		out_zmq_produce_binary(self, metadata, msg);
 	}
 	return 0;
 }
@@ -0,0 +1,154 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>                 // memcpy, memcmp
+#include "dumpvdl2.pb-c.h"          // Dumpvdl2__RawAvlcFrame
+#include "avlc.h"                   // parse_dlc_addr
+#include "raw_frames_index.h"
+
+static void put_be32(uint8_t *buf, uint32_t val) {
+	buf[0] = (uint8_t)(val >> 24);
+	buf[1] = (uint8_t)(val >> 16);
+	buf[2] = (uint8_t)(val >> 8);
+	buf[3] = (uint8_t)val;
+}
+
+static void put_be64(uint8_t *buf, uint64_t val) {
+	put_be32(buf, (uint32_t)(val >> 32));
+	put_be32(buf + 4, (uint32_t)val);
+}
+
+static uint32_t get_be32(uint8_t const *buf) {
+	return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) |
+		((uint32_t)buf[2] << 8) | (uint32_t)buf[3];
+}
+
+static uint64_t get_be64(uint8_t const *buf) {
+	return ((uint64_t)get_be32(buf) << 32) | get_be32(buf + 4);
+}
+
+void raw_frames_index_header_encode(uint8_t *buf) {
+	memcpy(buf, RAW_FRAMES_INDEX_MAGIC, 8);
+	put_be32(buf + 8, RAW_FRAMES_INDEX_VERSION);
+	put_be32(buf + 12, RAW_FRAMES_INDEX_RECORD_LEN);
+}
+
+bool raw_frames_index_header_is_valid(uint8_t const *buf, size_t len) {
+	return len >= RAW_FRAMES_INDEX_HEADER_LEN &&
+		memcmp(buf, RAW_FRAMES_INDEX_MAGIC, 8) == 0 &&
+		get_be32(buf + 8) == RAW_FRAMES_INDEX_VERSION &&
+		get_be32(buf + 12) == RAW_FRAMES_INDEX_RECORD_LEN;
+}
+
+void raw_frames_index_record_encode(raw_frames_index_record_t const *r, uint8_t *buf) {
+	put_be64(buf, r->offset);
+	put_be64(buf + 8, (uint64_t)(int64_t)r->timestamp.tv_sec);
+	put_be32(buf + 16, (uint32_t)r->timestamp.tv_usec);
+	put_be32(buf + 20, r->freq);
+	put_be32(buf + 24, r->src);
+	put_be32(buf + 28, r->dst);
+}
+
+void raw_frames_index_record_decode(uint8_t const *buf, raw_frames_index_record_t *r) {
+	r->offset = get_be64(buf);
+	r->timestamp.tv_sec = (time_t)(int64_t)get_be64(buf + 8);
+	r->timestamp.tv_usec = (suseconds_t)get_be32(buf + 16);
+	r->freq = get_be32(buf + 20);
+	r->src = get_be32(buf + 24);
+	r->dst = get_be32(buf + 28);
+}
+
+// Fills in the record (except the offset) with data from a serialized
+// Dumpvdl2__RawAvlcFrame. The message is unpacked, but AVLC frame contents
+// are not decoded - addresses are read directly from the frame header.
+// Returns false if the message is not a raw frame and can't be indexed.
+bool raw_frames_index_record_from_frame(uint8_t const *buf, size_t len, raw_frames_index_record_t *r) {
+	Dumpvdl2__RawAvlcFrame *f = dumpvdl2__raw_avlc_frame__unpack(NULL, len, buf);
+	bool result = false;
+	if(f == NULL || f->metadata == NULL || f->metadata->burst_timestamp == NULL) {
+		goto end;
+	}
+	r->timestamp.tv_sec = f->metadata->burst_timestamp->tv_sec;
+	r->timestamp.tv_usec = f->metadata->burst_timestamp->tv_usec;
+	r->freq = f->metadata->frequency;
+	r->src = r->dst = 0;
+	// Frames shorter than two address fields get indexed with null addresses
+	if(f->data.data != NULL && f->data.len >= 8) {
+		r->dst = parse_dlc_addr(f->data.data);
+		r->src = parse_dlc_addr(f->data.data + 4);
+	}
+	result = true;
+end:
+	dumpvdl2__raw_avlc_frame__free_unpacked(f, NULL);
+	return result;
+}
+
+bool raw_frames_filter_is_active(raw_frames_filter_t const *f) {
+	return f != NULL && (f->from_set || f->to_set || f->addr_set || f->freq != 0);
+}
+
+static int timeval_cmp(struct timeval const *a, struct timeval const *b) {
+	if(a->tv_sec != b->tv_sec) {
+		return a->tv_sec < b->tv_sec ? -1 : 1;
+	}
+	if(a->tv_usec != b->tv_usec) {
+		return a->tv_usec < b->tv_usec ? -1 : 1;
+	}
+	return 0;
+}
+
+// Returns the number of the first record whose timestamp is not earlier
+// than ts (or num_records if there is no such record). Records must be
+// sorted by timestamp.
+size_t raw_frames_index_lower_bound(uint8_t const *records, size_t num_records, struct timeval ts) {
+	raw_frames_index_record_t r;
+	size_t lo = 0, hi = num_records;
+	while(lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		raw_frames_index_record_decode(records + mid * RAW_FRAMES_INDEX_RECORD_LEN, &r);
+		if(timeval_cmp(&r.timestamp, &ts) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+bool raw_frames_filter_match(raw_frames_filter_t const *f, raw_frames_index_record_t const *r) {
+	if(f == NULL) {
+		return true;
+	}
+	if(f->from_set && timeval_cmp(&r->timestamp, &f->from) < 0) {
+		return false;
+	}
+	if(f->to_set && timeval_cmp(&r->timestamp, &f->to) >= 0) {
+		return false;
+	}
+	if(f->freq != 0 && r->freq != f->freq) {
+		return false;
+	}
+	if(f->addr_set && (r->src & RAW_FRAMES_INDEX_ADDR_MASK) != f->addr &&
+			(r->dst & RAW_FRAMES_INDEX_ADDR_MASK) != f->addr) {
+		return false;
+	}
+	return true;
+}
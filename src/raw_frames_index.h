@@ -0,0 +1,86 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RAW_FRAMES_INDEX_H
+#define _RAW_FRAMES_INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/time.h>               // struct timeval
+
+// Sidecar index of a raw frame file (binary format)
+//
+// The index is stored in a file named after the data file with
+// RAW_FRAMES_INDEX_SUFFIX appended. It starts with a header consisting of
+// RAW_FRAMES_INDEX_MAGIC followed by a version number and a record length
+// (both 32-bit). The header is followed by fixed-length records, one per
+// frame, in the same order as frames in the data file. Record fields:
+//
+//   offset     uint64  position of the frame (its length field) in the data file
+//   tv_sec     int64   burst timestamp, seconds
+//   tv_usec    uint32  burst timestamp, microseconds
+//   freq       uint32  channel frequency (Hz)
+//   src        uint32  AVLC source address (including address type)
+//   dst        uint32  AVLC destination address (including address type)
+//
+// All integers are stored in network byte order.
+
+#define RAW_FRAMES_INDEX_SUFFIX         ".idx"
+#define RAW_FRAMES_INDEX_MAGIC          "VDL2RIDX"
+#define RAW_FRAMES_INDEX_VERSION        1
+#define RAW_FRAMES_INDEX_HEADER_LEN     16
+#define RAW_FRAMES_INDEX_RECORD_LEN     32
+
+// Records are in the order in which frames have been written, which is the
+// timestamp order, except that frames from different channels (or held in
+// the deduplication window) may be written slightly out of order. Time range
+// lookups widen the range by this many seconds on both ends to account for it.
+#define RAW_FRAMES_INDEX_TIME_SKEW_MAX  30
+
+// Mask for extracting a 24-bit address from AVLC address field
+#define RAW_FRAMES_INDEX_ADDR_MASK      0xFFFFFFu
+
+typedef struct {
+	uint64_t offset;
+	struct timeval timestamp;
+	uint32_t freq;
+	uint32_t src;
+	uint32_t dst;
+} raw_frames_index_record_t;
+
+// Frame selection criteria for reading raw frame files
+typedef struct {
+	struct timeval from;                // inclusive
+	struct timeval to;                  // exclusive
+	uint32_t freq;                      // 0 = any
+	uint32_t addr;                      // matches either source or destination address
+	bool from_set, to_set, addr_set;
+} raw_frames_filter_t;
+
+// raw_frames_index.c
+void raw_frames_index_header_encode(uint8_t *buf);
+bool raw_frames_index_header_is_valid(uint8_t const *buf, size_t len);
+void raw_frames_index_record_encode(raw_frames_index_record_t const *r, uint8_t *buf);
+void raw_frames_index_record_decode(uint8_t const *buf, raw_frames_index_record_t *r);
+bool raw_frames_index_record_from_frame(uint8_t const *buf, size_t len, raw_frames_index_record_t *r);
+size_t raw_frames_index_lower_bound(uint8_t const *records, size_t num_records, struct timeval ts);
+bool raw_frames_filter_is_active(raw_frames_filter_t const *f);
+bool raw_frames_filter_match(raw_frames_filter_t const *f, raw_frames_index_record_t const *r);
+
+#endif // !_RAW_FRAMES_INDEX_H
@@ -24,32 +24,50 @@
  */
 
 #include <sys/time.h>                   // struct timeval
-#include <string.h>                     // strdup
+#include <string.h>                     // memcpy, memmove
+#include <stdatomic.h>                  // atomic_*
 #include <libacars/hash.h>              // la_hash
 #include <libacars/list.h>              // la_list
 #include "dumpvdl2.h"                   // NEW, XCALLOC
 #include "reassembly.h"
+#include "metrics.h"                    // metrics_inc, metrics_set
+
+/* Pending entries are expired with a hierarchical timer wheel instead of
+ * periodic scans of the whole table. The wheel runs on fragment timestamps
+ * (rx_time) rather than on the wall clock, so that historical data can be
+ * processed correctly. It ticks once per second and has two levels of
+ * REASM_WHEEL_SIZE slots each. Level 0 holds entries due within the next
+ * REASM_WHEEL_SIZE ticks, one slot per tick. Level 1 holds entries due later,
+ * one slot per REASM_WHEEL_SIZE ticks. Whenever the wheel reaches the
+ * beginning of a level 1 slot, the entries stored there are redistributed to
+ * level 0. Entries due beyond REASM_WHEEL_SPAN are parked in the farthest
+ * level 1 slot and rescheduled when it comes up. CLNP lifetime is at most
+ * 127.5 seconds, so this never happens in practice.
+ */
+#define REASM_WHEEL_BITS 6
+#define REASM_WHEEL_SIZE (1 << REASM_WHEEL_BITS)
+#define REASM_WHEEL_MASK (REASM_WHEEL_SIZE - 1)
+#define REASM_WHEEL_SPAN ((REASM_WHEEL_SIZE - 1) * REASM_WHEEL_SIZE)
 
-typedef struct reasm_table_s {
-	void const *key;                    /* a pointer identifying the protocol
-	                                       owning this reasm_table (type_descriptor
-	                                       can be used for this purpose). Due to small
-	                                       number of protocols, la_hash would be an overkill
-	                                       here. */
-	la_hash *fragment_table;            /* keyed with packet identifiers, values are
-	                                       reasm_table_entries */
-	reasm_table_funcs funcs;            /* protocol-specific callbacks */
-	int cleanup_interval;               /* expire old entries every cleanup_interval
-	                                       number of processed fragments */
-	int frag_cnt;                       /* counts added fragments (up to cleanup_interval) */
-} reasm_table;
-
-struct reasm_ctx_s {
-	la_list *rtables;                   /* list of reasm_tables, one per protocol */
+// a range of collected data
+struct fragment {
+	int start;
+	int end;
 };
 
 // the header of the fragment list
-typedef struct {
+typedef struct reasm_table_entry {
+	struct reasm_table_entry *wheel_prev, *wheel_next;  /* timer wheel slot links */
+	struct reasm_table_entry **wheel_slot;  /* timer wheel slot this entry is in
+	                                           (NULL if none) */
+	struct reasm_table_entry *age_prev, *age_next;  /* links on the table age list */
+
+	void *key;                          /* hash key of this entry */
+
+	time_t expires;                     /* timer wheel tick on which this entry expires */
+
+	size_t size;                        /* approximate memory footprint of this entry */
+
 	int frags_collected_total_len;      /* sum of fragment_data_len for all fragments received */
 
 	int total_pdu_len;                  /* total length of the reassembled message
@@ -59,37 +77,66 @@ typedef struct {
 
 	struct timeval reasm_timeout;       /* reassembly timeout to be applied to this message */
 
-	la_list *fragment_list;             /* payloads of all fragments gathered so far */
-	bool have_first_fragment;           /* whether we've already collected the first fragment of this PDU */
+	uint8_t *buf;                       /* reassembly buffer - fragment data is copied
+	                                       directly to its final position */
+	int buf_len;                        /* allocated length of buf */
+
+	struct fragment *ranges;            /* ranges of data collected so far, sorted by offset,
+	                                       adjacent ranges coalesced */
+	int range_cnt;                      /* number of used ranges */
+	int range_max;                      /* number of allocated ranges */
 } reasm_table_entry;
 
-// fragment list entry
-struct fragment {
-	int start;
-	int end;
-	octet_string_t *data;
+typedef struct reasm_table_s {
+	void const *key;                    /* a pointer identifying the protocol
+	                                       owning this reasm_table (type_descriptor
+	                                       can be used for this purpose). Due to small
+	                                       number of protocols, la_hash would be an overkill
+	                                       here. */
+	la_hash *fragment_table;            /* keyed with packet identifiers, values are
+	                                       reasm_table_entries */
+	reasm_table_funcs funcs;            /* protocol-specific callbacks */
+	reasm_table_entry *wheel[2][REASM_WHEEL_SIZE];  /* timer wheel slots */
+	time_t wheel_time;                  /* next timer wheel tick to be processed */
+	bool wheel_started;                 /* false until the first fragment arrives */
+	reasm_table_entry *age_head;        /* oldest entry (first candidate for eviction) */
+	reasm_table_entry *age_tail;        /* newest entry */
+	size_t memory;                      /* memory used by all entries of this table */
+} reasm_table;
+
+struct reasm_ctx_s {
+	la_list *rtables;                   /* list of reasm_tables, one per protocol */
 };
 
+// Initial number of ranges allocated for a new entry
+#define REASM_RANGES_INITIAL 4
+
+// Memory used by all reassembly tables of all contexts. Modified by decoder
+// threads, hence atomic.
+static atomic_size_t reasm_memory = 0;
+// Limit of reasm_memory. Each decoder thread owns its tables and may only
+// evict its own entries, so when the limit is reached, a thread makes room
+// by evicting its oldest entries and drops the fragment if it has nothing
+// left to evict. Memory held by other threads is released when their
+// entries complete or expire.
+static size_t reasm_max_memory = REASM_MAX_MEMORY_DEFAULT;
+
+void reasm_init(size_t max_memory) {
+	reasm_max_memory = max_memory;
+}
+
 reasm_ctx *reasm_ctx_new() {
 	NEW(reasm_ctx, rctx);
 	return rctx;
 }
 
-static void fragment_destroy(void *data) {
-	if(data == NULL) {
-		return;
-	}
-	struct fragment *f = data;
-	octet_string_destroy(f->data);
-	XFREE(f);
-}
-
 static void reasm_table_entry_destroy(void *rt_ptr) {
 	if(rt_ptr == NULL) {
 		return;
 	}
 	reasm_table_entry *rt_entry = rt_ptr;
-	la_list_free_full(rt_entry->fragment_list, fragment_destroy);
+	XFREE(rt_entry->buf);
+	XFREE(rt_entry->ranges);
 	XFREE(rt_entry);
 }
 
@@ -99,6 +146,7 @@ static void reasm_table_destroy(void *table) {
 	}
 	reasm_table *rtable = table;
 	la_hash_destroy(rtable->fragment_table);
+	atomic_fetch_sub(&reasm_memory, rtable->memory);
 	XFREE(rtable);
 }
 
@@ -124,10 +172,8 @@ reasm_table *reasm_table_lookup(reasm_ctx *rctx, void const *table_id) {
 	return NULL;
 }
 
-#define REASM_DEFAULT_CLEANUP_INTERVAL 100
-
 reasm_table *reasm_table_new(reasm_ctx *rctx, void const *table_id,
-		reasm_table_funcs funcs, int cleanup_interval) {
+		reasm_table_funcs funcs) {
 	ASSERT(rctx != NULL);
 	ASSERT(table_id != NULL);
 	ASSERT(funcs.get_key);
@@ -145,10 +191,6 @@ reasm_table *reasm_table_new(reasm_ctx *rctx, void const *table_id,
 	rtable->fragment_table = la_hash_new(funcs.hash_key, funcs.compare_keys,
 			funcs.destroy_key, reasm_table_entry_destroy);
 	rtable->funcs = funcs;
-
-	// Replace insane values with reasonable default
-	rtable->cleanup_interval = cleanup_interval > 0 ?
-		cleanup_interval : REASM_DEFAULT_CLEANUP_INTERVAL;
 	rctx->rtables = la_list_append(rctx->rtables, rtable);
 end:
 	return rtable;
@@ -164,9 +206,9 @@ static bool reasm_timed_out(struct timeval rx_last, struct timeval rx_first,
 		.tv_sec = rx_first.tv_sec + timeout.tv_sec,
 		.tv_usec = rx_first.tv_usec + timeout.tv_usec
 	};
-	if(to.tv_usec > 1e9) {
+	if(to.tv_usec >= 1000000) {
 		to.tv_sec++;
-		to.tv_usec -= 1e9;
+		to.tv_usec -= 1000000;
 	}
 	debug_print(D_MISC, "rx_first: %lu.%lu to: %lu.%lu rx_last: %lu.%lu\n",
 			rx_first.tv_sec, rx_first.tv_usec, to.tv_sec, to.tv_usec, rx_last.tv_sec, rx_last.tv_usec);
@@ -174,44 +216,244 @@ static bool reasm_timed_out(struct timeval rx_last, struct timeval rx_first,
 			(rx_last.tv_sec == to.tv_sec && rx_last.tv_usec > to.tv_usec));
 }
 
-// Simple check for equality of fragments.
-// Only offsets and lengths are compared. No data comparison is done
-// to speed things up.
-static bool fragments_are_equal(struct fragment const *f1, struct fragment const *f2) {
-		return f1->start == f2->start && f1->end == f2->end;
+// Returns the first timer wheel tick not earlier than the reassembly deadline
+// of the given entry.
+static time_t reasm_expiry_tick(reasm_table_entry const *rt_entry) {
+	long usec = rt_entry->first_frag_rx_time.tv_usec + rt_entry->reasm_timeout.tv_usec;
+	time_t tick = rt_entry->first_frag_rx_time.tv_sec + rt_entry->reasm_timeout.tv_sec + usec / 1000000;
+	if(usec % 1000000 != 0) {
+		tick++;
+	}
+	return tick;
+}
+
+static void reasm_wheel_insert(reasm_table *rtable, reasm_table_entry *rt_entry) {
+	time_t when = rt_entry->expires > rtable->wheel_time ? rt_entry->expires : rtable->wheel_time;
+	time_t delta = when - rtable->wheel_time;
+	reasm_table_entry **slot = NULL;
+	if(delta < REASM_WHEEL_SIZE) {
+		slot = &rtable->wheel[0][when & REASM_WHEEL_MASK];
+	} else {
+		if(delta > REASM_WHEEL_SPAN) {
+			when = rtable->wheel_time + REASM_WHEEL_SPAN;
+		}
+		slot = &rtable->wheel[1][(when >> REASM_WHEEL_BITS) & REASM_WHEEL_MASK];
+	}
+	rt_entry->wheel_prev = NULL;
+	rt_entry->wheel_next = *slot;
+	if(*slot != NULL) {
+		(*slot)->wheel_prev = rt_entry;
+	}
+	*slot = rt_entry;
+	rt_entry->wheel_slot = slot;
+}
+
+static void reasm_wheel_unlink(reasm_table_entry *rt_entry) {
+	if(rt_entry->wheel_slot == NULL) {
+		return;
+	}
+	if(rt_entry->wheel_prev != NULL) {
+		rt_entry->wheel_prev->wheel_next = rt_entry->wheel_next;
+	} else {
+		*rt_entry->wheel_slot = rt_entry->wheel_next;
+	}
+	if(rt_entry->wheel_next != NULL) {
+		rt_entry->wheel_next->wheel_prev = rt_entry->wheel_prev;
+	}
+	rt_entry->wheel_prev = rt_entry->wheel_next = NULL;
+	rt_entry->wheel_slot = NULL;
 }
 
-// Check if fragments overlap
-static bool fragments_overlap(struct fragment const *f1, struct fragment const *f2) {
-	return (f2->start <= f1->start && f1->start <= f2->end) ||
-			(f1->start <= f2->start && f2->start <= f1->end);
+// Detaches the whole content of a timer wheel slot and returns it as a list
+// linked with wheel_next pointers.
+static reasm_table_entry *reasm_wheel_slot_take(reasm_table_entry **slot) {
+	reasm_table_entry *list = *slot;
+	*slot = NULL;
+	for(reasm_table_entry *e = list; e != NULL; e = e->wheel_next) {
+		e->wheel_slot = NULL;
+	}
+	return list;
 }
 
-// Callback for la_hash_foreach_remove used during reassembly table cleanups.
-static bool is_rt_entry_expired(void const *keyptr, void const *valptr, void *ctx) {
-	UNUSED(keyptr);
-	ASSERT(valptr != NULL);
-	ASSERT(ctx != NULL);
+// Charges size octets to the entry and its table. The caller must have
+// added them to reasm_memory already.
+static void reasm_memory_account(reasm_table *rtable, reasm_table_entry *rt_entry, size_t size) {
+	rt_entry->size += size;
+	rtable->memory += size;
+}
 
-	reasm_table_entry const *rt_entry = valptr;
-	struct timeval *now = ctx;
-	return reasm_timed_out(*now, rt_entry->first_frag_rx_time, rt_entry->reasm_timeout);
+// Adds len octets to reasm_memory, unless that would exceed the limit
+static bool reasm_memory_reserve(size_t len) {
+	size_t used = atomic_load(&reasm_memory);
+	do {
+		if(reasm_max_memory > 0 && used + len > reasm_max_memory) {
+			return false;
+		}
+	} while(!atomic_compare_exchange_weak(&reasm_memory, &used, used + len));
+	return true;
 }
 
-// Removes expired entries from the given reassembly table.
-static void reasm_table_cleanup(reasm_table *rtable, struct timeval now) {
-	ASSERT(rtable != NULL);
-	ASSERT(rtable->fragment_table != NULL);
-	int deleted_count = la_hash_foreach_remove(rtable->fragment_table,
-			is_rt_entry_expired, &now);
-	// Avoid compiler warning when DEBUG is off
-	UNUSED(deleted_count);
-	debug_print(D_MISC, "Expired %d entries\n", deleted_count);
+// Removes the entry from all lists and from the fragment table and frees it.
+static void reasm_table_entry_remove(reasm_table *rtable, reasm_table_entry *rt_entry) {
+	reasm_wheel_unlink(rt_entry);
+	if(rt_entry->age_prev != NULL) {
+		rt_entry->age_prev->age_next = rt_entry->age_next;
+	} else {
+		rtable->age_head = rt_entry->age_next;
+	}
+	if(rt_entry->age_next != NULL) {
+		rt_entry->age_next->age_prev = rt_entry->age_prev;
+	} else {
+		rtable->age_tail = rt_entry->age_prev;
+	}
+	rtable->memory -= rt_entry->size;
+	atomic_fetch_sub(&reasm_memory, rt_entry->size);
+	la_hash_remove(rtable->fragment_table, rt_entry->key);
+}
+
+// Processes timer wheel slots up to and including the tick of the given timestamp.
+// Expiration is performed in relation to rx_time of the fragment currently
+// being processed. This allows processing historical data with timestamps in
+// the past.
+static void reasm_wheel_advance(reasm_table *rtable, struct timeval now) {
+	if(!rtable->wheel_started) {
+		rtable->wheel_time = now.tv_sec;
+		rtable->wheel_started = true;
+		return;
+	}
+	if(now.tv_sec < rtable->wheel_time) {
+		return;
+	}
+	int expired_count = 0;
+	if(now.tv_sec - rtable->wheel_time > REASM_WHEEL_SPAN + REASM_WHEEL_SIZE) {
+		// A long gap between fragments. Instead of stepping through all
+		// the ticks, pull all entries out of the wheel and reschedule them.
+		for(reasm_table_entry *e = rtable->age_head; e != NULL; e = e->age_next) {
+			reasm_wheel_unlink(e);
+		}
+		rtable->wheel_time = now.tv_sec;
+		for(reasm_table_entry *e = rtable->age_head, *next = NULL; e != NULL; e = next) {
+			next = e->age_next;
+			if(reasm_timed_out(now, e->first_frag_rx_time, e->reasm_timeout)) {
+				reasm_table_entry_remove(rtable, e);
+				expired_count++;
+			} else {
+				reasm_wheel_insert(rtable, e);
+			}
+		}
+		goto end;
+	}
+	while(rtable->wheel_time <= now.tv_sec) {
+		time_t tick = rtable->wheel_time;
+		if((tick & REASM_WHEEL_MASK) == 0) {
+			reasm_table_entry *e = reasm_wheel_slot_take(
+					&rtable->wheel[1][(tick >> REASM_WHEEL_BITS) & REASM_WHEEL_MASK]);
+			for(reasm_table_entry *next = NULL; e != NULL; e = next) {
+				next = e->wheel_next;
+				reasm_wheel_insert(rtable, e);
+			}
+		}
+		reasm_table_entry *e = reasm_wheel_slot_take(&rtable->wheel[0][tick & REASM_WHEEL_MASK]);
+		rtable->wheel_time++;
+		for(reasm_table_entry *next = NULL; e != NULL; e = next) {
+			next = e->wheel_next;
+			// The tick is rounded up, so the deadline may fall exactly on
+			// the current timestamp. Check it again then.
+			if(e->expires <= tick && reasm_timed_out(now, e->first_frag_rx_time, e->reasm_timeout)) {
+				reasm_table_entry_remove(rtable, e);
+				expired_count++;
+			} else {
+				reasm_wheel_insert(rtable, e);
+			}
+		}
+	}
+end:
+	for(int i = 0; i < expired_count; i++) {
+		metrics_inc(M_REASM_OFFSETBASED_EXPIRED);
+	}
+	metrics_set(MG_REASM_OFFSETBASED_MEMORY, atomic_load(&reasm_memory));
+	debug_print(D_MISC, "Expired %d entries\n", expired_count);
+}
+
+// Reserves len octets of the global memory budget, evicting oldest entries
+// of the table (except for the given one) until they fit. Returns true on
+// success, false if the limit can't be satisfied.
+static bool reasm_make_room(reasm_table *rtable, reasm_table_entry *keep, size_t len) {
+	// Don't flush the whole table for something that won't fit anyway
+	if(reasm_max_memory > 0 && len > reasm_max_memory) {
+		return false;
+	}
+	while(reasm_memory_reserve(len) == false) {
+		reasm_table_entry *victim = rtable->age_head;
+		if(victim == keep) {
+			victim = victim->age_next;
+		}
+		if(victim == NULL) {
+			return false;
+		}
+		debug_print(D_MISC, "memory limit reached (%zu + %zu > %zu), evicting entry of size %zu\n",
+				atomic_load(&reasm_memory), len, reasm_max_memory, victim->size);
+		reasm_table_entry_remove(rtable, victim);
+		metrics_inc(M_REASM_OFFSETBASED_EVICTED);
+	}
+	return true;
+}
+
+// Returns the index of the first collected range which ends at or after
+// the given offset (or range_cnt if there is no such range).
+static int reasm_range_search(reasm_table_entry const *rt_entry, int offset) {
+	int lo = 0, hi = rt_entry->range_cnt;
+	while(lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if(rt_entry->ranges[mid].end < offset) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+// Inserts the range start..end at position idx (as returned by
+// reasm_range_search), merging it with adjacent ranges where possible.
+// The range must not overlap with any of the existing ones.
+static void reasm_range_insert(reasm_table_entry *rt_entry, int idx, int start, int end) {
+	struct fragment *r = rt_entry->ranges;
+	bool merge_left = idx > 0 && r[idx - 1].end + 1 == start;
+	bool merge_right = idx < rt_entry->range_cnt && r[idx].start == end + 1;
+	if(merge_left && merge_right) {
+		r[idx - 1].end = r[idx].end;
+		memmove(&r[idx], &r[idx + 1], (rt_entry->range_cnt - idx - 1) * sizeof(struct fragment));
+		rt_entry->range_cnt--;
+	} else if(merge_left) {
+		r[idx - 1].end = end;
+	} else if(merge_right) {
+		r[idx].start = start;
+	} else {
+		ASSERT(rt_entry->range_cnt < rt_entry->range_max);
+		memmove(&r[idx + 1], &r[idx], (rt_entry->range_cnt - idx) * sizeof(struct fragment));
+		r[idx].start = start;
+		r[idx].end = end;
+		rt_entry->range_cnt++;
+	}
+}
+
+// Returns the length of the reassembly buffer needed to store a fragment
+// ending at frag_end. One octet is reserved for the NULL terminator.
+// The buffer is sized from the PDU length hint on first use, so that
+// normally it is never reallocated.
+static int reasm_buf_len_wanted(reasm_table_entry const *rt_entry, int frag_end, int len_hint) {
+	int needed = frag_end + 2;
+	if(needed <= rt_entry->buf_len) {
+		return rt_entry->buf_len;
+	}
+	int wanted = rt_entry->buf_len > 0 ? 2 * rt_entry->buf_len : len_hint + 1;
+	return wanted > needed ? wanted : needed;
 }
 
 // Core reassembly logic.
-// Validates the given message fragment and appends it to the reassembly table
-// fragment la_list.
+// Validates the given message fragment and copies its data into the
+// reassembly buffer of the PDU it belongs to.
 reasm_status reasm_fragment_add(reasm_table *rtable, reasm_fragment_info const *finfo) {
 	ASSERT(rtable != NULL);
 	ASSERT(finfo != NULL);
@@ -233,6 +475,8 @@ reasm_status reasm_fragment_add(reasm_table *rtable, reasm_fragment_info const *
 		return REASM_ARGS_INVALID;
 	}
 
+	reasm_wheel_advance(rtable, finfo->rx_time);
+
 	int frag_end = finfo->offset + finfo->fragment_data_len - 1;
 	reasm_status ret = REASM_UNKNOWN;
 	void *lookup_key = rtable->funcs.get_tmp_key(finfo->pdu_info);
@@ -252,6 +496,20 @@ restart:
 		void *msg_key = rtable->funcs.get_key(finfo->pdu_info);
 		ASSERT(msg_key != NULL);
 		la_hash_insert(rtable->fragment_table, msg_key, rt_entry);
+		rt_entry->key = msg_key;
+		rt_entry->expires = reasm_expiry_tick(rt_entry);
+		reasm_wheel_insert(rtable, rt_entry);
+		rt_entry->age_prev = rtable->age_tail;
+		if(rtable->age_tail != NULL) {
+			rtable->age_tail->age_next = rt_entry;
+		} else {
+			rtable->age_head = rt_entry;
+		}
+		rtable->age_tail = rt_entry;
+		// Not checked against the limit - if there is no room for the
+		// fragment data, the new entry is removed below
+		atomic_fetch_add(&reasm_memory, sizeof(reasm_table_entry));
+		reasm_memory_account(rtable, rt_entry, sizeof(reasm_table_entry));
 	}
 
 	// Check reassembly timeout
@@ -261,89 +519,100 @@ restart:
 		// a new message. Remove the old rt_entry and create new one.
 
 		debug_print(D_MISC, "reasm timeout expired; creating new rt_entry\n");
-		la_hash_remove(rtable->fragment_table, lookup_key);
+		reasm_table_entry_remove(rtable, rt_entry);
+		metrics_inc(M_REASM_OFFSETBASED_EXPIRED);
 		goto restart;
 	}
 
-	// Create new fragment list entry.
-	// Don't copy the data initially - this will be done when all sanity checks
-	// are completed.
-	NEW(struct fragment, current_fragment);
-	current_fragment->start = finfo->offset;
-	current_fragment->end = frag_end;
-
-	// Compare the current fragment with fragments seen so far.
-	// Check for duplicates and overlaps.
-	for(la_list *l = rt_entry->fragment_list; l != NULL; l = la_list_next(l)) {
-		struct fragment *f = l->data;
-		if(fragments_are_equal(current_fragment, f)) {
+	// Compare the current fragment with data collected so far.
+	// A fragment which is entirely covered by a single collected range is
+	// a duplicate. Any other intersection is an overlap.
+	int idx = reasm_range_search(rt_entry, finfo->offset);
+	if(idx < rt_entry->range_cnt && rt_entry->ranges[idx].start <= frag_end) {
+		struct fragment const *r = &rt_entry->ranges[idx];
+		if(r->start <= finfo->offset && frag_end <= r->end) {
 			ret = REASM_DUPLICATE;
-			goto cleanup;
-		} else if(fragments_overlap(current_fragment, f)) {
+		} else {
 			debug_print(D_MISC, "fragment overlap detected (current: start=%d end=%d existing: start=%d end=%d)\n",
-					current_fragment->start, current_fragment->end, f->start, f->end);
+					finfo->offset, frag_end, r->start, r->end);
 			ret = REASM_OVERLAP;
-			goto cleanup;
 		}
+		goto end;
+	}
+
+	if(finfo->is_final_fragment && rt_entry->total_pdu_len > 0) {
+		debug_print(D_MISC, "Multiple final fragments in this PDU? Discarding.\n");
+		ret = REASM_BOGUS_FINAL_FRAGMENT;
+		goto end;
+	}
+
+	// Make sure the fragment fits within the memory limit.
+	// Evict oldest entries, if necessary.
+
+	int buf_len = reasm_buf_len_wanted(rt_entry, frag_end, finfo->pdu_len_hint);
+	int range_max = rt_entry->range_max;
+	if(rt_entry->range_cnt == range_max) {
+		range_max = range_max > 0 ? 2 * range_max : REASM_RANGES_INITIAL;
+	}
+	size_t growth = (size_t)(buf_len - rt_entry->buf_len) +
+		(size_t)(range_max - rt_entry->range_max) * sizeof(struct fragment);
+	if(reasm_make_room(rtable, rt_entry, growth) == false) {
+		debug_print(D_MISC, "memory limit reached, dropping fragment\n");
+		metrics_inc(M_REASM_OFFSETBASED_DROPPED);
+		ret = REASM_MEMORY_LIMIT;
+		if(rt_entry->range_cnt == 0) {
+			reasm_table_entry_remove(rtable, rt_entry);
+		}
+		goto end;
 	}
+	if(buf_len > rt_entry->buf_len) {
+		rt_entry->buf = XREALLOC(rt_entry->buf, buf_len);
+		rt_entry->buf_len = buf_len;
+	}
+	if(range_max > rt_entry->range_max) {
+		rt_entry->ranges = XREALLOC(rt_entry->ranges, range_max * sizeof(struct fragment));
+		rt_entry->range_max = range_max;
+	}
+	reasm_memory_account(rtable, rt_entry, growth);
 
 	// If this is the final fragment of this PDU, then compute the
-	// total PDU length (provided that it has not been computed earlier)
+	// total PDU length
 
 	if(finfo->is_final_fragment) {
-		if(rt_entry->total_pdu_len < 1) {
-			rt_entry->total_pdu_len = finfo->offset + finfo->fragment_data_len;
-			debug_print(D_MISC, "Final fragment: offset %d fragment_data_len %d -> total_pdu_len %d\n",
-					finfo->offset, finfo->fragment_data_len, rt_entry->total_pdu_len);
-		} else {
-			debug_print(D_MISC, "Multiple final fragments in this PDU? Discarding.\n");
-			ret = REASM_BOGUS_FINAL_FRAGMENT;
-			goto cleanup;
-		}
+		rt_entry->total_pdu_len = finfo->offset + finfo->fragment_data_len;
+		debug_print(D_MISC, "Final fragment: offset %d fragment_data_len %d -> total_pdu_len %d\n",
+				finfo->offset, finfo->fragment_data_len, rt_entry->total_pdu_len);
 	}
 
-	// All checks succeeded. Add the fragment to the list
+	// All checks succeeded. Store the fragment data
 
-	debug_print(D_MISC, "Good fragment (start=%d end=%d), adding to the list\n",
-			current_fragment->start, current_fragment->end);
+	debug_print(D_MISC, "Good fragment (start=%d end=%d), adding to the buffer\n",
+			finfo->offset, frag_end);
 
-	uint8_t *fragment_data = XCALLOC(finfo->fragment_data_len, sizeof(uint8_t));
-	memcpy(fragment_data, finfo->fragment_data, finfo->fragment_data_len);
-	current_fragment->data = octet_string_new(fragment_data, finfo->fragment_data_len);
-	rt_entry->fragment_list = la_list_append(rt_entry->fragment_list, current_fragment);
+	memcpy(rt_entry->buf + finfo->offset, finfo->fragment_data, finfo->fragment_data_len);
+	reasm_range_insert(rt_entry, idx, finfo->offset, frag_end);
 	rt_entry->frags_collected_total_len += finfo->fragment_data_len;
 
 	// Reassembly is complete if total_pdu_len for this rt_entry is set
-	// and we've already collected the required amount of data.
+	// and the collected data forms a single range covering the whole PDU.
 
-	if(rt_entry->total_pdu_len < 1 || rt_entry->frags_collected_total_len < rt_entry->total_pdu_len) {
+	struct fragment const *last = &rt_entry->ranges[rt_entry->range_cnt - 1];
+	if(rt_entry->total_pdu_len < 1) {
 		ret = REASM_IN_PROGRESS;
-	} else if(rt_entry->frags_collected_total_len == rt_entry->total_pdu_len) {
-		ret = REASM_COMPLETE;
-	} else {
-		// We've collected more data than needed?
+	} else if(last->end >= rt_entry->total_pdu_len) {
+		// We've collected data beyond the end of the PDU?
 		// This really shouldn't happen.
-		debug_print(D_MISC, "Bad length: too much data collected from fragments (%d > pdu_len %d\n",
-				rt_entry->frags_collected_total_len, rt_entry->total_pdu_len);
+		debug_print(D_MISC, "Bad length: data collected up to offset %d > pdu_len %d\n",
+				last->end, rt_entry->total_pdu_len);
 		ret = REASM_BAD_LEN;
+	} else if(rt_entry->range_cnt == 1 && last->start == 0 && last->end == rt_entry->total_pdu_len - 1) {
+		ret = REASM_COMPLETE;
+	} else {
+		ret = REASM_IN_PROGRESS;
 	}
-	goto end;
-
-cleanup:
-
-	XFREE(current_fragment);
 
 end:
 
-	// Update fragment counter and expire old entries if necessary.
-	// Expiration is performed in relation to rx_time of the fragment currently
-	// being processed. This allows processing historical data with timestamps in
-	// the past.
-
-	if(++rtable->frag_cnt > rtable->cleanup_interval) {
-		reasm_table_cleanup(rtable, finfo->rx_time);
-		rtable->frag_cnt = 0;
-	}
 	debug_print(D_MISC, "Result: %d\n", ret);
 	XFREE(lookup_key);
 	return ret;
@@ -364,40 +633,20 @@ int reasm_payload_get(reasm_table *rtable, void const *pdu_info, uint8_t **resul
 		result_len = -1;
 		goto end;
 	}
-	if(rt_entry->frags_collected_total_len < 1) {
+	if(rt_entry->total_pdu_len < 1 || rt_entry->range_cnt != 1 ||
+			rt_entry->ranges[0].start != 0 || rt_entry->ranges[0].end != rt_entry->total_pdu_len - 1) {
 		result_len = 0;
 		goto end;
 	}
-	// Reassemble all fragments in the correct order.
-	// Append a NULL byte at the end of the reassembled buffer, so that the caller
-	// may cast it to char * in case this is a text message.
-	uint8_t *reasm_buf = XCALLOC(rt_entry->frags_collected_total_len + 1, sizeof(uint8_t));
-	uint8_t *ptr = reasm_buf;
-	int wanted_offset = 0;
-	bool done = false;
-	bool fragment_found = false;
-	do {
-		fragment_found = false;
-		for(la_list *l = rt_entry->fragment_list; l != NULL; l = la_list_next(l)) {
-			struct fragment *f = l->data;
-			if(f->start == wanted_offset) {
-				memcpy(ptr, f->data->buf, f->data->len);
-				ptr += f->data->len;
-				fragment_found = true;
-				if(f->end + 1 == rt_entry->frags_collected_total_len) {
-					done = true;
-				} else {
-					wanted_offset = f->end + 1;
-				}
-			}
-		}
-	} while(fragment_found && !done);
-
-	ASSERT(fragment_found);     // This shouldn't happen - we should have exited the above loop with done == true
-	reasm_buf[rt_entry->frags_collected_total_len] = '\0'; // buffer len is frags_collected_total_len + 1
-	*result = reasm_buf;
-	result_len = rt_entry->frags_collected_total_len;
-	la_hash_remove(rtable->fragment_table, tmp_key);
+	// Fragments have already been copied into place, so just hand the buffer
+	// over to the caller. Append a NULL byte at the end of the reassembled
+	// buffer, so that the caller may cast it to char * in case this is a text
+	// message (buf_len is at least total_pdu_len + 1).
+	rt_entry->buf[rt_entry->total_pdu_len] = '\0';
+	*result = rt_entry->buf;
+	rt_entry->buf = NULL;
+	result_len = rt_entry->total_pdu_len;
+	reasm_table_entry_remove(rtable, rt_entry);
 end:
 	XFREE(tmp_key);
 	return result_len;
@@ -413,7 +662,8 @@ char const *reasm_status_name_get(reasm_status status) {
 		[REASM_BAD_LEN] = "bad length",
 		[REASM_OVERLAP] = "overlapped fragment",
 		[REASM_BOGUS_FINAL_FRAGMENT] = "bogus final fragment",
-		[REASM_ARGS_INVALID] = "invalid args"
+		[REASM_ARGS_INVALID] = "invalid args",
+		[REASM_MEMORY_LIMIT] = "memory limit exceeded"
 	};
 	if(status < 0 || status > REASM_STATUS_MAX) {
 		return NULL;
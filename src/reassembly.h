@@ -20,6 +20,7 @@
 #define REASSEMBLY_H 1
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <sys/time.h>
 #include <libacars/hash.h>
 #include <libacars/reassembly.h>        // la_reasm_ctx
@@ -54,6 +55,10 @@ typedef struct {
 
 	int offset;                      /* offset of the first octet of this fragment */
 
+	int pdu_len_hint;               /* upper bound of the reassembled message length,
+	                                   if known (0 otherwise); used to size the
+	                                   reassembly buffer */
+
 	bool is_final_fragment;         /* is this the final fragment of this message? */
 } reasm_fragment_info;
 
@@ -67,20 +72,25 @@ typedef enum {
 	REASM_BAD_LEN,
 	REASM_OVERLAP,
 	REASM_BOGUS_FINAL_FRAGMENT,
-	REASM_ARGS_INVALID
+	REASM_ARGS_INVALID,
+	REASM_MEMORY_LIMIT
 } reasm_status;
-#define REASM_STATUS_MAX REASM_ARGS_INVALID
+#define REASM_STATUS_MAX REASM_MEMORY_LIMIT
 
 typedef struct {
 	la_reasm_ctx *seqbased;
 	reasm_ctx *offsetbased;
 } reasm_contexts;
 
+// Default limit of memory used by all offset-based reassembly tables
+#define REASM_MAX_MEMORY_DEFAULT (16 * 1024 * 1024)
+
 // reassembly.c
+void reasm_init(size_t max_memory);
 reasm_ctx *reasm_ctx_new();
 void reasm_ctx_destroy(void *ctx);
 reasm_table *reasm_table_new(reasm_ctx *rctx, void const *table_id,
-		reasm_table_funcs funcs, int cleanup_interval);
+		reasm_table_funcs funcs);
 reasm_table *reasm_table_lookup(reasm_ctx *rctx, void const *table_id);
 reasm_status reasm_fragment_add(reasm_table *rtable, reasm_fragment_info const *finfo);
 int reasm_payload_get(reasm_table *rtable, void const *msg_info, uint8_t **result);
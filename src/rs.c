@@ -47,3 +47,8 @@ int rs_verify(uint8_t *data, int fec_octets) {
 	}
 	return ret;
 }
+
+// Computes RS_N - RS_K parity octets for a block of RS_K data octets
+void rs_encode(uint8_t *data, uint8_t *parity) {
+	encode_rs_char(rs, data, parity);
+}
@@ -20,11 +20,22 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <stdatomic.h>             // atomic_int
+#include <pthread.h>               // pthread_mutex_*
 #include <rtl-sdr.h>
 #include "dumpvdl2.h"
 #include "rtl.h"
 
-static rtlsdr_dev_t *rtl = NULL;
+// Devices opened by all rtl_init() instances, for rtl_cancel().
+// rtl_cancel() is called from a signal handler, so it can't take the mutex.
+// Instead, a device is published by incrementing rtl_dev_cnt (with release
+// semantics) after its pointer has been stored. The mutex only serializes
+// concurrent rtl_init() calls. A signal arriving before the device is
+// published (or before its async read starts) can't cancel it, so rtl_init()
+// checks do_exit once more right before starting the async read.
+static rtlsdr_dev_t *rtl_devs[INPUTS_MAX];
+static atomic_int rtl_dev_cnt;
+static pthread_mutex_t rtl_devs_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /* taken from librtlsdr-keenerd, (c) Kyle Keen */
 static int nearest_gain(rtlsdr_dev_t *dev, int target_gain) {
@@ -120,8 +131,8 @@ find_serial:
 	return -1;
 }
 
-void rtl_init(vdl2_state_t *ctx, char *dev, int freq, int bw, float gain, int correction, int bias) {
-	UNUSED(ctx);
+void rtl_init(vdl2_state_t *ctx, char *dev, int freq, uint32_t sample_rate, int bw, float gain, int correction, int bias) {
+	rtlsdr_dev_t *rtl = NULL;
 	int r;
 
 	int device = rtl_verbose_device_search(dev);
@@ -132,7 +143,12 @@ void rtl_init(vdl2_state_t *ctx, char *dev, int freq, int bw, float gain, int co
 		fprintf(stderr, "Failed to open rtlsdr device #%u: error %d\n", device, r);
 		_exit(1);
 	}
-	r = rtlsdr_set_sample_rate(rtl, RTL_RATE);
+	pthread_mutex_lock(&rtl_devs_mutex);
+	int cnt = atomic_load_explicit(&rtl_dev_cnt, memory_order_relaxed);
+	rtl_devs[cnt] = rtl;
+	atomic_store_explicit(&rtl_dev_cnt, cnt + 1, memory_order_release);
+	pthread_mutex_unlock(&rtl_devs_mutex);
+	r = rtlsdr_set_sample_rate(rtl, sample_rate);
 	if (r < 0) {
 		fprintf(stderr, "Failed to set sample rate for device #%d: error %d\n", device, r);
 		_exit(1);
@@ -190,16 +206,25 @@ void rtl_init(vdl2_state_t *ctx, char *dev, int freq, int bw, float gain, int co
     }
 
 	rtlsdr_reset_buffer(rtl);
+	// Pairs with the fence in rtl_cancel(): either the signal handler sees
+	// this device or we see do_exit set
+	atomic_thread_fence(memory_order_seq_cst);
+	if(do_exit != 0) {
+		return;
+	}
 	fprintf(stderr, "Device %d started\n", device);
-	sbuf = XCALLOC(RTL_BUFSIZE / sizeof(uint8_t), sizeof(float));
-	process_buf_uchar_init();
-	if(rtlsdr_read_async(rtl, process_buf_uchar, NULL, RTL_BUFCNT, RTL_BUFSIZE) < 0) {
+	ctx->sbuf = XCALLOC(RTL_BUFSIZE / sizeof(uint8_t), sizeof(float));
+	if(rtlsdr_read_async(rtl, process_buf_uchar, ctx, RTL_BUFCNT, RTL_BUFSIZE) < 0) {
 		fprintf(stderr, "Device #%d: async read failed\n", device);
 		_exit(1);
 	}
 }
 
 void rtl_cancel() {
-	if(rtl != NULL)
-		rtlsdr_cancel_async(rtl);
+	atomic_thread_fence(memory_order_seq_cst);
+	int cnt = atomic_load_explicit(&rtl_dev_cnt, memory_order_acquire);
+	for(int i = 0; i < cnt; i++) {
+		if(rtl_devs[i] != NULL)
+			rtlsdr_cancel_async(rtl_devs[i]);
+	}
 }
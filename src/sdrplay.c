@@ -22,21 +22,18 @@
 #include <string.h>             // strcmp
 #include <unistd.h>             // _exit, usleep
 #include <mirsdrapi-rsp.h>
-#include "dumpvdl2.h"           // sbuf, Config
+#include "dumpvdl2.h"           // sample_block_*, Config
 #include "sdrplay.h"
 
 #define MAX_IF_GR                59         // Upper limit of IF GR
 #define MIN_IF_GR                20         // Lower limit of IF GR (in normal IF GR range)
 #define MIXER_GR                 19
-#define ASYNC_BUF_NUMBER         15
-#define ASYNC_BUF_SIZE           (32*16384) // 512k shorts
-#define SDRPLAY_RATE (SYMBOL_RATE * SPS * SDRPLAY_OVERSAMPLE)
+#define ASYNC_BUF_SIZE           (32*16384) // 256k I/Q pairs
 #define SDRPLAY_DEFAULT_AGC_SETPOINT    -30
 
 typedef struct {
 	void *context;
-	unsigned char *sdrplay_data;
-	int data_index;
+	sample_block_t samples;
 } sdrplay_ctx_t;
 
 typedef enum {
@@ -78,60 +75,9 @@ static void sdrplay_streamCallback(short *xi, short *xq, unsigned int firstSampl
 	UNUSED(fsChanged);
 	UNUSED(reset);
 	UNUSED(hwRemoved);
-	int i, j, count1, count2, new_buf_flag;
-	int end, input_index;
 	sdrplay_ctx_t *SDRPlay = cbContext;
-	if(numSamples == 0) {
-		return;
-	}
-	unsigned char *dptr = SDRPlay->sdrplay_data;
-	// data_index counts samples
-	// numSamples counts I/Q sample pairs
-	end = SDRPlay->data_index + (numSamples * 2);
-	count2 = end - (ASYNC_BUF_SIZE * ASYNC_BUF_NUMBER);
-	if(count2 < 0) count2 = 0;              // count2 is samples wrapping around to start of buf
-	count1 = (numSamples * 2) - count2;     // count1 is samples fitting before the end of buf
-
-	// flag is set if this packet takes us past a multiple of ASYNC_BUF_SIZE
-	new_buf_flag = (SDRPlay->data_index / ASYNC_BUF_SIZE == end / ASYNC_BUF_SIZE ? 0 : 1);
-
-	// now interleave data from I/Q into circular buffer
-	input_index = 0;
-	for (i = 0, j = SDRPlay->data_index * sizeof(short); i < count1 / 2; i++) {
-		// Copy I low / high part
-		dptr[j++] = xi[input_index] & 0xff;
-		dptr[j++] = (xi[input_index] >> 8) & 0xff;
-		// Copy Q low / high part
-		dptr[j++] = xq[input_index] & 0xff;
-		dptr[j++] = (xq[input_index] >> 8 ) & 0xff;
-		input_index++;
-	}
-	SDRPlay->data_index += count1;
-
-	if(SDRPlay->data_index >= ASYNC_BUF_SIZE * ASYNC_BUF_NUMBER) {
-		SDRPlay->data_index = 0;            // pointer back to start of buffer
-	}
-
-	// insert remaining samples at the start of the buffer
-	for (i = 0, j = SDRPlay->data_index * sizeof(short); i < count2 / 2; i++) {
-		// Copy I low / high part
-		dptr[j++] = xi[input_index] & 0xff;
-		dptr[j++] = (xi[input_index] >> 8) & 0xff;
-		// Copy Q low / high part
-		dptr[j++] = xq[input_index] & 0xff;
-		dptr[j++] = (xq[input_index] >> 8 ) & 0xff;
-		input_index++;
-	}
-	SDRPlay->data_index += count2;
-
-	// send ASYNC_BUF_SIZE samples downstream, if available
-	if(new_buf_flag) {
-		// go back by one buffer length, then round down further to start of buffer
-		end = SDRPlay->data_index - ASYNC_BUF_SIZE;
-		if(end < 0) end += ASYNC_BUF_SIZE * ASYNC_BUF_NUMBER;
-		end -= end % ASYNC_BUF_SIZE;
-		process_buf_short(&SDRPlay->sdrplay_data[end * sizeof(short)], ASYNC_BUF_SIZE * sizeof(short), NULL);
-	}
+	// Convert I/Q straight into the demodulator sample block
+	sample_block_feed_cs16_split(&SDRPlay->samples, xi, xq, numSamples);
 }
 
 static void sdrplay_gainCallback(unsigned int gRdB, unsigned int lnaGRdB, void *cbContext) {
@@ -219,10 +165,23 @@ dev_found:
 	return devIdx;
 }
 
-void sdrplay_init(vdl2_state_t const *ctx, char const *dev, char const *antenna,
-		uint32_t freq, int gr, int ppm_error, int enable_biast,
+// Selects the widest IF filter which does not exceed the sampling rate
+static mir_sdr_Bw_MHzT sdrplay_select_bandwidth(uint32_t sample_rate) {
+	if(sample_rate >= 8000000) {
+		return mir_sdr_BW_8_000;
+	} else if(sample_rate >= 7000000) {
+		return mir_sdr_BW_7_000;
+	} else if(sample_rate >= 6000000) {
+		return mir_sdr_BW_6_000;
+	} else if(sample_rate >= 5000000) {
+		return mir_sdr_BW_5_000;
+	}
+	return mir_sdr_BW_1_536;
+}
+
+void sdrplay_init(vdl2_state_t *ctx, char const *dev, char const *antenna,
+		uint32_t freq, uint32_t sample_rate, int gr, int ppm_error, int enable_biast,
 		int enable_notch_filter, int enable_agc, int tuner) {
-	UNUSED(ctx);
 
 	mir_sdr_ErrT err;
 	float ver;
@@ -337,8 +296,7 @@ void sdrplay_init(vdl2_state_t const *ctx, char const *dev, char const *antenna,
 	}
 	fprintf(stderr, "Frequency correction set to %d ppm\n", ppm_error);
 
-	SDRPlay.sdrplay_data = XCALLOC(ASYNC_BUF_SIZE * ASYNC_BUF_NUMBER, sizeof(short));
-	sbuf = XCALLOC(ASYNC_BUF_SIZE, sizeof(float));
+	sample_block_init(&SDRPlay.samples, ctx, ASYNC_BUF_SIZE);
 
 	int gRdBsystem = gr;
 	if(gr == SDR_AUTO_GAIN) {
@@ -370,10 +328,9 @@ void sdrplay_init(vdl2_state_t const *ctx, char const *dev, char const *antenna,
 		_exit(1);
 	}
 
-	SDRPlay.data_index = 0;
 	int sdrplaySamplesPerPacket = 0;
 
-	err = mir_sdr_StreamInit (&gRdb, (double)SDRPLAY_RATE/1e6, (double)freq/1e6, mir_sdr_BW_1_536, mir_sdr_IF_Zero,
+	err = mir_sdr_StreamInit (&gRdb, (double)sample_rate/1e6, (double)freq/1e6, sdrplay_select_bandwidth(sample_rate), mir_sdr_IF_Zero,
 			lna_state, &gRdBsystem, mir_sdr_USE_RSP_SET_GR, &sdrplaySamplesPerPacket,
 			sdrplay_streamCallback, sdrplay_gainCallback, &SDRPlay);
 	if(err != mir_sdr_Success) {
@@ -22,19 +22,16 @@
 #include <unistd.h>             // _exit, usleep
 #include <sdrplay_api.h>
 #include <libacars/dict.h>      // la_dict
-#include "dumpvdl2.h"           // sbuf, Config
-#include "sdrplay3.h"           // SDRPLAY3_OVERSAMPLE
+#include "dumpvdl2.h"           // sample_block_*, Config
+#include "sdrplay3.h"           // sdrplay3_init
 
-#define SDRPLAY3_ASYNC_BUF_NUMBER           15
-#define SDRPLAY3_ASYNC_BUF_SIZE             (32*16384) // 512k shorts
-#define SDRPLAY3_RATE (SYMBOL_RATE * SPS * SDRPLAY3_OVERSAMPLE)
+#define SDRPLAY3_ASYNC_BUF_SIZE             (32*16384) // 256k I/Q pairs
 #define SDRPLAY3_DEFAULT_AGC_SETPOINT       -30
 
 typedef struct {
 	void *context;
 	HANDLE *dev;
-	unsigned char *sdrplay3_data;
-	int data_index;
+	sample_block_t samples;
 } sdrplay3_ctx_t;
 
 static char const *get_hw_descr(int hw_id) {
@@ -54,60 +51,9 @@ static void sdrplay3_streamCallback(short *xi, short *xq, sdrplay_api_StreamCbPa
 		unsigned int numSamples, unsigned int reset, void *cbContext) {
 	UNUSED(params);
 	UNUSED(reset);
-	int i, j, count1, count2, new_buf_flag;
-	int end, input_index;
 	sdrplay3_ctx_t *SDRPlay = cbContext;
-	if(numSamples == 0) {
-		return;
-	}
-	unsigned char *dptr = SDRPlay->sdrplay3_data;
-	// data_index counts samples
-	// numSamples counts I/Q sample pairs
-	end = SDRPlay->data_index + (numSamples * 2);
-	count2 = end - (SDRPLAY3_ASYNC_BUF_SIZE * SDRPLAY3_ASYNC_BUF_NUMBER);
-	if(count2 < 0) count2 = 0;              // count2 is samples wrapping around to start of buf
-	count1 = (numSamples * 2) - count2;     // count1 is samples fitting before the end of buf
-
-	// flag is set if this packet takes us past a multiple of SDRPLAY3_ASYNC_BUF_SIZE
-	new_buf_flag = (SDRPlay->data_index / SDRPLAY3_ASYNC_BUF_SIZE == end / SDRPLAY3_ASYNC_BUF_SIZE ? 0 : 1);
-
-	// now interleave data from I/Q into circular buffer
-	input_index = 0;
-	for (i = 0, j = SDRPlay->data_index * sizeof(short); i < count1 / 2; i++) {
-		// Copy I low / high part
-		dptr[j++] = xi[input_index] & 0xff;
-		dptr[j++] = (xi[input_index] >> 8) & 0xff;
-		// Copy Q low / high part
-		dptr[j++] = xq[input_index] & 0xff;
-		dptr[j++] = (xq[input_index] >> 8 ) & 0xff;
-		input_index++;
-	}
-	SDRPlay->data_index += count1;
-
-	if(SDRPlay->data_index >= SDRPLAY3_ASYNC_BUF_SIZE * SDRPLAY3_ASYNC_BUF_NUMBER) {
-		SDRPlay->data_index = 0;            // pointer back to start of buffer
-	}
-
-	// insert remaining samples at the start of the buffer
-	for (i = 0, j = SDRPlay->data_index * sizeof(short); i < count2 / 2; i++) {
-		// Copy I low / high part
-		dptr[j++] = xi[input_index] & 0xff;
-		dptr[j++] = (xi[input_index] >> 8) & 0xff;
-		// Copy Q low / high part
-		dptr[j++] = xq[input_index] & 0xff;
-		dptr[j++] = (xq[input_index] >> 8 ) & 0xff;
-		input_index++;
-	}
-	SDRPlay->data_index += count2;
-
-	// send SDRPLAY3_ASYNC_BUF_SIZE samples downstream, if available
-	if(new_buf_flag) {
-		// go back by one buffer length, then round down further to start of buffer
-		end = SDRPlay->data_index - SDRPLAY3_ASYNC_BUF_SIZE;
-		if(end < 0) end += SDRPLAY3_ASYNC_BUF_SIZE * SDRPLAY3_ASYNC_BUF_NUMBER;
-		end -= end % SDRPLAY3_ASYNC_BUF_SIZE;
-		process_buf_short(&SDRPlay->sdrplay3_data[end * sizeof(short)], SDRPLAY3_ASYNC_BUF_SIZE * sizeof(short), NULL);
-	}
+	// Convert I/Q straight into the demodulator sample block
+	sample_block_feed_cs16_split(&SDRPlay->samples, xi, xq, numSamples);
 }
 
 static void sdrplay3_eventCallback(sdrplay_api_EventT eventId, sdrplay_api_TunerSelectT tuner,
@@ -314,11 +260,24 @@ dev_found:
 	return devIdx;
 }
 
-void sdrplay3_init(vdl2_state_t const *ctx, char const *dev, char const *antenna,
-		double freq, int ifgr, int lna_state, double freq_correction_ppm,
+// Selects the widest IF filter which does not exceed the sampling rate
+static sdrplay_api_Bw_MHzT sdrplay3_select_bandwidth(uint32_t sample_rate) {
+	if(sample_rate >= 8000000) {
+		return sdrplay_api_BW_8_000;
+	} else if(sample_rate >= 7000000) {
+		return sdrplay_api_BW_7_000;
+	} else if(sample_rate >= 6000000) {
+		return sdrplay_api_BW_6_000;
+	} else if(sample_rate >= 5000000) {
+		return sdrplay_api_BW_5_000;
+	}
+	return sdrplay_api_BW_1_536;
+}
+
+void sdrplay3_init(vdl2_state_t *ctx, char const *dev, char const *antenna,
+		double freq, uint32_t sample_rate, int ifgr, int lna_state, double freq_correction_ppm,
 		int enable_biast, int enable_notch_filter, int enable_dab_notch_filter,
 		int agc_set_point, int tuner) {
-	UNUSED(ctx);
 
 	sdrplay_api_ErrT err;
 	float ver = 1.0f;
@@ -395,11 +354,11 @@ void sdrplay3_init(vdl2_state_t const *ctx, char const *dev, char const *antenna
 		fprintf(stderr, "Unable to read device %s parameters: %s\n", device->SerNo, sdrplay_api_GetErrorString(err));
 		goto fail;
 	}
-	devParams->devParams->fsFreq.fsHz = SDRPLAY3_RATE;
+	devParams->devParams->fsFreq.fsHz = sample_rate;
 	devParams->devParams->ppm = freq_correction_ppm;
 
 	sdrplay_api_RxChannelParamsT *chParams = devParams->rxChannelA;
-	chParams->tunerParams.bwType = sdrplay_api_BW_1_536;
+	chParams->tunerParams.bwType = sdrplay3_select_bandwidth(sample_rate);
 	chParams->tunerParams.ifType = sdrplay_api_IF_Zero;
 	chParams->tunerParams.rfFreq.rfHz = freq;
 
@@ -454,10 +413,8 @@ void sdrplay3_init(vdl2_state_t const *ctx, char const *dev, char const *antenna
 	callbacks.StreamBCbFn = NULL;
 	callbacks.EventCbFn = sdrplay3_eventCallback;
 
-	SDRPlay.sdrplay3_data = XCALLOC(SDRPLAY3_ASYNC_BUF_SIZE * SDRPLAY3_ASYNC_BUF_NUMBER, sizeof(short));
-	SDRPlay.data_index = 0;
 	SDRPlay.dev = device->dev;
-	sbuf = XCALLOC(SDRPLAY3_ASYNC_BUF_SIZE, sizeof(float));
+	sample_block_init(&SDRPlay.samples, ctx, SDRPLAY3_ASYNC_BUF_SIZE);
 
 	err = sdrplay_api_Init(device->dev, &callbacks, &SDRPlay);
 	if(err != sdrplay_api_Success) {
@@ -0,0 +1,363 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Reader of SigMF recording metadata (https://sigmf.org).
+ * A recording consists of a dataset file (<name>.sigmf-data) holding raw
+ * samples and a metadata file (<name>.sigmf-meta) which is a JSON document.
+ * Only a handful of fields are of interest here:
+ * - global."core:datatype" - sample format,
+ * - global."core:sample_rate" - sampling rate,
+ * - global."core:num_channels" - must be 1 if present,
+ * - captures[0]."core:frequency" - center frequency.
+ * Everything else is skipped by a minimal JSON parser below, so that no
+ * additional library is required.
+ */
+
+#include <stdio.h>                      // fprintf, fopen, fread, fclose
+#include <stdlib.h>                     // strtod
+#include <string.h>                     // strcmp, strncmp, strlen, strcpy, strerror, memcpy
+#include <errno.h>                      // errno
+#include <math.h>                       // lrint
+#include <sys/stat.h>                   // stat
+#include "dumpvdl2.h"                   // XCALLOC, XFREE, ASSERT, debug_print
+#include "sigmf.h"
+
+// Metadata files with lots of annotations might be large, but not that large
+#define SIGMF_META_MAX_SIZE (64 * 1024 * 1024)
+#define JSON_MAX_DEPTH 64
+#define JSON_MAX_KEY_LEN 64
+
+typedef struct {
+	char const *p;
+	int depth;
+} json_parser;
+
+// Parser callbacks must consume the value of the member or element
+typedef bool (json_member_func)(json_parser *jp, char const *key, void *ctx);
+typedef bool (json_element_func)(json_parser *jp, int idx, void *ctx);
+
+static bool json_skip_value(json_parser *jp);
+
+static void json_skip_ws(json_parser *jp) {
+	while(*jp->p == ' ' || *jp->p == '\t' || *jp->p == '\n' || *jp->p == '\r') {
+		jp->p++;
+	}
+}
+
+// Consumes the given character (preceded by optional whitespace), if it's there
+static bool json_accept(json_parser *jp, char c) {
+	json_skip_ws(jp);
+	if(*jp->p != c) {
+		return false;
+	}
+	jp->p++;
+	return true;
+}
+
+// Stores the string in buf, truncating it if necessary (buf may be NULL).
+// Escape sequences other than \" \\ and \/ are replaced with '?', which is
+// good enough for the fields of interest.
+static bool json_parse_string(json_parser *jp, char *buf, size_t buflen) {
+	if(!json_accept(jp, '"')) {
+		return false;
+	}
+	size_t len = 0;
+	while(*jp->p != '"') {
+		char c = *jp->p++;
+		if(c == '\0') {
+			return false;
+		} else if(c == '\\') {
+			c = *jp->p++;
+			if(c == '\0') {
+				return false;
+			} else if(c == 'u') {
+				for(int i = 0; i < 4; i++) {
+					if(*jp->p == '\0') {
+						return false;
+					}
+					jp->p++;
+				}
+				c = '?';
+			} else if(c != '"' && c != '\\' && c != '/') {
+				c = '?';
+			}
+		}
+		if(buf != NULL && len + 1 < buflen) {
+			buf[len++] = c;
+		}
+	}
+	jp->p++;
+	if(buf != NULL) {
+		buf[len] = '\0';
+	}
+	return true;
+}
+
+static bool json_parse_number(json_parser *jp, double *result) {
+	json_skip_ws(jp);
+	char *end = NULL;
+	double val = strtod(jp->p, &end);
+	if(end == jp->p) {
+		return false;
+	}
+	jp->p = end;
+	if(result != NULL) {
+		*result = val;
+	}
+	return true;
+}
+
+static bool json_parse_literal(json_parser *jp, char const *literal) {
+	size_t len = strlen(literal);
+	if(strncmp(jp->p, literal, len) != 0) {
+		return false;
+	}
+	jp->p += len;
+	return true;
+}
+
+static bool json_parse_object(json_parser *jp, json_member_func *member_func, void *ctx) {
+	if(!json_accept(jp, '{') || ++jp->depth > JSON_MAX_DEPTH) {
+		return false;
+	}
+	if(!json_accept(jp, '}')) {
+		do {
+			char key[JSON_MAX_KEY_LEN];
+			if(!json_parse_string(jp, key, sizeof(key)) || !json_accept(jp, ':') ||
+					!member_func(jp, key, ctx)) {
+				return false;
+			}
+		} while(json_accept(jp, ','));
+		if(!json_accept(jp, '}')) {
+			return false;
+		}
+	}
+	jp->depth--;
+	return true;
+}
+
+static bool json_parse_array(json_parser *jp, json_element_func *element_func, void *ctx) {
+	if(!json_accept(jp, '[') || ++jp->depth > JSON_MAX_DEPTH) {
+		return false;
+	}
+	if(!json_accept(jp, ']')) {
+		int idx = 0;
+		do {
+			if(!element_func(jp, idx++, ctx)) {
+				return false;
+			}
+		} while(json_accept(jp, ','));
+		if(!json_accept(jp, ']')) {
+			return false;
+		}
+	}
+	jp->depth--;
+	return true;
+}
+
+static bool json_skip_member(json_parser *jp, char const *key, void *ctx) {
+	UNUSED(key);
+	UNUSED(ctx);
+	return json_skip_value(jp);
+}
+
+static bool json_skip_element(json_parser *jp, int idx, void *ctx) {
+	UNUSED(idx);
+	UNUSED(ctx);
+	return json_skip_value(jp);
+}
+
+static bool json_skip_value(json_parser *jp) {
+	json_skip_ws(jp);
+	switch(*jp->p) {
+		case '{':
+			return json_parse_object(jp, json_skip_member, NULL);
+		case '[':
+			return json_parse_array(jp, json_skip_element, NULL);
+		case '"':
+			return json_parse_string(jp, NULL, 0);
+		case 't':
+			return json_parse_literal(jp, "true");
+		case 'f':
+			return json_parse_literal(jp, "false");
+		case 'n':
+			return json_parse_literal(jp, "null");
+		default:
+			return json_parse_number(jp, NULL);
+	}
+}
+
+// Values collected while parsing the metadata
+typedef struct {
+	char datatype[32];
+	double sample_rate;
+	double frequency;
+	double num_channels;
+} sigmf_fields;
+
+static bool sigmf_global_member(json_parser *jp, char const *key, void *ctx) {
+	sigmf_fields *f = ctx;
+	if(!strcmp(key, "core:datatype")) {
+		return json_parse_string(jp, f->datatype, sizeof(f->datatype));
+	} else if(!strcmp(key, "core:sample_rate")) {
+		return json_parse_number(jp, &f->sample_rate);
+	} else if(!strcmp(key, "core:num_channels")) {
+		return json_parse_number(jp, &f->num_channels);
+	}
+	return json_skip_value(jp);
+}
+
+static bool sigmf_capture_member(json_parser *jp, char const *key, void *ctx) {
+	sigmf_fields *f = ctx;
+	if(!strcmp(key, "core:frequency")) {
+		return json_parse_number(jp, &f->frequency);
+	}
+	return json_skip_value(jp);
+}
+
+static bool sigmf_capture(json_parser *jp, int idx, void *ctx) {
+	if(idx == 0) {
+		return json_parse_object(jp, sigmf_capture_member, ctx);
+	}
+	return json_skip_value(jp);
+}
+
+static bool sigmf_toplevel_member(json_parser *jp, char const *key, void *ctx) {
+	if(!strcmp(key, "global")) {
+		return json_parse_object(jp, sigmf_global_member, ctx);
+	} else if(!strcmp(key, "captures")) {
+		return json_parse_array(jp, sigmf_capture, ctx);
+	}
+	return json_skip_value(jp);
+}
+
+static enum sample_formats sigmf_datatype_parse(char const *datatype) {
+	static struct {
+		char const *datatype;
+		enum sample_formats sfmt;
+	} const datatypes[] = {
+		{ "cu8",        SFMT_U8 },
+		{ "ci8",        SFMT_S8 },
+		{ "ci16_le",    SFMT_S16_LE },
+		{ "cf32_le",    SFMT_F32_LE },
+	};
+	for(size_t i = 0; i < sizeof(datatypes) / sizeof(datatypes[0]); i++) {
+		if(!strcmp(datatype, datatypes[i].datatype)) {
+			return datatypes[i].sfmt;
+		}
+	}
+	return SFMT_UNDEF;
+}
+
+static bool has_suffix(char const *str, char const *suffix) {
+	size_t len = strlen(str), slen = strlen(suffix);
+	return len >= slen && !strcmp(str + len - slen, suffix);
+}
+
+// Returns a copy of path with its SigMF extension replaced with ext
+static char *sigmf_path_with_ext(char const *path, char const *ext) {
+	size_t base_len = strlen(path) - strlen(SIGMF_DATA_EXT);    // both extensions are equally long
+	char *result = XCALLOC(base_len + strlen(ext) + 1, sizeof(char));
+	memcpy(result, path, base_len);
+	strcpy(result + base_len, ext);
+	return result;
+}
+
+static char *sigmf_file_read(char const *path) {
+	FILE *f = fopen(path, "r");
+	if(f == NULL) {
+		fprintf(stderr, "Could not open %s: %s\n", path, strerror(errno));
+		return NULL;
+	}
+	char *buf = NULL;
+	struct stat st;
+	if(fstat(fileno(f), &st) < 0) {
+		fprintf(stderr, "Could not stat %s: %s\n", path, strerror(errno));
+		goto end;
+	}
+	if(st.st_size > SIGMF_META_MAX_SIZE) {
+		fprintf(stderr, "%s: file too large\n", path);
+		goto end;
+	}
+	size_t size = (size_t)st.st_size;
+	buf = XCALLOC(size + 1, sizeof(char));
+	if(fread(buf, 1, size, f) != size) {
+		fprintf(stderr, "Could not read %s\n", path);
+		XFREE(buf);
+	}
+end:
+	fclose(f);
+	return buf;
+}
+
+// Returns true if the path points to either part of a SigMF recording
+bool sigmf_is_recording(char const *path) {
+	ASSERT(path != NULL);
+	return has_suffix(path, SIGMF_DATA_EXT) || has_suffix(path, SIGMF_META_EXT);
+}
+
+// Reads metadata of the recording which path belongs to (either the dataset
+// or the metadata file). On success, meta->data_path is allocated and
+// the remaining fields are set to the values found in the metadata.
+int sigmf_meta_read(char const *path, sigmf_meta_t *meta) {
+	ASSERT(path != NULL);
+	ASSERT(meta != NULL);
+	ASSERT(sigmf_is_recording(path));
+	int ret = -1;
+	char *meta_path = sigmf_path_with_ext(path, SIGMF_META_EXT);
+	char *buf = sigmf_file_read(meta_path);
+	if(buf == NULL) {
+		goto end;
+	}
+	sigmf_fields f = { 0 };
+	json_parser jp = { .p = buf, .depth = 0 };
+	if(!json_parse_object(&jp, sigmf_toplevel_member, &f)) {
+		fprintf(stderr, "%s: JSON syntax error at offset %td\n", meta_path, jp.p - buf);
+		goto end;
+	}
+	debug_print(D_MISC, "%s: datatype: '%s' sample_rate: %f frequency: %f num_channels: %f\n",
+			meta_path, f.datatype, f.sample_rate, f.frequency, f.num_channels);
+
+	if(f.num_channels > 1.0) {
+		fprintf(stderr, "%s: multichannel recordings are not supported\n", meta_path);
+		goto end;
+	}
+	meta->sample_fmt = SFMT_UNDEF;
+	if(f.datatype[0] != '\0') {
+		meta->sample_fmt = sigmf_datatype_parse(f.datatype);
+		if(meta->sample_fmt == SFMT_UNDEF) {
+			fprintf(stderr, "%s: unsupported datatype '%s' (supported: cu8, ci8, ci16_le, cf32_le)\n",
+					meta_path, f.datatype);
+			goto end;
+		}
+	}
+	if(f.sample_rate < 0.0 || f.sample_rate > (double)UINT32_MAX ||
+			f.frequency < 0.0 || f.frequency > (double)UINT32_MAX) {
+		fprintf(stderr, "%s: sampling rate or frequency out of range\n", meta_path);
+		goto end;
+	}
+	meta->sample_rate = (uint32_t)lrint(f.sample_rate);
+	meta->centerfreq = (uint32_t)lrint(f.frequency);
+	meta->data_path = sigmf_path_with_ext(path, SIGMF_DATA_EXT);
+	ret = 0;
+end:
+	XFREE(buf);
+	XFREE(meta_path);
+	return ret;
+}
@@ -0,0 +1,41 @@
+/*
+ *  This file is a part of dumpvdl2
+ *
+ *  Copyright (c) 2017-2023 Tomasz Lemiech <szpajder@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _SIGMF_H
+#define _SIGMF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "dumpvdl2.h"                   // enum sample_formats
+
+#define SIGMF_DATA_EXT ".sigmf-data"
+#define SIGMF_META_EXT ".sigmf-meta"
+
+// Recording parameters read from SigMF metadata
+typedef struct {
+	char *data_path;                    // path to the dataset file
+	enum sample_formats sample_fmt;     // SFMT_UNDEF if not given
+	uint32_t sample_rate;               // 0 if not given
+	uint32_t centerfreq;                // 0 if not given
+} sigmf_meta_t;
+
+// sigmf.c
+bool sigmf_is_recording(char const *path);
+int sigmf_meta_read(char const *path, sigmf_meta_t *meta);
+
+#endif // !_SIGMF_H
@@ -23,8 +23,8 @@
 #include <SoapySDR/Version.h>   // SOAPY_SDR_API_VERSION
 #include <SoapySDR/Types.h>     // SoapySDRKwargs_*
 #include <SoapySDR/Device.h>    // SoapySDRStream, SoapySDRDevice_*
-#include <SoapySDR/Formats.h>   // SOAPY_SDR_CS16, SoapySDR_formatToSize()
-#include "dumpvdl2.h"           // vdl2_state_t, do_exit, XFREE()
+#include <SoapySDR/Formats.h>   // SOAPY_SDR_CS8, SOAPY_SDR_CS16, SOAPY_SDR_CF32, SoapySDR_formatToSize()
+#include "dumpvdl2.h"           // vdl2_state_t, do_exit, XFREE(), sample_block_*
 #include "soapysdr.h"
 
 static void soapysdr_verbose_device_search() {
@@ -40,9 +40,32 @@ static void soapysdr_verbose_device_search() {
 	SoapySDRKwargsList_clear(results, length);
 }
 
-void soapysdr_init(vdl2_state_t *ctx, char *dev, char *antenna, int freq, int bw, float gain,
+// Returns the sample format to be requested from the device. Its native format
+// is preferred if it can be consumed directly, as it saves a conversion in the
+// driver and often some bus bandwidth (eg. CS8 on HackRF or RTL-SDR).
+// Otherwise CS16 is used, as every driver supports it.
+static enum sample_formats soapysdr_stream_format(SoapySDRDevice *sdr) {
+	enum sample_formats result = SFMT_S16_LE;
+	double full_scale = 0.0;
+	char *native = SoapySDRDevice_getNativeStreamFormat(sdr, SOAPY_SDR_RX, 0, &full_scale);
+	if(native != NULL) {
+		debug_print(D_SDR, "native stream format: %s, full scale: %f\n", native, full_scale);
+		if(!strcmp(native, SOAPY_SDR_CS8)) {
+			result = SFMT_S8;
+		} else if(!strcmp(native, SOAPY_SDR_CF32)) {
+			result = SFMT_F32_LE;
+		}
+#if SOAPY_SDR_API_VERSION < 0x00080000
+		free(native);
+#else
+		SoapySDR_free(native);
+#endif
+	}
+	return result;
+}
+
+void soapysdr_init(vdl2_state_t *ctx, char *dev, char *antenna, int freq, uint32_t sample_rate, int bw, float gain,
 		int ppm_error, char* settings, char* gains_param) {
-	UNUSED(ctx);
 	soapysdr_verbose_device_search();
 
 	SoapySDRDevice *sdr = SoapySDRDevice_makeStrArgs(dev);
@@ -50,7 +73,7 @@ void soapysdr_init(vdl2_state_t *ctx, char *dev, char *antenna, int freq, int bw
 		fprintf(stderr, "Could not open SoapySDR device '%s': %s\n", dev, SoapySDRDevice_lastError());
 		_exit(1);
 	}
-	if(SoapySDRDevice_setSampleRate(sdr, SOAPY_SDR_RX, 0, SOAPYSDR_RATE) != 0) {
+	if(SoapySDRDevice_setSampleRate(sdr, SOAPY_SDR_RX, 0, sample_rate) != 0) {
 		fprintf(stderr, "setSampleRate failed: %s\n", SoapySDRDevice_lastError());
 		_exit(1);
 	}
@@ -135,17 +158,19 @@ void soapysdr_init(vdl2_state_t *ctx, char *dev, char *antenna, int freq, int bw
 		XFREE(settings);
 	}
 
-	size_t elemsize = SoapySDR_formatToSize(SOAPY_SDR_CS16);
-	int16_t *buffer = XCALLOC(SOAPYSDR_SAMPLE_PER_BUFFER, elemsize);
-	unsigned char *ring_buffer = XCALLOC(SOAPYSDR_BUFSIZE * SOAPYSDR_BUFCNT, sizeof(short));
-	unsigned char *send_buffer = XCALLOC(SOAPYSDR_BUFSIZE, sizeof(short));
-	sbuf = XCALLOC(SOAPYSDR_BUFSIZE, sizeof(float));
+	enum sample_formats sfmt = soapysdr_stream_format(sdr);
+	char const *format = sfmt == SFMT_S8 ? SOAPY_SDR_CS8 : sfmt == SFMT_F32_LE ? SOAPY_SDR_CF32 : SOAPY_SDR_CS16;
+	fprintf(stderr, "Stream format: %s\n", format);
+	size_t elemsize = SoapySDR_formatToSize(format);
+	void *buffer = XCALLOC(SOAPYSDR_SAMPLE_PER_BUFFER, elemsize);
+	sample_block_t samples;
+	sample_block_init(&samples, ctx, SOAPYSDR_BUFSIZE);
 
 	SoapySDRStream *rxStream;
 #if SOAPY_SDR_API_VERSION < 0x00080000
-	if(SoapySDRDevice_setupStream(sdr, &rxStream, SOAPY_SDR_RX, SOAPY_SDR_CS16, NULL, 0, NULL) != 0)
+	if(SoapySDRDevice_setupStream(sdr, &rxStream, SOAPY_SDR_RX, format, NULL, 0, NULL) != 0)
 #else
-		if((rxStream = SoapySDRDevice_setupStream(sdr, SOAPY_SDR_RX, SOAPY_SDR_CS16, NULL, 0, NULL)) == NULL)
+		if((rxStream = SoapySDRDevice_setupStream(sdr, SOAPY_SDR_RX, format, NULL, 0, NULL)) == NULL)
 #endif
 		{
 			fprintf(stderr, "setupStream failed: %s\n", SoapySDRDevice_lastError());
@@ -155,9 +180,6 @@ void soapysdr_init(vdl2_state_t *ctx, char *dev, char *antenna, int freq, int bw
 	usleep(100000);
 
 	// Read input samples
-	long ring_index = 0;
-	long buf_elem_size = SOAPYSDR_BUFSIZE * sizeof(short);
-	long last_send_index = 0;
 	while (!do_exit) {
 		void *buffs[] = {buffer};
 		int flags = 0;
@@ -176,52 +198,17 @@ void soapysdr_init(vdl2_state_t *ctx, char *dev, char *antenna, int freq, int bw
 			do_exit = 1;
 			break;
 		}
-		int iq_count = r * 2;
-		// copy to ring_buffer
-		// Ring_index is on unsigned char
-		if(ring_index + r * elemsize < SOAPYSDR_BUFSIZE * SOAPYSDR_BUFCNT * sizeof(short)) {
-			for(int i = 0; i< iq_count; i++) {
-				// copy low / high part
-				ring_buffer[ring_index++] = buffer[i] & 0xff;
-				ring_buffer[ring_index++] = (buffer[i] >> 8) & 0xff;
-			}
-		} else {
-			int counth = SOAPYSDR_BUFSIZE * SOAPYSDR_BUFCNT * sizeof(short) - ring_index;
-			int buffer_index = 0;
-			for(int i = 0; i < counth / (int)sizeof(short); i++) {
-				// copy low / high part
-				ring_buffer[ring_index++] = buffer[buffer_index] & 0xff;
-				ring_buffer[ring_index++] = (buffer[buffer_index] >> 8) & 0xff;
-				buffer_index++;
-			}
-			int countl = iq_count * sizeof(short) - counth;
-			ring_index = 0;
-			for(int i = 0; i < countl / (int)sizeof(short); i++) {
-				// copy low / high part
-				ring_buffer[ring_index++] = buffer[buffer_index] & 0xff;
-				ring_buffer[ring_index++] = (buffer[buffer_index] >> 8) & 0xff;
-				buffer_index++;
-			}
-		}
-
-		// Store * elemsize
-		if(ring_index < last_send_index) {
-			int size = ring_index + SOAPYSDR_BUFSIZE * SOAPYSDR_BUFCNT * sizeof(short) - last_send_index;
-			if(size >= buf_elem_size) {
-				// copy to trunc buffer
-				int send_index = 0;
-				for(int i = 0; i< buf_elem_size; i++) {
-					// copy low / high part
-					send_buffer[send_index++] = ring_buffer[last_send_index++];
-					if(last_send_index >= SOAPYSDR_BUFSIZE * SOAPYSDR_BUFCNT * (long)sizeof(short)) {
-						last_send_index = 0;
-					}
-				}
-				process_buf_short(&send_buffer[0], buf_elem_size, NULL);
-			}
-		} else if((ring_index - last_send_index) >= buf_elem_size) {
-			process_buf_short(&ring_buffer[ring_index - buf_elem_size], buf_elem_size, NULL);
-			last_send_index = ring_index;
+		// Convert I/Q straight into the demodulator sample block
+		switch(sfmt) {
+			case SFMT_S8:
+				sample_block_feed_cs8(&samples, buffer, (uint32_t)r * 2);
+				break;
+			case SFMT_F32_LE:
+				sample_block_feed_cf32(&samples, buffer, (uint32_t)r * 2);
+				break;
+			default:
+				sample_block_feed_cs16(&samples, buffer, (uint32_t)r * 2);
+				break;
 		}
 	}
 	SoapySDRDevice_deactivateStream(sdr, rxStream, 0, 0);
@@ -16,79 +16,195 @@
  *  You should have received a copy of the GNU General Public License
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+
+/* Metrics are accumulated in the in-process registry (metrics.c) and
+ * sent to the statsd server periodically by a separate thread. Each flush
+ * sends deltas of all counters which have changed since the previous one,
+ * packed into as few datagrams as possible.
+ */
+
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
-#include <sys/time.h>
+#include <pthread.h>                // pthread_mutex_*
 #include <statsd/statsd-client.h>
 #include <libacars/libacars.h>      // la_msg_dir
 #include <libacars/vstring.h>       // la_vstring
 #include "dumpvdl2.h"
+#include "metrics.h"                // metrics_*
 #include "config.h"
 
 #define STATSD_NAMESPACE "dumpvdl2"
+// Max payload size of a single datagram. Keep it below the typical MTU to
+// avoid fragmentation.
+#define STATSD_PACKET_MAX 1400
+
 static statsd_link *statsd = NULL;
+static pthread_t statsd_thread;
+static pthread_mutex_t statsd_flush_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int statsd_interval;
+
+// Values sent in the previous flush
+static struct {
+	int channel_cnt;                // number of channel slots announced so far
+	uint64_t channel_counters[METRICS_MAX_CHANNELS][MC_COUNTER_CNT];
+	uint64_t channel_histogram_cnt[METRICS_MAX_CHANNELS][MH_HISTOGRAM_CNT];
+	double channel_histogram_sum[METRICS_MAX_CHANNELS][MH_HISTOGRAM_CNT];
+	uint64_t msgdir_counters[LA_MSG_DIR_GND2AIR + 1][MD_COUNTER_CNT];
+	uint64_t counters[M_COUNTER_CNT];
+	int64_t gauges[MG_GAUGE_CNT];
+	int queue_cnt;                  // number of queues announced so far
+	uint64_t queue_enqueued[METRICS_MAX_QUEUES];
+	uint64_t queue_dropped[METRICS_MAX_QUEUES];
+	bool initialized;
+} sent;
+
+static struct {
+	char buf[STATSD_PACKET_MAX + 1];
+	size_t len;
+	int metric_cnt;
+	int packet_cnt;
+} packet;
+
+static void statsd_packet_send() {
+	if(packet.len > 0) {
+		statsd_send(statsd, packet.buf);
+		packet.packet_cnt++;
+		packet.len = 0;
+		packet.buf[0] = '\0';
+	}
+}
+
+// Appends a metric to the current packet, sending it out first if there is
+// no room left.
+static void statsd_packet_add(char *metric, char const *type, size_t value) {
+	char line[320];
+	statsd_prepare(statsd, metric, value, type, 1.0, line, sizeof(line), 1);
+	size_t line_len = strlen(line);
+	if(packet.len + line_len > STATSD_PACKET_MAX) {
+		statsd_packet_send();
+	}
+	memcpy(packet.buf + packet.len, line, line_len + 1);
+	packet.len += line_len;
+	packet.metric_cnt++;
+}
+
+// Returns true if the counter needs to be sent, ie. it has changed since
+// the last flush or it's being sent for the first time (so that the statsd
+// server knows about all counters right from the start, even if they are zero).
+static bool statsd_counter_update(uint64_t *last, uint64_t now, bool first, size_t *delta) {
+	if(now == *last && !first) {
+		return false;
+	}
+	*delta = now - *last;
+	*last = now;
+	return true;
+}
+
+static void statsd_flush() {
+	char metric[256];
+	size_t delta;
+	pthread_mutex_lock(&statsd_flush_mutex);
+	packet.metric_cnt = packet.packet_cnt = 0;
+
+	int channel_cnt = metrics_channel_cnt();
+	for(int slot = 0; slot < channel_cnt; slot++) {
+		uint32_t freq = metrics_channel_freq(slot);
+		bool first = slot >= sent.channel_cnt;
+		for(metrics_channel_counter id = 0; id < MC_COUNTER_CNT; id++) {
+			if(statsd_counter_update(&sent.channel_counters[slot][id],
+						metrics_channel_counter_get(slot, id), first, &delta)) {
+				snprintf(metric, sizeof(metric), "%u.%s", freq, metrics_channel_counter_name(id));
+				statsd_packet_add(metric, "c", delta);
+			}
+		}
+		// Timers are not sent per event. Instead, the average value over
+		// the flush interval is sent once.
+		for(metrics_channel_histogram id = 0; id < MH_HISTOGRAM_CNT; id++) {
+			if(strcmp(metrics_channel_histogram_unit(id), "seconds") != 0) {
+				continue;
+			}
+			uint64_t cnt;
+			double sum;
+			metrics_channel_histogram_get(slot, id, &cnt, &sum);
+			uint64_t *last_cnt = &sent.channel_histogram_cnt[slot][id];
+			double *last_sum = &sent.channel_histogram_sum[slot][id];
+			if(cnt > *last_cnt) {
+				uint32_t avg_ms = (uint32_t)((sum - *last_sum) * 1000.0 / (double)(cnt - *last_cnt));
+				snprintf(metric, sizeof(metric), "%u.%s", freq, metrics_channel_histogram_name(id));
+				statsd_packet_add(metric, "ms", avg_ms);
+				*last_cnt = cnt;
+				*last_sum = sum;
+			}
+		}
+	}
+	sent.channel_cnt = channel_cnt;
+
+	for(la_msg_dir dir = LA_MSG_DIR_AIR2GND; dir <= LA_MSG_DIR_GND2AIR; dir++) {
+		for(metrics_msgdir_counter id = 0; id < MD_COUNTER_CNT; id++) {
+			if(statsd_counter_update(&sent.msgdir_counters[dir][id],
+						metrics_msgdir_counter_get(dir, id), !sent.initialized, &delta)) {
+				snprintf(metric, sizeof(metric), "%s.%s", metrics_msgdir_counter_name(id), metrics_msgdir_label(dir));
+				statsd_packet_add(metric, "c", delta);
+			}
+		}
+	}
+	for(metrics_counter id = 0; id < M_COUNTER_CNT; id++) {
+		if(statsd_counter_update(&sent.counters[id], metrics_counter_get(id), !sent.initialized, &delta)) {
+			snprintf(metric, sizeof(metric), "%s", metrics_counter_name(id));
+			statsd_packet_add(metric, "c", delta);
+		}
+	}
+	for(metrics_gauge id = 0; id < MG_GAUGE_CNT; id++) {
+		int64_t val = metrics_gauge_get(id);
+		if(val != sent.gauges[id]) {
+			snprintf(metric, sizeof(metric), "%s", metrics_gauge_name(id));
+			statsd_packet_add(metric, "g", val > 0 ? (size_t)val : 0);
+			sent.gauges[id] = val;
+		}
+	}
+	// Queue lengths are sent on every flush, because they change constantly
+	int queue_cnt = metrics_queue_cnt();
+	metrics_queue_stats qs;
+	for(int i = 0; i < queue_cnt; i++) {
+		bool first = i >= sent.queue_cnt;
+		metrics_queue_get(i, &qs);
+		snprintf(metric, sizeof(metric), "queue.%s.length", qs.name);
+		statsd_packet_add(metric, "g", qs.length);
+		snprintf(metric, sizeof(metric), "queue.%s.length_max", qs.name);
+		statsd_packet_add(metric, "g", qs.length_max);
+		if(statsd_counter_update(&sent.queue_enqueued[i], qs.enqueued, first, &delta)) {
+			snprintf(metric, sizeof(metric), "queue.%s.enqueued", qs.name);
+			statsd_packet_add(metric, "c", delta);
+		}
+		if(statsd_counter_update(&sent.queue_dropped[i], qs.dropped, first, &delta)) {
+			snprintf(metric, sizeof(metric), "queue.%s.dropped", qs.name);
+			statsd_packet_add(metric, "c", delta);
+		}
+	}
+	sent.queue_cnt = queue_cnt;
 
-static char const *counters_per_channel[] = {
-	"avlc.errors.bad_fcs",
-	"avlc.errors.too_short",
-	"avlc.frames.good",
-	"avlc.frames.processed",
-	"avlc.msg.air2air",
-	"avlc.msg.air2all",
-	"avlc.msg.air2gnd",
-	"avlc.msg.gnd2air",
-	"avlc.msg.gnd2all",
-	"avlc.msg.gnd2gnd",
-	"decoder.blocks.fec_ok",
-	"decoder.blocks.processed",
-	"decoder.crc.good",
-	"decoder.crc.bad",
-	"decoder.errors.bitstream",
-	"decoder.errors.data_truncated",
-	"decoder.errors.deinterleave_data",
-	"decoder.errors.deinterleave_fec",
-	"decoder.errors.fec_bad",
-	"decoder.errors.fec_truncated",
-	"decoder.errors.no_fec",
-	"decoder.errors.no_header",
-	"decoder.errors.too_long",
-	"decoder.errors.truncated_octets",
-	"decoder.errors.unstuff",
-	"decoder.msg.good",
-	"decoder.msg.good_loud",
-	"decoder.preambles.good",
-	"demod.sync.good",
-	NULL
-};
-
-static char const *counters_per_msgdir[] = {
-	"acars.reasm.unknown",
-	"acars.reasm.complete",
-	// "acars.reasm.in_progress",   // we report final reasm states only
-	"acars.reasm.skipped",
-	"acars.reasm.duplicate",
-	"acars.reasm.out_of_seq",
-	"acars.reasm.invalid_args",
-	"x25.reasm.unknown",
-	"x25.reasm.complete",
-	// "x25.reasm.in_progress",     // we report final reasm states only
-	"x25.reasm.skipped",
-	"x25.reasm.duplicate",
-	"x25.reasm.out_of_seq",
-	"x25.reasm.invalid_args",
-	NULL
-};
-
-static char const *msg_dir_labels[] = {
-	[LA_MSG_DIR_UNKNOWN] = "unknown",
-	[LA_MSG_DIR_AIR2GND] = "air2gnd",
-	[LA_MSG_DIR_GND2AIR] = "gnd2air"
-};
-
-int statsd_initialize(char *statsd_addr) {
+	sent.initialized = true;
+	statsd_packet_send();
+	debug_print(D_STATS, "flushed %d metrics in %d packets\n", packet.metric_cnt, packet.packet_cnt);
+	pthread_mutex_unlock(&statsd_flush_mutex);
+}
+
+static void *statsd_flush_thread(void *ctx) {
+	UNUSED(ctx);
+	while(!do_exit) {
+		// Wake up every second to check do_exit
+		for(int i = 0; i < statsd_interval && !do_exit; i++) {
+			sleep(1);
+		}
+		statsd_flush();
+	}
+	return NULL;
+}
+
+int statsd_initialize(char *statsd_addr, int interval) {
 	char *addr;
 	char *port;
 
@@ -112,92 +228,16 @@ int statsd_initialize(char *statsd_addr) {
 	if(statsd == NULL) {
 		return -2;
 	}
+	statsd_interval = interval;
+	start_thread(&statsd_thread, statsd_flush_thread, NULL);
 	return 0;
 }
 
-void statsd_initialize_counters_per_channel(uint32_t freq) {
-	if(statsd == NULL) {
-		return;
-	}
-	char metric[256];
-	for(int n = 0; counters_per_channel[n] != NULL; n++) {
-		snprintf(metric, sizeof(metric), "%u.%s", freq, counters_per_channel[n]);
-		statsd_count(statsd, metric, 0, 1.0);
-	}
-}
-
-static void _statsd_initialize_counters_for_msg_dir(char const *counters[], la_msg_dir msg_dir) {
-	char metric[256];
-	for(int n = 0; counters[n] != NULL; n++) {
-		snprintf(metric, sizeof(metric), "%s.%s", counters[n], msg_dir_labels[msg_dir]);
-		statsd_count(statsd, metric, 0, 1.0);
-	}
-}
-
-void statsd_initialize_counters_per_msgdir() {
-	if(statsd == NULL) {
-		return;
-	}
-	_statsd_initialize_counters_for_msg_dir(counters_per_msgdir, LA_MSG_DIR_AIR2GND);
-	_statsd_initialize_counters_for_msg_dir(counters_per_msgdir, LA_MSG_DIR_GND2AIR);
-}
-
-void statsd_initialize_counter_set(char **counter_set) {
-	if(statsd == NULL) {
-		return;
-	}
-	for(int n = 0; counter_set[n] != NULL; n++) {
-		statsd_count(statsd, counter_set[n], 0, 1.0);
-	}
-}
-
-void statsd_counter_per_channel_increment(uint32_t freq, char *counter) {
-	if(statsd == NULL) {
-		return;
-	}
-	char metric[256];
-	snprintf(metric, sizeof(metric), "%d.%s", freq, counter);
-	statsd_inc(statsd, metric, 1.0);
-}
-
-void statsd_counter_per_msgdir_increment(la_msg_dir msg_dir, char *counter) {
-	if(statsd == NULL) {
-		return;
-	}
-	char metric[256];
-	snprintf(metric, sizeof(metric), "%s.%s", counter, msg_dir_labels[msg_dir]);
-	statsd_inc(statsd, metric, 1.0);
-}
-
-void statsd_counter_increment(char *counter) {
-	if(statsd == NULL) {
-		return;
-	}
-	statsd_inc(statsd, counter, 1.0);
-}
-
-void statsd_gauge_set(char *gauge, size_t value) {
+// Sends out whatever has been accumulated since the last flush.
+// Called on program exit.
+void statsd_shutdown() {
 	if(statsd == NULL) {
 		return;
 	}
-	statsd_gauge(statsd, gauge, value);
-}
-
-void statsd_timing_delta_per_channel_send(uint32_t freq, char *timer, struct timeval ts) {
-	if(statsd == NULL) {
-		return;
-	}
-	char metric[256];
-	struct timeval te;
-	uint32_t tdiff;
-	gettimeofday(&te, NULL);
-	if(te.tv_sec < ts.tv_sec || (te.tv_sec == ts.tv_sec && te.tv_usec < ts.tv_usec)) {
-		debug_print(D_STATS, "timediff is negative: ts.tv_sec=%lu ts.tv_usec=%lu te.tv_sec=%lu te.tv_usec=%lu\n",
-				ts.tv_sec, ts.tv_usec, te.tv_sec, te.tv_usec);
-		return;
-	}
-	tdiff = ((te.tv_sec - ts.tv_sec) * 1000000UL + te.tv_usec - ts.tv_usec) / 1000;
-	debug_print(D_STATS, "tdiff: %u ms\n", tdiff);
-	snprintf(metric, sizeof(metric), "%d.%s", freq, timer);
-	statsd_timing(statsd, metric, tdiff);
+	statsd_flush();
 }
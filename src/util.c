@@ -27,8 +27,33 @@
 #include <libacars/vstring.h>       // la_vstring, la_isprintf_multiline_text()
 #include <libacars/dict.h>          // la_dict
 #include "dumpvdl2.h"
+#include "bench.h"                  // bench_alloc_add
+#ifdef WITH_ALLOC_STATS
+#include "alloc-stats.h"            // alloc_stats_add, alloc_stats_remove
+#endif
 #include "libacars/json.h"
 
+// Program-wide state, shared by dumpvdl2 and dumpvdl2-bench
+int do_exit = 0;
+dumpvdl2_config_t Config;
+
+void start_thread(pthread_t *pth, void *(*start_routine)(void *), void *thread_ctx) {
+	int ret;
+	if((ret = pthread_create(pth, NULL, start_routine, thread_ctx) != 0)) {
+		errno = ret;
+		perror("pthread_create failed");
+		_exit(2);
+	}
+}
+
+void describe_option(char const *name, char const *description, int indent) {
+	int descr_shiftwidth = USAGE_OPT_NAME_COLWIDTH - (int)strlen(name) - indent * USAGE_INDENT_STEP;
+	if(descr_shiftwidth < 1) {
+		descr_shiftwidth = 1;
+	}
+	fprintf(stderr, "%*s%s%*s%s\n", IND(indent), "", name, descr_shiftwidth, "", description);
+}
+
 void *xcalloc(size_t nmemb, size_t size, char const *file, int line, char const *func) {
 	void *ptr = calloc(nmemb, size);
 	if(ptr == NULL) {
@@ -36,16 +61,29 @@ void *xcalloc(size_t nmemb, size_t size, char const *file, int line, char const
 				file, line, func, nmemb, size, strerror(errno));
 		_exit(1);
 	}
+	bench_alloc_add(nmemb * size);
+#ifdef WITH_ALLOC_STATS
+	alloc_stats_add(ptr, nmemb * size, file, line, func);
+#endif
 	return ptr;
 }
 
 void *xrealloc(void *ptr, size_t size, char const *file, int line, char const *func) {
+#ifdef WITH_ALLOC_STATS
+	// realloc() releases the old block without calling free(), so
+	// unregister it here. The new one is accounted to this call site.
+	alloc_stats_remove(ptr);
+#endif
 	ptr = realloc(ptr, size);
 	if(ptr == NULL) {
 		fprintf(stderr, "%s:%d: %s(): realloc(%zu) failed: %s\n",
 				file, line, func, size, strerror(errno));
 		_exit(1);
 	}
+	bench_alloc_add(size);
+#ifdef WITH_ALLOC_STATS
+	alloc_stats_add(ptr, size, file, line, func);
+#endif
 	return ptr;
 }
 
@@ -28,11 +28,13 @@
 #include <libacars/json.h>
 #include "config.h"                 // IS_BIG_ENDIAN
 #include "dumpvdl2.h"
+#include "bench.h"                  // bench_layer_*
 #include "x25.h"
 #include "reassembly.h"             // reasm_contexts
 #include "clnp.h"
 #include "esis.h"
 #include "tlv.h"
+#include "metrics.h"                // metrics_inc_per_msgdir
 
 /***************************************************************************
  * Packet reassembly types and callbacks
@@ -87,24 +89,18 @@ static struct timeval x25_reasm_timeout = {
 	.tv_usec = 0
 };
 
-void update_statsd_x25_metrics(la_reasm_status reasm_status, uint32_t msg_type) {
-	static la_dict const reasm_status_counter_names[] = {
-		{ .id = LA_REASM_UNKNOWN, .val = "x25.reasm.unknown" },
-		{ .id = LA_REASM_COMPLETE, .val = "x25.reasm.complete" },
-		// { .id = LA_REASM_IN_PROGRESS, .val = "x25.reasm.in_progress" },  // report final states only
-		{ .id = LA_REASM_SKIPPED, .val = "x25.reasm.skipped" },
-		{ .id = LA_REASM_DUPLICATE, .val = "x25.reasm.duplicate" },
-		{ .id = LA_REASM_FRAG_OUT_OF_SEQUENCE, .val = "x25.reasm.out_of_seq" },
-		{ .id = LA_REASM_ARGS_INVALID, .val = "x25.reasm.invalid_args" },
-		{ .id = 0, .val = NULL }
-	};
-	char const *metric = la_dict_search(reasm_status_counter_names, reasm_status);
-	if(metric == NULL) {
-		return;
+static void update_x25_metrics(la_reasm_status reasm_status, uint32_t msg_type) {
+	metrics_msgdir_counter id;
+	switch(reasm_status) {
+		case LA_REASM_UNKNOWN:                  id = MD_X25_REASM_UNKNOWN; break;
+		case LA_REASM_COMPLETE:                 id = MD_X25_REASM_COMPLETE; break;
+		case LA_REASM_SKIPPED:                  id = MD_X25_REASM_SKIPPED; break;
+		case LA_REASM_DUPLICATE:                id = MD_X25_REASM_DUPLICATE; break;
+		case LA_REASM_FRAG_OUT_OF_SEQUENCE:     id = MD_X25_REASM_OUT_OF_SEQ; break;
+		case LA_REASM_ARGS_INVALID:             id = MD_X25_REASM_INVALID_ARGS; break;
+		default:                                return;     // report final states only
 	}
-	statsd_increment_per_msgdir(msg_type & MSGFLT_SRC_AIR ? LA_MSG_DIR_AIR2GND : LA_MSG_DIR_GND2AIR, (char *)metric);
-	// In case USE_STATSD is disabled
-	UNUSED(msg_type);
+	metrics_inc_per_msgdir(msg_type & MSGFLT_SRC_AIR ? LA_MSG_DIR_AIR2GND : LA_MSG_DIR_GND2AIR, id);
 }
 
 /***************************************************************************
@@ -438,7 +434,7 @@ la_type_descriptor const proto_DEF_X25_SNDCF_error_report = {
 // Forward declaration
 la_type_descriptor const proto_DEF_X25_pkt;
 
-static char *fmt_x25_addr(uint8_t const *data, uint8_t len) {
+char *fmt_x25_addr(uint8_t const *data, uint8_t len) {
 	// len is in nibbles here
 	static char const hex[] = "0123456789abcdef";
 	char *buf = NULL;
@@ -581,6 +577,7 @@ static la_proto_node *parse_x25_user_data(uint8_t *buf, uint32_t len, uint32_t *
 
 la_proto_node *x25_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type,
 		reasm_contexts *rtables, struct timeval rx_time, uint32_t src_addr, uint32_t dst_addr) {
+	uint64_t t = bench_layer_start(BENCH_LAYER_X25, BENCH_OP_PARSE);
 	NEW(x25_pkt_t, pkt);
 	la_proto_node *node = la_proto_node_new();
 	node->td = &proto_DEF_X25_pkt;
@@ -689,7 +686,7 @@ la_proto_node *x25_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type,
 							Config.decode_fragments == false) {
 						decode_user_data = false;
 					}
-					update_statsd_x25_metrics(pkt->reasm_status, *msg_type);
+					update_x25_metrics(pkt->reasm_status, *msg_type);
 				}
 				node->next = decode_user_data == true ?
 					parse_x25_user_data(x25_data, x25_data_len, msg_type,
@@ -742,9 +739,11 @@ la_proto_node *x25_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type,
 	}
 	pkt->hdr = hdr;
 	pkt->err = false;
+	bench_layer_end(t);
 	return node;
 fail:
 	node->next = unknown_proto_pdu_new(buf, len);
+	bench_layer_end(t);
 	return node;
 }
 
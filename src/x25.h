@@ -114,6 +114,8 @@ typedef struct {
 } x25_pkt_t;
 
 // x25.c
+extern la_type_descriptor const proto_DEF_X25_pkt;
+char *fmt_x25_addr(uint8_t const *data, uint8_t len);
 la_proto_node *x25_parse(uint8_t *buf, uint32_t len, uint32_t *msg_type,
 		reasm_contexts *rtables, struct timeval rx_time, uint32_t src_addr, uint32_t dst_addr);
 #endif // !_X25_H
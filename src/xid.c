@@ -26,6 +26,7 @@
 #include <libacars/json.h>
 #include "config.h"                 // IS_BIG_ENDIAN
 #include "dumpvdl2.h"               // la_dict_search()
+#include "bench.h"                  // bench_layer_*
 #include "tlv.h"
 #include "avlc.h"                   // avlc_addr_t
 #include "xid.h"
@@ -1023,6 +1024,7 @@ static la_dict const xid_vdl_params[] = {
  **************************************************************************/
 
 la_proto_node *xid_parse(uint8_t cr, uint8_t pf, uint8_t *buf, uint32_t len, uint32_t *msg_type) {
+	uint64_t t = bench_layer_start(BENCH_LAYER_XID, BENCH_OP_PARSE);
 	NEW(xid_msg_t, msg);
 	la_proto_node *node = la_proto_node_new();
 	node->td = &proto_DEF_XID_msg;
@@ -1095,9 +1097,11 @@ la_proto_node *xid_parse(uint8_t cr, uint8_t pf, uint8_t *buf, uint32_t len, uin
 		*msg_type |= MSGFLT_XID_NO_GSIF;
 	}
 	msg->err = false;
+	bench_layer_end(t);
 	return node;
 end:
 	node->next = unknown_proto_pdu_new(buf, len);
+	bench_layer_end(t);
 	return node;
 }
 
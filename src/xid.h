@@ -41,4 +41,5 @@ typedef struct {
 } xid_msg_t;
 
 // xid.c
+extern la_type_descriptor const proto_DEF_XID_msg;
 la_proto_node *xid_parse(uint8_t cr, uint8_t pf, uint8_t *buf, uint32_t len, uint32_t *msg_type);